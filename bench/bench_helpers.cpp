@@ -0,0 +1,353 @@
+// Copyright 2026 The Kyua Authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// * Neither the name of Google Inc. nor the names of its contributors
+//   may be used to endorse or promote products derived from this software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/// \file bench/bench_helpers.cpp
+/// Synthetic test program to benchmark the orchestration overhead of Kyua.
+///
+/// This program mimics a test program of any of the supported interfaces and
+/// does as little work as possible on its own so that the cost of running it
+/// is dominated by Kyua.  Its behavior is selected by its basename, which has
+/// the form INTERFACE-SCENARIO-COUNT[-SUFFIX]:
+///
+/// * INTERFACE is one of atf, googletest, plain or tap and determines the
+///   protocol the program speaks.
+/// * SCENARIO is one of pass, output, cleanup or deep_workdir and determines
+///   what each test case does.  See the scenario_* functions below.
+/// * COUNT is the number of test cases the program exposes.  It must be 1 for
+///   the plain and tap interfaces, which only support one test case per
+///   program.
+/// * SUFFIX is ignored and can be used to give unique names to several copies
+///   of the same program.
+///
+/// Just like the helpers in the engine module, the different variants are
+/// expected to be created as hard or symbolic links to this binary.
+
+extern "C" {
+#include <sys/stat.h>
+
+#include <unistd.h>
+}
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+
+/// Amount of data written to each of stdout and stderr by the output scenario.
+static const std::size_t output_bytes = 1024 * 1024;
+
+
+/// Depth of the directory tree created by the deep_workdir scenario.
+static const int workdir_depth = 32;
+
+
+/// Name of the test suite used by the googletest interface.
+static const char* const googletest_suite = "Bench";
+
+
+/// Configuration of the program, as derived from its name.
+struct program_config {
+    /// The interface to mimic.
+    std::string interface;
+
+    /// The scenario to run.
+    std::string scenario;
+
+    /// Number of test cases exposed by the program.
+    int count;
+};
+
+
+/// Prints an error and terminates the program.
+///
+/// \param message The error message.
+static void
+fail(const std::string& message)
+{
+    std::cerr << "bench_helpers: " << message << '\n';
+    std::exit(EXIT_FAILURE);
+}
+
+
+/// Splits a string on a delimiter.
+///
+/// \param str The string to split.
+/// \param delimiter The separator between fields.
+///
+/// \return The fields of the string.
+static std::vector< std::string >
+split(const std::string& str, const char delimiter)
+{
+    std::vector< std::string > fields;
+    std::istringstream input(str);
+    std::string field;
+    while (std::getline(input, field, delimiter))
+        fields.push_back(field);
+    return fields;
+}
+
+
+/// Parses the configuration of the program from its name.
+///
+/// \param arg0 The value of argv[0].
+///
+/// \return The program configuration.
+static program_config
+parse_config(const char* arg0)
+{
+    const char* basename = std::strrchr(arg0, '/');
+    basename = (basename == NULL) ? arg0 : basename + 1;
+
+    const std::vector< std::string > fields = split(basename, '-');
+    if (fields.size() < 3)
+        fail(std::string("Invalid program name ") + basename);
+
+    program_config config;
+    config.interface = fields[0];
+    config.scenario = fields[1];
+    config.count = std::atoi(fields[2].c_str());
+    if (config.count < 1)
+        fail("The number of test cases must be positive");
+    if ((config.interface == "plain" || config.interface == "tap") &&
+        config.count != 1)
+        fail("The plain and tap interfaces only support one test case");
+    return config;
+}
+
+
+/// Computes the name of a test case.
+///
+/// \param index The index of the test case.
+///
+/// \return The name of the test case.
+static std::string
+test_case_name(const int index)
+{
+    std::ostringstream name;
+    name << "tc" << index;
+    return name.str();
+}
+
+
+/// Scenario that writes a large amount of data to stdout and stderr.
+static void
+scenario_output(void)
+{
+    const std::string line(79, 'x');
+    for (std::size_t i = 0; i < output_bytes; i += line.length() + 1) {
+        std::cout << line << '\n';
+        std::cerr << line << '\n';
+    }
+    std::cout.flush();
+    std::cerr.flush();
+}
+
+
+/// Scenario that creates a deep directory tree in the work directory.
+///
+/// Every level contains a small file so that the cleanup of the work
+/// directory has to deal with both files and directories.
+static void
+scenario_deep_workdir(void)
+{
+    std::string path = ".";
+    for (int i = 0; i < workdir_depth; ++i) {
+        path += "/d";
+        if (::mkdir(path.c_str(), 0755) == -1)
+            fail("Failed to create " + path);
+        std::ofstream file((path + "/file").c_str());
+        if (!file)
+            fail("Failed to create " + path + "/file");
+        file << "some contents\n";
+    }
+}
+
+
+/// Runs the body of a test case.
+///
+/// \param config The program configuration.
+static void
+run_body(const program_config& config)
+{
+    if (config.scenario == "output")
+        scenario_output();
+    else if (config.scenario == "deep_workdir")
+        scenario_deep_workdir();
+    else if (config.scenario != "pass" && config.scenario != "cleanup")
+        fail("Unknown scenario " + config.scenario);
+}
+
+
+/// Implements the atf interface.
+///
+/// \param config The program configuration.
+/// \param argc The number of CLI arguments.
+/// \param argv The CLI arguments.
+///
+/// \return The exit code of the program.
+static int
+main_atf(const program_config& config, const int argc, char* const* argv)
+{
+    bool list = false;
+    std::string result_file;
+    std::string test_case;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "-l")
+            list = true;
+        else if (arg.compare(0, 2, "-r") == 0)
+            result_file = arg.substr(2);
+        else if (arg.compare(0, 2, "-s") == 0 || arg.compare(0, 2, "-v") == 0)
+            continue;
+        else
+            test_case = arg;
+    }
+
+    if (list) {
+        std::cout << "Content-Type: application/X-atf-tp; version=\"1\"\n";
+        for (int i = 0; i < config.count; ++i) {
+            std::cout << "\nident: " << test_case_name(i) << '\n';
+            if (config.scenario == "cleanup")
+                std::cout << "has.cleanup: true\n";
+        }
+        return EXIT_SUCCESS;
+    }
+
+    if (test_case.empty())
+        fail("No test case specified");
+    const std::string cleanup_suffix = ":cleanup";
+    if (test_case.length() > cleanup_suffix.length() &&
+        test_case.compare(test_case.length() - cleanup_suffix.length(),
+                          cleanup_suffix.length(), cleanup_suffix) == 0)
+        return EXIT_SUCCESS;
+
+    run_body(config);
+    if (!result_file.empty()) {
+        std::ofstream output(result_file.c_str());
+        if (!output)
+            fail("Failed to create " + result_file);
+        output << "passed\n";
+    }
+    return EXIT_SUCCESS;
+}
+
+
+/// Implements the googletest interface.
+///
+/// \param config The program configuration.
+/// \param argc The number of CLI arguments.
+/// \param argv The CLI arguments.
+///
+/// \return The exit code of the program.
+static int
+main_googletest(const program_config& config, const int argc,
+                char* const* argv)
+{
+    const std::string filter_flag = "--gtest_filter=";
+    std::string filter;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--gtest_list_tests") {
+            std::cout << googletest_suite << ".\n";
+            for (int j = 0; j < config.count; ++j)
+                std::cout << "  " << test_case_name(j) << '\n';
+            return EXIT_SUCCESS;
+        } else if (arg.compare(0, filter_flag.length(), filter_flag) == 0) {
+            filter = arg.substr(filter_flag.length());
+        }
+    }
+    if (filter.empty())
+        fail("No test case specified");
+
+    std::cout << "[ RUN      ] " << filter << '\n';
+    run_body(config);
+    std::cout << "[       OK ] " << filter << " (0 ms)\n";
+    return EXIT_SUCCESS;
+}
+
+
+/// Implements the plain interface.
+///
+/// \param config The program configuration.
+///
+/// \return The exit code of the program.
+static int
+main_plain(const program_config& config)
+{
+    run_body(config);
+    return EXIT_SUCCESS;
+}
+
+
+/// Implements the tap interface.
+///
+/// \param config The program configuration.
+///
+/// \return The exit code of the program.
+static int
+main_tap(const program_config& config)
+{
+    std::cout << "1..1\n";
+    run_body(config);
+    std::cout << "ok 1 - " << config.scenario << '\n';
+    return EXIT_SUCCESS;
+}
+
+
+}  // anonymous namespace
+
+
+/// Entry point to the test program.
+///
+/// \param argc The number of CLI arguments.
+/// \param argv The CLI arguments themselves.
+///
+/// \return The exit code of the program.
+int
+main(int argc, char** argv)
+{
+    const program_config config = parse_config(argv[0]);
+    if (config.interface == "atf")
+        return main_atf(config, argc, argv);
+    else if (config.interface == "googletest")
+        return main_googletest(config, argc, argv);
+    else if (config.interface == "plain")
+        return main_plain(config);
+    else if (config.interface == "tap")
+        return main_tap(config);
+    else
+        fail("Unknown interface " + config.interface);
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,153 @@
+// Copyright 2026 The Kyua Authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// * Neither the name of Google Inc. nor the names of its contributors
+//   may be used to endorse or promote products derived from this software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/// \file bench/format_bench.cpp
+/// Microbenchmarks of the string formatter.
+///
+/// This program formats a few strings representative of what Kyua formats in
+/// its hot paths, such as log lines and work directory paths, many times in a
+/// row and prints how long each of them took.  The timings depend on the
+/// machine, so nothing is asserted about them; they are only meant to be
+/// compared across changes to utils::format.
+///
+/// The number of iterations can be given as the only argument.
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "utils/datetime.hpp"
+#include "utils/format/macros.hpp"
+
+namespace datetime = utils::datetime;
+
+
+namespace {
+
+
+/// Default number of iterations to run for every benchmark.
+static const int default_iterations = 100000;
+
+
+/// Formats a log line as written by utils::logging.
+///
+/// \return The formatted string.
+static std::string
+format_log_line(void)
+{
+    return (F("%s %s %s %s:%s: %s") % "20110221-183000" % 'D' % 1234 %
+            "file.cpp" % 56 % std::string("message")).str();
+}
+
+
+/// Formats a path to a work directory.
+///
+/// \return The formatted string.
+static std::string
+format_path(void)
+{
+    return (F("%s/%s/%s") % "/tmp/kyua.XXXX" % 12345U % "work").str();
+}
+
+
+/// Formats values with width and precision modifiers.
+///
+/// \return The formatted string.
+static std::string
+format_modifiers(void)
+{
+    return (F("%05s %.3s %s") % 42 % 3.14159 % true).str();
+}
+
+
+/// Runs a formatting operation repeatedly and reports its cost.
+///
+/// \param name The name of the benchmark, for reporting purposes.
+/// \param expected The string that every iteration must produce.
+/// \param hook The operation to benchmark.
+/// \param iterations Number of times to run the operation.
+///
+/// \return True if the operation produced the expected string; false
+/// otherwise.
+static bool
+run_benchmark(const char* name, const std::string& expected,
+              std::string (*hook)(void), const int iterations)
+{
+    const datetime::timestamp start = datetime::timestamp::now();
+    std::size_t length = 0;
+    for (int i = 0; i < iterations; i++)
+        length += hook().length();
+    const datetime::timestamp end = datetime::timestamp::now();
+
+    if (hook() != expected ||
+        length != expected.length() * static_cast< std::size_t >(iterations)) {
+        std::cerr << F("%s: unexpected result '%s'\n") % name % hook();
+        return false;
+    }
+
+    const int64_t elapsed = (end - start).to_microseconds();
+    std::cout << F("%s: %s iterations in %sus (%.3s us/iteration)\n") %
+        name % iterations % elapsed %
+        (static_cast< double >(elapsed) / iterations);
+    return true;
+}
+
+
+}  // anonymous namespace
+
+
+/// Entry point to the benchmark.
+///
+/// \param argc The number of CLI arguments.
+/// \param argv The CLI arguments themselves.
+///
+/// \return The exit code of the program.
+int
+main(int argc, char** argv)
+{
+    if (argc > 2) {
+        std::cerr << "Usage: format_bench [iterations]\n";
+        return EXIT_FAILURE;
+    }
+    const int iterations = argc == 2 ? std::atoi(argv[1]) : default_iterations;
+    if (iterations <= 0) {
+        std::cerr << "The number of iterations must be positive\n";
+        return EXIT_FAILURE;
+    }
+
+    bool ok = true;
+    ok &= run_benchmark("log_line",
+                        "20110221-183000 D 1234 file.cpp:56: message",
+                        format_log_line, iterations);
+    ok &= run_benchmark("path", "/tmp/kyua.XXXX/12345/work", format_path,
+                        iterations);
+    ok &= run_benchmark("modifiers", "00042 3.142 true", format_modifiers,
+                        iterations);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,196 @@
+#! /bin/sh
+# Copyright 2026 The Kyua Authors.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are
+# met:
+#
+# * Redistributions of source code must retain the above copyright
+#   notice, this list of conditions and the following disclaimer.
+# * Redistributions in binary form must reproduce the above copyright
+#   notice, this list of conditions and the following disclaimer in the
+#   documentation and/or other materials provided with the distribution.
+# * Neither the name of Google Inc. nor the names of its contributors
+#   may be used to endorse or promote products derived from this software
+#   without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+# "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+# A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+# OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+# LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+# DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+# THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+# \file bench/run_bench.sh
+# Measures the orchestration overhead of Kyua with synthetic test suites.
+#
+# For every combination of test interface, scenario and parallelism level,
+# this script generates a test suite made of links to the bench_helpers
+# program, runs it with "kyua test" and extracts the timings from the
+# resulting results file.  The results are printed to stdout as CSV, one row
+# per run, with the following columns:
+#
+# * interface, scenario, parallelism: the parameters of the run.
+# * tests: the number of test cases that ran.
+# * wall_seconds: time from the start of the first phase of the run (usually
+#   the listing of the first test program) to the end of the last one.
+# * tests_per_second: tests divided by wall_seconds.
+# * mean_test_seconds: average time spent running each test case.
+# * overhead_per_test_seconds: wall-clock time consumed by each test case
+#   once its own run time is discounted, taking into account that up to
+#   "parallelism" tests run at once.
+
+set -e
+
+Prog_Name="${0##*/}"
+
+# Number of test cases exposed by each atf and googletest program.
+CASES_PER_PROGRAM=10
+
+
+# Prints an error message and exits.
+#
+# \param ... The message to print.
+err() {
+    echo "${Prog_Name}: ${*}" 1>&2
+    exit 1
+}
+
+
+# Prints usage information and exits.
+usage() {
+    cat 1>&2 <<EOF
+Usage: ${Prog_Name} -h helper [-i interfaces] [-j levels] [-k kyua] [-n tests]
+    [-s scenarios]
+EOF
+    exit 1
+}
+
+
+# Generates a test suite in the current directory.
+#
+# \param helper Absolute path to the bench_helpers binary.
+# \param interface The interface of the test programs to generate.
+# \param scenario The scenario to run in each test case.
+# \param tests The total number of test cases to generate.
+generate_suite() {
+    local helper="${1}"; shift
+    local interface="${1}"; shift
+    local scenario="${1}"; shift
+    local tests="${1}"; shift
+
+    local per_program
+    case "${interface}" in
+        atf|googletest) per_program="${CASES_PER_PROGRAM}" ;;
+        *) per_program=1 ;;
+    esac
+
+    printf 'syntax(2)\ntest_suite("bench")\n' >Kyuafile
+    local remaining="${tests}" i=0
+    while [ "${remaining}" -gt 0 ]; do
+        local count="${per_program}"
+        [ "${remaining}" -ge "${count}" ] || count="${remaining}"
+        local name="${interface}-${scenario}-${count}-${i}"
+        ln -s "${helper}" "${name}"
+        echo "${interface}_test_program{name=\"${name}\"}" >>Kyuafile
+        remaining=$((remaining - count))
+        i=$((i + 1))
+    done
+}
+
+
+# Runs a single benchmark and prints its results as a CSV row.
+#
+# \param kyua Path to the kyua binary to benchmark.
+# \param helper Absolute path to the bench_helpers binary.
+# \param interface The interface of the test programs to generate.
+# \param scenario The scenario to run in each test case.
+# \param tests The total number of test cases to generate.
+# \param parallelism The value of the parallelism setting to use.
+run_one() {
+    local kyua="${1}"; shift
+    local helper="${1}"; shift
+    local interface="${1}"; shift
+    local scenario="${1}"; shift
+    local tests="${1}"; shift
+    local parallelism="${1}"; shift
+
+    local dir
+    dir="$(mktemp -d "${TMPDIR:-/tmp}/kyua-bench.XXXXXX")"
+    (
+        cd "${dir}"
+        generate_suite "${helper}" "${interface}" "${scenario}" "${tests}"
+        "${kyua}" -v parallelism="${parallelism}" test \
+            --results-file=results.db >/dev/null \
+            || err "kyua test failed for ${interface}/${scenario}"
+        "${kyua}" db-exec --no-headers --results-file=results.db \
+            "SELECT (SELECT COUNT(*) FROM test_results)," \
+            "(SELECT MAX(end_time) - MIN(start_time) FROM phases)," \
+            "(SELECT SUM(end_time - start_time) FROM test_results)"
+    ) | awk -F, -v interface="${interface}" -v scenario="${scenario}" \
+        -v parallelism="${parallelism}" '{
+        tests = $1; wall = $2 / 1000000.0; busy = $3 / 1000000.0;
+        slots = (parallelism < tests) ? parallelism : tests;
+        printf "%s,%s,%d,%d,%.6f,%.3f,%.6f,%.6f\n", interface, scenario,
+            parallelism, tests, wall, (wall > 0) ? tests / wall : 0,
+            busy / tests, (wall * slots - busy) / tests;
+    }'
+    rm -rf "${dir}"
+}
+
+
+main() {
+    local helper= kyua=kyua tests=100
+    local interfaces="atf googletest plain tap"
+    local levels="1 2 4 8"
+    local scenarios="pass output cleanup deep_workdir"
+
+    while getopts ':h:i:j:k:n:s:' arg "${@}"; do
+        case "${arg}" in
+            h) helper="${OPTARG}" ;;
+            i) interfaces="${OPTARG}" ;;
+            j) levels="${OPTARG}" ;;
+            k) kyua="${OPTARG}" ;;
+            n) tests="${OPTARG}" ;;
+            s) scenarios="${OPTARG}" ;;
+            \?) usage ;;
+        esac
+    done
+    shift $((OPTIND - 1))
+    [ ${#} -eq 0 ] || usage
+    [ -n "${helper}" ] || usage
+
+    case "${helper}" in
+        /*) ;;
+        *) helper="$(pwd)/${helper}" ;;
+    esac
+    [ -x "${helper}" ] || err "Cannot find helper ${helper}"
+    case "${kyua}" in
+        */*) kyua="$(cd "${kyua%/*}" && pwd)/${kyua##*/}" ;;
+    esac
+
+    echo "interface,scenario,parallelism,tests,wall_seconds," \
+        "tests_per_second,mean_test_seconds,overhead_per_test_seconds" \
+        | tr -d ' '
+    for interface in ${interfaces}; do
+        for scenario in ${scenarios}; do
+            # Only the atf interface supports cleanup routines.
+            if [ "${scenario}" = cleanup -a "${interface}" != atf ]; then
+                continue
+            fi
+            for parallelism in ${levels}; do
+                run_one "${kyua}" "${helper}" "${interface}" "${scenario}" \
+                    "${tests}" "${parallelism}"
+            done
+        done
+    done
+}
+
+
+main "${@}"
@@ -34,6 +34,7 @@
 #include <map>
 #include <ostream>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "cli/common.ipp"
@@ -55,6 +56,7 @@
 #include "utils/format/macros.hpp"
 #include "utils/fs/path.hpp"
 #include "utils/optional.ipp"
+#include "utils/process/resource_usage.hpp"
 #include "utils/sanity.hpp"
 #include "utils/stream.hpp"
 #include "utils/text/operations.ipp"
@@ -97,6 +99,9 @@ class report_console_hooks : public drivers::scan_results::base_hooks {
     /// from _start_time to compute this due to parallel execution.
     utils::datetime::delta _runtime;
 
+    /// The number of results that were served from the result cache.
+    std::size_t _cached;
+
     /// Representation of a single result.
     struct result_data {
         /// The relative path to the test program.
@@ -133,6 +138,12 @@ class report_console_hooks : public drivers::scan_results::base_hooks {
     /// memory may be too much.
     std::map< model::test_result_type, std::vector< result_data > > _results;
 
+    /// Results that were only good after retrying the test.
+    ///
+    /// These are kept apart from the other results so that they are reported
+    /// separately even though the tests eventually passed.
+    std::vector< result_data > _flaky;
+
     /// Pretty-prints the value of an environment variable.
     ///
     /// \param indent Prefix for the lines to print.  Continuation lines
@@ -200,6 +211,25 @@ class report_console_hooks : public drivers::scan_results::base_hooks {
         _output << F("Duration:   %s\n") %
             cli::format_delta(result_iter.end_time() -
                               result_iter.start_time());
+        const optional< std::pair< int, int > > repetitions =
+            result_iter.repetitions();
+        if (repetitions) {
+            _output << F("Runs:       %s (%s failed)\n") %
+                repetitions.get().first % repetitions.get().second;
+        }
+
+        const std::vector< model::test_result > attempts =
+            result_iter.previous_attempts();
+        if (!attempts.empty()) {
+            _output << "\n";
+            _output << (repetitions ? "Other failed runs:\n" :
+                        "Previous attempts:\n");
+            for (std::vector< model::test_result >::size_type i = 0;
+                 i < attempts.size(); ++i) {
+                _output << F("    %s: %s\n") % (i + 1) %
+                    cli::format_result(attempts[i]);
+            }
+        }
 
         _output << "\n";
         _output << "Metadata:\n";
@@ -212,6 +242,26 @@ class report_console_hooks : public drivers::scan_results::base_hooks {
             }
         }
 
+        const std::map< std::string, utils::process::resource_usage > usages =
+            result_iter.resource_usages();
+        for (std::map< std::string, utils::process::resource_usage >::
+                 const_iterator iter = usages.begin(); iter != usages.end();
+             ++iter) {
+            const utils::process::resource_usage& usage = (*iter).second;
+            _output << "\n";
+            _output << F("Resource usage (%s):\n") % (*iter).first;
+            _output << F("    user_time = %s\n") %
+                cli::format_delta(usage.user_time);
+            _output << F("    system_time = %s\n") %
+                cli::format_delta(usage.system_time);
+            _output << F("    max_rss = %s\n") % usage.max_rss;
+            _output << F("    block_input = %s\n") % usage.block_input;
+            _output << F("    block_output = %s\n") % usage.block_output;
+            _output << F("    voluntary_ctxsw = %s\n") % usage.voluntary_ctxsw;
+            _output << F("    involuntary_ctxsw = %s\n") %
+                usage.involuntary_ctxsw;
+        }
+
         const std::string stdout_contents = result_iter.stdout_contents();
         if (!stdout_contents.empty()) {
             _output << "\n"
@@ -259,6 +309,17 @@ class report_console_hooks : public drivers::scan_results::base_hooks {
             return;
         const std::vector< result_data >& all = (*iter2).second;
 
+        print_result_list(all, title);
+    }
+
+    /// Prints a list of results under a title.
+    ///
+    /// \param all The results to print.
+    /// \param title Title used when printing results.
+    void
+    print_result_list(const std::vector< result_data >& all,
+                      const char* title)
+    {
         _output << F("===> %s\n") % title;
         for (std::vector< result_data >::const_iterator iter = all.begin();
              iter != all.end(); iter++) {
@@ -283,7 +344,8 @@ public:
         _output(output_),
         _verbose(verbose_),
         _results_filters(results_filters_),
-        _results_file(results_file_)
+        _results_file(results_file_),
+        _cached(0)
     {
         PRE(!results_filters_.empty());
     }
@@ -312,10 +374,15 @@ public:
         const datetime::delta duration = iter.end_time() - iter.start_time();
 
         _runtime += duration;
+        if (iter.is_cached())
+            _cached++;
         const model::test_result result = iter.result();
-        _results[result.type()].push_back(
-            result_data(iter.test_program()->relative_path(),
-                        iter.test_case_name(), iter.result(), duration));
+        const result_data data(iter.test_program()->relative_path(),
+                               iter.test_case_name(), result, duration);
+        if (result.good() && !iter.previous_attempts().empty())
+            _flaky.push_back(data);
+        else
+            _results[result.type()].push_back(data);
 
         if (_verbose) {
             // TODO(jmmv): _results_filters is a list and is small enough for
@@ -349,19 +416,27 @@ public:
             print_results((*match).first, (*match).second);
         }
 
+        if (!_flaky.empty())
+            print_result_list(_flaky, "Flaky tests");
+
         const std::size_t broken = count_results(model::test_result_broken);
         const std::size_t failed = count_results(model::test_result_failed);
         const std::size_t passed = count_results(model::test_result_passed);
         const std::size_t skipped = count_results(model::test_result_skipped);
         const std::size_t xfail = count_results(
             model::test_result_expected_failure);
-        const std::size_t total = broken + failed + passed + skipped + xfail;
+        const std::size_t total = broken + failed + passed + skipped + xfail +
+            _flaky.size();
 
         _output << "===> Summary\n";
         _output << F("Results read from %s\n") % _results_file;
         _output << F("Test cases: %s total, %s skipped, %s expected failures, "
                      "%s broken, %s failed\n") %
             total % skipped % xfail % broken % failed;
+        if (_cached > 0)
+            _output << F("Cache hits: %s\n") % _cached;
+        if (!_flaky.empty())
+            _output << F("Flaky tests: %s\n") % _flaky.size();
         if (_verbose && _start_time) {
             INV(_end_time);
             _output << F("Start time: %s\n") %
@@ -31,8 +31,10 @@
 #include <algorithm>
 #include <cerrno>
 #include <cstdlib>
+#include <map>
 #include <set>
 #include <stdexcept>
+#include <vector>
 
 #include "cli/common.ipp"
 #include "drivers/scan_results.hpp"
@@ -54,6 +56,7 @@
 #include "utils/fs/operations.hpp"
 #include "utils/fs/path.hpp"
 #include "utils/optional.ipp"
+#include "utils/process/resource_usage.hpp"
 #include "utils/text/operations.hpp"
 #include "utils/text/templates.hpp"
 
@@ -167,8 +170,13 @@ class html_hooks : public drivers::scan_results::base_hooks {
     text::templates_def _summary_templates;
 
     /// Mapping of result types to the amount of tests with such result.
+    ///
+    /// Flaky tests are not accounted for here but in _flaky_count.
     std::map< model::test_result_type, std::size_t > _types_count;
 
+    /// The amount of tests that were only good after retrying them.
+    std::size_t _flaky_count;
+
     /// Generates a common set of templates for all of our files.
     ///
     /// \return A new templates object with common parameters.
@@ -185,6 +193,7 @@ class html_hooks : public drivers::scan_results::base_hooks {
     /// \param test_program The test program with the test case to be added.
     /// \param test_case_name Name of the test case.
     /// \param result The result of the test case.
+    /// \param flaky Whether the result was only good after retrying the test.
     /// \param has_detail If true, the result of the test case has not been
     ///     filtered and therefore there exists a separate file for the test
     ///     with all of its information.
@@ -192,9 +201,13 @@ class html_hooks : public drivers::scan_results::base_hooks {
     add_to_summary(const model::test_program& test_program,
                    const std::string& test_case_name,
                    const model::test_result& result,
+                   const bool flaky,
                    const bool has_detail)
     {
-        ++_types_count[result.type()];
+        if (flaky)
+            ++_flaky_count;
+        else
+            ++_types_count[result.type()];
 
         if (!has_detail)
             return;
@@ -227,6 +240,13 @@ class html_hooks : public drivers::scan_results::base_hooks {
             test_cases_file_vector = "skipped_test_cases_file";
             break;
         }
+
+        // Flaky tests are listed on their own, regardless of their result.
+        if (flaky) {
+            test_cases_vector = "flaky_test_cases";
+            test_cases_file_vector = "flaky_test_cases_file";
+        }
+
         INV(!test_cases_vector.empty());
         INV(!test_cases_file_vector.empty());
 
@@ -290,7 +310,8 @@ public:
         _ui(ui_),
         _directory(directory_),
         _results_filters(results_filters_),
-        _summary_templates(common_templates())
+        _summary_templates(common_templates()),
+        _flaky_count(0)
     {
         PRE(!results_filters_.empty());
 
@@ -305,6 +326,8 @@ public:
         _summary_templates.add_vector("passed_test_cases_file");
         _summary_templates.add_vector("skipped_test_cases");
         _summary_templates.add_vector("skipped_test_cases_file");
+        _summary_templates.add_vector("flaky_test_cases");
+        _summary_templates.add_vector("flaky_test_cases_file");
     }
 
     /// Callback executed when the context is loaded.
@@ -328,14 +351,20 @@ public:
         const model::test_program_ptr test_program = iter.test_program();
         const std::string& test_case_name = iter.test_case_name();
         const model::test_result result = iter.result();
-
-        if (std::find(_results_filters.begin(), _results_filters.end(),
-                      result.type()) == _results_filters.end()) {
-            add_to_summary(*test_program, test_case_name, result, false);
+        const std::vector< model::test_result > attempts =
+            iter.previous_attempts();
+        const bool flaky = result.good() && !attempts.empty();
+
+        // Flaky tests are always detailed, just like failures would be.
+        if (!flaky && std::find(_results_filters.begin(),
+                                _results_filters.end(),
+                                result.type()) == _results_filters.end()) {
+            add_to_summary(*test_program, test_case_name, result, false,
+                           false);
             return;
         }
 
-        add_to_summary(*test_program, test_case_name, result, true);
+        add_to_summary(*test_program, test_case_name, result, flaky, true);
 
         if (!_start_time || _start_time.get() > iter.start_time())
             _start_time = iter.start_time();
@@ -359,10 +388,54 @@ public:
                                iter.end_time().to_iso8601_in_utc());
         templates.add_variable("duration", cli::format_delta(duration));
 
+        templates.add_vector("attempt_result");
+        for (std::vector< model::test_result >::const_iterator
+                 attempt = attempts.begin(); attempt != attempts.end();
+             ++attempt) {
+            templates.add_to_vector("attempt_result",
+                                    text::escape_xml(
+                                        cli::format_result(*attempt)));
+        }
+
         const model::test_case& test_case = test_program->find(test_case_name);
         add_map(templates, test_case.get_metadata().to_properties(),
                 "metadata_var", "metadata_value");
 
+        {
+            const char* const usage_vectors[] = {
+                "usage_phase", "usage_user_time", "usage_system_time",
+                "usage_max_rss", "usage_block_input", "usage_block_output",
+                "usage_voluntary_ctxsw", "usage_involuntary_ctxsw", NULL };
+            for (const char* const* name = usage_vectors; *name != NULL;
+                 ++name)
+                templates.add_vector(*name);
+
+            const std::map< std::string, utils::process::resource_usage >
+                usages = iter.resource_usages();
+            for (std::map< std::string, utils::process::resource_usage >::
+                     const_iterator usage_iter = usages.begin();
+                 usage_iter != usages.end(); ++usage_iter) {
+                const utils::process::resource_usage& usage =
+                    (*usage_iter).second;
+                templates.add_to_vector("usage_phase",
+                                        text::escape_xml((*usage_iter).first));
+                templates.add_to_vector("usage_user_time",
+                                        cli::format_delta(usage.user_time));
+                templates.add_to_vector("usage_system_time",
+                                        cli::format_delta(usage.system_time));
+                templates.add_to_vector("usage_max_rss",
+                                        F("%s") % usage.max_rss);
+                templates.add_to_vector("usage_block_input",
+                                        F("%s") % usage.block_input);
+                templates.add_to_vector("usage_block_output",
+                                        F("%s") % usage.block_output);
+                templates.add_to_vector("usage_voluntary_ctxsw",
+                                        F("%s") % usage.voluntary_ctxsw);
+                templates.add_to_vector("usage_involuntary_ctxsw",
+                                        F("%s") % usage.involuntary_ctxsw);
+            }
+        }
+
         {
             const std::string stdout_text = iter.stdout_contents();
             if (!stdout_text.empty())
@@ -417,6 +490,8 @@ public:
         _summary_templates.add_variable("broken_tests_count",
                                         F("%s") % n_broken);
         _summary_templates.add_variable("bad_tests_count", F("%s") % n_bad);
+        _summary_templates.add_variable("flaky_tests_count",
+                                        F("%s") % _flaky_count);
 
         generate(text::templates_def(), "report.css", "report.css");
         generate(_summary_templates, "index.html", "index.html");
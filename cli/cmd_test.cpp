@@ -29,25 +29,41 @@
 #include "cli/cmd_test.hpp"
 
 #include <cstdlib>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "cli/common.ipp"
 #include "drivers/run_tests.hpp"
+#include "drivers/scan_results.hpp"
+#include "engine/filters.hpp"
 #include "model/test_program.hpp"
 #include "model/test_result.hpp"
+#include "store/exceptions.hpp"
 #include "store/layout.hpp"
+#include "store/read_transaction.hpp"
+#include "utils/cmdline/exceptions.hpp"
 #include "utils/cmdline/options.hpp"
 #include "utils/cmdline/parser.ipp"
 #include "utils/cmdline/ui.hpp"
 #include "utils/config/tree.ipp"
 #include "utils/datetime.hpp"
 #include "utils/format/macros.hpp"
+#include "utils/fs/operations.hpp"
 #include "utils/fs/path.hpp"
+#include "utils/metrics.hpp"
+#include "utils/optional.ipp"
+#include "utils/stream.hpp"
 
 namespace cmdline = utils::cmdline;
 namespace config = utils::config;
 namespace datetime = utils::datetime;
 namespace fs = utils::fs;
 namespace layout = store::layout;
+namespace metrics = utils::metrics;
 
 using cli::cmd_test;
 
@@ -55,6 +71,10 @@ using cli::cmd_test;
 namespace {
 
 
+/// Maximum number of recent results files from which to estimate durations.
+static const std::size_t max_history_files = 20;
+
+
 /// Hooks to print a progress report of the execution of the tests.
 class print_hooks : public drivers::run_tests::base_hooks {
     /// Object to interact with the I/O of the program.
@@ -63,6 +83,12 @@ class print_hooks : public drivers::run_tests::base_hooks {
     /// Whether the tests are executed in parallel or not.
     bool _parallel;
 
+    /// Identifiers of the test cases that failed at least once so far.
+    std::set< std::string > _retried;
+
+    /// Runs and failures of the repeated test cases awaiting their result.
+    std::map< std::string, std::pair< int, int > > _repetitions;
+
 public:
     /// The amount of positive test results found so far.
     unsigned long good_count;
@@ -70,6 +96,15 @@ public:
     /// The amount of negative test results found so far.
     unsigned long bad_count;
 
+    /// The amount of test results served from the result cache so far.
+    unsigned long cached_count;
+
+    /// The amount of positive test results that needed retries so far.
+    unsigned long flaky_count;
+
+    /// The amount of test cases not run due to the time budget so far.
+    unsigned long over_budget_count;
+
     /// Constructor for the hooks.
     ///
     /// \param ui_ Object to interact with the I/O of the program.
@@ -78,7 +113,10 @@ public:
         _ui(ui_),
         _parallel(parallel_),
         good_count(0),
-        bad_count(0)
+        bad_count(0),
+        cached_count(0),
+        flaky_count(0),
+        over_budget_count(0)
     {
     }
 
@@ -109,17 +147,155 @@ public:
                const model::test_result& result,
                const datetime::delta& duration)
     {
-        if (_parallel) {
-            _ui->out(F("%s  ->  ") %
-                     cli::format_test_case_id(test_program, test_case_name),
-                     false);
+        const std::string test_case_id = cli::format_test_case_id(
+            test_program, test_case_name);
+        if (_parallel)
+            _ui->out(F("%s  ->  ") % test_case_id, false);
+        const bool retried = _retried.erase(test_case_id) > 0;
+        const std::map< std::string, std::pair< int, int > >::iterator
+            repetitions = _repetitions.find(test_case_id);
+        if (repetitions != _repetitions.end()) {
+            const int runs = (*repetitions).second.first;
+            const int failures = (*repetitions).second.second;
+            if (failures == 0) {
+                _ui->out(F("%s  [%s, %s runs]") % cli::format_result(result) %
+                    cli::format_delta(duration) % runs);
+            } else {
+                _ui->out(F("%s  [%s, %s of %s runs failed]") %
+                    cli::format_result(result) % cli::format_delta(duration) %
+                    failures % runs);
+            }
+            _repetitions.erase(repetitions);
+        } else if (retried && result.good()) {
+            _ui->out(F("%s  [%s, flaky]") % cli::format_result(result) %
+                cli::format_delta(duration));
+            flaky_count++;
+        } else {
+            _ui->out(F("%s  [%s]") % cli::format_result(result) %
+                cli::format_delta(duration));
         }
-        _ui->out(F("%s  [%s]") % cli::format_result(result) %
+        if (result.good())
+            good_count++;
+        else
+            bad_count++;
+    }
+
+    /// Called when an attempt of a test case failed and it will run again.
+    ///
+    /// \param test_program The test program containing the test case.
+    /// \param test_case_name The name of the test case being executed.
+    /// \param result The result of the failed attempt.
+    /// \param duration The time it took to run the failed attempt.
+    virtual void
+    got_retry(const model::test_program& test_program,
+              const std::string& test_case_name,
+              const model::test_result& result,
+              const datetime::delta& duration)
+    {
+        const std::string test_case_id = cli::format_test_case_id(
+            test_program, test_case_name);
+        if (_parallel)
+            _ui->out(F("%s  ->  ") % test_case_id, false);
+        _ui->out(F("%s  [%s, retrying]") % cli::format_result(result) %
             cli::format_delta(duration));
+        _retried.insert(test_case_id);
+    }
+
+    /// Called when all the runs of a repeated test case completed.
+    ///
+    /// \param test_program The test program containing the test case.
+    /// \param test_case_name The name of the repeated test case.
+    /// \param runs The number of times the test case ran.
+    /// \param failures The number of runs that did not yield a good result.
+    virtual void
+    got_repetitions(const model::test_program& test_program,
+                    const std::string& test_case_name,
+                    const int runs, const int failures)
+    {
+        _repetitions[cli::format_test_case_id(test_program, test_case_name)] =
+            std::make_pair(runs, failures);
+    }
+
+    /// Called when a result of a test case is carried over from a previous run.
+    ///
+    /// \param test_program The test program containing the test case.
+    /// \param test_case_name The name of the test case.
+    /// \param result The result of the test case in the previous run.
+    /// \param duration The time it took to run the test in the previous run.
+    virtual void
+    got_reused_result(const model::test_program& test_program,
+                      const std::string& test_case_name,
+                      const model::test_result& result,
+                      const datetime::delta& duration)
+    {
+        _ui->out(F("%s  ->  %s  [%s, reused]") %
+                 cli::format_test_case_id(test_program, test_case_name) %
+                 cli::format_result(result) % cli::format_delta(duration));
+        if (result.good())
+            good_count++;
+        else
+            bad_count++;
+    }
+
+    /// Called when a result of a test case is served from the result cache.
+    ///
+    /// \param test_program The test program containing the test case.
+    /// \param test_case_name The name of the test case.
+    /// \param result The cached result of the test case.
+    /// \param duration The time it took to run the test when it was cached.
+    virtual void
+    got_cached_result(const model::test_program& test_program,
+                      const std::string& test_case_name,
+                      const model::test_result& result,
+                      const datetime::delta& duration)
+    {
+        _ui->out(F("%s  ->  %s  [%s, cached]") %
+                 cli::format_test_case_id(test_program, test_case_name) %
+                 cli::format_result(result) % cli::format_delta(duration));
         if (result.good())
             good_count++;
         else
             bad_count++;
+        cached_count++;
+    }
+
+    /// Called when a test case is not run because it does not fit in the time
+    /// budget.
+    ///
+    /// \param test_program The test program containing the test case.
+    /// \param test_case_name The name of the test case that was not run.
+    virtual void
+    got_over_budget(const model::test_program& test_program,
+                    const std::string& test_case_name)
+    {
+        _ui->out(F("%s  ->  not run (budget)") %
+                 cli::format_test_case_id(test_program, test_case_name));
+        over_budget_count++;
+    }
+};
+
+
+/// Hooks to collect the test cases that did not pass in a previous run.
+class failures_hooks : public drivers::scan_results::base_hooks {
+public:
+    /// Exact filters matching every test case that did not pass.
+    std::set< engine::test_filter > filters;
+
+    /// Callback executed when the context is loaded.
+    void
+    got_context(const model::context& /* context */)
+    {
+    }
+
+    /// Callback executed when a test result is found.
+    ///
+    /// \param iter Container for the test result's data.
+    void
+    got_result(store::results_iterator& iter)
+    {
+        if (!iter.result().good())
+            filters.insert(engine::test_filter(
+                iter.test_program()->relative_path(), iter.test_case_name()));
     }
 };
 
@@ -134,6 +310,35 @@ cmd_test::cmd_test(void) : cli_command(
     add_option(build_root_option);
     add_option(kyuafile_option);
     add_option(results_file_create_option);
+    add_option(cmdline::string_option(
+        "rerun-failed", "Only run the test cases that did not pass in a "
+        "previous results file", "file",
+        layout::results_auto_open_name, true));
+    add_option(cmdline::string_option(
+        "skip-unchanged", "Reuse the results of the test programs that did "
+        "not change since a previous results file", "file",
+        layout::results_auto_open_name, true));
+    add_option(cmdline::int_option(
+        "retries", "Number of times to run again the test cases that fail or "
+        "break", "num", "0"));
+    add_option(cmdline::int_option(
+        "repeat", "Number of times to run each test case", "num"));
+    add_option(cmdline::bool_option(
+        "repeat-until-fail", "Stop repeating the test cases as soon as one "
+        "run fails; repeats without limit unless --repeat is given"));
+    add_option(cmdline::int_option(
+        "fail-fast", "Stop running test cases once this many have failed",
+        "num"));
+    add_option(cmdline::string_option(
+        "time-budget", "Maximum wall-clock time for the run, in seconds or "
+        "with an s, m, h or d suffix", "duration"));
+    add_option(cmdline::string_option(
+        "prioritize-failures", "Run the test cases that did not pass in a "
+        "previous results file before any others", "file",
+        layout::results_auto_open_name, true));
+    add_option(cmdline::path_option(
+        "metrics-file", "Path to the file into which to write metrics about "
+        "the overhead of Kyua itself, in OpenMetrics format", "path"));
 }
 
 
@@ -148,16 +353,128 @@ int
 cmd_test::run(cmdline::ui* ui, const cmdline::parsed_cmdline& cmdline,
               const config::tree& user_config)
 {
+    std::set< engine::test_filter > filters = parse_filters(
+        cmdline.arguments());
+
+    drivers::run_tests::options run_options;
+
+    // The previous results file must be resolved before creating the new one
+    // or else the automatic lookup could pick the latter.
+    if (cmdline.has_option("rerun-failed")) {
+        run_options.rerun_of = layout::find_results(
+            cmdline.get_option< cmdline::string_option >("rerun-failed"));
+
+        failures_hooks failures;
+        const drivers::scan_results::result scan = drivers::scan_results::drive(
+            run_options.rerun_of.get(), filters, failures);
+        if (failures.filters.empty()) {
+            ui->out(F("No failed test cases to rerun in %s") %
+                    run_options.rerun_of.get());
+            return report_unused_filters(scan.unused_filters, ui) ?
+                EXIT_FAILURE : EXIT_SUCCESS;
+        }
+        filters = failures.filters;
+    }
+
+    if (cmdline.has_option("skip-unchanged")) {
+        run_options.reuse_from = layout::find_results(
+            cmdline.get_option< cmdline::string_option >("skip-unchanged"));
+    }
+
+    // Not having run the tests before is not an error when prioritizing, as
+    // this is meant to be used unconditionally.
+    if (cmdline.has_option("prioritize-failures")) {
+        try {
+            const fs::path previous = layout::find_results(
+                cmdline.get_option< cmdline::string_option >(
+                    "prioritize-failures"));
+            failures_hooks failures;
+            (void)drivers::scan_results::drive(
+                previous, std::set< engine::test_filter >(), failures);
+            run_options.prioritized = failures.filters;
+        } catch (const store::error& e) {
+            cmdline::print_warning(ui, F("Not prioritizing any test cases: "
+                                         "%s") % e.what());
+        }
+    }
+
+    run_options.retries = cmdline.get_option< cmdline::int_option >("retries");
+    if (run_options.retries < 0)
+        throw cmdline::usage_error("The number of retries cannot be "
+                                   "negative");
+
+    run_options.repeat_until_fail = cmdline.has_option("repeat-until-fail");
+    run_options.repeat = run_options.repeat_until_fail ? 0 : 1;
+    if (cmdline.has_option("repeat")) {
+        run_options.repeat = cmdline.get_option< cmdline::int_option >(
+            "repeat");
+        if (run_options.repeat < 1)
+            throw cmdline::usage_error("The number of repetitions must be "
+                                       "positive");
+    }
+    const bool repeating = run_options.repeat != 1 ||
+        run_options.repeat_until_fail;
+    if (repeating && run_options.retries > 0)
+        throw cmdline::usage_error("--retries cannot be used when repeating "
+                                   "test cases");
+
+    if (cmdline.has_option("time-budget")) {
+        try {
+            run_options.time_budget = datetime::delta::parse(
+                cmdline.get_option< cmdline::string_option >("time-budget"));
+        } catch (const std::runtime_error& e) {
+            throw cmdline::usage_error(F("Invalid time budget: %s") %
+                                       e.what());
+        }
+        if (run_options.time_budget.get() == datetime::delta())
+            throw cmdline::usage_error("The time budget must be positive");
+    }
+
+    // The durations of the test cases in recent runs help decide which ones
+    // fit in the time budget and how long to wait for them, but they are not
+    // required.
+    if (run_options.time_budget ||
+        user_config.is_set("adaptive_timeout_factor")) {
+        const std::string test_suite = layout::test_suite_for_path(
+            fs::current_path());
+        try {
+            run_options.history = layout::find_recent_results(
+                test_suite, max_history_files);
+            if (run_options.history.empty())
+                throw store::error(F("No previous results file found for "
+                                     "test suite %s") % test_suite);
+        } catch (const store::error& e) {
+            cmdline::print_warning(ui, F("Cannot estimate the duration of "
+                                         "the test cases: %s") % e.what());
+        }
+    }
+
+    if (cmdline.has_option("fail-fast")) {
+        run_options.fail_fast = cmdline.get_option< cmdline::int_option >(
+            "fail-fast");
+        if (run_options.fail_fast < 1)
+            throw cmdline::usage_error("The number of failures for "
+                                       "--fail-fast must be positive");
+    }
+
     const layout::results_id_file_pair results = layout::new_db(
         results_file_create(cmdline), kyuafile_path(cmdline).branch_path());
 
     const bool parallel = (user_config.lookup< config::positive_int_node >(
                                "parallelism") > 1);
 
-    print_hooks hooks(ui, parallel);
+    // Repeated test cases report their result only after all their runs, so
+    // print each result in a single line as if running in parallel.
+    print_hooks hooks(ui, parallel || repeating);
     const drivers::run_tests::result result = drivers::run_tests::drive(
         kyuafile_path(cmdline), build_root_path(cmdline), results.second,
-        parse_filters(cmdline.arguments()), user_config, hooks);
+        filters, run_options, user_config, hooks);
+
+    if (cmdline.has_option("metrics-file")) {
+        std::unique_ptr< std::ostream > output = utils::open_ostream(
+            cmdline.get_option< cmdline::path_option >("metrics-file"));
+        metrics::write_openmetrics(*output.get());
+    }
 
     int exit_code;
     if (hooks.good_count > 0 || hooks.bad_count > 0) {
@@ -168,8 +485,17 @@ cmd_test::run(cmdline::ui* ui, const cmdline::parsed_cmdline& cmdline,
         ui->out(F("Results saved to %s") % results.second);
         ui->out("");
 
-        ui->out(F("%s/%s passed (%s failed)") % hooks.good_count %
-                (hooks.good_count + hooks.bad_count) % hooks.bad_count);
+        std::string details = F("%s failed") % hooks.bad_count;
+        if (hooks.cached_count > 0)
+            details += F(", %s cached") % hooks.cached_count;
+        if (hooks.flaky_count > 0)
+            details += F(", %s flaky") % hooks.flaky_count;
+        if (hooks.over_budget_count > 0)
+            details += F(", %s not run") % hooks.over_budget_count;
+        ui->out(F("%s/%s passed (%s)") % hooks.good_count %
+                (hooks.good_count + hooks.bad_count) % details);
+        if (result.stopped_early)
+            ui->out("Stopped early due to --fail-fast; not all test cases ran");
 
         exit_code = (hooks.bad_count == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
     } else {
@@ -37,6 +37,7 @@ extern "C" {
 #include <unistd.h>
 }
 
+#include <cstddef>
 #include <cstdlib>
 #include <iostream>
 #include <string>
@@ -52,6 +53,7 @@ extern "C" {
 #include "cli/cmd_report.hpp"
 #include "cli/cmd_report_html.hpp"
 #include "cli/cmd_report_junit.hpp"
+#include "cli/cmd_report_trace.hpp"
 #include "cli/cmd_test.hpp"
 #include "cli/common.ipp"
 #include "cli/config.hpp"
@@ -92,6 +94,13 @@ using utils::optional;
 namespace {
 
 
+/// Size of the buffer for log entries written to a log file.
+///
+/// Entries are still written out immediately on errors, on exit and on crashes,
+/// so this only delays the write of routine messages.
+static const std::size_t log_buffer_size = 64 * 1024;
+
+
 /// Registers all valid scheduler interfaces.
 ///
 /// This is part of Kyua's setup but it is a bit strange to find it here.  I am
@@ -200,6 +209,7 @@ safe_main(cmdline::ui* ui, int argc, const char* const argv[],
     commands.insert(new cli::cmd_report(), "Reporting");
     commands.insert(new cli::cmd_report_html(), "Reporting");
     commands.insert(new cli::cmd_report_junit(), "Reporting");
+    commands.insert(new cli::cmd_report_trace(), "Reporting");
 
     if (mock_command.get() != NULL)
         commands.insert(std::move(mock_command));
@@ -217,6 +227,9 @@ safe_main(cmdline::ui* ui, int argc, const char* const argv[],
     } catch (const std::range_error& e) {
         throw cmdline::usage_error(e.what());
     }
+    if (logfile != fs::path("/dev/stdout") &&
+        logfile != fs::path("/dev/stderr"))
+        logging::set_buffered(log_buffer_size);
 
     if (cmdline.arguments().empty())
         throw cmdline::usage_error("No command provided");
@@ -38,6 +38,7 @@
 #include "model/test_case.hpp"
 #include "model/test_program.hpp"
 #include "model/test_result.hpp"
+#include "store/layout.hpp"
 #include "utils/defs.hpp"
 #include "utils/format/macros.hpp"
 #include "utils/fs/auto_cleaners.hpp"
@@ -45,6 +46,7 @@
 
 namespace config = utils::config;
 namespace fs = utils::fs;
+namespace layout = store::layout;
 namespace scheduler = engine::scheduler;
 
 using utils::optional;
@@ -74,7 +76,8 @@ drivers::debug_test::drive(engine::debugger_ptr debugger,
     scheduler::scheduler_handle handle = scheduler::setup();
 
     const engine::kyuafile kyuafile = engine::kyuafile::load(
-        kyuafile_path, build_root, user_config, handle);
+        kyuafile_path, build_root, user_config, handle,
+        layout::query_kyuafile_cache_dir());
     std::set< engine::test_filter > filters;
     filters.insert(filter);
 
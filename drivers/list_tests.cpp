@@ -34,10 +34,12 @@
 #include "engine/scanner.hpp"
 #include "engine/scheduler.hpp"
 #include "model/test_program.hpp"
+#include "store/layout.hpp"
 #include "utils/optional.ipp"
 
 namespace config = utils::config;
 namespace fs = utils::fs;
+namespace layout = store::layout;
 namespace scheduler = engine::scheduler;
 
 using utils::optional;
@@ -68,7 +70,8 @@ drivers::list_tests::drive(const fs::path& kyuafile_path,
     scheduler::scheduler_handle handle = scheduler::setup();
 
     const engine::kyuafile kyuafile = engine::kyuafile::load(
-        kyuafile_path, build_root, user_config, handle);
+        kyuafile_path, build_root, user_config, handle,
+        layout::query_kyuafile_cache_dir());
 
     engine::scanner scanner(kyuafile.test_programs(), filters);
 
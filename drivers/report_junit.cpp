@@ -40,6 +40,7 @@
 #include "utils/datetime.hpp"
 #include "utils/defs.hpp"
 #include "utils/format/macros.hpp"
+#include "utils/process/resource_usage.hpp"
 #include "utils/text/operations.hpp"
 
 namespace config = utils::config;
@@ -144,6 +145,77 @@ drivers::junit_timing(const datetime::timestamp& start_time,
 }
 
 
+/// Formats the resources consumed by a test as a properties node.
+///
+/// \param usages The resource usage records of the test, keyed by phase.
+///
+/// \return A string with the properties node to attach to the test case, or
+/// the empty string if there are no records.
+std::string
+drivers::junit_resource_usage(
+    const std::map< std::string, utils::process::resource_usage >& usages)
+{
+    if (usages.empty())
+        return "";
+
+    std::ostringstream output;
+    output << "<properties>\n";
+    for (std::map< std::string, utils::process::resource_usage >::
+             const_iterator iter = usages.begin(); iter != usages.end();
+         ++iter) {
+        const std::string prefix = text::escape_xml(
+            F("resource_usage.%s.") % (*iter).first);
+        const utils::process::resource_usage& usage = (*iter).second;
+        output << F("<property name=\"%suser_time\" value=\"%s\"/>\n")
+            % prefix % junit_duration(usage.user_time);
+        output << F("<property name=\"%ssystem_time\" value=\"%s\"/>\n")
+            % prefix % junit_duration(usage.system_time);
+        output << F("<property name=\"%smax_rss\" value=\"%s\"/>\n")
+            % prefix % usage.max_rss;
+        output << F("<property name=\"%sblock_input\" value=\"%s\"/>\n")
+            % prefix % usage.block_input;
+        output << F("<property name=\"%sblock_output\" value=\"%s\"/>\n")
+            % prefix % usage.block_output;
+        output << F("<property name=\"%svoluntary_ctxsw\" value=\"%s\"/>\n")
+            % prefix % usage.voluntary_ctxsw;
+        output << F("<property name=\"%sinvoluntary_ctxsw\" "
+                    "value=\"%s\"/>\n")
+            % prefix % usage.involuntary_ctxsw;
+    }
+    output << "</properties>\n";
+    return output.str();
+}
+
+
+/// Formats the earlier attempts of a retried test as status nodes.
+///
+/// The nodes follow the convention of the Maven Surefire plugin: tests that
+/// eventually passed are flaky and get flakyFailure or flakyError nodes, while
+/// tests that never passed get rerunFailure or rerunError nodes.
+///
+/// \param result The result of the last attempt of the test.
+/// \param attempts The results of the earlier attempts of the test.
+///
+/// \return A string with the nodes to attach to the test case, or the empty
+/// string if the test was not retried.
+std::string
+drivers::junit_attempts(const model::test_result& result,
+                        const std::vector< model::test_result >& attempts)
+{
+    const char* const prefix = result.good() ? "flaky" : "rerun";
+
+    std::ostringstream output;
+    for (std::vector< model::test_result >::const_iterator
+             iter = attempts.begin(); iter != attempts.end(); ++iter) {
+        const char* const kind = (*iter).type() == model::test_result_failed ?
+            "Failure" : "Error";
+        output << F("<%s%s message=\"%s\"/>\n") % prefix % kind
+            % text::escape_xml((*iter).reason());
+    }
+    return output.str();
+}
+
+
 /// Constructor for the hooks.
 ///
 /// \param [out] output_ Stream to which to write the report.
@@ -222,6 +294,9 @@ drivers::report_junit_hooks::got_result(store::results_iterator& iter)
             % text::escape_xml(result.reason());
     }
 
+    _output << junit_attempts(result, iter.previous_attempts());
+    _output << junit_resource_usage(iter.resource_usages());
+
     const std::string stdout_contents = iter.stdout_contents();
     if (!stdout_contents.empty()) {
         _output << F("<system-out>%s</system-out>\n")
@@ -32,13 +32,17 @@
 #if !defined(ENGINE_REPORT_JUNIT_HPP)
 #define ENGINE_REPORT_JUNIT_HPP
 
+#include <map>
 #include <ostream>
 #include <string>
+#include <vector>
 
 #include "drivers/scan_results.hpp"
 #include "model/metadata_fwd.hpp"
 #include "model/test_program_fwd.hpp"
+#include "model/test_result_fwd.hpp"
 #include "utils/datetime_fwd.hpp"
+#include "utils/process/resource_usage_fwd.hpp"
 
 namespace drivers {
 
@@ -53,6 +57,10 @@ std::string junit_duration(const utils::datetime::delta&);
 std::string junit_metadata(const model::metadata&);
 std::string junit_timing(const utils::datetime::timestamp&,
                          const utils::datetime::timestamp&);
+std::string junit_resource_usage(
+    const std::map< std::string, utils::process::resource_usage >&);
+std::string junit_attempts(const model::test_result&,
+                           const std::vector< model::test_result >&);
 
 
 /// Hooks for the scan_results driver to generate a JUnit report.
@@ -28,7 +28,9 @@
 
 #include "drivers/report_junit.hpp"
 
+#include <map>
 #include <sstream>
+#include <string>
 #include <vector>
 
 #include <atf-c++.hpp>
@@ -46,6 +48,7 @@
 #include "utils/format/macros.hpp"
 #include "utils/fs/path.hpp"
 #include "utils/optional.ipp"
+#include "utils/process/resource_usage.hpp"
 #include "utils/units.hpp"
 
 namespace datetime = utils::datetime;
@@ -66,7 +69,10 @@ static const char* const default_metadata =
     "execenv is empty\n"
     "execenv_jail_params is empty\n"
     "has_cleanup = false\n"
+    "is_cacheable = false\n"
     "is_exclusive = false\n"
+    "max_output_size = 0\n"
+    "max_retries = 0\n"
     "required_configs is empty\n"
     "required_disk_space = 0\n"
     "required_files is empty\n"
@@ -86,7 +92,10 @@ static const char* const overriden_metadata =
     "execenv is empty\n"
     "execenv_jail_params is empty\n"
     "has_cleanup = false\n"
+    "is_cacheable = false\n"
     "is_exclusive = false\n"
+    "max_output_size = 0\n"
+    "max_retries = 0\n"
     "required_configs is empty\n"
     "required_disk_space = 0\n"
     "required_files is empty\n"
@@ -209,6 +218,8 @@ ATF_TEST_CASE_BODY(junit_metadata__overrides)
         .set_execenv_jail_params("vnet")
         .set_has_cleanup(true)
         .set_is_exclusive(true)
+        .set_max_output_size(units::bytes(789))
+        .set_max_retries(2)
         .add_required_config("config1")
         .set_required_disk_space(units::bytes(456))
         .add_required_file(fs::path("file1"))
@@ -226,7 +237,10 @@ ATF_TEST_CASE_BODY(junit_metadata__overrides)
         + "execenv = jail\n"
         + "execenv_jail_params = vnet\n"
         + "has_cleanup = true\n"
+        + "is_cacheable = false\n"
         + "is_exclusive = true\n"
+        + "max_output_size = 789\n"
+        + "max_retries = 2\n"
         + "required_configs = config1\n"
         + "required_disk_space = 456\n"
         + "required_files = file1\n"
@@ -258,6 +272,92 @@ ATF_TEST_CASE_BODY(junit_timing)
 }
 
 
+ATF_TEST_CASE_WITHOUT_HEAD(junit_resource_usage__none);
+ATF_TEST_CASE_BODY(junit_resource_usage__none)
+{
+    ATF_REQUIRE_EQ("", drivers::junit_resource_usage(
+        std::map< std::string, utils::process::resource_usage >()));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(junit_resource_usage__some);
+ATF_TEST_CASE_BODY(junit_resource_usage__some)
+{
+    std::map< std::string, utils::process::resource_usage > usages;
+    usages["body"] = utils::process::resource_usage(
+        datetime::delta(1, 250000), datetime::delta(0, 5000), 2048, 1, 2, 3, 4);
+    usages["cleanup"] = utils::process::resource_usage();
+
+    const std::string expected =
+        "<properties>\n"
+        "<property name=\"resource_usage.body.user_time\" value=\"1.250\"/>\n"
+        "<property name=\"resource_usage.body.system_time\" "
+        "value=\"0.005\"/>\n"
+        "<property name=\"resource_usage.body.max_rss\" value=\"2048\"/>\n"
+        "<property name=\"resource_usage.body.block_input\" value=\"1\"/>\n"
+        "<property name=\"resource_usage.body.block_output\" value=\"2\"/>\n"
+        "<property name=\"resource_usage.body.voluntary_ctxsw\" "
+        "value=\"3\"/>\n"
+        "<property name=\"resource_usage.body.involuntary_ctxsw\" "
+        "value=\"4\"/>\n"
+        "<property name=\"resource_usage.cleanup.user_time\" "
+        "value=\"0.000\"/>\n"
+        "<property name=\"resource_usage.cleanup.system_time\" "
+        "value=\"0.000\"/>\n"
+        "<property name=\"resource_usage.cleanup.max_rss\" value=\"0\"/>\n"
+        "<property name=\"resource_usage.cleanup.block_input\" "
+        "value=\"0\"/>\n"
+        "<property name=\"resource_usage.cleanup.block_output\" "
+        "value=\"0\"/>\n"
+        "<property name=\"resource_usage.cleanup.voluntary_ctxsw\" "
+        "value=\"0\"/>\n"
+        "<property name=\"resource_usage.cleanup.involuntary_ctxsw\" "
+        "value=\"0\"/>\n"
+        "</properties>\n";
+    ATF_REQUIRE_EQ(expected, drivers::junit_resource_usage(usages));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(junit_attempts__none);
+ATF_TEST_CASE_BODY(junit_attempts__none)
+{
+    ATF_REQUIRE_EQ("", drivers::junit_attempts(
+        model::test_result(model::test_result_failed, "Some reason"),
+        std::vector< model::test_result >()));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(junit_attempts__flaky);
+ATF_TEST_CASE_BODY(junit_attempts__flaky)
+{
+    std::vector< model::test_result > attempts;
+    attempts.push_back(model::test_result(model::test_result_failed,
+                                          "Bad <value>"));
+    attempts.push_back(model::test_result(model::test_result_broken,
+                                          "Crashed"));
+
+    const std::string expected =
+        "<flakyFailure message=\"Bad &lt;value&gt;\"/>\n"
+        "<flakyError message=\"Crashed\"/>\n";
+    ATF_REQUIRE_EQ(expected, drivers::junit_attempts(
+        model::test_result(model::test_result_passed), attempts));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(junit_attempts__rerun);
+ATF_TEST_CASE_BODY(junit_attempts__rerun)
+{
+    std::vector< model::test_result > attempts;
+    attempts.push_back(model::test_result(model::test_result_broken,
+                                          "Timed out"));
+
+    const std::string expected = "<rerunError message=\"Timed out\"/>\n";
+    ATF_REQUIRE_EQ(expected, drivers::junit_attempts(
+        model::test_result(model::test_result_failed, "Still bad"),
+        attempts));
+}
+
+
 ATF_TEST_CASE_WITHOUT_HEAD(report_junit_hooks__minimal);
 ATF_TEST_CASE_BODY(report_junit_hooks__minimal)
 {
@@ -421,6 +521,13 @@ ATF_INIT_TEST_CASES(tcs)
 
     ATF_ADD_TEST_CASE(tcs, junit_timing);
 
+    ATF_ADD_TEST_CASE(tcs, junit_resource_usage__none);
+    ATF_ADD_TEST_CASE(tcs, junit_resource_usage__some);
+
+    ATF_ADD_TEST_CASE(tcs, junit_attempts__none);
+    ATF_ADD_TEST_CASE(tcs, junit_attempts__flaky);
+    ATF_ADD_TEST_CASE(tcs, junit_attempts__rerun);
+
     ATF_ADD_TEST_CASE(tcs, report_junit_hooks__minimal);
     ATF_ADD_TEST_CASE(tcs, report_junit_hooks__some_tests);
 }
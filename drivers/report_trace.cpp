@@ -0,0 +1,174 @@
+// Copyright 2026 The Kyua Authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// * Neither the name of Google Inc. nor the names of its contributors
+//   may be used to endorse or promote products derived from this software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "drivers/report_trace.hpp"
+
+extern "C" {
+#include <stdint.h>
+}
+
+#include <cstdio>
+#include <set>
+
+#include "store/read_backend.hpp"
+#include "store/read_transaction.hpp"
+#include "utils/datetime.hpp"
+#include "utils/format/macros.hpp"
+#include "utils/fs/path.hpp"
+#include "utils/optional.ipp"
+
+namespace datetime = utils::datetime;
+namespace fs = utils::fs;
+
+using utils::optional;
+
+
+namespace {
+
+
+/// Identifier of the only process that appears in the trace.
+const int trace_pid = 1;
+
+
+/// Computes the name of the event for a phase.
+///
+/// \param iter The phase being processed.
+///
+/// \return The test case identifier for per-test case phases, or the path to
+/// the test program for phases that apply to the whole program.
+static std::string
+event_name(const store::phases_iterator& iter)
+{
+    const optional< std::string > test_case_name = iter.test_case_name();
+    if (test_case_name)
+        return F("%s:%s") % iter.test_program_path() % test_case_name.get();
+    else
+        return iter.test_program_path().str();
+}
+
+
+/// Formats the name of a timeline lane.
+///
+/// \param slot The execution slot represented by the lane.
+///
+/// \return A user-friendly name for the lane.
+static std::string
+slot_name(const int slot)
+{
+    if (slot == 0)
+        return "kyua";
+    else
+        return F("slot %s") % slot;
+}
+
+
+}  // anonymous namespace
+
+
+/// Quotes a string to be used as a JSON value.
+///
+/// \param str The string to quote.
+///
+/// \return The string wrapped in double quotes, with any special characters
+/// escaped.
+std::string
+drivers::report_trace::json_string(const std::string& str)
+{
+    std::string quoted = "\"";
+    for (std::string::const_iterator iter = str.begin(); iter != str.end();
+         ++iter) {
+        const char ch = *iter;
+        switch (ch) {
+        case '"': quoted += "\\\""; break;
+        case '\\': quoted += "\\\\"; break;
+        case '\n': quoted += "\\n"; break;
+        case '\r': quoted += "\\r"; break;
+        case '\t': quoted += "\\t"; break;
+        default:
+            if (static_cast< unsigned char >(ch) < 0x20) {
+                char buffer[8];
+                std::snprintf(buffer, sizeof(buffer), "\\u%04x",
+                              static_cast< unsigned int >(ch));
+                quoted += buffer;
+            } else {
+                quoted += ch;
+            }
+        }
+    }
+    quoted += "\"";
+    return quoted;
+}
+
+
+/// Executes the operation.
+///
+/// Events are written as they are read from the results file, which returns
+/// phases ordered by their start time.  All timestamps in the output are
+/// relative to the start of the earliest phase.
+///
+/// \param results_file The path to the results file to process.
+/// \param output Stream to which to write the trace.
+void
+drivers::report_trace::drive(const fs::path& results_file,
+                             std::ostream& output)
+{
+    store::read_backend db = store::read_backend::open_ro(results_file);
+    store::read_transaction tx = db.start_read();
+
+    output << "{\"traceEvents\":[\n";
+    output << F("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%s,"
+                "\"tid\":0,\"args\":{\"name\":\"kyua\"}}") % trace_pid;
+
+    std::set< int > slots;
+    optional< int64_t > base_time;
+    for (store::phases_iterator iter = tx.get_phases(); iter; ++iter) {
+        const int64_t start = iter.start_time().to_microseconds();
+        const int64_t end = iter.end_time().to_microseconds();
+        if (!base_time)
+            base_time = start;
+        slots.insert(iter.slot());
+
+        output << F(",\n{\"name\":%s,\"cat\":%s,\"ph\":\"X\",\"ts\":%s,"
+                    "\"dur\":%s,\"pid\":%s,\"tid\":%s}")
+            % json_string(event_name(iter)) % json_string(iter.name())
+            % (start - base_time.get()) % (end > start ? end - start : 0)
+            % trace_pid % iter.slot();
+    }
+
+    for (std::set< int >::const_iterator iter = slots.begin();
+         iter != slots.end(); ++iter) {
+        output << F(",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%s,"
+                    "\"tid\":%s,\"args\":{\"name\":%s}}")
+            % trace_pid % *iter % json_string(slot_name(*iter));
+        output << F(",\n{\"name\":\"thread_sort_index\",\"ph\":\"M\","
+                    "\"pid\":%s,\"tid\":%s,\"args\":{\"sort_index\":%s}}")
+            % trace_pid % *iter % *iter;
+    }
+
+    output << "\n],\n\"displayTimeUnit\":\"ms\"}\n";
+}
@@ -0,0 +1,165 @@
+// Copyright 2026 The Kyua Authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// * Neither the name of Google Inc. nor the names of its contributors
+//   may be used to endorse or promote products derived from this software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "drivers/report_trace.hpp"
+
+extern "C" {
+#include <stdint.h>
+}
+
+#include <sstream>
+
+#include <atf-c++.hpp>
+
+#include "model/test_program.hpp"
+#include "store/exceptions.hpp"
+#include "store/write_backend.hpp"
+#include "store/write_transaction.hpp"
+#include "utils/datetime.hpp"
+#include "utils/fs/path.hpp"
+#include "utils/optional.ipp"
+
+namespace datetime = utils::datetime;
+namespace fs = utils::fs;
+
+using utils::none;
+
+
+namespace {
+
+
+/// Shorthand to construct a timestamp from a number of microseconds.
+///
+/// \param usecs Microseconds since the epoch.
+///
+/// \return A new timestamp.
+static datetime::timestamp
+usec(const int64_t usecs)
+{
+    return datetime::timestamp::from_microseconds(usecs);
+}
+
+
+}  // anonymous namespace
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(json_string);
+ATF_TEST_CASE_BODY(json_string)
+{
+    using drivers::report_trace::json_string;
+
+    ATF_REQUIRE_EQ("\"\"", json_string(""));
+    ATF_REQUIRE_EQ("\"dir/prog:case\"", json_string("dir/prog:case"));
+    ATF_REQUIRE_EQ("\"a\\\"b\\\\c\"", json_string("a\"b\\c"));
+    ATF_REQUIRE_EQ("\"\\n\\t\\u0001\"", json_string("\n\t\x01"));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(drive__empty);
+ATF_TEST_CASE_BODY(drive__empty)
+{
+    store::write_backend::open_rw(fs::path("test.db"));  // Create database.
+
+    std::ostringstream output;
+    drivers::report_trace::drive(fs::path("test.db"), output);
+    ATF_REQUIRE_EQ(
+        "{\"traceEvents\":[\n"
+        "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,"
+        "\"args\":{\"name\":\"kyua\"}}\n"
+        "],\n"
+        "\"displayTimeUnit\":\"ms\"}\n",
+        output.str());
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(drive__some_phases);
+ATF_TEST_CASE_BODY(drive__some_phases)
+{
+    {
+        store::write_backend backend = store::write_backend::open_rw(
+            fs::path("test.db"));
+        store::write_transaction tx = backend.start_write();
+
+        const model::test_program test_program = model::test_program_builder(
+            "plain", fs::path("dir/prog"), fs::path("/root"), "suite")
+            .add_test_case("main")
+            .build();
+        const int64_t tp_id = tx.put_test_program(test_program);
+        const int64_t tc_id = tx.put_test_case(test_program, "main", tp_id);
+
+        tx.put_phase(tp_id, utils::make_optional(tc_id), "store", 0,
+                     usec(3000500), usec(3000600));
+        tx.put_phase(tp_id, utils::make_optional(tc_id), "body", 2,
+                     usec(2000000), usec(3000000));
+        tx.put_phase(tp_id, none, "listing", 0, usec(1000000), usec(1500000));
+        tx.commit();
+    }
+
+    std::ostringstream output;
+    drivers::report_trace::drive(fs::path("test.db"), output);
+    ATF_REQUIRE_EQ(
+        "{\"traceEvents\":[\n"
+        "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,"
+        "\"args\":{\"name\":\"kyua\"}},\n"
+        "{\"name\":\"dir/prog\",\"cat\":\"listing\",\"ph\":\"X\","
+        "\"ts\":0,\"dur\":500000,\"pid\":1,\"tid\":0},\n"
+        "{\"name\":\"dir/prog:main\",\"cat\":\"body\",\"ph\":\"X\","
+        "\"ts\":1000000,\"dur\":1000000,\"pid\":1,\"tid\":2},\n"
+        "{\"name\":\"dir/prog:main\",\"cat\":\"store\",\"ph\":\"X\","
+        "\"ts\":2000500,\"dur\":100,\"pid\":1,\"tid\":0},\n"
+        "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,"
+        "\"args\":{\"name\":\"kyua\"}},\n"
+        "{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":0,"
+        "\"args\":{\"sort_index\":0}},\n"
+        "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,"
+        "\"args\":{\"name\":\"slot 2\"}},\n"
+        "{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":2,"
+        "\"args\":{\"sort_index\":2}}\n"
+        "],\n"
+        "\"displayTimeUnit\":\"ms\"}\n",
+        output.str());
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(drive__missing_db);
+ATF_TEST_CASE_BODY(drive__missing_db)
+{
+    std::ostringstream output;
+    ATF_REQUIRE_THROW(store::error,
+                      drivers::report_trace::drive(fs::path("test.db"),
+                                                   output));
+}
+
+
+ATF_INIT_TEST_CASES(tcs)
+{
+    ATF_ADD_TEST_CASE(tcs, json_string);
+    ATF_ADD_TEST_CASE(tcs, drive__empty);
+    ATF_ADD_TEST_CASE(tcs, drive__some_phases);
+    ATF_ADD_TEST_CASE(tcs, drive__missing_db);
+}
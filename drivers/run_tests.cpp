@@ -28,11 +28,18 @@
 
 #include "drivers/run_tests.hpp"
 
+#include <algorithm>
+#include <deque>
+#include <iterator>
+#include <map>
 #include <utility>
+#include <vector>
 
 #include "engine/config.hpp"
 #include "engine/filters.hpp"
+#include "engine/fingerprint.hpp"
 #include "engine/kyuafile.hpp"
+#include "engine/result_cache.hpp"
 #include "engine/scanner.hpp"
 #include "engine/scheduler.hpp"
 #include "model/context.hpp"
@@ -40,24 +47,35 @@
 #include "model/test_case.hpp"
 #include "model/test_program.hpp"
 #include "model/test_result.hpp"
+#include "store/layout.hpp"
+#include "store/read_backend.hpp"
+#include "store/read_transaction.hpp"
 #include "store/write_backend.hpp"
 #include "store/write_transaction.hpp"
 #include "utils/config/tree.ipp"
 #include "utils/datetime.hpp"
 #include "utils/defs.hpp"
 #include "utils/format/macros.hpp"
+#include "utils/jobserver.hpp"
 #include "utils/logging/macros.hpp"
+#include "utils/metrics.hpp"
 #include "utils/noncopyable.hpp"
 #include "utils/optional.ipp"
 #include "utils/passwd.hpp"
+#include "utils/process/resource_usage.hpp"
+#include "utils/sanity.hpp"
 #include "utils/text/operations.ipp"
+#include "utils/units.hpp"
 
 namespace config = utils::config;
 namespace datetime = utils::datetime;
 namespace fs = utils::fs;
+namespace metrics = utils::metrics;
 namespace passwd = utils::passwd;
 namespace scheduler = engine::scheduler;
+namespace layout = store::layout;
 namespace text = utils::text;
+namespace units = utils::units;
 
 using utils::none;
 using utils::optional;
@@ -73,12 +91,567 @@ namespace {
 typedef std::map< fs::path, int64_t > path_to_id_map;
 
 
-/// Map of in-flight PIDs to their corresponding test case IDs.
-typedef std::map< int, int64_t > pid_to_id_map;
+/// Pair of PID to a test case ID.
+typedef std::pair< int, int64_t > pid_and_id_pair;
 
 
-/// Pair of PID to a test case ID.
-typedef pid_to_id_map::value_type pid_and_id_pair;
+/// Test case whose subprocess is running.
+struct in_flight_test {
+    /// Identifier of the test case in the store.
+    int64_t test_case_id;
+
+    /// Execution slot occupied by the test case.
+    int slot;
+
+    /// Whether the test case has already been asked to terminate.
+    bool terminated;
+
+    /// Constructor.
+    ///
+    /// \param test_case_id_ Identifier of the test case in the store.
+    /// \param slot_ Execution slot occupied by the test case.
+    in_flight_test(const int64_t test_case_id_, const int slot_) :
+        test_case_id(test_case_id_), slot(slot_), terminated(false)
+    {
+    }
+};
+
+
+/// Map of in-flight PIDs to their corresponding test cases.
+typedef std::map< int, in_flight_test > pid_to_test_map;
+
+
+/// Map of test program relative paths to their fingerprints, if known.
+typedef std::map< fs::path, optional< std::string > > fingerprints_map;
+
+
+/// Map of test case IDs to the keys under which to cache their results.
+typedef std::map< int64_t, std::string > id_to_cache_key_map;
+
+
+/// Exclusive test case to run once all others are done, along with the key
+/// under which to cache its result, if it is cacheable.
+typedef std::pair< engine::scan_result, optional< std::string > >
+    exclusive_test;
+
+
+/// Map of test case IDs to the number of their attempts that failed so far.
+typedef std::map< int64_t, int > id_to_attempts_map;
+
+
+/// Failed attempt of a test case that is waiting to run again.
+///
+/// The attempt is only recorded as such once the test case starts again: if
+/// the run stops before that, the attempt becomes the result of the test case.
+struct pending_retry {
+    /// The completion handle of the failed attempt.
+    scheduler::result_handle_ptr result_handle;
+
+    /// Identifier of the test case in the store.
+    int64_t test_case_id;
+
+    /// Execution slot in which the failed attempt ran.
+    int slot;
+
+    /// Constructor.
+    ///
+    /// \param result_handle_ The completion handle of the failed attempt.
+    /// \param test_case_id_ Identifier of the test case in the store.
+    /// \param slot_ Execution slot in which the failed attempt ran.
+    pending_retry(const scheduler::result_handle_ptr result_handle_,
+                  const int64_t test_case_id_, const int slot_) :
+        result_handle(result_handle_), test_case_id(test_case_id_),
+        slot(slot_)
+    {
+    }
+};
+
+
+/// Progress of a test case that the user asked to run more than once.
+struct repetition {
+    /// Test program and test case to run.
+    engine::scan_result match;
+
+    /// Identifier of the test case in the store.
+    int64_t test_case_id;
+
+    /// Number of runs started so far.
+    int started;
+
+    /// Number of runs completed so far.
+    int finished;
+
+    /// Number of completed runs that did not yield a good result.
+    int failures;
+
+    /// Completed run to record as the result of the test case, if any.
+    ///
+    /// This is the first failed run or, if all runs passed so far, the last
+    /// one.  Its work directory is kept until the test case is done.
+    scheduler::result_handle_ptr kept;
+
+    /// Execution slot in which the kept run ran.
+    int kept_slot;
+
+    /// Constructor for a test case whose first run has just started.
+    ///
+    /// \param match_ Test program and test case to run.
+    /// \param test_case_id_ Identifier of the test case in the store.
+    repetition(const engine::scan_result& match_,
+               const int64_t test_case_id_) :
+        match(match_), test_case_id(test_case_id_), started(1), finished(0),
+        failures(0), kept_slot(0)
+    {
+    }
+};
+
+
+/// Map of test case IDs to the progress of their repetitions.
+typedef std::map< int64_t, repetition > id_to_repetition_map;
+
+
+/// Maximum size of the result cache unless configured otherwise.
+static const units::bytes default_result_cache_size(64 * units::MB);
+
+
+/// Result of a test case in a previous run.
+struct previous_result {
+    /// Name of the test case.
+    std::string test_case_name;
+
+    /// Result of the test case.
+    model::test_result result;
+
+    /// Time when the test case started to run.
+    datetime::timestamp start_time;
+
+    /// Time when the test case finished running.
+    datetime::timestamp end_time;
+
+    /// Constructor.
+    ///
+    /// \param test_case_name_ Name of the test case.
+    /// \param result_ Result of the test case.
+    /// \param start_time_ Time when the test case started to run.
+    /// \param end_time_ Time when the test case finished running.
+    previous_result(const std::string& test_case_name_,
+                    const model::test_result& result_,
+                    const datetime::timestamp& start_time_,
+                    const datetime::timestamp& end_time_) :
+        test_case_name(test_case_name_),
+        result(result_),
+        start_time(start_time_),
+        end_time(end_time_)
+    {
+    }
+};
+
+
+/// Results of a test program in a previous run.
+struct previous_program {
+    /// The test program as recorded in the previous run.
+    model::test_program_ptr test_program;
+
+    /// Fingerprint of the test program in the previous run.
+    std::string fingerprint;
+
+    /// Results of the test cases of the test program.
+    std::vector< previous_result > results;
+
+    /// Whether all the results are good.
+    bool all_good;
+
+    /// Constructor.
+    previous_program(void) : all_good(true)
+    {
+    }
+};
+
+
+/// Map of test program relative paths to their results in a previous run.
+typedef std::map< fs::path, previous_program > previous_programs_map;
+
+
+/// Map of test cases, identified by the relative path of their test program
+/// and their name, to the time they usually take to run.
+typedef std::map< std::pair< fs::path, std::string >, datetime::delta >
+    durations_map;
+
+
+/// Upper bound of the part of the time budget set aside to wrap up the run.
+static const datetime::delta max_budget_reserve(60, 0);
+
+
+/// Result recorded for the test cases that do not fit in the time budget.
+static const model::test_result over_budget_result(
+    model::test_result_skipped, "Not run: does not fit in the time budget");
+
+
+/// Time during which an execution slot stays empty between two tests.
+static metrics::histogram slot_idle_seconds(
+    "kyua_run_slot_idle_seconds",
+    "Time from an execution slot becoming free to the next test starting");
+
+
+/// Time to record the results of a test case.
+static metrics::histogram store_seconds(
+    "kyua_run_store_seconds",
+    "Time to record the result of a test case in the results file");
+
+
+/// Grabs the lowest-numbered free execution slot.
+///
+/// Slots are only used to lay out the timeline of the run, so that tests that
+/// ran concurrently show up in different lanes and each lane never has more
+/// than one test at a time.
+///
+/// \param [in,out] busy Occupancy of the slots, indexed by slot number.  Index
+///     0 is reserved for the driver and is never handed out.
+///
+/// \return The number of the acquired slot.
+static int
+acquire_slot(std::vector< bool >& busy)
+{
+    for (std::vector< bool >::size_type i = 1; i < busy.size(); ++i) {
+        if (!busy[i]) {
+            busy[i] = true;
+            return static_cast< int >(i);
+        }
+    }
+    UNREACHABLE_MSG("No free execution slots");
+}
+
+
+/// Grabs a free execution slot and accounts for the time it was idle.
+///
+/// \param [in,out] busy Occupancy of the slots, indexed by slot number.
+/// \param [in,out] freed_at Time at which each slot last became free, if it
+///     has not been taken again since.
+///
+/// \return The number of the acquired slot.
+static int
+claim_slot(std::vector< bool >& busy,
+           std::vector< optional< datetime::timestamp > >& freed_at)
+{
+    const int slot = acquire_slot(busy);
+    if (freed_at[slot]) {
+        slot_idle_seconds.observe(datetime::timestamp::now() -
+                                  freed_at[slot].get());
+        freed_at[slot] = none;
+    }
+    return slot;
+}
+
+
+/// Loads the test programs of a previous run whose results can be reused.
+///
+/// Only test programs that have a fingerprint, that were run in full and whose
+/// test cases all yielded good results are returned.
+///
+/// \param results_file Path to the results file of the previous run.
+///
+/// \return The reusable test programs, keyed by their relative path.
+static previous_programs_map
+load_previous_programs(const fs::path& results_file)
+{
+    store::read_backend db = store::read_backend::open_ro(results_file);
+    store::read_transaction tx = db.start_read();
+
+    const std::map< fs::path, std::string > fingerprints =
+        tx.get_test_program_fingerprints();
+
+    previous_programs_map programs;
+    for (store::results_iterator iter = tx.get_results(); iter; ++iter) {
+        const model::test_program_ptr test_program = iter.test_program();
+        const std::map< fs::path, std::string >::const_iterator fingerprint =
+            fingerprints.find(test_program->relative_path());
+        if (fingerprint == fingerprints.end())
+            continue;
+
+        previous_program& program = programs[test_program->relative_path()];
+        program.test_program = test_program;
+        program.fingerprint = (*fingerprint).second;
+        const model::test_result result = iter.result();
+        program.all_good &= result.good();
+        program.results.push_back(previous_result(
+            iter.test_case_name(), result, iter.start_time(),
+            iter.end_time()));
+    }
+
+    for (previous_programs_map::iterator iter = programs.begin();
+         iter != programs.end(); ) {
+        const previous_program& program = (*iter).second;
+        if (!program.all_good || program.results.size() !=
+            program.test_program->test_cases().size()) {
+            programs.erase(iter++);
+        } else {
+            ++iter;
+        }
+    }
+    return programs;
+}
+
+
+/// Loads the time the test cases usually take to run from previous runs.
+///
+/// The duration of each test case is the 99th percentile of the durations
+/// recorded across all the given results files, which discards the odd run
+/// that was slowed down by an overloaded machine only when there is enough
+/// history.  Skipped test cases are ignored because they may not have run in
+/// full.
+///
+/// \param results_files Paths to the results files of previous runs.
+///
+/// \return The durations of the test cases that ran to completion.
+///
+/// \throw store::error If any of the results files cannot be read.
+static durations_map
+load_durations(const std::vector< fs::path >& results_files)
+{
+    typedef std::map< std::pair< fs::path, std::string >,
+                      std::vector< datetime::delta > > samples_map;
+    samples_map samples;
+
+    for (std::vector< fs::path >::const_iterator file = results_files.begin();
+         file != results_files.end(); ++file) {
+        store::read_backend db = store::read_backend::open_ro(*file);
+        store::read_transaction tx = db.start_read();
+
+        for (store::results_iterator iter = tx.get_results(); iter; ++iter) {
+            if (iter.result().type() == model::test_result_skipped)
+                continue;
+            samples[std::make_pair(iter.test_program()->relative_path(),
+                                   iter.test_case_name())].push_back(
+                iter.end_time() - iter.start_time());
+        }
+    }
+
+    durations_map durations;
+    for (samples_map::iterator iter = samples.begin(); iter != samples.end();
+         ++iter) {
+        std::vector< datetime::delta >& values = (*iter).second;
+        std::sort(values.begin(), values.end());
+        // Nearest-rank percentile: the smallest value such that 99% of the
+        // samples are not larger than it.
+        const std::size_t rank = (values.size() * 99 + 99) / 100;
+        durations[(*iter).first] = values[rank - 1];
+    }
+    return durations;
+}
+
+
+/// Computes the adaptive timeout of a test case, if enabled.
+///
+/// The adaptive timeout is a multiple of the time the test case usually takes
+/// to run, but never shorter than a configurable floor so that tests that
+/// usually complete in a few milliseconds are not killed by jitter.  The
+/// scheduler caps it at the timeout declared by the test case.
+///
+/// \param match Test program and test case to be run.
+/// \param durations Time the test cases usually take to run.
+/// \param user_config The end-user configuration properties.
+///
+/// \return The adaptive timeout for the test case, or none if adaptive
+/// timeouts are disabled or the test case has no history.
+static optional< datetime::delta >
+adaptive_timeout(const engine::scan_result& match,
+                 const durations_map& durations,
+                 const config::tree& user_config)
+{
+    if (!user_config.is_set("adaptive_timeout_factor"))
+        return none;
+
+    const durations_map::const_iterator iter = durations.find(
+        std::make_pair(match.first->relative_path(), match.second));
+    if (iter == durations.end())
+        return none;
+
+    const int64_t factor = user_config.lookup< config::positive_int_node >(
+        "adaptive_timeout_factor");
+    const datetime::delta floor(
+        user_config.lookup< config::positive_int_node >(
+            "adaptive_timeout_floor"), 0);
+    return utils::make_optional(std::max(
+        floor, (*iter).second * static_cast< std::size_t >(factor)));
+}
+
+
+/// Computes the time by which all test bodies must be done to meet a budget.
+///
+/// Part of the budget is set aside for the cleanup routines of the test cases
+/// terminated at the deadline and for committing the results file.
+///
+/// \param start_time Time at which the run started.
+/// \param budget Maximum wall-clock time for the whole run.
+///
+/// \return The deadline for the test bodies.
+static datetime::timestamp
+budget_deadline(const datetime::timestamp& start_time,
+                const datetime::delta& budget)
+{
+    const datetime::delta reserve = std::min(
+        datetime::delta::from_microseconds(budget.to_microseconds() / 10),
+        max_budget_reserve);
+    return start_time + datetime::delta::from_microseconds(
+        budget.to_microseconds() - reserve.to_microseconds());
+}
+
+
+/// Determines whether a test case is expected to complete before a deadline.
+///
+/// Test cases that did not run to completion before are assumed to fit as long
+/// as the deadline has not passed yet: the scheduler terminates them if they
+/// turn out to run past it.
+///
+/// \param match Test program and test case to check.
+/// \param durations Time the test cases usually take to run.
+/// \param deadline Time by which the test case has to be done.
+///
+/// \return True if the test case can start; false otherwise.
+static bool
+fits_in_budget(const engine::scan_result& match,
+               const durations_map& durations,
+               const datetime::timestamp& deadline)
+{
+    const datetime::timestamp now = datetime::timestamp::now();
+    if (now >= deadline)
+        return false;
+
+    const durations_map::const_iterator iter = durations.find(
+        std::make_pair(match.first->relative_path(), match.second));
+    return iter == durations.end() || now + (*iter).second <= deadline;
+}
+
+
+/// Checks whether the deadline of the run, if any, has passed.
+///
+/// \param deadline Time by which all test bodies must be done, if any.
+///
+/// \return True if no more test runs can start; false otherwise.
+static bool
+past_deadline(const optional< datetime::timestamp >& deadline)
+{
+    return deadline && datetime::timestamp::now() >= deadline.get();
+}
+
+
+/// Carries the results of an unchanged test program over from a previous run.
+///
+/// \param program The results of the test program in the previous run.
+/// \param filters The test case filters as provided by the user.
+/// \param original_results_file Path to the results file of the previous run.
+/// \param [in,out] tx Writable transaction where to store the results.
+/// \param [in,out] used_filters Filters that matched any reused test case.
+/// \param hooks The hooks for this execution.
+static void
+reuse_test_program(const previous_program& program,
+                   const engine::test_filters& filters,
+                   const fs::path& original_results_file,
+                   store::write_transaction& tx,
+                   std::set< engine::test_filter >& used_filters,
+                   drivers::run_tests::base_hooks& hooks)
+{
+    const model::test_program& test_program = *program.test_program;
+
+    const int64_t test_program_id = tx.put_test_program(test_program);
+    tx.put_test_program_fingerprint(test_program_id, program.fingerprint);
+
+    for (std::vector< previous_result >::const_iterator
+             iter = program.results.begin(); iter != program.results.end();
+             ++iter) {
+        const engine::test_filters::match match = filters.match_test_case(
+            test_program.relative_path(), (*iter).test_case_name);
+        if (!match.first)
+            continue;
+        if (match.second)
+            used_filters.insert(match.second.get());
+
+        const int64_t test_case_id = tx.put_test_case(
+            test_program, (*iter).test_case_name, test_program_id);
+        tx.put_result((*iter).result, test_case_id, (*iter).start_time,
+                      (*iter).end_time);
+        tx.put_reused_result(test_case_id, original_results_file);
+        hooks.got_reused_result(test_program, (*iter).test_case_name,
+                                (*iter).result,
+                                (*iter).end_time - (*iter).start_time);
+    }
+}
+
+
+/// Computes the fingerprint of a test program only once.
+///
+/// \param test_program The test program to compute the fingerprint of.
+/// \param user_config The end-user configuration properties.
+/// \param [in,out] fingerprints Cache of already-computed fingerprints.
+///
+/// \return The fingerprint of the test program, or none if it cannot be
+/// computed.
+static optional< std::string >
+program_fingerprint(const model::test_program& test_program,
+                    const config::tree& user_config,
+                    fingerprints_map& fingerprints)
+{
+    const fs::path& key = test_program.relative_path();
+    fingerprints_map::const_iterator iter = fingerprints.find(key);
+    if (iter == fingerprints.end()) {
+        iter = fingerprints.insert(std::make_pair(
+            key, engine::fingerprint(test_program, user_config))).first;
+    }
+    return (*iter).second;
+}
+
+
+/// Opens the result cache as configured by the user.
+///
+/// \param user_config The end-user configuration properties.
+///
+/// \return The result cache, or none if the cache is disabled.
+static optional< engine::result_cache >
+open_result_cache(const config::tree& user_config)
+{
+    const units::bytes size = user_config.is_set("result_cache_size") ?
+        user_config.lookup< engine::bytes_node >("result_cache_size") :
+        default_result_cache_size;
+    if (size == units::bytes(0))
+        return none;
+
+    const optional< fs::path > directory =
+        user_config.is_set("result_cache_dir") ?
+        utils::make_optional(fs::path(
+            user_config.lookup< config::string_node >("result_cache_dir"))) :
+        layout::query_cache_dir();
+    if (!directory)
+        return none;
+
+    return utils::make_optional(engine::result_cache(directory.get(), size));
+}
+
+
+/// Computes the key under which the result of a test case is cached.
+///
+/// \param test_program The test program containing the test case.
+/// \param test_case_name The name of the test case.
+/// \param user_config The end-user configuration properties.
+/// \param [in,out] fingerprints Cache of already-computed fingerprints.
+///
+/// \return The cache key, or none if the test case is not cacheable or if its
+/// inputs cannot be read.
+static optional< std::string >
+find_cache_key(const model::test_program& test_program,
+               const std::string& test_case_name,
+               const config::tree& user_config,
+               fingerprints_map& fingerprints)
+{
+    if (!test_program.find(test_case_name).get_metadata().is_cacheable())
+        return none;
+
+    const optional< std::string > fingerprint = program_fingerprint(
+        test_program, user_config, fingerprints);
+    if (!fingerprint)
+        return none;
+    return engine::fingerprint(test_program, test_case_name,
+                               fingerprint.get());
+}
 
 
 /// Puts a test program in the store and returns its identifier.
@@ -92,18 +665,36 @@ typedef pid_to_id_map::value_type pid_and_id_pair;
 /// \param test_program The test program being put.
 /// \param [in,out] tx Writable transaction on the store.
 /// \param [in,out] ids_cache Cache of already-put test programs.
+/// \param user_config The end-user configuration properties.
+/// \param [in,out] fingerprints Cache of already-computed fingerprints.
 ///
 /// \return A test program identifier.
 static int64_t
 find_test_program_id(const model::test_program_ptr test_program,
                      store::write_transaction& tx,
-                     path_to_id_map& ids_cache)
+                     path_to_id_map& ids_cache,
+                     const config::tree& user_config,
+                     fingerprints_map& fingerprints)
 {
     const fs::path& key = test_program->relative_path();
     std::map< fs::path, int64_t >::const_iterator iter = ids_cache.find(key);
     if (iter == ids_cache.end()) {
         const int64_t id = tx.put_test_program(*test_program);
         ids_cache.insert(std::make_pair(key, id));
+
+        const optional< std::string > fingerprint = program_fingerprint(
+            *test_program, user_config, fingerprints);
+        if (fingerprint)
+            tx.put_test_program_fingerprint(id, fingerprint.get());
+
+        const scheduler::lazy_test_program* lazy_test_program =
+            dynamic_cast< const scheduler::lazy_test_program* >(
+                test_program.get());
+        if (lazy_test_program != NULL && lazy_test_program->listing_times()) {
+            const scheduler::phase_times& times =
+                lazy_test_program->listing_times().get();
+            tx.put_phase(id, none, "listing", 0, times.first, times.second);
+        }
         return id;
     } else {
         return (*iter).second;
@@ -125,7 +716,43 @@ put_test_result(const int64_t test_case_id,
                   result.start_time(), result.end_time());
     tx.put_test_case_file("__STDOUT__", result.stdout_file(), test_case_id);
     tx.put_test_case_file("__STDERR__", result.stderr_file(), test_case_id);
+    for (scheduler::resource_usage_map::const_iterator
+             iter = result.resource_usages().begin();
+         iter != result.resource_usages().end(); ++iter) {
+        tx.put_resource_usage(test_case_id, (*iter).first, (*iter).second);
+    }
+}
+
+
+/// Stores the timeline of the execution of a test in the database.
+///
+/// \param result_handle The completion handle of the test subprocess.
+/// \param test_case_id Identifier of the test case in the database.
+/// \param slot Execution slot in which the test ran.
+/// \param [in,out] tx Writable transaction where to store the phases.
+/// \param ids_cache Cache of already-put test programs.
+///
+/// \return The identifier of the test program of the test in the database.
+static int64_t
+put_test_phases(const scheduler::test_result_handle& result_handle,
+                const int64_t test_case_id,
+                const int slot,
+                store::write_transaction& tx,
+                const path_to_id_map& ids_cache)
+{
+    const path_to_id_map::const_iterator program_iter = ids_cache.find(
+        result_handle.test_program()->relative_path());
+    INV(program_iter != ids_cache.end());
+    const int64_t test_program_id = (*program_iter).second;
 
+    for (scheduler::phase_times_map::const_iterator
+             iter = result_handle.phases().begin();
+         iter != result_handle.phases().end(); ++iter) {
+        tx.put_phase(test_program_id, utils::make_optional(test_case_id),
+                     (*iter).first, slot, (*iter).second.first,
+                     (*iter).second.second);
+    }
+    return test_program_id;
 }
 
 
@@ -157,6 +784,8 @@ safe_cleanup(scheduler::test_result_handle handle) throw()
 /// \param [in,out] tx Writable transaction to obtain test IDs.
 /// \param [in,out] ids_cache Cache of already-put test cases.
 /// \param user_config The end-user configuration properties.
+/// \param [in,out] fingerprints Cache of already-computed fingerprints.
+/// \param durations Time the test cases usually take to run.
 /// \param hooks The hooks for this execution.
 ///
 /// \returns The PID for the started test and the test case's identifier in the
@@ -167,6 +796,8 @@ start_test(scheduler::scheduler_handle& handle,
            store::write_transaction& tx,
            path_to_id_map& ids_cache,
            const config::tree& user_config,
+           fingerprints_map& fingerprints,
+           const durations_map& durations,
            drivers::run_tests::base_hooks& hooks)
 {
     const model::test_program_ptr test_program = match.first;
@@ -175,55 +806,487 @@ start_test(scheduler::scheduler_handle& handle,
     hooks.got_test_case(*test_program, test_case_name);
 
     const int64_t test_program_id = find_test_program_id(
-        test_program, tx, ids_cache);
+        test_program, tx, ids_cache, user_config, fingerprints);
     const int64_t test_case_id = tx.put_test_case(
         *test_program, test_case_name, test_program_id);
 
     const scheduler::exec_handle exec_handle = handle.spawn_test(
-        test_program, test_case_name, user_config);
+        test_program, test_case_name, user_config, none, none,
+        adaptive_timeout(match, durations, user_config));
     return std::make_pair(exec_handle, test_case_id);
 }
 
 
+/// Starts a test asynchronously after one of its attempts failed.
+///
+/// \param handle Scheduler handle.
+/// \param match Test program and test case to start.
+/// \param test_case_id Identifier of the test case in the store.
+/// \param user_config The end-user configuration properties.
+/// \param durations Time the test cases usually take to run.
+/// \param hooks The hooks for this execution.
+///
+/// \returns The PID for the started test and the test case's identifier in the
+/// store.
+pid_and_id_pair
+restart_test(scheduler::scheduler_handle& handle,
+             const engine::scan_result& match,
+             const int64_t test_case_id,
+             const config::tree& user_config,
+             const durations_map& durations,
+             drivers::run_tests::base_hooks& hooks)
+{
+    hooks.got_test_case(*match.first, match.second);
+
+    const scheduler::exec_handle exec_handle = handle.spawn_test(
+        match.first, match.second, user_config, none, none,
+        adaptive_timeout(match, durations, user_config));
+    return std::make_pair(exec_handle, test_case_id);
+}
+
+
+/// Determines whether a test has to run again after one of its attempts.
+///
+/// Only failed and broken results are retried, up to as many times as the
+/// max_retries property of the test case says or, if it is not set, as the
+/// user requested.
+///
+/// \param result_handle The completion handle of the test subprocess.
+/// \param failed_attempts Number of attempts of the test that failed before
+///     this one.
+/// \param retries Number of retries requested by the user.
+///
+/// \return True if the test has to run again; false otherwise.
+static bool
+needs_retry(const scheduler::result_handle_ptr result_handle,
+            const int failed_attempts, const int retries)
+{
+    const scheduler::test_result_handle* test_result_handle =
+        dynamic_cast< const scheduler::test_result_handle* >(
+            result_handle.get());
+
+    const model::test_result_type type =
+        test_result_handle->test_result().type();
+    if (type != model::test_result_failed && type != model::test_result_broken)
+        return false;
+
+    const int max_retries = test_result_handle->test_program()->find(
+        test_result_handle->test_case_name()).get_metadata().max_retries();
+    return failed_attempts < (max_retries > 0 ? max_retries : retries);
+}
+
+
+/// Records the result of a test case served from the result cache.
+///
+/// \param match Test program and test case whose result was found.
+/// \param cache_key The key under which the result was found.
+/// \param cached The result found in the cache.
+/// \param [in,out] tx Writable transaction where to store the result.
+/// \param [in,out] ids_cache Cache of already-put test programs.
+/// \param user_config The end-user configuration properties.
+/// \param [in,out] fingerprints Cache of already-computed fingerprints.
+/// \param hooks The hooks for this execution.
+static void
+put_cached_test_result(const engine::scan_result& match,
+                       const std::string& cache_key,
+                       const engine::cached_result& cached,
+                       store::write_transaction& tx,
+                       path_to_id_map& ids_cache,
+                       const config::tree& user_config,
+                       fingerprints_map& fingerprints,
+                       drivers::run_tests::base_hooks& hooks)
+{
+    const model::test_program_ptr test_program = match.first;
+    const std::string& test_case_name = match.second;
+
+    const int64_t test_program_id = find_test_program_id(
+        test_program, tx, ids_cache, user_config, fingerprints);
+    const int64_t test_case_id = tx.put_test_case(
+        *test_program, test_case_name, test_program_id);
+
+    const datetime::timestamp end_time = datetime::timestamp::now();
+    tx.put_result(cached.result(), test_case_id,
+                  end_time - cached.duration(), end_time);
+    tx.put_test_case_file("__STDOUT__", cached.stdout_file(), test_case_id);
+    tx.put_test_case_file("__STDERR__", cached.stderr_file(), test_case_id);
+    tx.put_cached_result(test_case_id, cache_key);
+
+    hooks.got_cached_result(*test_program, test_case_name, cached.result(),
+                            cached.duration());
+}
+
+
+/// Records a test case that is not run because it does not fit in the budget.
+///
+/// \param match Test program and test case that is not run.
+/// \param [in,out] tx Writable transaction where to store the result.
+/// \param [in,out] ids_cache Cache of already-put test programs.
+/// \param user_config The end-user configuration properties.
+/// \param [in,out] fingerprints Cache of already-computed fingerprints.
+/// \param hooks The hooks for this execution.
+static void
+put_over_budget_result(const engine::scan_result& match,
+                       store::write_transaction& tx,
+                       path_to_id_map& ids_cache,
+                       const config::tree& user_config,
+                       fingerprints_map& fingerprints,
+                       drivers::run_tests::base_hooks& hooks)
+{
+    const model::test_program_ptr test_program = match.first;
+    const std::string& test_case_name = match.second;
+
+    LI(F("Not running %s:%s as it does not fit in the time budget") %
+       test_program->relative_path() % test_case_name);
+
+    const int64_t test_program_id = find_test_program_id(
+        test_program, tx, ids_cache, user_config, fingerprints);
+    const int64_t test_case_id = tx.put_test_case(
+        *test_program, test_case_name, test_program_id);
+
+    const datetime::timestamp now = datetime::timestamp::now();
+    tx.put_result(over_budget_result, test_case_id, now, now);
+
+    hooks.got_over_budget(*test_program, test_case_name);
+}
+
+
 /// Processes the completion of a test.
 ///
 /// \param [in,out] result_handle The completion handle of the test subprocess.
 /// \param test_case_id Identifier of the test case as returned by start_test().
+/// \param slot Execution slot in which the test ran.
 /// \param [in,out] tx Writable transaction to put the test results.
+/// \param ids_cache Cache of already-put test programs.
+/// \param [in,out] cache_keys Keys under which to cache the results of the
+///     in-flight cacheable tests.  The entry of this test, if any, is removed.
+/// \param [in,out] cache The result cache, if enabled.
 /// \param hooks The hooks for this execution.
 ///
+/// \return True if the test did not yield a good result; false otherwise.
+///
 /// \post result_handle is cleaned up.  The caller cannot clean it up again.
-void
+bool
 finish_test(scheduler::result_handle_ptr result_handle,
             const int64_t test_case_id,
+            const int slot,
             store::write_transaction& tx,
+            const path_to_id_map& ids_cache,
+            id_to_cache_key_map& cache_keys,
+            optional< engine::result_cache >& cache,
             drivers::run_tests::base_hooks& hooks)
 {
     const scheduler::test_result_handle* test_result_handle =
         dynamic_cast< const scheduler::test_result_handle* >(
             result_handle.get());
 
+    const int64_t test_program_id = put_test_phases(
+        *test_result_handle, test_case_id, slot, tx, ids_cache);
+    const optional< int64_t > phase_test_case_id =
+        utils::make_optional(test_case_id);
+
+    const datetime::timestamp store_start = datetime::timestamp::now();
     put_test_result(test_case_id, *test_result_handle, tx);
+    const datetime::timestamp store_end = datetime::timestamp::now();
+    store_seconds.observe(store_end - store_start);
+    tx.put_phase(test_program_id, phase_test_case_id, "store", 0, store_start,
+                 store_end);
+
+    // Only cache results that are worth not running the test again for.  In
+    // particular, skipped and broken tests may behave differently once their
+    // environment is fixed.
+    const id_to_cache_key_map::iterator key_iter = cache_keys.find(
+        test_case_id);
+    if (key_iter != cache_keys.end()) {
+        const model::test_result_type type =
+            test_result_handle->test_result().type();
+        if (cache && (type == model::test_result_passed ||
+                      type == model::test_result_expected_failure)) {
+            cache.get().put(
+                (*key_iter).second, test_result_handle->test_result(),
+                result_handle->end_time() - result_handle->start_time(),
+                test_result_handle->stdout_file(),
+                test_result_handle->stderr_file());
+        }
+        cache_keys.erase(key_iter);
+    }
 
     const model::test_result test_result = safe_cleanup(*test_result_handle);
+    tx.put_phase(test_program_id, phase_test_case_id, "workdir_cleanup", 0,
+                 store_end, datetime::timestamp::now());
     hooks.got_result(
         *test_result_handle->test_program(),
         test_result_handle->test_case_name(),
         test_result_handle->test_result(),
         result_handle->end_time() - result_handle->start_time());
+    return !test_result.good();
+}
+
+
+/// Processes the completion of a run of a test that does not yield its result.
+///
+/// \param [in,out] result_handle The completion handle of the test subprocess.
+/// \param test_case_id Identifier of the test case as returned by start_test().
+/// \param attempt Number under which to record the run as a failed attempt, or
+///     none if the run is only accounted for in the timeline.
+/// \param slot Execution slot in which the test ran.
+/// \param [in,out] tx Writable transaction to put the attempt.
+/// \param ids_cache Cache of already-put test programs.
+///
+/// \post result_handle is cleaned up.  The caller cannot clean it up again.
+static void
+drop_run(scheduler::result_handle_ptr result_handle,
+         const int64_t test_case_id,
+         const optional< int > attempt,
+         const int slot,
+         store::write_transaction& tx,
+         const path_to_id_map& ids_cache)
+{
+    const scheduler::test_result_handle* test_result_handle =
+        dynamic_cast< const scheduler::test_result_handle* >(
+            result_handle.get());
+
+    const int64_t test_program_id = put_test_phases(
+        *test_result_handle, test_case_id, slot, tx, ids_cache);
+    if (attempt) {
+        tx.put_attempt(test_result_handle->test_result(), test_case_id,
+                       attempt.get(), result_handle->start_time(),
+                       result_handle->end_time());
+        tx.put_attempt_file("__STDOUT__", test_result_handle->stdout_file(),
+                            test_case_id, attempt.get());
+        tx.put_attempt_file("__STDERR__", test_result_handle->stderr_file(),
+                            test_case_id, attempt.get());
+    }
+
+    const datetime::timestamp cleanup_start = datetime::timestamp::now();
+    (void)safe_cleanup(*test_result_handle);
+    tx.put_phase(test_program_id, utils::make_optional(test_case_id),
+                 "workdir_cleanup", 0, cleanup_start,
+                 datetime::timestamp::now());
+}
+
+
+/// Processes the completion of a failed attempt of a test that will run again.
+///
+/// \param [in,out] result_handle The completion handle of the test subprocess.
+/// \param test_case_id Identifier of the test case as returned by start_test().
+/// \param attempt Number of the attempt that failed, starting at 1.
+/// \param slot Execution slot in which the test ran.
+/// \param [in,out] tx Writable transaction to put the attempt.
+/// \param ids_cache Cache of already-put test programs.
+/// \param [in,out] cache_keys Keys under which to cache the results of the
+///     in-flight cacheable tests.  The entry of this test, if any, is removed:
+///     a test that needs retries is not deterministic.
+/// \param hooks The hooks for this execution.
+///
+/// \post result_handle is cleaned up.  The caller cannot clean it up again.
+void
+retry_test(scheduler::result_handle_ptr result_handle,
+           const int64_t test_case_id,
+           const int attempt,
+           const int slot,
+           store::write_transaction& tx,
+           const path_to_id_map& ids_cache,
+           id_to_cache_key_map& cache_keys,
+           drivers::run_tests::base_hooks& hooks)
+{
+    const scheduler::test_result_handle* test_result_handle =
+        dynamic_cast< const scheduler::test_result_handle* >(
+            result_handle.get());
+
+    drop_run(result_handle, test_case_id, utils::make_optional(attempt), slot,
+             tx, ids_cache);
+    cache_keys.erase(test_case_id);
+    hooks.got_retry(
+        *test_result_handle->test_program(),
+        test_result_handle->test_case_name(),
+        test_result_handle->test_result(),
+        result_handle->end_time() - result_handle->start_time());
+}
+
+
+/// Determines whether a repeated test has to run again.
+///
+/// \param state Progress of the repetitions of the test.
+/// \param repeat Number of runs requested by the user, or 0 for no limit.
+/// \param stopped Whether a failure put an end to all repetitions.
+///
+/// \return True if another run of the test has to start; false otherwise.
+static bool
+wants_more_runs(const repetition& state, const int repeat, const bool stopped)
+{
+    return !stopped && (repeat == 0 || state.started < repeat);
+}
+
+
+/// Accounts for the completion of a run of a repeated test.
+///
+/// Only the first failed run, or the last run if all passed, is kept to
+/// become the result of the test.  Any other failed runs are recorded in full
+/// as attempts, and any other passed runs are discarded.
+///
+/// \param [in,out] result_handle The completion handle of the test subprocess.
+/// \param slot Execution slot in which the run happened.
+/// \param [in,out] state Progress of the repetitions of the test.
+/// \param [in,out] tx Writable transaction to put any dropped runs.
+/// \param ids_cache Cache of already-put test programs.
+///
+/// \return True if the run did not yield a good result; false otherwise.
+static bool
+complete_run(scheduler::result_handle_ptr result_handle,
+             const int slot,
+             repetition& state,
+             store::write_transaction& tx,
+             const path_to_id_map& ids_cache)
+{
+    const bool good = dynamic_cast< const scheduler::test_result_handle* >(
+        result_handle.get())->test_result().good();
+    state.finished++;
+    if (!good)
+        state.failures++;
+
+    const bool kept_good = state.kept && dynamic_cast<
+        const scheduler::test_result_handle* >(
+            state.kept.get())->test_result().good();
+    if (state.kept && !kept_good) {
+        optional< int > attempt;
+        if (!good)
+            attempt = state.finished;
+        drop_run(result_handle, state.test_case_id, attempt, slot, tx,
+                 ids_cache);
+    } else {
+        if (state.kept)
+            drop_run(state.kept, state.test_case_id, none, state.kept_slot,
+                     tx, ids_cache);
+        state.kept = result_handle;
+        state.kept_slot = slot;
+    }
+    return !good;
+}
+
+
+/// Records the result of a repeated test once all of its runs completed.
+///
+/// \param [in,out] state Progress of the repetitions of the test.
+/// \param [in,out] tx Writable transaction to put the test results.
+/// \param ids_cache Cache of already-put test programs.
+/// \param [in,out] cache_keys Keys under which to cache the results of the
+///     in-flight cacheable tests.
+/// \param [in,out] cache The result cache, if enabled.
+/// \param hooks The hooks for this execution.
+///
+/// \return True if the test did not yield a good result; false otherwise.
+static bool
+finish_repetitions(repetition& state,
+                   store::write_transaction& tx,
+                   const path_to_id_map& ids_cache,
+                   id_to_cache_key_map& cache_keys,
+                   optional< engine::result_cache >& cache,
+                   drivers::run_tests::base_hooks& hooks)
+{
+    PRE(state.started == state.finished);
+    PRE(state.kept);
+
+    hooks.got_repetitions(*state.match.first, state.match.second,
+                          state.finished, state.failures);
+    const bool bad = finish_test(state.kept, state.test_case_id,
+                                 state.kept_slot, tx, ids_cache, cache_keys,
+                                 cache, hooks);
+    tx.put_repetitions(state.test_case_id, state.finished, state.failures);
+    state.kept.reset();
+    return bad;
+}
+
+
+/// Records the result of the repeated tests that are waiting to run again.
+///
+/// This is used once the repetitions stop early, for the test cases that have
+/// no runs in flight.  The others are recorded as soon as their runs complete.
+///
+/// \param [in,out] repeat_queue Test cases waiting to run again.  Emptied.
+/// \param [in,out] repetitions Progress of the repeated test cases.
+/// \param [in,out] tx Writable transaction to put the test results.
+/// \param ids_cache Cache of already-put test programs.
+/// \param [in,out] cache_keys Keys under which to cache the results of the
+///     in-flight cacheable tests.
+/// \param [in,out] cache The result cache, if enabled.
+/// \param hooks The hooks for this execution.
+///
+/// \return The number of recorded test cases that did not yield a good result.
+static int
+flush_repetitions(std::deque< int64_t >& repeat_queue,
+                  id_to_repetition_map& repetitions,
+                  store::write_transaction& tx,
+                  const path_to_id_map& ids_cache,
+                  id_to_cache_key_map& cache_keys,
+                  optional< engine::result_cache >& cache,
+                  drivers::run_tests::base_hooks& hooks)
+{
+    int failed_tests = 0;
+    for (std::deque< int64_t >::const_iterator iter = repeat_queue.begin();
+         iter != repeat_queue.end(); ++iter) {
+        const id_to_repetition_map::iterator waiting = repetitions.find(*iter);
+        if (waiting != repetitions.end() &&
+            (*waiting).second.started == (*waiting).second.finished) {
+            if (finish_repetitions((*waiting).second, tx, ids_cache,
+                                   cache_keys, cache, hooks))
+                ++failed_tests;
+            repetitions.erase(waiting);
+        }
+    }
+    repeat_queue.clear();
+    return failed_tests;
+}
+
+
+/// Yields the next test case to run.
+///
+/// The test cases matched by the prioritized filters come first, in the order
+/// in which they are found, and are skipped once the regular scan gets to them.
+///
+/// \param [in,out] scanner The scanner over all the test cases to run.
+/// \param [in,out] priority_scanner The scanner over the prioritized test
+///     cases, or NULL if no test cases are prioritized.
+/// \param filters The test case filters as provided by the user, which the
+///     prioritized test cases must also match.
+/// \param [in,out] prioritized_tests The test cases already yielded by the
+///     priority scanner.
+///
+/// \return The next test case to run, or none if there are no more.
+static optional< engine::scan_result >
+yield_test(engine::scanner& scanner,
+           engine::scanner* priority_scanner,
+           const engine::test_filters& filters,
+           std::set< engine::scan_result >& prioritized_tests)
+{
+    if (priority_scanner != NULL) {
+        for (optional< engine::scan_result > match = priority_scanner->yield();
+             match; match = priority_scanner->yield()) {
+            if (filters.match_test_case(match.get().first->relative_path(),
+                                        match.get().second).first) {
+                prioritized_tests.insert(match.get());
+                return match;
+            }
+        }
+    }
+
+    optional< engine::scan_result > match = scanner.yield();
+    while (match && prioritized_tests.find(match.get()) !=
+           prioritized_tests.end())
+        match = scanner.yield();
+    return match;
 }
 
 
-/// Extracts the keys of a pid_to_id_map and returns them as a string.
+/// Extracts the PIDs of the in-flight tests and returns them as a string.
 ///
-/// \param map The PID to test ID map from which to get the PIDs.
+/// \param map The in-flight tests from which to get the PIDs.
 ///
 /// \return A user-facing string with the collection of PIDs.
 static std::string
-format_pids(const pid_to_id_map& map)
+format_pids(const pid_to_test_map& map)
 {
-    std::set< pid_to_id_map::key_type > pids;
-    for (pid_to_id_map::const_iterator iter = map.begin(); iter != map.end();
+    std::set< pid_to_test_map::key_type > pids;
+    for (pid_to_test_map::const_iterator iter = map.begin(); iter != map.end();
          ++iter) {
         pids.insert(iter->first);
     }
@@ -231,6 +1294,469 @@ format_pids(const pid_to_id_map& map)
 }
 
 
+/// State of the execution of the test cases.
+///
+/// This keeps track of the test cases in flight and of the ones waiting to run
+/// again, and implements the rules to retry failed test cases, to repeat test
+/// cases and to stop early.  Both the concurrent and the exclusive test cases
+/// go through this class so that these rules apply to all of them alike.
+class run_state : utils::noncopyable {
+    /// Scheduler handle.
+    scheduler::scheduler_handle& _handle;
+
+    /// Writable transaction where to store the results.
+    store::write_transaction& _tx;
+
+    /// Settings that control how the test cases run.
+    const drivers::run_tests::options& _options;
+
+    /// The end-user configuration properties.
+    const config::tree& _user_config;
+
+    /// Time the test cases usually take to run.
+    const durations_map& _durations;
+
+    /// Time by which the run has to end, if any.
+    const optional< datetime::timestamp > _deadline;
+
+    /// The result cache, if enabled.
+    optional< engine::result_cache >& _cache;
+
+    /// Cache of already-computed fingerprints.
+    fingerprints_map& _fingerprints;
+
+    /// The hooks for this execution.
+    drivers::run_tests::base_hooks& _hooks;
+
+    /// Whether the test cases run more than once.
+    const bool _repeating;
+
+    /// Cache of already-put test programs.
+    path_to_id_map _ids_cache;
+
+    /// Test cases whose subprocesses are running, keyed by their PIDs.
+    pid_to_test_map _in_flight;
+
+    /// Occupancy of the execution slots, indexed by slot number.
+    std::vector< bool > _busy_slots;
+
+    /// Time at which each slot last became free, if not taken again since.
+    std::vector< optional< datetime::timestamp > > _slot_freed_at;
+
+    /// Jobserver of the make(1) that invoked us, if any.
+    optional< utils::jobserver > _jobserver;
+
+    /// Keys under which to cache the results of the in-flight cacheable tests.
+    id_to_cache_key_map _cache_keys;
+
+    /// Number of failed attempts of the test cases that are being retried.
+    id_to_attempts_map _failed_attempts;
+
+    /// Failed test cases waiting to run again.
+    std::deque< pending_retry > _retry_queue;
+
+    /// Progress of the test cases that run more than once.
+    id_to_repetition_map _repetitions;
+
+    /// Repeated test cases waiting to run again.
+    std::deque< int64_t > _repeat_queue;
+
+    /// Whether a failure or the end of the time budget stopped the repetitions.
+    bool _stopped;
+
+    /// Number of test cases that did not yield a good result so far.
+    int _failed_tests;
+
+    /// Whether the run stopped before running all the test cases.
+    bool _stopped_early;
+
+    /// Starts tracking a test case whose subprocess was just spawned.
+    ///
+    /// \param pid_id The PID of the subprocess and the test case identifier.
+    /// \param slot Execution slot occupied by the test case.
+    void
+    track(const pid_and_id_pair& pid_id, const int slot)
+    {
+        INV_MSG(_in_flight.find(pid_id.first) == _in_flight.end(),
+                F("Spawned test has PID of still-tracked process %s") %
+                pid_id.first);
+        _in_flight.insert(std::make_pair(
+            pid_id.first, in_flight_test(pid_id.second, slot)));
+    }
+
+    /// Processes the completion of a test case subprocess.
+    ///
+    /// Depending on the result, the test case is recorded, queued to run
+    /// again after a failure or queued for its next repetition.
+    ///
+    /// \param result_handle The completion handle of the test subprocess.
+    void
+    complete(scheduler::result_handle_ptr result_handle)
+    {
+        const pid_to_test_map::iterator iter = _in_flight.find(
+            result_handle->original_pid());
+        INV_MSG(iter != _in_flight.end(),
+                F("Lost track of in-flight PID %s; tracking %s") %
+                result_handle->original_pid() % format_pids(_in_flight));
+        const int64_t test_case_id = (*iter).second.test_case_id;
+        const int slot = (*iter).second.slot;
+        _in_flight.erase(iter);
+        _busy_slots[slot] = false;
+        _slot_freed_at[slot] = datetime::timestamp::now();
+
+        // Every in-flight test other than the first holds a token, so give one
+        // back as soon as possible for other make(1) jobs to use.
+        if (_jobserver && _jobserver.get().held() > 0)
+            _jobserver.get().release();
+
+        const id_to_repetition_map::iterator repeat_iter = _repetitions.find(
+            test_case_id);
+        if (repeat_iter != _repetitions.end()) {
+            repetition& state = (*repeat_iter).second;
+            if (complete_run(result_handle, slot, state, _tx, _ids_cache) &&
+                _options.repeat_until_fail && !_stopped) {
+                LI(F("Stopping repetitions after a failure of %s") %
+                   test_case_id);
+                _stopped = true;
+            }
+            if (state.started == state.finished &&
+                !wants_more_runs(state, _options.repeat, _stopped)) {
+                if (finish_repetitions(state, _tx, _ids_cache, _cache_keys,
+                                       _cache, _hooks))
+                    ++_failed_tests;
+                _repetitions.erase(repeat_iter);
+            }
+            if (failed_enough() || past_deadline(_deadline))
+                _stopped = true;
+
+            // Tests that were waiting for a free slot to run again are done if
+            // they have no runs left in flight.
+            if (_stopped)
+                _failed_tests += flush_repetitions(
+                    _repeat_queue, _repetitions, _tx, _ids_cache, _cache_keys,
+                    _cache, _hooks);
+            return;
+        }
+
+        int& attempts = _failed_attempts[test_case_id];
+        if (!failed_enough() && !past_deadline(_deadline) &&
+            needs_retry(result_handle, attempts, _options.retries)) {
+            ++attempts;
+            _retry_queue.push_back(pending_retry(result_handle, test_case_id,
+                                                 slot));
+        } else {
+            _failed_attempts.erase(test_case_id);
+            if (finish_test(result_handle, test_case_id, slot, _tx, _ids_cache,
+                            _cache_keys, _cache, _hooks))
+                ++_failed_tests;
+        }
+    }
+
+    /// Records the failed test cases waiting to run again as they are.
+    ///
+    /// \post The retry queue is empty.
+    void
+    finish_retries(void)
+    {
+        for (std::deque< pending_retry >::const_iterator
+                 iter = _retry_queue.begin(); iter != _retry_queue.end();
+             ++iter) {
+            LI(F("Not retrying %s as the run is stopping") %
+               (*iter).test_case_id);
+            _failed_attempts.erase((*iter).test_case_id);
+            if (finish_test((*iter).result_handle, (*iter).test_case_id,
+                            (*iter).slot, _tx, _ids_cache, _cache_keys, _cache,
+                            _hooks))
+                ++_failed_tests;
+        }
+        _retry_queue.clear();
+    }
+
+public:
+    /// Constructor.
+    ///
+    /// \param handle_ Scheduler handle.
+    /// \param tx_ Writable transaction where to store the results.
+    /// \param options_ Settings that control how the test cases run.
+    /// \param user_config_ The end-user configuration properties.
+    /// \param durations_ Time the test cases usually take to run.
+    /// \param deadline_ Time by which the run has to end, if any.
+    /// \param cache_ The result cache, if enabled.
+    /// \param fingerprints_ Cache of already-computed fingerprints.
+    /// \param hooks_ The hooks for this execution.
+    /// \param slots Number of test cases that can run concurrently.
+    run_state(scheduler::scheduler_handle& handle_,
+              store::write_transaction& tx_,
+              const drivers::run_tests::options& options_,
+              const config::tree& user_config_,
+              const durations_map& durations_,
+              const optional< datetime::timestamp >& deadline_,
+              optional< engine::result_cache >& cache_,
+              fingerprints_map& fingerprints_,
+              drivers::run_tests::base_hooks& hooks_,
+              const std::size_t slots) :
+        _handle(handle_), _tx(tx_), _options(options_),
+        _user_config(user_config_), _durations(durations_),
+        _deadline(deadline_), _cache(cache_), _fingerprints(fingerprints_),
+        _hooks(hooks_),
+        _repeating(options_.repeat != 1 || options_.repeat_until_fail),
+        _busy_slots(slots + 1, false), _slot_freed_at(slots + 1),
+        _stopped(false), _failed_tests(0), _stopped_early(false)
+    {
+        // When running under make(1), share its concurrency budget.  The first
+        // in-flight test runs on our implicit token and every other test needs
+        // an extra token from the jobserver, with the parallelism setting
+        // still acting as an upper bound.
+        if (slots > 1)
+            _jobserver = utils::jobserver::from_environment();
+    }
+
+    /// Returns the number of test cases in flight.
+    ///
+    /// \return A count of running subprocesses.
+    std::size_t
+    in_flight(void) const
+    {
+        return _in_flight.size();
+    }
+
+    /// Checks if there are failed test cases waiting to run again.
+    ///
+    /// \return True if start_retry() has work to do.
+    bool
+    retry_pending(void) const
+    {
+        return !_retry_queue.empty();
+    }
+
+    /// Checks if there are repeated test cases waiting to run again.
+    ///
+    /// \return True if start_repetition() has work to do.
+    bool
+    repetition_pending(void) const
+    {
+        return !_repeat_queue.empty();
+    }
+
+    /// Checks if nothing is running nor waiting to run again.
+    ///
+    /// \return True if all the started test cases have been recorded.
+    bool
+    idle(void) const
+    {
+        return _in_flight.empty() && _retry_queue.empty() &&
+            _repetitions.empty();
+    }
+
+    /// Determines whether enough tests failed to stop running any more of them.
+    ///
+    /// \return True if no more tests have to start; false otherwise.
+    bool
+    failed_enough(void) const
+    {
+        return _options.fail_fast > 0 && _failed_tests >= _options.fail_fast;
+    }
+
+    /// Checks if the run stopped before running all the test cases.
+    ///
+    /// \return True if some test cases did not run or were terminated.
+    bool
+    stopped_early(void) const
+    {
+        return _stopped_early;
+    }
+
+    /// Records that the run stopped before running all the test cases.
+    void
+    mark_stopped_early(void)
+    {
+        _stopped_early = true;
+    }
+
+    /// Grabs a jobserver token if one is needed to start another test case.
+    ///
+    /// \return True if the test case can start; false if it has to wait.
+    bool
+    acquire_token(void)
+    {
+        return !_jobserver || _in_flight.empty() ||
+            _jobserver.get().try_acquire();
+    }
+
+    /// Computes the key under which the result of a test case is cached.
+    ///
+    /// \param match Test program and test case to look up.
+    ///
+    /// \return The cache key, or none if the cache is disabled or the test
+    /// case is not cacheable.
+    optional< std::string >
+    cache_key(const engine::scan_result& match)
+    {
+        if (!_cache)
+            return none;
+        return find_cache_key(*match.first, match.second, _user_config,
+                              _fingerprints);
+    }
+
+    /// Records the result of a test case from the result cache, if there.
+    ///
+    /// \param match Test program and test case to look up.
+    /// \param key The key under which the result of the test case is cached.
+    ///
+    /// \return True if the result was in the cache and has been recorded;
+    /// false if the test case has to run.
+    bool
+    put_cached(const engine::scan_result& match, const std::string& key)
+    {
+        const optional< engine::cached_result > cached = _cache.get().get(key);
+        if (!cached)
+            return false;
+        put_cached_test_result(match, key, cached.get(), _tx, _ids_cache,
+                               _user_config, _fingerprints, _hooks);
+        return true;
+    }
+
+    /// Records a test case that is not run because it does not fit in the
+    /// time budget.
+    ///
+    /// \param match Test program and test case that is not run.
+    void
+    put_over_budget(const engine::scan_result& match)
+    {
+        put_over_budget_result(match, _tx, _ids_cache, _user_config,
+                               _fingerprints, _hooks);
+    }
+
+    /// Starts the first run of a test case.
+    ///
+    /// \param match Test program and test case to start.
+    /// \param key The key under which to cache the result of the test case, if
+    ///     it is cacheable.
+    void
+    start(const engine::scan_result& match, const optional< std::string >& key)
+    {
+        const int slot = claim_slot(_busy_slots, _slot_freed_at);
+        const pid_and_id_pair pid_id = start_test(
+            _handle, match, _tx, _ids_cache, _user_config, _fingerprints,
+            _durations, _hooks);
+        track(pid_id, slot);
+        if (key)
+            _cache_keys[pid_id.second] = key.get();
+        if (_repeating) {
+            const repetition state(match, pid_id.second);
+            _repetitions.insert(std::make_pair(pid_id.second, state));
+            if (wants_more_runs(state, _options.repeat, _stopped))
+                _repeat_queue.push_back(pid_id.second);
+        }
+    }
+
+    /// Starts the oldest failed test case waiting to run again.
+    ///
+    /// Once enough tests failed or the time budget is exhausted, the test
+    /// cases waiting to run again are not started: their last failed attempts
+    /// become their results instead.
+    ///
+    /// \return True if a test case started; false if there are none waiting,
+    /// if the retries stopped or if there are no jobserver tokens available.
+    bool
+    start_retry(void)
+    {
+        if (_retry_queue.empty())
+            return false;
+        if (failed_enough() || past_deadline(_deadline)) {
+            finish_retries();
+            return false;
+        }
+        if (!acquire_token())
+            return false;
+
+        const pending_retry retry = _retry_queue.front();
+        _retry_queue.pop_front();
+
+        const scheduler::test_result_handle* test_result_handle =
+            dynamic_cast< const scheduler::test_result_handle* >(
+                retry.result_handle.get());
+        const engine::scan_result match(test_result_handle->test_program(),
+                                        test_result_handle->test_case_name());
+        retry_test(retry.result_handle, retry.test_case_id,
+                   _failed_attempts[retry.test_case_id], retry.slot, _tx,
+                   _ids_cache, _cache_keys, _hooks);
+
+        const int slot = claim_slot(_busy_slots, _slot_freed_at);
+        track(restart_test(_handle, match, retry.test_case_id, _user_config,
+                           _durations, _hooks), slot);
+        return true;
+    }
+
+    /// Starts the next run of the oldest repeated test case waiting to run.
+    ///
+    /// If the time budget is exhausted, the repetitions stop instead.
+    ///
+    /// \return True if a test case started; false if there are none waiting,
+    /// if the repetitions stopped or if there are no jobserver tokens
+    /// available.
+    bool
+    start_repetition(void)
+    {
+        if (_repeat_queue.empty())
+            return false;
+        if (past_deadline(_deadline)) {
+            _stopped = true;
+            _failed_tests += flush_repetitions(
+                _repeat_queue, _repetitions, _tx, _ids_cache, _cache_keys,
+                _cache, _hooks);
+            return false;
+        }
+        if (!acquire_token())
+            return false;
+
+        repetition& state = (*_repetitions.find(_repeat_queue.front())).second;
+        _repeat_queue.pop_front();
+        state.started++;
+        if (wants_more_runs(state, _options.repeat, _stopped))
+            _repeat_queue.push_back(state.test_case_id);
+
+        const int slot = claim_slot(_busy_slots, _slot_freed_at);
+        const scheduler::exec_handle exec_handle = _handle.spawn_test(
+            state.match.first, state.match.second, _user_config, none, none,
+            adaptive_timeout(state.match, _durations, _user_config));
+        track(pid_and_id_pair(exec_handle, state.test_case_id), slot);
+        return true;
+    }
+
+    /// Terminates the test cases in flight once enough tests failed.
+    ///
+    /// The test cases still go through their cleanup routines and get a
+    /// result once they complete so that the results file remains consistent.
+    ///
+    /// Test cases are only terminated once, so this can be called repeatedly
+    /// while waiting for them to complete.
+    void
+    terminate_in_flight(void)
+    {
+        for (pid_to_test_map::iterator iter = _in_flight.begin();
+             iter != _in_flight.end(); ++iter) {
+            if ((*iter).second.terminated)
+                continue;
+            _handle.terminate_test((*iter).first, "Terminated because too many "
+                                   "other tests failed");
+            (*iter).second.terminated = true;
+            _stopped_early = true;
+        }
+    }
+
+    /// Waits for any test case in flight to complete and processes it.
+    ///
+    /// \pre There is at least one test case in flight.
+    void
+    wait_any(void)
+    {
+        PRE(!_in_flight.empty());
+        complete(_handle.wait_any());
+    }
+};
+
+
 }  // anonymous namespace
 
 
@@ -240,12 +1766,23 @@ drivers::run_tests::base_hooks::~base_hooks(void)
 }
 
 
+/// Constructs the default settings to run the test cases.
+drivers::run_tests::options::options(void) :
+    retries(0),
+    repeat(1),
+    repeat_until_fail(false),
+    fail_fast(0)
+{
+}
+
+
 /// Executes the operation.
 ///
 /// \param kyuafile_path The path to the Kyuafile to be loaded.
 /// \param build_root If not none, path to the built test programs.
 /// \param store_path The path to the store to be used.
 /// \param filters The test case filters as provided by the user.
+/// \param run_options Settings that control how the test cases run.
 /// \param user_config The end-user configuration properties.
 /// \param hooks The hooks for this execution.
 ///
@@ -255,13 +1792,34 @@ drivers::run_tests::drive(const fs::path& kyuafile_path,
                           const optional< fs::path > build_root,
                           const fs::path& store_path,
                           const std::set< engine::test_filter >& filters,
+                          const options& run_options,
                           const config::tree& user_config,
                           base_hooks& hooks)
 {
+    const datetime::timestamp start_time = datetime::timestamp::now();
+
+    PRE(run_options.repeat >= 1 ||
+        (run_options.repeat == 0 && run_options.repeat_until_fail));
+    PRE(run_options.fail_fast >= 0);
+    const bool repeating = run_options.repeat != 1 ||
+        run_options.repeat_until_fail;
+
     scheduler::scheduler_handle handle = scheduler::setup();
 
+    optional< datetime::timestamp > deadline;
+    if (run_options.time_budget) {
+        deadline = budget_deadline(start_time, run_options.time_budget.get());
+        handle.set_deadline(deadline.get(), "Terminated at the end of the "
+                            "time budget");
+    }
+    durations_map durations;
+    if (run_options.time_budget ||
+        user_config.is_set("adaptive_timeout_factor"))
+        durations = load_durations(run_options.history);
+
     const engine::kyuafile kyuafile = engine::kyuafile::load(
-        kyuafile_path, build_root, user_config, handle);
+        kyuafile_path, build_root, user_config, handle,
+        layout::query_kyuafile_cache_dir());
     store::write_backend db = store::write_backend::open_rw(store_path);
     store::write_transaction tx = db.start_write();
 
@@ -269,76 +1827,195 @@ drivers::run_tests::drive(const fs::path& kyuafile_path,
         const model::context context = scheduler::current_context();
         (void)tx.put_context(context);
     }
+    if (run_options.rerun_of)
+        tx.put_rerun_of(run_options.rerun_of.get());
+
+    fingerprints_map fingerprints;
+
+    // Test programs whose fingerprint matches that of a previous run in which
+    // they passed are not run again: their results are copied instead.
+    model::test_programs_vector test_programs;
+    std::set< engine::test_filter > reused_filters;
+    if (run_options.reuse_from) {
+        const previous_programs_map previous = load_previous_programs(
+            run_options.reuse_from.get());
+        const engine::test_filters reuse_filters(filters);
+        for (model::test_programs_vector::const_iterator
+                 iter = kyuafile.test_programs().begin();
+             iter != kyuafile.test_programs().end(); ++iter) {
+            const model::test_program_ptr test_program = *iter;
+            const previous_programs_map::const_iterator program =
+                previous.find(test_program->relative_path());
+            if (program != previous.end() &&
+                reuse_filters.match_test_program(
+                    test_program->relative_path())) {
+                const optional< std::string > fingerprint =
+                    program_fingerprint(*test_program, user_config,
+                                        fingerprints);
+                if (fingerprint &&
+                    fingerprint.get() == (*program).second.fingerprint) {
+                    LI(F("Reusing previous results of unchanged test "
+                         "program %s") % test_program->relative_path());
+                    reuse_test_program((*program).second, reuse_filters,
+                                       run_options.reuse_from.get(), tx,
+                                       reused_filters, hooks);
+                    continue;
+                }
+            }
+            test_programs.push_back(test_program);
+        }
+    } else {
+        test_programs = kyuafile.test_programs();
+    }
 
-    engine::scanner scanner(kyuafile.test_programs(), filters);
+    engine::scanner scanner(test_programs, filters);
 
-    path_to_id_map ids_cache;
-    pid_to_id_map in_flight;
-    std::vector< engine::scan_result > exclusive_tests;
+    // Test cases that failed recently run first because they are the most
+    // likely to fail again.  Note that an empty set of filters matches all
+    // test cases, so only scan for the prioritized ones if there are any.
+    engine::scanner priority_scanner(test_programs, run_options.prioritized);
+    engine::scanner* priority_scanner_ptr =
+        run_options.prioritized.empty() ? NULL : &priority_scanner;
+    const engine::test_filters user_filters(filters);
+    std::set< engine::scan_result > prioritized_tests;
+
+    // The point of repeating tests is to run them, so bypass the cache.
+    optional< engine::result_cache > cache;
+    if (!repeating)
+        cache = open_result_cache(user_config);
 
     const std::size_t slots = user_config.lookup< config::positive_int_node >(
         "parallelism");
     INV(slots >= 1);
+    run_state state(handle, tx, run_options, user_config, durations, deadline,
+                    cache, fingerprints, hooks, slots);
+    std::vector< exclusive_test > exclusive_tests;
+
+    // Next test to start, if it was deferred due to a lack of jobserver tokens.
+    optional< engine::scan_result > pending;
     do {
-        INV(in_flight.size() <= slots);
+        INV(state.in_flight() <= slots);
 
         // Spawn as many jobs as needed to fill our execution slots.  We do this
         // first with the assumption that the spawning is faster than any single
         // job, so we want to keep as many jobs in the background as possible.
-        while (in_flight.size() < slots) {
-            optional< engine::scan_result > match = scanner.yield();
-            if (!match)
+        while (state.in_flight() < slots) {
+            // Failed tests run again before any new tests so that their final
+            // results are known as early as possible.
+            if (state.retry_pending()) {
+                if (!state.start_retry())
+                    break;
+                continue;
+            }
+
+            if (state.failed_enough())
                 break;
+
+            optional< engine::scan_result > match;
+            if (pending) {
+                match = pending;
+                pending = none;
+            } else {
+                match = yield_test(scanner, priority_scanner_ptr, user_filters,
+                                   prioritized_tests);
+            }
+            if (!match) {
+                // Once all tests have started, keep the slots busy with
+                // further runs of the repeated ones.
+                if (!state.start_repetition())
+                    break;
+                continue;
+            }
             const model::test_program_ptr test_program = match.get().first;
             const std::string& test_case_name = match.get().second;
 
+            // Cacheable tests whose inputs did not change since their result
+            // was cached need not run at all, even if they are exclusive.
+            const optional< std::string > cache_key = state.cache_key(
+                match.get());
+            if (cache_key && state.put_cached(match.get(), cache_key.get()))
+                continue;
+
             const model::test_case& test_case = test_program->find(
                 test_case_name);
             if (test_case.get_metadata().is_exclusive()) {
                 // Exclusive tests get processed later, separately.
-                exclusive_tests.push_back(match.get());
+                exclusive_tests.push_back(exclusive_test(match.get(),
+                                                         cache_key));
                 continue;
             }
 
-            const pid_and_id_pair pid_id = start_test(
-                handle, match.get(), tx, ids_cache, user_config, hooks);
-            INV_MSG(in_flight.find(pid_id.first) == in_flight.end(),
-                    F("Spawned test has PID of still-tracked process %s") %
-                    pid_id.first);
-            in_flight.insert(pid_id);
+            if (deadline && !fits_in_budget(match.get(), durations,
+                                            deadline.get())) {
+                state.put_over_budget(match.get());
+                continue;
+            }
+
+            if (!state.acquire_token()) {
+                pending = match;
+                break;
+            }
+
+            state.start(match.get(), cache_key);
         }
 
+        // Once enough tests failed, terminate those in flight.
+        if (state.failed_enough())
+            state.terminate_in_flight();
+
         // If there are any used slots, consume any at random and return the
         // result.  We consume slots one at a time to give preference to the
         // spawning of new tests as detailed above.
-        if (!in_flight.empty()) {
-            scheduler::result_handle_ptr result_handle = handle.wait_any();
-
-            const pid_to_id_map::iterator iter = in_flight.find(
-                result_handle->original_pid());
-            INV_MSG(iter != in_flight.end(),
-                    F("Lost track of in-flight PID %s; tracking %s") %
-                    result_handle->original_pid() % format_pids(in_flight));
-            const int64_t test_case_id = (*iter).second;
-            in_flight.erase(iter);
-
-            finish_test(result_handle, test_case_id, tx, hooks);
-        }
-    } while (!in_flight.empty() || !scanner.done());
+        if (state.in_flight() > 0)
+            state.wait_any();
+    } while (state.in_flight() > 0 || state.retry_pending() ||
+             (!state.failed_enough() &&
+              (pending || state.repetition_pending() || !scanner.done())));
+    INV(state.idle());
+    if (state.failed_enough() && (pending || !scanner.done()))
+        state.mark_stopped_early();
 
-    // Run any exclusive tests that we spotted earlier sequentially.
-    for (std::vector< engine::scan_result >::const_iterator
+    // Run any exclusive tests that we spotted earlier sequentially.  Each test
+    // goes through all of its retries and repetitions before the next starts.
+    for (std::vector< exclusive_test >::const_iterator
              iter = exclusive_tests.begin(); iter != exclusive_tests.end();
-             ++iter) {
-        const pid_and_id_pair data = start_test(
-            handle, *iter, tx, ids_cache, user_config, hooks);
-        scheduler::result_handle_ptr result_handle = handle.wait_any();
-        finish_test(result_handle, data.second, tx, hooks);
+         ++iter) {
+        if (state.failed_enough()) {
+            state.mark_stopped_early();
+            break;
+        }
+        if (deadline && !fits_in_budget((*iter).first, durations,
+                                        deadline.get())) {
+            state.put_over_budget((*iter).first);
+            continue;
+        }
+
+        state.start((*iter).first, (*iter).second);
+        while (state.in_flight() > 0) {
+            state.wait_any();
+            if (!state.start_retry())
+                (void)state.start_repetition();
+        }
     }
+    INV(state.idle());
 
     tx.commit();
 
+    if (cache)
+        cache.get().trim();
+
     handle.cleanup();
 
-    return result(scanner.unused_filters());
+    // If we stopped early, the filters that did not match any test case may
+    // just not have had the chance to do so.
+    std::set< engine::test_filter > unused_filters;
+    if (!state.stopped_early()) {
+        const std::set< engine::test_filter > scanner_unused =
+            scanner.unused_filters();
+        std::set_difference(scanner_unused.begin(), scanner_unused.end(),
+                            reused_filters.begin(), reused_filters.end(),
+                            std::inserter(unused_filters,
+                                          unused_filters.begin()));
+    }
+    return result(unused_filters, state.stopped_early());
 }
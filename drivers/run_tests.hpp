@@ -38,14 +38,15 @@
 
 #include <set>
 #include <string>
+#include <vector>
 
 #include "engine/filters.hpp"
 #include "model/test_program.hpp"
 #include "model/test_result_fwd.hpp"
 #include "utils/config/tree_fwd.hpp"
-#include "utils/datetime_fwd.hpp"
-#include "utils/fs/path_fwd.hpp"
-#include "utils/optional_fwd.hpp"
+#include "utils/datetime.hpp"
+#include "utils/fs/path.hpp"
+#include "utils/optional.hpp"
 
 namespace drivers {
 namespace run_tests {
@@ -73,6 +74,111 @@ public:
                             const std::string& test_case_name,
                             const model::test_result& result,
                             const utils::datetime::delta& duration) = 0;
+
+    /// Called when an attempt of a test case failed and it will run again.
+    ///
+    /// got_test_case() is called again when the new attempt begins, and
+    /// got_result() or got_retry() are called once it completes.
+    ///
+    /// \param test_program The test program containing the test case.
+    /// \param test_case_name The name of the executed test case.
+    /// \param result The result of the failed attempt.
+    /// \param duration The time it took to run the failed attempt.
+    virtual void got_retry(const model::test_program& test_program,
+                           const std::string& test_case_name,
+                           const model::test_result& result,
+                           const utils::datetime::delta& duration) = 0;
+
+    /// Called when all the runs of a repeated test case completed.
+    ///
+    /// got_result() is called right after with the result of the first run
+    /// that failed or, if all passed, with the result of the last run.
+    ///
+    /// \param test_program The test program containing the test case.
+    /// \param test_case_name The name of the repeated test case.
+    /// \param runs The number of times the test case ran.
+    /// \param failures The number of runs that did not yield a good result.
+    virtual void got_repetitions(const model::test_program& test_program,
+                                 const std::string& test_case_name,
+                                 const int runs, const int failures) = 0;
+
+    /// Called when a result is carried over from a previous run.
+    ///
+    /// \param test_program The test program containing the test case.
+    /// \param test_case_name The name of the test case that was not run.
+    /// \param result The result of the test case in the previous run.
+    /// \param duration The time it took to run the test in the previous run.
+    virtual void got_reused_result(const model::test_program& test_program,
+                                   const std::string& test_case_name,
+                                   const model::test_result& result,
+                                   const utils::datetime::delta& duration) = 0;
+
+    /// Called when a result is served from the result cache.
+    ///
+    /// \param test_program The test program containing the test case.
+    /// \param test_case_name The name of the test case that was not run.
+    /// \param result The cached result of the test case.
+    /// \param duration The time it took to run the test when it was cached.
+    virtual void got_cached_result(const model::test_program& test_program,
+                                   const std::string& test_case_name,
+                                   const model::test_result& result,
+                                   const utils::datetime::delta& duration) = 0;
+
+    /// Called when a test case is not run because it does not fit in the time
+    /// budget.
+    ///
+    /// \param test_program The test program containing the test case.
+    /// \param test_case_name The name of the test case that was not run.
+    virtual void got_over_budget(const model::test_program& test_program,
+                                 const std::string& test_case_name) = 0;
+};
+
+
+/// Settings that control how the driver runs the test cases.
+///
+/// The default values run every selected test case once, in the order in which
+/// they are found, and record no link to previous results files.
+class options {
+public:
+    /// If not none, path to the results file from which the filters were
+    /// computed, to be recorded in the new results file.
+    utils::optional< utils::fs::path > rerun_of;
+
+    /// If not none, path to the results file of a previous run from which to
+    /// carry over the results of the test programs that did not change
+    /// instead of running them again.
+    utils::optional< utils::fs::path > reuse_from;
+
+    /// Number of times to run again a test that fails or breaks, unless the
+    /// test case overrides it.
+    int retries;
+
+    /// Number of times to run every test case, or 0 to repeat them until one
+    /// fails.
+    int repeat;
+
+    /// Whether to stop repeating the test cases as soon as any run does not
+    /// yield a good result.
+    bool repeat_until_fail;
+
+    /// Number of failed tests after which to stop starting new ones and to
+    /// terminate those in flight, or 0 to run all of them.
+    int fail_fast;
+
+    /// Filters matching the test cases to run before any others, such as
+    /// those that failed recently.
+    std::set< engine::test_filter > prioritized;
+
+    /// If not none, maximum wall-clock time for the run.  Test cases that do
+    /// not fit in it are not run and those that run past it are terminated.
+    utils::optional< utils::datetime::delta > time_budget;
+
+    /// Paths to the results files of previous runs from which to estimate how
+    /// long the test cases take to run, used to decide which test cases fit in
+    /// the time budget and to compute adaptive timeouts.
+    std::vector< utils::fs::path > history;
+
+    options(void);
 };
 
 
@@ -85,11 +191,17 @@ public:
     /// test filter does not match any test case, it is probably a typo.
     std::set< engine::test_filter > unused_filters;
 
+    /// Whether some test cases did not run or were terminated because too many
+    /// others failed.
+    bool stopped_early;
+
     /// Initializer for the tuple's fields.
     ///
     /// \param unused_filters_ The filters that did not match any test case.
-    result(const std::set< engine::test_filter >& unused_filters_) :
-        unused_filters(unused_filters_)
+    /// \param stopped_early_ Whether not all test cases ran to completion.
+    result(const std::set< engine::test_filter >& unused_filters_,
+           const bool stopped_early_) :
+        unused_filters(unused_filters_), stopped_early(stopped_early_)
     {
     }
 };
@@ -97,7 +209,7 @@ public:
 
 result drive(const utils::fs::path&, const utils::optional< utils::fs::path >,
              const utils::fs::path&, const std::set< engine::test_filter >&,
-             const utils::config::tree&, base_hooks&);
+             const options&, const utils::config::tree&, base_hooks&);
 
 
 }  // namespace run_tests
@@ -50,6 +50,7 @@ extern "C" {
 #include "utils/logging/macros.hpp"
 #include "utils/optional.ipp"
 #include "utils/process/exceptions.hpp"
+#include "utils/process/exec_plan.hpp"
 #include "utils/process/operations.hpp"
 #include "utils/process/status.hpp"
 #include "utils/stream.hpp"
@@ -165,25 +166,31 @@ engine::atf_interface::parse_list(const optional< process::status >& status,
 }
 
 
-/// Executes a test case of the test program.
+/// Checks whether plan_test() is implemented by this interface.
 ///
-/// This method is intended to be called within a subprocess and is expected
-/// to terminate execution either by exec(2)ing the test program or by
-/// exiting with a failure.
+/// \return Always true.
+bool
+engine::atf_interface::supports_plan_test(void) const
+{
+    return true;
+}
+
+
+/// Computes how to execute a test case of the test program.
 ///
 /// \param test_program The test program to execute.
 /// \param test_case_name Name of the test case to invoke.
 /// \param vars User-provided variables to pass to the test program.
 /// \param control_directory Directory where the interface may place control
 ///     files.
-void
-engine::atf_interface::exec_test(const model::test_program& test_program,
+///
+/// \return The plan to execute the test case.
+process::exec_plan
+engine::atf_interface::plan_test(const model::test_program& test_program,
                                  const std::string& test_case_name,
                                  const config::properties_map& vars,
                                  const fs::path& control_directory) const
 {
-    utils::setenv("__RUNNING_INSIDE_ATF_RUN", "internal-yes-value");
-
     process::args_vector args;
     for (config::properties_map::const_iterator iter = vars.begin();
          iter != vars.end(); ++iter) {
@@ -193,9 +200,36 @@ engine::atf_interface::exec_test(const model::test_program& test_program,
     args.push_back(F("-r%s") % (control_directory / result_name));
     args.push_back(test_case_name);
 
+    process::exec_plan plan(test_program.absolute_path(), args);
+    plan.set_env("__RUNNING_INSIDE_ATF_RUN", "internal-yes-value");
+    return plan;
+}
+
+
+/// Executes a test case of the test program.
+///
+/// This method is intended to be called within a subprocess and is expected
+/// to terminate execution either by exec(2)ing the test program or by
+/// exiting with a failure.
+///
+/// \param test_program The test program to execute.
+/// \param test_case_name Name of the test case to invoke.
+/// \param vars User-provided variables to pass to the test program.
+/// \param control_directory Directory where the interface may place control
+///     files.
+void
+engine::atf_interface::exec_test(const model::test_program& test_program,
+                                 const std::string& test_case_name,
+                                 const config::properties_map& vars,
+                                 const fs::path& control_directory) const
+{
+    const process::exec_plan plan = plan_test(test_program, test_case_name,
+                                              vars, control_directory);
+    plan.apply();
+
     auto e = execenv::get(test_program, test_case_name);
     e->init();
-    e->exec(args);
+    e->exec(plan.args());
     __builtin_unreachable();
 }
 
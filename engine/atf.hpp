@@ -48,6 +48,13 @@ public:
         const utils::fs::path&,
         const utils::fs::path&) const;
 
+    bool supports_plan_test(void) const;
+
+    utils::process::exec_plan plan_test(
+        const model::test_program&, const std::string&,
+        const utils::config::properties_map&,
+        const utils::fs::path&) const;
+
     void exec_test(const model::test_program&, const std::string&,
                    const utils::config::properties_map&,
                    const utils::fs::path&) const
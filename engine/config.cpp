@@ -37,17 +37,20 @@
 #include "engine/exceptions.hpp"
 #include "engine/execenv/execenv.hpp"
 #include "utils/config/exceptions.hpp"
+#include "utils/config/nodes.ipp"
 #include "utils/config/parser.hpp"
 #include "utils/config/tree.ipp"
 #include "utils/passwd.hpp"
 #include "utils/text/exceptions.hpp"
 #include "utils/text/operations.ipp"
+#include "utils/units.hpp"
 
 namespace config = utils::config;
 namespace execenv = engine::execenv;
 namespace fs = utils::fs;
 namespace passwd = utils::passwd;
 namespace text = utils::text;
+namespace units = utils::units;
 
 
 namespace {
@@ -60,11 +63,19 @@ namespace {
 static void
 init_tree(config::tree& tree)
 {
+    tree.define< config::positive_int_node >("adaptive_timeout_factor");
+    tree.define< config::positive_int_node >("adaptive_timeout_floor");
     tree.define< config::string_node >("architecture");
     tree.define< config::strings_set_node >("execenvs");
+    tree.define< config::bool_node >("in_memory_output");
+    tree.define< config::positive_int_node >("max_output_size");
     tree.define< config::positive_int_node >("parallelism");
     tree.define< config::string_node >("platform");
+    tree.define< config::string_node >("result_cache_dir");
+    tree.define< engine::bytes_node >("result_cache_size");
     tree.define< engine::user_node >("unprivileged_user");
+    tree.define< config::bool_node >("use_cgroups");
+    tree.define< engine::bytes_node >("work_directory_tmpfs_size");
     tree.define_dynamic("test_suites");
 }
 
@@ -76,6 +87,7 @@ init_tree(config::tree& tree)
 static void
 set_defaults(config::tree& tree)
 {
+    tree.set< config::positive_int_node >("adaptive_timeout_floor", 30);
     tree.set< config::string_node >("architecture", KYUA_ARCHITECTURE);
 
     std::set< std::string > supported;
@@ -219,6 +231,57 @@ engine::user_node::to_string(void) const
 }
 
 
+/// Copies the node.
+///
+/// \return A dynamically-allocated node.
+config::detail::base_node*
+engine::bytes_node::deep_copy(void) const
+{
+    std::unique_ptr< bytes_node > new_node(new bytes_node());
+    new_node->_value = _value;
+    return new_node.release();
+}
+
+
+/// Pushes the node's value onto the Lua stack.
+///
+/// \param state The Lua state onto which to push the value.
+void
+engine::bytes_node::push_lua(lutok::state& state) const
+{
+    state.push_string(F("%s") % static_cast< uint64_t >(value()));
+}
+
+
+/// Sets the value of the node from an entry in the Lua stack.
+///
+/// Numbers are taken as a count of bytes and strings are parsed as bytes
+/// quantities with an optional unit suffix, such as "512M".
+///
+/// \param state The Lua state from which to get the value.
+/// \param value_index The stack index in which the value resides.
+///
+/// \throw value_error If the value in state(value_index) cannot be
+///     processed by this node.
+void
+engine::bytes_node::set_lua(lutok::state& state, const int value_index)
+{
+    if (state.is_number(value_index)) {
+        const long count = state.to_integer(value_index);
+        if (count < 0)
+            throw config::value_error("Bytes quantity cannot be negative");
+        set(units::bytes(count));
+    } else if (state.is_string(value_index)) {
+        try {
+            set(units::bytes::parse(state.to_string(value_index)));
+        } catch (const std::runtime_error& e) {
+            throw config::value_error(e.what());
+        }
+    } else
+        throw config::value_error("Invalid bytes quantity");
+}
+
+
 /// Constructs a config with the built-in settings.
 ///
 /// \return A default test suite configuration.
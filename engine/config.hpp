@@ -38,6 +38,7 @@
 #include "utils/config/tree_fwd.hpp"
 #include "utils/fs/path_fwd.hpp"
 #include "utils/passwd_fwd.hpp"
+#include "utils/units.hpp"
 
 namespace engine {
 
@@ -55,6 +56,16 @@ public:
 };
 
 
+/// Tree node to hold a bytes quantity.
+class bytes_node : public utils::config::native_leaf_node< utils::units::bytes > {
+public:
+    virtual base_node* deep_copy(void) const;
+
+    void push_lua(lutok::state&) const;
+    void set_lua(lutok::state&, const int);
+};
+
+
 utils::config::tree default_config(void);
 utils::config::tree empty_config(void);
 utils::config::tree load_config(const utils::fs::path&);
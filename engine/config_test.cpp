@@ -42,10 +42,12 @@
 #include "utils/cmdline/parser.hpp"
 #include "utils/config/tree.ipp"
 #include "utils/passwd.hpp"
+#include "utils/units.hpp"
 
 namespace config = utils::config;
 namespace fs = utils::fs;
 namespace passwd = utils::passwd;
+namespace units = utils::units;
 
 using utils::none;
 using utils::optional;
@@ -74,6 +76,11 @@ set_mock_users(void)
 static void
 validate_defaults(const config::tree& config)
 {
+    ATF_REQUIRE(!config.is_set("adaptive_timeout_factor"));
+    ATF_REQUIRE_EQ(
+        30,
+        config.lookup< config::positive_int_node >("adaptive_timeout_floor"));
+
     ATF_REQUIRE_EQ(
         KYUA_ARCHITECTURE,
         config.lookup< config::string_node >("architecture"));
@@ -117,6 +124,21 @@ ATF_TEST_CASE_BODY(config__set__parallelism)
 }
 
 
+ATF_TEST_CASE_WITHOUT_HEAD(config__set__work_directory_tmpfs_size);
+ATF_TEST_CASE_BODY(config__set__work_directory_tmpfs_size)
+{
+    config::tree user_config = engine::default_config();
+    ATF_REQUIRE(!user_config.is_set("work_directory_tmpfs_size"));
+    user_config.set_string("work_directory_tmpfs_size", "512M");
+    ATF_REQUIRE_EQ(
+        units::bytes(512 * units::MB),
+        user_config.lookup< engine::bytes_node >("work_directory_tmpfs_size"));
+    ATF_REQUIRE_THROW_RE(
+        config::error, "work_directory_tmpfs_size",
+        user_config.set_string("work_directory_tmpfs_size", "foo"));
+}
+
+
 ATF_TEST_CASE_WITHOUT_HEAD(config__load__defaults);
 ATF_TEST_CASE_BODY(config__load__defaults)
 {
@@ -162,6 +184,36 @@ ATF_TEST_CASE_BODY(config__load__overrides)
 }
 
 
+ATF_TEST_CASE_WITHOUT_HEAD(config__load__bytes);
+ATF_TEST_CASE_BODY(config__load__bytes)
+{
+    atf::utils::create_file(
+        "config",
+        "syntax(2)\n"
+        "work_directory_tmpfs_size = '2G'\n");
+    ATF_REQUIRE_EQ(
+        units::bytes(2 * units::GB),
+        engine::load_config(fs::path("config")).lookup< engine::bytes_node >(
+            "work_directory_tmpfs_size"));
+
+    atf::utils::create_file(
+        "config",
+        "syntax(2)\n"
+        "work_directory_tmpfs_size = 1048576\n");
+    ATF_REQUIRE_EQ(
+        units::bytes(units::MB),
+        engine::load_config(fs::path("config")).lookup< engine::bytes_node >(
+            "work_directory_tmpfs_size"));
+
+    atf::utils::create_file(
+        "config",
+        "syntax(2)\n"
+        "work_directory_tmpfs_size = -1\n");
+    ATF_REQUIRE_THROW_RE(engine::load_error, "cannot be negative",
+                         engine::load_config(fs::path("config")));
+}
+
+
 ATF_TEST_CASE_WITHOUT_HEAD(config__load__lua_error);
 ATF_TEST_CASE_BODY(config__load__lua_error)
 {
@@ -195,8 +247,10 @@ ATF_INIT_TEST_CASES(tcs)
 {
     ATF_ADD_TEST_CASE(tcs, config__defaults);
     ATF_ADD_TEST_CASE(tcs, config__set__parallelism);
+    ATF_ADD_TEST_CASE(tcs, config__set__work_directory_tmpfs_size);
     ATF_ADD_TEST_CASE(tcs, config__load__defaults);
     ATF_ADD_TEST_CASE(tcs, config__load__overrides);
+    ATF_ADD_TEST_CASE(tcs, config__load__bytes);
     ATF_ADD_TEST_CASE(tcs, config__load__lua_error);
     ATF_ADD_TEST_CASE(tcs, config__load__bad_syntax__version);
     ATF_ADD_TEST_CASE(tcs, config__load__missing_file);
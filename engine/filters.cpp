@@ -43,6 +43,54 @@ using utils::none;
 using utils::optional;
 
 
+namespace {
+
+
+/// Collects the paths of the filters that match whole test programs.
+///
+/// \param filters The filters to index.
+///
+/// \return The paths of the filters that do not name a test case.
+static std::unordered_set< std::string >
+index_programs(const std::set< engine::test_filter >& filters)
+{
+    std::unordered_set< std::string > programs;
+    for (std::set< engine::test_filter >::const_iterator iter = filters.begin();
+         iter != filters.end(); ++iter) {
+        if ((*iter).test_case.empty())
+            programs.insert((*iter).test_program.str());
+    }
+    return programs;
+}
+
+
+/// Looks for the outermost program filter that matches a test program.
+///
+/// This walks the components of the given path in the same way as
+/// fs::path::is_parent_of does, so a program filter matches the test program
+/// if and only if test_filter::matches_test_program would say so.
+///
+/// \param programs The paths of the filters that match whole test programs.
+/// \param test_program The test program to look up.
+///
+/// \return The path of the matching filter closest to the root, if any.
+static optional< fs::path >
+find_program_filter(const std::unordered_set< std::string >& programs,
+                    fs::path test_program)
+{
+    optional< fs::path > found = none;
+    do {
+        if (programs.find(test_program.str()) != programs.end())
+            found = test_program;
+        test_program = test_program.branch_path();
+    } while (test_program != fs::path(".") && test_program != fs::path("/"));
+    return found;
+}
+
+
+}  // anonymous namespace
+
+
 /// Constructs a filter.
 ///
 /// \param test_program_ The name of the test program or of the subdirectory to
@@ -230,8 +278,14 @@ engine::operator<<(std::ostream& output, const test_filter& object)
 ///
 /// \param filters_ The filters themselves; if empty, no filters are applied.
 engine::test_filters::test_filters(const std::set< test_filter >& filters_) :
-    _filters(filters_)
+    _filters(filters_),
+    _programs(index_programs(filters_))
 {
+    for (std::set< test_filter >::const_iterator iter = _filters.begin();
+         iter != _filters.end(); ++iter) {
+        if (!(*iter).test_case.empty())
+            _test_cases[(*iter).test_program.str()].insert((*iter).test_case);
+    }
 }
 
 
@@ -252,12 +306,8 @@ engine::test_filters::match_test_program(const fs::path& name) const
     if (_filters.empty())
         return true;
 
-    bool matches = false;
-    for (std::set< test_filter >::const_iterator iter = _filters.begin();
-         !matches && iter != _filters.end(); iter++) {
-        matches = (*iter).matches_test_program(name);
-    }
-    return matches;
+    return _test_cases.find(name.str()) != _test_cases.end() ||
+        find_program_filter(_programs, name);
 }
 
 
@@ -268,7 +318,8 @@ engine::test_filters::match_test_program(const fs::path& name) const
 ///
 /// \return A boolean indicating if the test case is matched by any filter and,
 /// if true, a string containing the filter name.  The string is empty when
-/// there are no filters defined.
+/// there are no filters defined.  If several filters match, which can only
+/// happen if they are not disjoint, the one that sorts first is returned.
 engine::test_filters::match
 engine::test_filters::match_test_case(const fs::path& test_program,
                                       const std::string& test_case) const
@@ -278,12 +329,22 @@ engine::test_filters::match_test_case(const fs::path& test_program,
         return match(true, none);
     }
 
+    // A program filter sorts before any filter on a test case of a program
+    // within it, and the outermost program filter sorts before the others.
     optional< test_filter > found = none;
-    for (std::set< test_filter >::const_iterator iter = _filters.begin();
-         !found && iter != _filters.end(); iter++) {
-        if ((*iter).matches_test_case(test_program, test_case))
-            found = *iter;
+    const optional< fs::path > program = find_program_filter(_programs,
+                                                             test_program);
+    if (program) {
+        found = test_filter(program.get(), "");
+    } else {
+        const std::unordered_map< std::string,
+                                  std::unordered_set< std::string > >::
+            const_iterator iter = _test_cases.find(test_program.str());
+        if (iter != _test_cases.end() &&
+            (*iter).second.find(test_case) != (*iter).second.end())
+            found = test_filter(test_program, test_case);
     }
+    INV(!found || found.get().matches_test_case(test_program, test_case));
     INV(!found || match_test_program(test_program));
     return match(static_cast< bool >(found), found);
 }
@@ -317,22 +378,23 @@ engine::test_filters::difference(const std::set< test_filter >& matched) const
 void
 engine::check_disjoint_filters(const std::set< engine::test_filter >& filters)
 {
-    // Yes, this is an O(n^2) algorithm.  However, we can assume that the number
-    // of test filters (which are provided by the user on the command line) on a
-    // particular run is in the order of tens, and thus this should not cause
-    // any serious performance trouble.
-    for (std::set< test_filter >::const_iterator i1 = filters.begin();
-         i1 != filters.end(); i1++) {
-        for (std::set< test_filter >::const_iterator i2 = filters.begin();
-             i2 != filters.end(); i2++) {
-            const test_filter& filter1 = *i1;
-            const test_filter& filter2 = *i2;
-
-            if (i1 != i2 && filter1.contains(filter2)) {
-                throw std::runtime_error(
-                    F("Filters '%s' and '%s' are not disjoint") %
-                    filter1.str() % filter2.str());
-            }
+    // Only program filters can contain other filters, so look up the
+    // components of every filter among them instead of comparing all pairs:
+    // the lists of filters can be long when they come from automation.
+    const std::unordered_set< std::string > programs = index_programs(filters);
+    for (std::set< test_filter >::const_iterator iter = filters.begin();
+         iter != filters.end(); ++iter) {
+        const optional< fs::path > program = find_program_filter(
+            programs, (*iter).test_program);
+        if (!program)
+            continue;
+
+        const test_filter container(program.get(), "");
+        if (container != *iter) {
+            INV(container.contains(*iter));
+            throw std::runtime_error(
+                F("Filters '%s' and '%s' are not disjoint") %
+                container.str() % (*iter).str());
         }
     }
 }
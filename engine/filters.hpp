@@ -41,6 +41,8 @@
 #include <ostream>
 #include <string>
 #include <set>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
 
 #include "utils/fs/path.hpp"
@@ -89,10 +91,22 @@ std::ostream& operator<<(std::ostream&, const test_filter&);
 /// they are not, some filters may never have a chance to do a match, which is
 /// most likely the fault of the user.  To check for non-disjoint filters before
 /// constructing this object, use check_disjoint_filters.
+///
+/// The filters are indexed on construction so that matching a test program or
+/// test case costs time proportional to the depth of its path and not to the
+/// number of filters, which can be large when the filters come from lists of
+/// tests to rerun or shard.
 class test_filters {
     /// The user-provided filters.
     std::set< test_filter > _filters;
 
+    /// Paths of the filters that match whole test programs or subdirectories.
+    std::unordered_set< std::string > _programs;
+
+    /// Names of the test cases to match, keyed by their test program path.
+    std::unordered_map< std::string, std::unordered_set< std::string > >
+        _test_cases;
+
 public:
     explicit test_filters(const std::set< test_filter >&);
 
@@ -32,6 +32,8 @@
 
 #include <atf-c++.hpp>
 
+#include "utils/format/macros.hpp"
+
 namespace fs = utils::fs;
 
 
@@ -381,6 +383,79 @@ ATF_TEST_CASE_BODY(test_filters__match_test_case__some_filters)
     ATF_REQUIRE(!match.first);
 }
 
+ATF_TEST_CASE_WITHOUT_HEAD(test_filters__match_test_case__not_disjoint)
+ATF_TEST_CASE_BODY(test_filters__match_test_case__not_disjoint)
+{
+    std::set< engine::test_filter > raw_filters;
+    raw_filters.insert(mkfilter("a", ""));
+    raw_filters.insert(mkfilter("a/b", ""));
+    raw_filters.insert(mkfilter("a/b/c", "foo"));
+    raw_filters.insert(mkfilter("d", ""));
+    raw_filters.insert(mkfilter("d", "bar"));
+
+    const engine::test_filters filters(raw_filters);
+    engine::test_filters::match match;
+
+    match = filters.match_test_case(fs::path("a/b/c"), "foo");
+    ATF_REQUIRE(match.first);
+    ATF_REQUIRE_EQ("a", match.second.get().str());
+
+    match = filters.match_test_case(fs::path("a/b"), "baz");
+    ATF_REQUIRE(match.first);
+    ATF_REQUIRE_EQ("a", match.second.get().str());
+
+    match = filters.match_test_case(fs::path("d"), "bar");
+    ATF_REQUIRE(match.first);
+    ATF_REQUIRE_EQ("d", match.second.get().str());
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(test_filters__match_test_case__many_filters)
+ATF_TEST_CASE_BODY(test_filters__match_test_case__many_filters)
+{
+    std::set< engine::test_filter > raw_filters;
+    for (int i = 0; i < 1000; ++i) {
+        raw_filters.insert(engine::test_filter(
+            fs::path(F("dir_%s/program") % (i % 10)), F("case_%s") % i));
+    }
+    raw_filters.insert(mkfilter("dir_3/sub", ""));
+    raw_filters.insert(mkfilter("top", ""));
+
+    const engine::test_filters filters(raw_filters);
+
+    const char* programs[] = { "dir_0/program", "dir_3/program", "dir_3/sub",
+                               "dir_3/sub/program", "dir_3/subprogram",
+                               "dir_10/program", "top", "top/program",
+                               "program", NULL };
+    for (const char** program = programs; *program != NULL; ++program) {
+        bool program_matches = false;
+        for (int i = 0; i < 1010; ++i) {
+            const fs::path test_program(*program);
+            const std::string test_case = F("case_%s") % i;
+
+            // Compare against a linear scan of the filters, which is the
+            // reference definition of a match.
+            std::set< engine::test_filter >::const_iterator iter;
+            for (iter = raw_filters.begin(); iter != raw_filters.end(); ++iter)
+                if ((*iter).matches_test_case(test_program, test_case))
+                    break;
+
+            const engine::test_filters::match match = filters.match_test_case(
+                test_program, test_case);
+            if (iter == raw_filters.end()) {
+                ATF_REQUIRE(!match.first);
+            } else {
+                ATF_REQUIRE(match.first);
+                ATF_REQUIRE_EQ(*iter, match.second.get());
+                program_matches = true;
+            }
+        }
+        ATF_REQUIRE_EQ(program_matches,
+                       filters.match_test_program(fs::path(*program)));
+    }
+}
+
+
 
 ATF_TEST_CASE_WITHOUT_HEAD(test_filters__match_test_program__no_filters)
 ATF_TEST_CASE_BODY(test_filters__match_test_program__no_filters)
@@ -487,6 +562,38 @@ ATF_TEST_CASE_BODY(check_disjoint_filters__fail)
                          engine::check_disjoint_filters(filters));
 }
 
+ATF_TEST_CASE_WITHOUT_HEAD(check_disjoint_filters__fail__nested);
+ATF_TEST_CASE_BODY(check_disjoint_filters__fail__nested)
+{
+    std::set< engine::test_filter > filters;
+    filters.insert(mkfilter("a", ""));
+    filters.insert(mkfilter("ab", ""));
+    filters.insert(mkfilter("a/b/c", ""));
+
+    ATF_REQUIRE_THROW_RE(std::runtime_error, "'a'.*'a/b/c'.*not disjoint",
+                         engine::check_disjoint_filters(filters));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(check_disjoint_filters__many);
+ATF_TEST_CASE_BODY(check_disjoint_filters__many)
+{
+    std::set< engine::test_filter > filters;
+    for (int i = 0; i < 10000; ++i) {
+        filters.insert(engine::test_filter(
+            fs::path(F("dir_%s/program") % (i % 100)), F("case_%s") % i));
+    }
+    for (int i = 0; i < 100; ++i)
+        filters.insert(engine::test_filter(fs::path(F("other_%s") % i), ""));
+    engine::check_disjoint_filters(filters);
+
+    filters.insert(mkfilter("dir_42", ""));
+    ATF_REQUIRE_THROW_RE(std::runtime_error,
+                         "'dir_42'.*'dir_42/program:case_.*not disjoint",
+                         engine::check_disjoint_filters(filters));
+}
+
+
 
 ATF_TEST_CASE_WITHOUT_HEAD(filters_state__match_test_program);
 ATF_TEST_CASE_BODY(filters_state__match_test_program)
@@ -556,6 +663,33 @@ ATF_TEST_CASE_BODY(filters_state__unused__some)
     ATF_REQUIRE(exp_unused == state.unused());
 }
 
+ATF_TEST_CASE_WITHOUT_HEAD(filters_state__unused__many);
+ATF_TEST_CASE_BODY(filters_state__unused__many)
+{
+    std::set< engine::test_filter > filters;
+    for (int i = 0; i < 1000; ++i) {
+        filters.insert(engine::test_filter(
+            fs::path(F("dir_%s/program") % (i % 10)), F("case_%s") % i));
+    }
+    filters.insert(mkfilter("top", ""));
+    engine::filters_state state(filters);
+
+    std::set< engine::test_filter > exp_unused = filters;
+    for (int i = 0; i < 1000; i += 2) {
+        const fs::path program(F("dir_%s/program") % (i % 10));
+        ATF_REQUIRE(state.match_test_program(program));
+        ATF_REQUIRE(state.match_test_case(program, F("case_%s") % i));
+        ATF_REQUIRE(!state.match_test_case(program, "other"));
+        exp_unused.erase(engine::test_filter(program, F("case_%s") % i));
+    }
+    ATF_REQUIRE(state.match_test_case(fs::path("top/a"), "b"));
+    exp_unused.erase(mkfilter("top", ""));
+
+    ATF_REQUIRE_EQ(500, exp_unused.size());
+    ATF_REQUIRE(exp_unused == state.unused());
+}
+
+
 
 ATF_INIT_TEST_CASES(tcs)
 {
@@ -578,6 +712,8 @@ ATF_INIT_TEST_CASES(tcs)
 
     ATF_ADD_TEST_CASE(tcs, test_filters__match_test_case__no_filters);
     ATF_ADD_TEST_CASE(tcs, test_filters__match_test_case__some_filters);
+    ATF_ADD_TEST_CASE(tcs, test_filters__match_test_case__not_disjoint);
+    ATF_ADD_TEST_CASE(tcs, test_filters__match_test_case__many_filters);
     ATF_ADD_TEST_CASE(tcs, test_filters__match_test_program__no_filters);
     ATF_ADD_TEST_CASE(tcs, test_filters__match_test_program__some_filters);
     ATF_ADD_TEST_CASE(tcs, test_filters__difference__no_filters);
@@ -586,9 +722,12 @@ ATF_INIT_TEST_CASES(tcs)
 
     ATF_ADD_TEST_CASE(tcs, check_disjoint_filters__ok);
     ATF_ADD_TEST_CASE(tcs, check_disjoint_filters__fail);
+    ATF_ADD_TEST_CASE(tcs, check_disjoint_filters__fail__nested);
+    ATF_ADD_TEST_CASE(tcs, check_disjoint_filters__many);
 
     ATF_ADD_TEST_CASE(tcs, filters_state__match_test_program);
     ATF_ADD_TEST_CASE(tcs, filters_state__match_test_case);
     ATF_ADD_TEST_CASE(tcs, filters_state__unused__none);
     ATF_ADD_TEST_CASE(tcs, filters_state__unused__some);
+    ATF_ADD_TEST_CASE(tcs, filters_state__unused__many);
 }
@@ -0,0 +1,249 @@
+// Copyright 2026 The Kyua Authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// * Neither the name of Google Inc. nor the names of its contributors
+//   may be used to endorse or promote products derived from this software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "engine/fingerprint.hpp"
+
+extern "C" {
+#include <stdint.h>
+}
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <vector>
+
+#include "engine/scheduler.hpp"
+#include "model/metadata.hpp"
+#include "model/test_case.hpp"
+#include "model/test_program.hpp"
+#include "model/types.hpp"
+#include "utils/config/tree.ipp"
+#include "utils/format/macros.hpp"
+#include "utils/fs/path.hpp"
+#include "utils/logging/macros.hpp"
+#include "utils/optional.ipp"
+
+namespace config = utils::config;
+
+using utils::none;
+using utils::optional;
+
+
+namespace {
+
+
+/// Incremental FNV-1a hash of 64 bits.
+///
+/// This is not a cryptographic hash: it only has to tell apart different
+/// builds of the same test program, not resist tampering.
+class fnv1a_hash {
+    /// Current value of the hash.
+    uint64_t _value;
+
+public:
+    /// Constructor.
+    fnv1a_hash(void) : _value(UINT64_C(14695981039346656037))
+    {
+    }
+
+    /// Feeds raw bytes into the hash.
+    ///
+    /// \param data The bytes to add.
+    /// \param length The number of bytes in data.
+    void
+    add(const char* data, const std::size_t length)
+    {
+        for (std::size_t i = 0; i < length; ++i) {
+            _value ^= static_cast< unsigned char >(data[i]);
+            _value *= UINT64_C(1099511628211);
+        }
+    }
+
+    /// Feeds a string into the hash, followed by a terminator.
+    ///
+    /// The terminator ensures that consecutive strings cannot be confused with
+    /// a different split of the same characters.
+    ///
+    /// \param str The string to add.
+    void
+    add(const std::string& str)
+    {
+        add(str.c_str(), str.length() + 1);
+    }
+
+    /// Feeds a collection of key/value pairs into the hash.
+    ///
+    /// \param properties The pairs to add, in their sorted order.
+    void
+    add(const std::map< std::string, std::string >& properties)
+    {
+        for (std::map< std::string, std::string >::const_iterator iter =
+                 properties.begin(); iter != properties.end(); ++iter) {
+            add((*iter).first);
+            add((*iter).second);
+        }
+        add("");
+    }
+
+    /// Returns the current value of the hash.
+    ///
+    /// \return The hash as a string of hexadecimal digits.
+    std::string
+    str(void) const
+    {
+        std::ostringstream output;
+        output << std::hex << std::setw(16) << std::setfill('0') << _value;
+        return output.str();
+    }
+};
+
+
+/// Feeds the contents of a file into a hash.
+///
+/// \param [in,out] hash The hash to update.
+/// \param path The file to read.
+///
+/// \return True if the file was read in full; false otherwise, in which case
+/// the reason has been logged.
+static bool
+add_file(fnv1a_hash& hash, const utils::fs::path& path)
+{
+    std::ifstream input(path.c_str(), std::ios::in | std::ios::binary);
+    if (!input) {
+        const int original_errno = errno;
+        LW(F("Cannot open %s to compute its fingerprint: %s") % path %
+           std::strerror(original_errno));
+        return false;
+    }
+
+    char buffer[64 * 1024];
+    while (input.read(buffer, sizeof(buffer)) || input.gcount() > 0)
+        hash.add(buffer, static_cast< std::size_t >(input.gcount()));
+    if (input.bad()) {
+        LW(F("Failed to read %s to compute its fingerprint") % path);
+        return false;
+    }
+    return true;
+}
+
+
+}  // anonymous namespace
+
+
+/// Computes the fingerprint of a test program.
+///
+/// \param test_program The test program to compute the fingerprint of.
+/// \param user_config The configuration variables provided by the user, from
+///     which the variables passed to the test program are derived.
+///
+/// \return The fingerprint of the test program, or none if its binary cannot
+/// be read.
+optional< std::string >
+engine::fingerprint(const model::test_program& test_program,
+                    const config::tree& user_config)
+{
+    fnv1a_hash hash;
+    if (!add_file(hash, test_program.absolute_path()))
+        return none;
+
+    hash.add(test_program.interface_name());
+    hash.add(test_program.test_suite_name());
+    hash.add(test_program.get_metadata().to_properties());
+    hash.add(engine::scheduler::generate_config(
+        user_config, test_program.test_suite_name()));
+    return utils::make_optional(hash.str());
+}
+
+
+/// Computes the fingerprint of a single test case.
+///
+/// On top of the fingerprint of its test program, this covers the metadata of
+/// the test case and the contents of the files it declares to require.
+///
+/// \param test_program The test program containing the test case.
+/// \param test_case_name The name of the test case.
+/// \param program_fingerprint The fingerprint of the test program, as returned
+///     by the other overload of this function.  Taken as an argument so that
+///     the binary of a test program is only read once for all its test cases.
+///
+/// \return The fingerprint of the test case, or none if any of its required
+/// files cannot be read.
+optional< std::string >
+engine::fingerprint(const model::test_program& test_program,
+                    const std::string& test_case_name,
+                    const std::string& program_fingerprint)
+{
+    const model::metadata& md = test_program.find(
+        test_case_name).get_metadata();
+
+    fnv1a_hash hash;
+    hash.add(program_fingerprint);
+    hash.add(test_case_name);
+    hash.add(md.to_properties());
+    for (model::paths_set::const_iterator iter = md.required_files().begin();
+         iter != md.required_files().end(); ++iter) {
+        if (!add_file(hash, *iter))
+            return none;
+    }
+    return utils::make_optional(hash.str());
+}
+
+
+/// Computes the fingerprint of the contents of a file.
+///
+/// \param file The file to read.
+///
+/// \return The fingerprint of the file, or none if it cannot be read.
+optional< std::string >
+engine::fingerprint(const utils::fs::path& file)
+{
+    fnv1a_hash hash;
+    if (!add_file(hash, file))
+        return none;
+    return utils::make_optional(hash.str());
+}
+
+
+/// Computes the fingerprint of a sequence of strings.
+///
+/// \param values The strings to compute the fingerprint of, in order.
+///
+/// \return The fingerprint of the strings.
+std::string
+engine::fingerprint(const std::vector< std::string >& values)
+{
+    fnv1a_hash hash;
+    for (std::vector< std::string >::const_iterator iter = values.begin();
+         iter != values.end(); ++iter)
+        hash.add(*iter);
+    return hash.str();
+}
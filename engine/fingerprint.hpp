@@ -0,0 +1,65 @@
+// Copyright 2026 The Kyua Authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// * Neither the name of Google Inc. nor the names of its contributors
+//   may be used to endorse or promote products derived from this software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+/// \file engine/fingerprint.hpp
+/// Computation of the identity of a test program.
+///
+/// The fingerprint of a test program summarizes everything that can affect
+/// the results of its test cases: the contents of its binary, its definition
+/// in the Kyuafile and the configuration variables passed to it.  Two test
+/// programs with the same fingerprint are expected to yield the same results.
+/// The fingerprint of a test case extends that of its test program with the
+/// test case's own definition and the contents of the files it requires.
+
+#if !defined(ENGINE_FINGERPRINT_HPP)
+#define ENGINE_FINGERPRINT_HPP
+
+#include <string>
+#include <vector>
+
+#include "model/test_program_fwd.hpp"
+#include "utils/config/tree_fwd.hpp"
+#include "utils/fs/path_fwd.hpp"
+#include "utils/optional_fwd.hpp"
+
+namespace engine {
+
+
+utils::optional< std::string > fingerprint(const model::test_program&,
+                                           const utils::config::tree&);
+utils::optional< std::string > fingerprint(const model::test_program&,
+                                           const std::string&,
+                                           const std::string&);
+utils::optional< std::string > fingerprint(const utils::fs::path&);
+std::string fingerprint(const std::vector< std::string >&);
+
+
+}  // namespace engine
+
+#endif  // !defined(ENGINE_FINGERPRINT_HPP)
@@ -0,0 +1,253 @@
+// Copyright 2026 The Kyua Authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// * Neither the name of Google Inc. nor the names of its contributors
+//   may be used to endorse or promote products derived from this software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "engine/fingerprint.hpp"
+
+#include <string>
+#include <vector>
+
+#include <atf-c++.hpp>
+
+#include "engine/config.hpp"
+#include "model/metadata.hpp"
+#include "model/test_program.hpp"
+#include "utils/config/tree.ipp"
+#include "utils/fs/operations.hpp"
+#include "utils/fs/path.hpp"
+#include "utils/optional.ipp"
+
+namespace config = utils::config;
+namespace fs = utils::fs;
+
+using utils::optional;
+
+
+namespace {
+
+
+/// Builds a test program for the tests.
+///
+/// \param relative_path Path to the binary relative to the current directory.
+/// \param test_suite Name of the test suite the program belongs to.
+/// \param md Metadata of the test program.
+///
+/// \return The constructed test program.
+static model::test_program
+make_program(const char* relative_path, const char* test_suite = "suite",
+             const model::metadata& md = model::metadata_builder().build())
+{
+    return model::test_program_builder(
+        "plain", fs::path(relative_path), fs::current_path(), test_suite)
+        .set_metadata(md).build();
+}
+
+
+/// Computes the fingerprint of a test program that must be readable.
+///
+/// \param program The test program to compute the fingerprint of.
+/// \param user_config The configuration to use.
+///
+/// \return The fingerprint.
+static std::string
+fingerprint_of(const model::test_program& program,
+               const config::tree& user_config = engine::empty_config())
+{
+    const optional< std::string > fingerprint = engine::fingerprint(
+        program, user_config);
+    ATF_REQUIRE(fingerprint);
+    return fingerprint.get();
+}
+
+
+}  // anonymous namespace
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(fingerprint__same_contents);
+ATF_TEST_CASE_BODY(fingerprint__same_contents)
+{
+    atf::utils::create_file("prog1", "binary contents");
+    atf::utils::create_file("prog2", "binary contents");
+
+    const std::string fingerprint = fingerprint_of(make_program("prog1"));
+    ATF_REQUIRE_EQ(16, fingerprint.length());
+    ATF_REQUIRE_EQ(fingerprint, fingerprint_of(make_program("prog1")));
+    ATF_REQUIRE_EQ(fingerprint, fingerprint_of(make_program("prog2")));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(fingerprint__different_contents);
+ATF_TEST_CASE_BODY(fingerprint__different_contents)
+{
+    atf::utils::create_file("prog1", "binary contents");
+    atf::utils::create_file("prog2", "binary contents 2");
+    atf::utils::create_file("prog3", "");
+
+    const std::string fingerprint1 = fingerprint_of(make_program("prog1"));
+    const std::string fingerprint2 = fingerprint_of(make_program("prog2"));
+    const std::string fingerprint3 = fingerprint_of(make_program("prog3"));
+    ATF_REQUIRE(fingerprint1 != fingerprint2);
+    ATF_REQUIRE(fingerprint1 != fingerprint3);
+    ATF_REQUIRE(fingerprint2 != fingerprint3);
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(fingerprint__different_definition);
+ATF_TEST_CASE_BODY(fingerprint__different_definition)
+{
+    atf::utils::create_file("prog", "binary contents");
+
+    const std::string fingerprint = fingerprint_of(make_program("prog"));
+    ATF_REQUIRE(fingerprint != fingerprint_of(make_program("prog", "other")));
+    ATF_REQUIRE(fingerprint != fingerprint_of(make_program(
+        "prog", "suite", model::metadata_builder()
+        .set_description("Some description").build())));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(fingerprint__different_config);
+ATF_TEST_CASE_BODY(fingerprint__different_config)
+{
+    atf::utils::create_file("prog", "binary contents");
+    const model::test_program program = make_program("prog");
+
+    config::tree user_config = engine::empty_config();
+    user_config.set_string("test_suites.other.var", "value");
+    const std::string fingerprint = fingerprint_of(program, user_config);
+    ATF_REQUIRE_EQ(fingerprint, fingerprint_of(program));
+
+    user_config.set_string("test_suites.suite.var", "value");
+    ATF_REQUIRE(fingerprint != fingerprint_of(program, user_config));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(fingerprint__missing_binary);
+ATF_TEST_CASE_BODY(fingerprint__missing_binary)
+{
+    ATF_REQUIRE(!engine::fingerprint(make_program("missing"),
+                                     engine::empty_config()));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(fingerprint__test_case__definition);
+ATF_TEST_CASE_BODY(fingerprint__test_case__definition)
+{
+    const model::test_program program = model::test_program_builder(
+        "plain", fs::path("prog"), fs::current_path(), "suite")
+        .add_test_case("first")
+        .add_test_case("second")
+        .add_test_case("third", model::metadata_builder()
+                       .set_description("Some description").build())
+        .build();
+
+    const optional< std::string > first = engine::fingerprint(
+        program, "first", "0123456789abcdef");
+    ATF_REQUIRE(first);
+    ATF_REQUIRE_EQ(16, first.get().length());
+    ATF_REQUIRE(first == engine::fingerprint(program, "first",
+                                             "0123456789abcdef"));
+    ATF_REQUIRE(first != engine::fingerprint(program, "first",
+                                             "fedcba9876543210"));
+    ATF_REQUIRE(first != engine::fingerprint(program, "second",
+                                             "0123456789abcdef"));
+    ATF_REQUIRE(first != engine::fingerprint(program, "third",
+                                             "0123456789abcdef"));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(fingerprint__test_case__required_files);
+ATF_TEST_CASE_BODY(fingerprint__test_case__required_files)
+{
+    const fs::path data = fs::current_path() / "data";
+    const model::test_program program = model::test_program_builder(
+        "plain", fs::path("prog"), fs::current_path(), "suite")
+        .add_test_case("main", model::metadata_builder()
+                       .add_required_file(data).build())
+        .build();
+
+    ATF_REQUIRE(!engine::fingerprint(program, "main", "0123456789abcdef"));
+
+    atf::utils::create_file(data.str(), "first contents");
+    const optional< std::string > fingerprint = engine::fingerprint(
+        program, "main", "0123456789abcdef");
+    ATF_REQUIRE(fingerprint);
+    ATF_REQUIRE(fingerprint == engine::fingerprint(program, "main",
+                                                   "0123456789abcdef"));
+
+    atf::utils::create_file(data.str(), "second contents");
+    ATF_REQUIRE(fingerprint != engine::fingerprint(program, "main",
+                                                   "0123456789abcdef"));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(fingerprint__file);
+ATF_TEST_CASE_BODY(fingerprint__file)
+{
+    ATF_REQUIRE(!engine::fingerprint(fs::path("missing")));
+
+    atf::utils::create_file("file1", "some contents");
+    atf::utils::create_file("file2", "some contents");
+    const optional< std::string > fingerprint = engine::fingerprint(
+        fs::path("file1"));
+    ATF_REQUIRE(fingerprint);
+    ATF_REQUIRE_EQ(16, fingerprint.get().length());
+    ATF_REQUIRE(fingerprint == engine::fingerprint(fs::path("file2")));
+
+    atf::utils::create_file("file2", "other contents");
+    ATF_REQUIRE(fingerprint != engine::fingerprint(fs::path("file2")));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(fingerprint__strings);
+ATF_TEST_CASE_BODY(fingerprint__strings)
+{
+    std::vector< std::string > values1;
+    values1.push_back("ab");
+    values1.push_back("c");
+    std::vector< std::string > values2;
+    values2.push_back("a");
+    values2.push_back("bc");
+
+    ATF_REQUIRE_EQ(16, engine::fingerprint(values1).length());
+    ATF_REQUIRE_EQ(engine::fingerprint(values1), engine::fingerprint(values1));
+    ATF_REQUIRE(engine::fingerprint(values1) != engine::fingerprint(values2));
+}
+
+
+ATF_INIT_TEST_CASES(tcs)
+{
+    ATF_ADD_TEST_CASE(tcs, fingerprint__same_contents);
+    ATF_ADD_TEST_CASE(tcs, fingerprint__different_contents);
+    ATF_ADD_TEST_CASE(tcs, fingerprint__different_definition);
+    ATF_ADD_TEST_CASE(tcs, fingerprint__different_config);
+    ATF_ADD_TEST_CASE(tcs, fingerprint__missing_binary);
+    ATF_ADD_TEST_CASE(tcs, fingerprint__test_case__definition);
+    ATF_ADD_TEST_CASE(tcs, fingerprint__test_case__required_files);
+    ATF_ADD_TEST_CASE(tcs, fingerprint__file);
+    ATF_ADD_TEST_CASE(tcs, fingerprint__strings);
+}
@@ -43,12 +43,12 @@ extern "C" {
 #include "model/test_program.hpp"
 #include "model/test_result.hpp"
 #include "utils/defs.hpp"
-#include "utils/env.hpp"
 #include "utils/format/macros.hpp"
 #include "utils/fs/path.hpp"
 #include "utils/logging/macros.hpp"
 #include "utils/optional.ipp"
 #include "utils/process/exceptions.hpp"
+#include "utils/process/exec_plan.hpp"
 #include "utils/process/operations.hpp"
 #include "utils/process/status.hpp"
 #include "utils/stream.hpp"
@@ -165,6 +165,43 @@ engine::googletest_interface::parse_list(
 }
 
 
+/// Checks whether plan_test() is implemented by this interface.
+///
+/// \return Always true.
+bool
+engine::googletest_interface::supports_plan_test(void) const
+{
+    return true;
+}
+
+
+/// Computes how to execute a test case of the test program.
+///
+/// \param test_program The test program to execute.
+/// \param test_case_name Name of the test case to invoke.
+/// \param vars User-provided variables to pass to the test program.
+///
+/// \return The plan to execute the test case.
+process::exec_plan
+engine::googletest_interface::plan_test(
+    const model::test_program& test_program,
+    const std::string& test_case_name,
+    const config::properties_map& vars,
+    const fs::path& /* control_directory */) const
+{
+    process::args_vector args{
+        "--gtest_color=no",
+        F("--gtest_filter=%s") % (test_case_name)
+    };
+    process::exec_plan plan(test_program.absolute_path(), args);
+    for (config::properties_map::const_iterator iter = vars.begin();
+         iter != vars.end(); ++iter) {
+        plan.set_env(F("TEST_ENV_%s") % (*iter).first, (*iter).second);
+    }
+    return plan;
+}
+
+
 /// Executes a test case of the test program.
 ///
 /// This method is intended to be called within a subprocess and is expected
@@ -174,23 +211,16 @@ engine::googletest_interface::parse_list(
 /// \param test_program The test program to execute.
 /// \param test_case_name Name of the test case to invoke.
 /// \param vars User-provided variables to pass to the test program.
+/// \param control_directory Directory where the interface may place control
+///     files.
 void
 engine::googletest_interface::exec_test(
     const model::test_program& test_program,
     const std::string& test_case_name,
     const config::properties_map& vars,
-    const fs::path& /* control_directory */) const
+    const fs::path& control_directory) const
 {
-    for (config::properties_map::const_iterator iter = vars.begin();
-         iter != vars.end(); ++iter) {
-        utils::setenv(F("TEST_ENV_%s") % (*iter).first, (*iter).second);
-    }
-
-    process::args_vector args{
-        "--gtest_color=no",
-        F("--gtest_filter=%s") % (test_case_name)
-    };
-    process::exec(test_program.absolute_path(), args);
+    plan_test(test_program, test_case_name, vars, control_directory).exec();
 }
 
 
@@ -28,8 +28,23 @@
 
 #include "engine/kyuafile.hpp"
 
+extern "C" {
+#include <sys/stat.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+}
+
 #include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
 #include <iterator>
+#include <memory>
+#include <set>
 #include <stdexcept>
 
 #include <lutok/exceptions.hpp>
@@ -38,24 +53,41 @@
 #include <lutok/state.ipp>
 
 #include "engine/exceptions.hpp"
+#include "engine/fingerprint.hpp"
 #include "engine/scheduler.hpp"
+#include "model/exceptions.hpp"
 #include "model/metadata.hpp"
 #include "model/test_program.hpp"
+#include "model/types.hpp"
 #include "utils/config/exceptions.hpp"
 #include "utils/config/tree.ipp"
 #include "utils/datetime.hpp"
+#include "utils/defs.hpp"
 #include "utils/format/macros.hpp"
+#include "utils/fs/directory.hpp"
+#include "utils/fs/exceptions.hpp"
 #include "utils/fs/lua_module.hpp"
 #include "utils/fs/operations.hpp"
 #include "utils/logging/macros.hpp"
+#include "utils/logging/operations.hpp"
 #include "utils/noncopyable.hpp"
 #include "utils/optional.ipp"
+#include "utils/process/child.ipp"
+#include "utils/process/exceptions.hpp"
+#include "utils/process/fdstream.hpp"
+#include "utils/process/status.hpp"
+#include "utils/process/systembuf.hpp"
 #include "utils/sanity.hpp"
+#include "utils/text/exceptions.hpp"
+#include "utils/text/operations.ipp"
 
 namespace config = utils::config;
 namespace datetime = utils::datetime;
 namespace fs = utils::fs;
+namespace logging = utils::logging;
+namespace process = utils::process;
 namespace scheduler = engine::scheduler;
+namespace text = utils::text;
 
 using utils::none;
 using utils::optional;
@@ -88,6 +120,13 @@ static int lua_syntax(lutok::state&);
 static int lua_test_suite(lutok::state&);
 
 
+/// Identifier of the format of the files in the Kyuafile cache.
+///
+/// Bump this whenever the format changes or the evaluation of the Kyuafiles
+/// changes in a way that makes previously-cached entries invalid.
+static const char* const cache_format = "kyuafile-cache 1";
+
+
 /// Concatenates two paths while avoiding paths to start with './'.
 ///
 /// \param root Path to the directory containing the file.
@@ -106,11 +145,467 @@ relativize(const fs::path& root, const fs::path& file)
 }
 
 
+/// Gets the modification time of a file.
+///
+/// \param path The file to query.
+///
+/// \return The modification time in a textual form suitable for comparisons,
+/// or none if the file cannot be queried.
+static optional< std::string >
+modification_time(const fs::path& path)
+{
+    struct ::stat sb;
+    if (::stat(path.c_str(), &sb) == -1)
+        return none;
+    return utils::make_optional(std::string(
+        F("%s.%09s") % sb.st_mtim.tv_sec % sb.st_mtim.tv_nsec));
+}
+
+
+/// Computes the fingerprint of the list of files in a directory.
+///
+/// \param directory The directory to scan.
+///
+/// \return The fingerprint of the names of the files in the directory, or none
+/// if the directory cannot be scanned.
+static optional< std::string >
+directory_fingerprint(const fs::path& directory)
+{
+    std::vector< std::string > names;
+    try {
+        const std::set< fs::directory_entry > entries = fs::scan_directory(
+            directory);
+        for (std::set< fs::directory_entry >::const_iterator
+                 iter = entries.begin(); iter != entries.end(); ++iter)
+            names.push_back((*iter).name);
+    } catch (const fs::error& e) {
+        return none;
+    }
+    return utils::make_optional(engine::fingerprint(names));
+}
+
+
+/// Snapshot of a Kyuafile at the time it was evaluated.
+///
+/// Kyuafiles can query the file system through the fs module, usually to look
+/// for test programs in their own directory.  The list of files in the
+/// directory containing the Kyuafile is recorded as well so that adding or
+/// removing files next to it invalidates the cache.
+struct kyuafile_state {
+    /// Absolute path to the Kyuafile.
+    fs::path path;
+
+    /// Modification time of the Kyuafile.
+    std::string mtime;
+
+    /// Fingerprint of the list of files next to the Kyuafile.
+    std::string directory_fingerprint;
+
+    /// Fingerprint of the contents of the Kyuafile.
+    std::string fingerprint;
+
+    /// Constructor.
+    ///
+    /// \param path_ Absolute path to the Kyuafile.
+    /// \param mtime_ Modification time of the Kyuafile.
+    /// \param directory_fingerprint_ Fingerprint of the list of files next to
+    ///     the Kyuafile.
+    /// \param fingerprint_ Fingerprint of the contents of the Kyuafile.
+    kyuafile_state(const fs::path& path_, const std::string& mtime_,
+                   const std::string& directory_fingerprint_,
+                   const std::string& fingerprint_) :
+        path(path_), mtime(mtime_),
+        directory_fingerprint(directory_fingerprint_),
+        fingerprint(fingerprint_)
+    {
+    }
+
+    /// Equality comparator.
+    ///
+    /// \param other The other object to compare this one to.
+    ///
+    /// \return True if this object and other are equal; false otherwise.
+    bool
+    operator==(const kyuafile_state& other) const
+    {
+        return path == other.path && mtime == other.mtime &&
+            directory_fingerprint == other.directory_fingerprint &&
+            fingerprint == other.fingerprint;
+    }
+};
+
+
+/// Takes a snapshot of a Kyuafile.
+///
+/// \param path Absolute path to the Kyuafile.
+///
+/// \return The current state of the Kyuafile, or none if it cannot be queried.
+static optional< kyuafile_state >
+query_state(const fs::path& path)
+{
+    const optional< std::string > mtime = modification_time(path);
+    const optional< std::string > directory = directory_fingerprint(
+        path.branch_path());
+    const optional< std::string > fingerprint = engine::fingerprint(path);
+    if (!mtime || !directory || !fingerprint)
+        return none;
+    return utils::make_optional(kyuafile_state(
+        path, mtime.get(), directory.get(), fingerprint.get()));
+}
+
+
+/// Definition of a test program as found in a Kyuafile.
+///
+/// The definitions keep the metadata properties exactly as given in the
+/// Kyuafile so that they can be stored in the cache and turned back into the
+/// same test programs without evaluating the Kyuafiles again.
+struct program_definition {
+    /// Name of the test program interface.
+    std::string interface;
+
+    /// Path to the test program, relative to the source root.
+    fs::path path;
+
+    /// Name of the test suite the test program belongs to.
+    std::string test_suite;
+
+    /// Metadata properties explicitly given in the Kyuafile.
+    model::properties_map properties;
+
+    /// Metadata of the test program, as built from properties.
+    model::metadata metadata;
+
+    /// Constructor.
+    ///
+    /// \param interface_ Name of the test program interface.
+    /// \param path_ Path to the test program, relative to the source root.
+    /// \param test_suite_ Name of the test suite the test program belongs to.
+    /// \param properties_ Metadata properties explicitly given in the
+    ///     Kyuafile.
+    /// \param metadata_ Metadata of the test program.
+    program_definition(const std::string& interface_, const fs::path& path_,
+                       const std::string& test_suite_,
+                       const model::properties_map& properties_,
+                       const model::metadata& metadata_) :
+        interface(interface_), path(path_), test_suite(test_suite_),
+        properties(properties_), metadata(metadata_)
+    {
+    }
+};
+
+
+/// Result of evaluating a Kyuafile and all the files it includes.
+struct evaluation {
+    /// Definitions of the test programs, in the order in which they appear.
+    std::vector< program_definition > programs;
+
+    /// Snapshots of all the evaluated Kyuafiles.
+    std::vector< kyuafile_state > kyuafiles;
+
+    /// Whether all the evaluated Kyuafiles could be snapshotted.
+    ///
+    /// The result of the evaluation cannot be cached otherwise, as there would
+    /// be no way to tell if it is stale.
+    bool cacheable;
+
+    /// Constructor.
+    evaluation(void) : cacheable(true)
+    {
+    }
+
+    /// Appends the results of evaluating an included Kyuafile.
+    ///
+    /// \param other The evaluation of the included Kyuafile.
+    void
+    append(const evaluation& other)
+    {
+        std::copy(other.programs.begin(), other.programs.end(),
+                  std::back_inserter(programs));
+        std::copy(other.kyuafiles.begin(), other.kyuafiles.end(),
+                  std::back_inserter(kyuafiles));
+        cacheable &= other.cacheable;
+    }
+};
+
+
+/// Writes a string to a serialized evaluation.
+///
+/// Strings are prefixed by their length so that they can hold any character.
+///
+/// \param output The stream into which to write the string.
+/// \param value The string to write.
+static void
+write_string(std::ostream& output, const std::string& value)
+{
+    output << value.length() << ':' << value << '\n';
+}
+
+
+/// Reads a string from a serialized evaluation.
+///
+/// \param input The stream from which to read the string.
+/// \param [out] value The string read.
+///
+/// \return True if the string was read; false if the input is malformed.
+static bool
+read_string(std::istream& input, std::string& value)
+{
+    std::size_t length;
+    if (!(input >> length) || input.get() != ':')
+        return false;
+    value.resize(length);
+    if (length > 0 && !input.read(&value[0], length))
+        return false;
+    return input.get() == '\n';
+}
+
+
+/// Reads a count of items from a serialized evaluation.
+///
+/// \param input The stream from which to read the count.
+/// \param [out] count The count read.
+///
+/// \return True if the count was read; false if the input is malformed.
+static bool
+read_count(std::istream& input, std::size_t& count)
+{
+    std::string value;
+    if (!read_string(input, value))
+        return false;
+    try {
+        count = text::to_type< std::size_t >(value);
+    } catch (const text::value_error& e) {
+        return false;
+    }
+    return true;
+}
+
+
+/// Reads the definitions of the test programs from a serialized evaluation.
+///
+/// \param input The stream from which to read the definitions.
+/// \param build_root The root directory of the test programs.
+///
+/// \return The definitions, or none if the input is malformed or if any of
+/// the test programs does not exist any more.
+static optional< std::vector< program_definition > >
+read_programs(std::istream& input, const fs::path& build_root)
+{
+    std::vector< program_definition > programs;
+
+    std::size_t count;
+    if (!read_count(input, count))
+        return none;
+    for (std::size_t i = 0; i < count; ++i) {
+        std::string interface, path, test_suite;
+        std::size_t properties_count;
+        if (!read_string(input, interface) || !read_string(input, path) ||
+            !read_string(input, test_suite) ||
+            !read_count(input, properties_count))
+            return none;
+
+        model::properties_map properties;
+        for (std::size_t j = 0; j < properties_count; ++j) {
+            std::string key, value;
+            if (!read_string(input, key) || !read_string(input, value))
+                return none;
+            properties[key] = value;
+        }
+
+        model::metadata_builder mdbuilder;
+        try {
+            for (model::properties_map::const_iterator iter =
+                     properties.begin(); iter != properties.end(); ++iter)
+                mdbuilder.set_string((*iter).first, (*iter).second);
+        } catch (const model::error& e) {
+            LW(F("Invalid metadata in serialized Kyuafile: %s") % e.what());
+            return none;
+        }
+
+        // The test program may have been removed from the build directory
+        // without touching the Kyuafiles; evaluate them again to report it.
+        if (!fs::exists(build_root / path)) {
+            LD(F("Test program %s is gone") % path);
+            return none;
+        }
+
+        programs.push_back(program_definition(
+            interface, fs::path(path), test_suite, properties,
+            mdbuilder.build()));
+    }
+
+    return utils::make_optional(programs);
+}
+
+
+/// Serializes the evaluation of a Kyuafile.
+///
+/// \param output The stream into which to write the evaluation.
+/// \param result The evaluation to write.
+static void
+write_evaluation(std::ostream& output, const evaluation& result)
+{
+    write_string(output, F("%s") % result.kyuafiles.size());
+    for (std::vector< kyuafile_state >::const_iterator
+             iter = result.kyuafiles.begin(); iter != result.kyuafiles.end();
+         ++iter) {
+        write_string(output, (*iter).path.str());
+        write_string(output, (*iter).mtime);
+        write_string(output, (*iter).directory_fingerprint);
+        write_string(output, (*iter).fingerprint);
+    }
+    write_string(output, F("%s") % result.programs.size());
+    for (std::vector< program_definition >::const_iterator
+             iter = result.programs.begin(); iter != result.programs.end();
+         ++iter) {
+        write_string(output, (*iter).interface);
+        write_string(output, (*iter).path.str());
+        write_string(output, (*iter).test_suite);
+        write_string(output, F("%s") % (*iter).properties.size());
+        for (model::properties_map::const_iterator
+                 iter2 = (*iter).properties.begin();
+             iter2 != (*iter).properties.end(); ++iter2) {
+            write_string(output, (*iter2).first);
+            write_string(output, (*iter2).second);
+        }
+    }
+}
+
+
+/// Deserializes the evaluation of a Kyuafile.
+///
+/// The snapshots of the Kyuafiles are returned as they were recorded; it is up
+/// to the caller to check if they are still current.
+///
+/// \param input The stream from which to read the evaluation.
+/// \param build_root The root directory of the test programs.
+///
+/// \return The evaluation, or none if the input is malformed or if any of the
+/// test programs does not exist any more.
+static optional< evaluation >
+read_evaluation(std::istream& input, const fs::path& build_root)
+{
+    evaluation result;
+
+    std::size_t count;
+    if (!read_count(input, count))
+        return none;
+    for (std::size_t i = 0; i < count; ++i) {
+        std::string path, mtime, directory, fingerprint;
+        if (!read_string(input, path) || !read_string(input, mtime) ||
+            !read_string(input, directory) || !read_string(input, fingerprint))
+            return none;
+        result.kyuafiles.push_back(kyuafile_state(
+            fs::path(path), mtime, directory, fingerprint));
+    }
+
+    const optional< std::vector< program_definition > > programs =
+        read_programs(input, build_root);
+    if (!programs)
+        return none;
+    result.programs = programs.get();
+
+    return utils::make_optional(result);
+}
+
+
+/// Hook to evaluate an included Kyuafile in a subprocess.
+///
+/// The subprocess evaluates the Kyuafile, and all the files it includes, in its
+/// own Lua state and sends the result back to the parent through a pipe using
+/// the same serialization as the cache.
+class include_evaluator {
+    /// Root directory of the test suite.
+    fs::path _source_root;
+
+    /// Root directory of the test programs.
+    fs::path _build_root;
+
+    /// Name of the Kyuafile to evaluate relative to _source_root.
+    fs::path _relative_filename;
+
+    /// Read end of the pipe to the parent; closed by the subprocess.
+    int _read_fd;
+
+    /// Write end of the pipe to the parent.
+    int _write_fd;
+
+public:
+    /// Constructor.
+    ///
+    /// \param source_root_ Root directory of the test suite.
+    /// \param build_root_ Root directory of the test programs.
+    /// \param relative_filename_ Name of the Kyuafile to evaluate relative to
+    ///     source_root_.
+    /// \param read_fd_ Read end of the pipe to the parent.
+    /// \param write_fd_ Write end of the pipe to the parent.
+    include_evaluator(const fs::path& source_root_, const fs::path& build_root_,
+                      const fs::path& relative_filename_, const int read_fd_,
+                      const int write_fd_) :
+        _source_root(source_root_), _build_root(build_root_),
+        _relative_filename(relative_filename_), _read_fd(read_fd_),
+        _write_fd(write_fd_)
+    {
+    }
+
+    void operator()(void) UTILS_NORETURN;
+};
+
+
+/// Evaluation of an included Kyuafile delegated to a subprocess.
+struct pending_include {
+    /// Name of the included Kyuafile relative to the source root.
+    fs::path file;
+
+    /// Number of test programs defined by the includer before the include.
+    std::size_t programs_offset;
+
+    /// Number of Kyuafiles evaluated by the includer before the include.
+    std::size_t kyuafiles_offset;
+
+    /// The subprocess evaluating the Kyuafile, or NULL once it is collected.
+    std::shared_ptr< process::child > child;
+
+    /// Read end of the pipe to the subprocess, or -1 once it is collected.
+    int fd;
+
+    /// Result of the evaluation, once it is collected and if it succeeded.
+    optional< evaluation > result;
+
+    /// Reason for the failure of the evaluation, if it failed.
+    optional< std::string > error;
+
+    /// Constructor.
+    ///
+    /// \param file_ Name of the included Kyuafile relative to the source root.
+    /// \param programs_offset_ Number of test programs defined by the includer
+    ///     before the include.
+    /// \param kyuafiles_offset_ Number of Kyuafiles evaluated by the includer
+    ///     before the include.
+    /// \param child_ The subprocess evaluating the Kyuafile.
+    /// \param fd_ Read end of the pipe to the subprocess.
+    pending_include(const fs::path& file_, const std::size_t programs_offset_,
+                    const std::size_t kyuafiles_offset_,
+                    const std::shared_ptr< process::child > child_,
+                    const int fd_) :
+        file(file_), programs_offset(programs_offset_),
+        kyuafiles_offset(kyuafiles_offset_), child(child_), fd(fd_)
+    {
+    }
+};
+
+
 /// Implementation of a parser for Kyuafiles.
 ///
 /// The main purpose of having this as a class is to keep track of global state
 /// within the Lua files and allowing the Lua callbacks to easily access such
 /// data.
+///
+/// The files included by the top-level Kyuafile can be evaluated in
+/// subprocesses while the Kyuafile itself is still being processed.  Their
+/// results are merged back in the order of the include() calls once the
+/// Kyuafile is done, so the outcome is the same as evaluating everything
+/// serially.  Files included from those subprocesses are evaluated serially.
 class parser : utils::noncopyable {
     /// Lua state to parse a single Kyuafile file.
     lutok::state _state;
@@ -134,11 +629,22 @@ class parser : utils::noncopyable {
     /// This is set once the Kyuafile invokes the test_suite() call.
     optional< std::string > _test_suite;
 
-    /// Collection of test programs defined by the Kyuafile.
+    /// Test programs defined by the Kyuafile and the files it included.
+    ///
+    /// This acts as an accumulator for all the *_test_program() and include()
+    /// calls within the Kyuafile.
+    evaluation _evaluation;
+
+    /// Maximum number of included files to evaluate in subprocesses at once.
     ///
-    /// This acts as an accumulator for all the *_test_program() calls within
-    /// the Kyuafile.
-    model::test_programs_vector _test_programs;
+    /// If zero, included files are evaluated serially in this process.
+    const std::size_t _max_subprocesses;
+
+    /// Included files delegated to subprocesses, in the order of the calls.
+    std::vector< pending_include > _includes;
+
+    /// Number of entries at the beginning of _includes already collected.
+    std::size_t _collected;
 
     /// Safely gets _test_suite and respects any test program overrides.
     ///
@@ -168,6 +674,135 @@ class parser : utils::noncopyable {
         return test_suite;
     }
 
+    /// Starts the evaluation of an included file in a subprocess.
+    ///
+    /// \param file Name of the included file relative to _source_root.
+    ///
+    /// \return True if the subprocess was started; false if it could not be
+    /// and the file has to be evaluated in this process.
+    bool
+    start_include(const fs::path& file)
+    {
+        int fds[2];
+        if (::pipe(fds) == -1) {
+            const int original_errno = errno;
+            LW(F("Failed to create pipe to evaluate %s: %s") % file %
+               std::strerror(original_errno));
+            return false;
+        }
+        for (int i = 0; i < 2; ++i)
+            ::fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+
+        std::shared_ptr< process::child > child;
+        try {
+            child.reset(process::child::fork_files(
+                include_evaluator(_source_root, _build_root, file, fds[0],
+                                  fds[1]),
+                fs::path("/dev/stdout"), fs::path("/dev/stderr")).release());
+        } catch (const process::system_error& e) {
+            LW(F("Failed to spawn subprocess to evaluate %s: %s") % file %
+               e.what());
+            ::close(fds[0]);
+            ::close(fds[1]);
+            return false;
+        }
+        ::close(fds[1]);
+
+        _includes.push_back(pending_include(
+            file, _evaluation.programs.size(), _evaluation.kyuafiles.size(),
+            child, fds[0]));
+        return true;
+    }
+
+    /// Waits for the oldest running subprocess and records its result.
+    ///
+    /// \pre There is at least one running subprocess.
+    void
+    collect(void)
+    {
+        PRE(_collected < _includes.size());
+        pending_include& include = _includes[_collected];
+        ++_collected;
+
+        {
+            process::ifdstream input(include.fd);
+            include.fd = -1;
+
+            std::string status, value;
+            if (read_string(input, status) && read_string(input, value)) {
+                if (status == "ok") {
+                    const optional< evaluation > result = read_evaluation(
+                        input, _build_root);
+                    if (result) {
+                        evaluation copy = result.get();
+                        copy.cacheable = value == "1";
+                        include.result = utils::make_optional(copy);
+                    }
+                } else if (status == "error") {
+                    include.error = utils::make_optional(value);
+                }
+            }
+        }
+
+        const process::status status = include.child->wait();
+        include.child.reset();
+        if (!status.exited() || status.exitstatus() != EXIT_SUCCESS) {
+            include.result = none;
+            if (!include.error)
+                include.error = utils::make_optional(std::string(
+                    F("Subprocess evaluating '%s' failed") % include.file));
+        } else if (!include.result && !include.error) {
+            include.error = utils::make_optional(std::string(
+                F("Subprocess evaluating '%s' returned an invalid result") %
+                include.file));
+        }
+    }
+
+    /// Merges the results of the subprocesses into _evaluation.
+    ///
+    /// \param load_path Path to the Kyuafile, for error reporting purposes.
+    ///
+    /// \throw load_error If the evaluation of any included file failed.  The
+    ///     failure of the earliest include() call is reported.
+    void
+    join_includes(const fs::path& load_path)
+    {
+        while (_collected < _includes.size())
+            collect();
+
+        for (std::vector< pending_include >::const_iterator
+                 iter = _includes.begin(); iter != _includes.end(); ++iter) {
+            if ((*iter).error)
+                throw engine::load_error(load_path, (*iter).error.get());
+        }
+
+        evaluation merged;
+        merged.cacheable = _evaluation.cacheable;
+        std::size_t programs = 0, kyuafiles = 0;
+        for (std::vector< pending_include >::const_iterator
+                 iter = _includes.begin(); iter != _includes.end(); ++iter) {
+            std::copy(_evaluation.programs.begin() + programs,
+                      _evaluation.programs.begin() + (*iter).programs_offset,
+                      std::back_inserter(merged.programs));
+            std::copy(_evaluation.kyuafiles.begin() + kyuafiles,
+                      _evaluation.kyuafiles.begin() + (*iter).kyuafiles_offset,
+                      std::back_inserter(merged.kyuafiles));
+            merged.append((*iter).result.get());
+            programs = (*iter).programs_offset;
+            kyuafiles = (*iter).kyuafiles_offset;
+        }
+        std::copy(_evaluation.programs.begin() + programs,
+                  _evaluation.programs.end(),
+                  std::back_inserter(merged.programs));
+        std::copy(_evaluation.kyuafiles.begin() + kyuafiles,
+                  _evaluation.kyuafiles.end(),
+                  std::back_inserter(merged.kyuafiles));
+
+        _evaluation = merged;
+        _includes.clear();
+        _collected = 0;
+    }
+
 public:
     /// Initializes the parser and the Lua state.
     ///
@@ -176,16 +811,14 @@ public:
     /// \param build_root_ The root directory of the test programs.
     /// \param relative_filename_ Name of the Kyuafile to load relative to
     ///     source_root_.
-    /// \param user_config User configuration holding any test suite properties
-    ///     to be passed to the list operation.
-    /// \param scheduler_handle The scheduler context to use for loading the
-    ///     test case lists.
+    /// \param max_subprocesses_ Maximum number of included files to evaluate
+    ///     in subprocesses at once.  If zero, they are evaluated serially.
     parser(const fs::path& source_root_, const fs::path& build_root_,
            const fs::path& relative_filename_,
-           const config::tree& user_config,
-           scheduler::scheduler_handle& scheduler_handle) :
+           const std::size_t max_subprocesses_) :
         _source_root(source_root_), _build_root(build_root_),
-        _relative_filename(relative_filename_)
+        _relative_filename(relative_filename_),
+        _max_subprocesses(max_subprocesses_), _collected(0)
     {
         lutok::stack_cleaner cleaner(_state);
 
@@ -198,10 +831,7 @@ public:
         _state.push_cxx_function(lua_current_kyuafile);
         _state.set_global("current_kyuafile");
 
-        *_state.new_userdata< const config::tree* >() = &user_config;
-        *_state.new_userdata< scheduler::scheduler_handle* >() =
-            &scheduler_handle;
-        _state.push_cxx_closure(lua_include, 2);
+        _state.push_cxx_function(lua_include);
         _state.set_global("include");
 
         _state.push_cxx_function(lua_test_suite);
@@ -214,10 +844,7 @@ public:
             const std::string& interface = *iter;
 
             _state.push_string(interface);
-            *_state.new_userdata< const config::tree* >() = &user_config;
-            *_state.new_userdata< scheduler::scheduler_handle* >() =
-                &scheduler_handle;
-            _state.push_cxx_closure(lua_generic_test_program, 3);
+            _state.push_cxx_closure(lua_generic_test_program, 1);
             _state.set_global(interface + "_test_program");
         }
 
@@ -228,8 +855,23 @@ public:
     }
 
     /// Destructor.
+    ///
+    /// Waits for any subprocesses left behind if the parsing was aborted.
     ~parser(void)
     {
+        for (std::vector< pending_include >::iterator iter = _includes.begin();
+             iter != _includes.end(); ++iter) {
+            if ((*iter).fd != -1)
+                ::close((*iter).fd);
+            if ((*iter).child.get() != NULL) {
+                try {
+                    (void)(*iter).child->wait();
+                } catch (const process::system_error& e) {
+                    LW(F("Failed to wait for subprocess evaluating %s: %s") %
+                       (*iter).file % e.what());
+                }
+            }
+        }
     }
 
     /// Gets the parser object associated to a Lua state.
@@ -260,26 +902,23 @@ public:
 
     /// Callback for the Kyuafile include() function.
     ///
-    /// \post _test_programs is extended with the the test programs defined by
-    /// the included file.
+    /// \post _evaluation is extended with the the test programs defined by
+    /// the included file, or the file is being evaluated in a subprocess.
     ///
     /// \param raw_file Path to the file to include.
-    /// \param user_config User configuration holding any test suite properties
-    ///     to be passed to the list operation.
-    /// \param scheduler_handle Scheduler context to run test programs in.
     void
-    callback_include(const fs::path& raw_file,
-                     const config::tree& user_config,
-                     scheduler::scheduler_handle& scheduler_handle)
+    callback_include(const fs::path& raw_file)
     {
         const fs::path file = relativize(_relative_filename.branch_path(),
                                          raw_file);
-        const model::test_programs_vector subtps =
-            parser(_source_root, _build_root, file, user_config,
-                   scheduler_handle).parse();
 
-        std::copy(subtps.begin(), subtps.end(),
-                  std::back_inserter(_test_programs));
+        if (_max_subprocesses > 0) {
+            if (_includes.size() - _collected >= _max_subprocesses)
+                collect();
+            if (start_include(file))
+                return;
+        }
+        _evaluation.append(parser(_source_root, _build_root, file, 0).parse());
     }
 
     /// Callback for the Kyuafile syntax() function.
@@ -305,7 +944,7 @@ public:
 
     /// Callback for the various Kyuafile *_test_program() functions.
     ///
-    /// \post _test_programs is extended to include the newly defined test
+    /// \post _evaluation is extended to include the newly defined test
     /// program.
     ///
     /// \param interface Name of the test program interface.
@@ -314,10 +953,8 @@ public:
     ///     Kyuafile to _source_root.
     /// \param test_suite_override Name of the test suite this test program
     ///     belongs to, if explicitly defined at the test program level.
-    /// \param metadata Metadata variables passed to the test program.
-    /// \param user_config User configuration holding any test suite properties
-    ///     to be passed to the list operation.
-    /// \param scheduler_handle Scheduler context to run test programs in.
+    /// \param properties Metadata properties passed to the test program.
+    /// \param metadata Metadata built from the properties.
     ///
     /// \throw std::runtime_error If the test program definition is invalid or
     ///     if the test program does not exist.
@@ -325,9 +962,8 @@ public:
     callback_test_program(const std::string& interface,
                           const fs::path& raw_path,
                           const std::string& test_suite_override,
-                          const model::metadata& metadata,
-                          const config::tree& user_config,
-                          scheduler::scheduler_handle& scheduler_handle)
+                          const model::properties_map& properties,
+                          const model::metadata& metadata)
     {
         if (raw_path.is_absolute())
             throw std::runtime_error(F("Got unexpected absolute path for test "
@@ -345,10 +981,8 @@ public:
 
         const std::string test_suite = get_test_suite(test_suite_override);
 
-        _test_programs.push_back(model::test_program_ptr(
-            new scheduler::lazy_test_program(interface, path, _build_root,
-                                             test_suite, metadata, user_config,
-                                             scheduler_handle)));
+        _evaluation.programs.push_back(program_definition(
+            interface, path, test_suite, properties, metadata));
     }
 
     /// Callback for the Kyuafile test_suite() function.
@@ -370,13 +1004,21 @@ public:
     ///
     /// \pre Can only be invoked once.
     ///
-    /// \return The collection of test programs defined by the Kyuafile.
+    /// \return The test programs defined by the Kyuafile and the files it
+    /// includes, along with the snapshots of all these files.
     ///
     /// \throw load_error If there is any problem parsing the file.
-    const model::test_programs_vector&
+    const evaluation&
     parse(void)
     {
-        PRE(_test_programs.empty());
+        PRE(_evaluation.programs.empty());
+
+        const optional< kyuafile_state > state = query_state(
+            callback_current_kyuafile());
+        if (state)
+            _evaluation.kyuafiles.push_back(state.get());
+        else
+            _evaluation.cacheable = false;
 
         const fs::path load_path = relativize(_source_root, _relative_filename);
         try {
@@ -388,17 +1030,53 @@ public:
             // not work because the helper functions above are executed within a
             // Lua context, and we lose their type when they are propagated out
             // of it.
+            //
+            // Errors in earlier include() calls take precedence, as the
+            // evaluation would have stopped at them if done serially.
+            join_includes(load_path);
             throw engine::load_error(load_path, e.what());
         }
+        join_includes(load_path);
 
         if (!_version)
             throw engine::load_error(load_path, "syntax() never called");
 
-        return _test_programs;
+        return _evaluation;
     }
 };
 
 
+/// Evaluates the included Kyuafile and sends the result to the parent.
+///
+/// The subprocess exits without running any destructors, as all the objects
+/// it inherited belong to the parent.
+void
+include_evaluator::operator()(void)
+{
+    ::close(_read_fd);
+
+    process::systembuf buffer(_write_fd);
+    std::ostream output(&buffer);
+    try {
+        parser include_parser(_source_root, _build_root, _relative_filename,
+                              0);
+        const evaluation& result = include_parser.parse();
+        write_string(output, "ok");
+        write_string(output, result.cacheable ? "1" : "0");
+        write_evaluation(output, result);
+    } catch (const std::exception& e) {
+        write_string(output, "error");
+        write_string(output, e.what());
+    }
+    output.flush();
+
+    std::cout.flush();
+    std::cerr.flush();
+    logging::flush();
+    ::_exit(output ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+
 /// Glue to invoke parser::callback_test_program() from Lua.
 ///
 /// This is a helper function for the various *_test_program() calls, as they
@@ -408,8 +1086,6 @@ public:
 /// special argument 'test_suite' provides an override to the global test suite
 /// name.  The rest of the arguments are part of the test program metadata.
 /// \pre state(upvalue 1) String with the name of the interface.
-/// \pre state(upvalue 2) User configuration with the per-test suite settings.
-/// \pre state(upvalue 3) Scheduler context to run test programs in.
 ///
 /// \param state The Lua state that executed the function.
 ///
@@ -424,19 +1100,6 @@ lua_generic_test_program(lutok::state& state)
                                  "function");
     const std::string interface = state.to_string(state.upvalue_index(1));
 
-    if (!state.is_userdata(state.upvalue_index(2)))
-        throw std::runtime_error("Found corrupt state for test_program "
-                                 "function");
-    const config::tree* user_config = *state.to_userdata< const config::tree* >(
-        state.upvalue_index(2));
-
-    if (!state.is_userdata(state.upvalue_index(3)))
-        throw std::runtime_error("Found corrupt state for test_program "
-                                 "function");
-    scheduler::scheduler_handle* scheduler_handle =
-        *state.to_userdata< scheduler::scheduler_handle* >(
-            state.upvalue_index(3));
-
     if (!state.is_table(-1))
         throw std::runtime_error(
             F("%s_test_program expects a table of properties as its single "
@@ -467,6 +1130,7 @@ lua_generic_test_program(lutok::state& state)
     }
     state.pop(1);
 
+    model::properties_map properties;
     model::metadata_builder mdbuilder;
     state.push_nil();
     while (state.next(-2)) {
@@ -491,14 +1155,14 @@ lua_generic_test_program(lutok::state& state)
             }
 
             mdbuilder.set_string(property, value);
+            properties[property] = value;
         }
 
         state.pop(1);
     }
 
     parser::get_from_state(state)->callback_test_program(
-        interface, path, test_suite, mdbuilder.build(), *user_config,
-        *scheduler_handle);
+        interface, path, test_suite, properties, mdbuilder.build());
     return 0;
 }
 
@@ -521,28 +1185,12 @@ lua_current_kyuafile(lutok::state& state)
 ///
 /// \param state The Lua state that executed the function.
 ///
-/// \pre state(upvalue 1) User configuration with the per-test suite settings.
-/// \pre state(upvalue 2) Scheduler context to run test programs in.
-///
 /// \return Number of return values left on the Lua stack.
 static int
 lua_include(lutok::state& state)
 {
-    if (!state.is_userdata(state.upvalue_index(1)))
-        throw std::runtime_error("Found corrupt state for test_program "
-                                 "function");
-    const config::tree* user_config = *state.to_userdata< const config::tree* >(
-        state.upvalue_index(1));
-
-    if (!state.is_userdata(state.upvalue_index(2)))
-        throw std::runtime_error("Found corrupt state for test_program "
-                                 "function");
-    scheduler::scheduler_handle* scheduler_handle =
-        *state.to_userdata< scheduler::scheduler_handle* >(
-            state.upvalue_index(2));
-
     parser::get_from_state(state)->callback_include(
-        fs::path(state.to_string(-1)), *user_config, *scheduler_handle);
+        fs::path(state.to_string(-1)));
     return 0;
 }
 
@@ -592,6 +1240,100 @@ lua_test_suite(lutok::state& state)
 }
 
 
+/// Looks up the evaluation of a Kyuafile in the cache.
+///
+/// \param entry Path to the cache entry of the Kyuafile.
+/// \param build_root The root directory of the test programs.
+///
+/// \return The cached evaluation, or none if there is no entry or if any of
+/// the Kyuafiles it depends on changed since it was stored.
+static optional< evaluation >
+read_cache(const fs::path& entry, const fs::path& build_root)
+{
+    std::ifstream input(entry.c_str(), std::ios::in | std::ios::binary);
+    if (!input) {
+        LD(F("No Kyuafile cache entry %s") % entry);
+        return none;
+    }
+
+    std::string format;
+    if (!read_string(input, format) || format != cache_format) {
+        LW(F("Ignoring malformed Kyuafile cache entry %s") % entry);
+        return none;
+    }
+
+    const optional< evaluation > result = read_evaluation(input, build_root);
+    if (!result) {
+        LD(F("Ignoring malformed or stale Kyuafile cache entry %s") % entry);
+        return none;
+    }
+
+    for (std::vector< kyuafile_state >::const_iterator
+             iter = result.get().kyuafiles.begin();
+         iter != result.get().kyuafiles.end(); ++iter) {
+        const optional< kyuafile_state > current = query_state((*iter).path);
+        if (!current || !(current.get() == *iter)) {
+            LD(F("Kyuafile %s changed since it was cached") % (*iter).path);
+            return none;
+        }
+    }
+
+    LD(F("Loaded %s test programs from Kyuafile cache entry %s") %
+       result.get().programs.size() % entry);
+    return result;
+}
+
+
+/// Stores the evaluation of a Kyuafile in the cache.
+///
+/// The entry is written to a temporary file and renamed into place so that
+/// concurrent Kyua processes never see partial entries.  Problems writing the
+/// entry are logged and otherwise ignored.
+///
+/// \param entry Path to the cache entry of the Kyuafile.
+/// \param result The evaluation to store.
+static void
+write_cache(const fs::path& entry, const evaluation& result)
+{
+    if (!result.cacheable) {
+        LD(F("Not caching %s: some Kyuafiles cannot be snapshotted") % entry);
+        return;
+    }
+
+    const fs::path temp_entry(F("%s.tmp.%s") % entry % ::getpid());
+    try {
+        fs::mkdir_p(entry.branch_path(), 0755);
+    } catch (const fs::error& e) {
+        LW(F("Failed to create the Kyuafile cache: %s") % e.what());
+        return;
+    }
+
+    std::ofstream output(temp_entry.c_str(),
+                         std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!output) {
+        LW(F("Failed to create Kyuafile cache entry %s") % temp_entry);
+        return;
+    }
+
+    write_string(output, cache_format);
+    write_evaluation(output, result);
+    output.close();
+
+    if (!output) {
+        LW(F("Failed to write Kyuafile cache entry %s") % temp_entry);
+        std::remove(temp_entry.c_str());
+    } else if (std::rename(temp_entry.c_str(), entry.c_str()) == -1) {
+        const int original_errno = errno;
+        LW(F("Cannot move %s into place: %s") % entry %
+           std::strerror(original_errno));
+        std::remove(temp_entry.c_str());
+    } else {
+        LD(F("Stored %s test programs in Kyuafile cache entry %s") %
+           result.programs.size() % entry);
+    }
+}
+
+
 }  // anonymous namespace
 
 
@@ -625,6 +1367,12 @@ engine::kyuafile::~kyuafile(void)
 
 /// Parses a test suite configuration file.
 ///
+/// Files included by the Kyuafile are evaluated in parallel in subprocesses,
+/// each with its own Lua state.  If a cache directory is given, the test
+/// programs defined by the whole include tree are stored in it and reused for
+/// as long as none of the Kyuafiles change and no files are added to or
+/// removed from the directories containing them.
+///
 /// \param file The file to parse.
 /// \param user_build_root If not none, specifies a path to a directory
 ///     containing the test programs themselves.  The layout of the build root
@@ -634,6 +1382,8 @@ engine::kyuafile::~kyuafile(void)
 ///     to be passed to the list operation.
 /// \param scheduler_handle The scheduler context to use for loading the test
 ///     case lists.
+/// \param cache_dir If not none, path to the directory holding the cache of
+///     evaluated Kyuafiles.
 ///
 /// \return High-level representation of the configuration file.
 ///
@@ -643,7 +1393,8 @@ engine::kyuafile
 engine::kyuafile::load(const fs::path& file,
                        const optional< fs::path > user_build_root,
                        const config::tree& user_config,
-                       scheduler::scheduler_handle& scheduler_handle)
+                       scheduler::scheduler_handle& scheduler_handle,
+                       const optional< fs::path >& cache_dir)
 {
     const fs::path source_root_ = file.branch_path();
     const fs::path build_root_ = user_build_root ?
@@ -657,10 +1408,36 @@ engine::kyuafile::load(const fs::path& file,
     const fs::path abs_build_root = build_root_.is_absolute() ?
         build_root_ : build_root_.to_absolute();
 
-    return kyuafile(source_root_, build_root_,
-                    parser(source_root_, abs_build_root,
-                           fs::path(file.leaf_name()), user_config,
-                           scheduler_handle).parse());
+    optional< fs::path > cache_entry;
+    optional< evaluation > result;
+    if (cache_dir) {
+        std::vector< std::string > key;
+        key.push_back(file.is_absolute() ? file.str() :
+                      file.to_absolute().str());
+        key.push_back(abs_build_root.str());
+        cache_entry = cache_dir.get() / engine::fingerprint(key);
+        result = read_cache(cache_entry.get(), abs_build_root);
+    }
+    if (!result) {
+        const long cpus = ::sysconf(_SC_NPROCESSORS_ONLN);
+        result = parser(source_root_, abs_build_root,
+                        fs::path(file.leaf_name()),
+                        cpus > 1 ? cpus : 1).parse();
+        if (cache_entry)
+            write_cache(cache_entry.get(), result.get());
+    }
+
+    model::test_programs_vector test_programs;
+    for (std::vector< program_definition >::const_iterator
+             iter = result.get().programs.begin();
+         iter != result.get().programs.end(); ++iter) {
+        test_programs.push_back(model::test_program_ptr(
+            new scheduler::lazy_test_program(
+                (*iter).interface, (*iter).path, abs_build_root,
+                (*iter).test_suite, (*iter).metadata, user_config,
+                scheduler_handle)));
+    }
+    return kyuafile(source_root_, build_root_, test_programs);
 }
 
 
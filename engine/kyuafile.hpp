@@ -43,7 +43,7 @@
 #include "model/test_program_fwd.hpp"
 #include "utils/config/tree_fwd.hpp"
 #include "utils/fs/path.hpp"
-#include "utils/optional_fwd.hpp"
+#include "utils/optional.hpp"
 
 namespace engine {
 
@@ -83,7 +83,9 @@ public:
     static kyuafile load(const utils::fs::path&,
                          const utils::optional< utils::fs::path >,
                          const utils::config::tree&,
-                         scheduler::scheduler_handle&);
+                         scheduler::scheduler_handle&,
+                         const utils::optional< utils::fs::path >& =
+                             utils::none);
 
     const utils::fs::path& source_root(void) const;
     const utils::fs::path& build_root(void) const;
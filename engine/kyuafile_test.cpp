@@ -33,6 +33,7 @@ extern "C" {
 }
 
 #include <stdexcept>
+#include <string>
 #include <typeinfo>
 
 #include <atf-c++.hpp>
@@ -51,6 +52,7 @@ extern "C" {
 #include "utils/datetime.hpp"
 #include "utils/env.hpp"
 #include "utils/format/macros.hpp"
+#include "utils/fs/directory.hpp"
 #include "utils/fs/operations.hpp"
 #include "utils/optional.ipp"
 
@@ -442,6 +444,184 @@ ATF_TEST_CASE_BODY(kyuafile__load__fs_calls_are_relative)
 }
 
 
+ATF_TEST_CASE_WITHOUT_HEAD(kyuafile__load__many_includes);
+ATF_TEST_CASE_BODY(kyuafile__load__many_includes)
+{
+    scheduler::scheduler_handle handle = scheduler::setup();
+
+    std::string contents = "syntax(2)\ntest_suite('the-suite')\n";
+    for (int i = 0; i < 20; ++i) {
+        const fs::path dir(F("dir%s") % i);
+        fs::mkdir(dir, 0755);
+        atf::utils::create_file(
+            (dir / "Kyuafile").str(),
+            F("syntax(2)\n"
+              "plain_test_program{name='first', test_suite='suite%s'}\n"
+              "include('sub/Kyuafile')\n") % i);
+        atf::utils::create_file((dir / "first").str(), "");
+
+        fs::mkdir(dir / "sub", 0755);
+        atf::utils::create_file(
+            (dir / "sub/Kyuafile").str(),
+            "syntax(2)\n"
+            "plain_test_program{name='second', test_suite='sub'}\n");
+        atf::utils::create_file((dir / "sub/second").str(), "");
+
+        contents += F("include('dir%s/Kyuafile')\n") % i;
+        contents += F("plain_test_program{name='prog%s'}\n") % i;
+        atf::utils::create_file(F("prog%s") % i, "");
+    }
+    atf::utils::create_file("Kyuafile", contents);
+
+    const engine::kyuafile suite = engine::kyuafile::load(
+        fs::path("Kyuafile"), none, config::tree(), handle);
+    ATF_REQUIRE_EQ(60, suite.test_programs().size());
+    for (int i = 0; i < 20; ++i) {
+        const model::test_program_ptr first = suite.test_programs()[i * 3];
+        ATF_REQUIRE_EQ(fs::path(F("dir%s/first") % i),
+                       first->relative_path());
+        ATF_REQUIRE_EQ(std::string(F("suite%s") % i),
+                       first->test_suite_name());
+        ATF_REQUIRE_EQ(fs::path(F("dir%s/sub/second") % i),
+                       suite.test_programs()[i * 3 + 1]->relative_path());
+        ATF_REQUIRE_EQ(fs::path(F("prog%s") % i),
+                       suite.test_programs()[i * 3 + 2]->relative_path());
+    }
+
+    handle.cleanup();
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(kyuafile__load__cache__reuse);
+ATF_TEST_CASE_BODY(kyuafile__load__cache__reuse)
+{
+    scheduler::scheduler_handle handle = scheduler::setup();
+
+    // Create the cache upfront so that storing the entry does not modify the
+    // directory holding the Kyuafile.
+    const fs::path cache_dir = fs::current_path() / "cache";
+    fs::mkdir(cache_dir, 0755);
+
+    atf::utils::create_file(
+        "Kyuafile",
+        "syntax(2)\n"
+        "test_suite('the-suite')\n"
+        "atf_test_program{name='one', timeout=10}\n"
+        "if fs.exists('subdir/two') then\n"
+        "    atf_test_program{name='subdir/two'}\n"
+        "end\n");
+    atf::utils::create_file("one", "");
+    fs::mkdir(fs::path("subdir"), 0755);
+
+    {
+        const engine::kyuafile suite = engine::kyuafile::load(
+            fs::path("Kyuafile"), none, config::tree(), handle,
+            utils::make_optional(cache_dir));
+        ATF_REQUIRE_EQ(1, suite.test_programs().size());
+    }
+    ATF_REQUIRE_EQ(3, fs::scan_directory(cache_dir).size());
+
+    // Changes outside of the directories of the Kyuafiles go unnoticed, which
+    // proves that the second load comes from the cache.
+    atf::utils::create_file("subdir/two", "");
+
+    {
+        const engine::kyuafile suite = engine::kyuafile::load(
+            fs::path("Kyuafile"), none, config::tree(), handle,
+            utils::make_optional(cache_dir));
+        ATF_REQUIRE_EQ(1, suite.test_programs().size());
+        ATF_REQUIRE_EQ("atf", suite.test_programs()[0]->interface_name());
+        ATF_REQUIRE_EQ(fs::path("one"),
+                       suite.test_programs()[0]->relative_path());
+        ATF_REQUIRE_EQ("the-suite",
+                       suite.test_programs()[0]->test_suite_name());
+        ATF_REQUIRE_EQ(datetime::delta(10, 0),
+                       suite.test_programs()[0]->get_metadata().timeout());
+    }
+
+    handle.cleanup();
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(kyuafile__load__cache__changed);
+ATF_TEST_CASE_BODY(kyuafile__load__cache__changed)
+{
+    scheduler::scheduler_handle handle = scheduler::setup();
+
+    const fs::path cache_dir = fs::current_path() / "cache";
+    fs::mkdir(cache_dir, 0755);
+
+    atf::utils::create_file(
+        "Kyuafile",
+        "syntax(2)\n"
+        "test_suite('the-suite')\n"
+        "include('dir/Kyuafile')\n");
+    fs::mkdir(fs::path("dir"), 0755);
+    atf::utils::create_file(
+        "dir/Kyuafile",
+        "syntax(2)\n"
+        "plain_test_program{name='one', test_suite='first'}\n"
+        "if fs.exists('two') then\n"
+        "    plain_test_program{name='two', test_suite='first'}\n"
+        "end\n");
+    atf::utils::create_file("dir/one", "");
+
+    ATF_REQUIRE_EQ(1, engine::kyuafile::load(
+        fs::path("Kyuafile"), none, config::tree(), handle,
+        utils::make_optional(cache_dir)).test_programs().size());
+
+    // Adding a file next to an included Kyuafile invalidates the cache.
+    atf::utils::create_file("dir/two", "");
+    ATF_REQUIRE_EQ(2, engine::kyuafile::load(
+        fs::path("Kyuafile"), none, config::tree(), handle,
+        utils::make_optional(cache_dir)).test_programs().size());
+
+    // And so does modifying an included Kyuafile.
+    atf::utils::create_file(
+        "dir/Kyuafile",
+        "syntax(2)\n"
+        "plain_test_program{name='one', test_suite='first'}\n");
+    ATF_REQUIRE_EQ(1, engine::kyuafile::load(
+        fs::path("Kyuafile"), none, config::tree(), handle,
+        utils::make_optional(cache_dir)).test_programs().size());
+
+    handle.cleanup();
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(kyuafile__load__cache__missing_test_program);
+ATF_TEST_CASE_BODY(kyuafile__load__cache__missing_test_program)
+{
+    scheduler::scheduler_handle handle = scheduler::setup();
+
+    const fs::path cache_dir = fs::current_path() / "cache";
+    fs::mkdir(cache_dir, 0755);
+
+    fs::mkdir(fs::path("src"), 0755);
+    atf::utils::create_file(
+        "src/Kyuafile",
+        "syntax(2)\n"
+        "atf_test_program{name='one', test_suite='first'}\n");
+    fs::mkdir(fs::path("build"), 0755);
+    atf::utils::create_file("build/one", "");
+
+    ATF_REQUIRE_EQ(1, engine::kyuafile::load(
+        fs::path("src/Kyuafile"), utils::make_optional(fs::path("build")),
+        config::tree(), handle, utils::make_optional(cache_dir))
+                   .test_programs().size());
+
+    fs::unlink(fs::path("build/one"));
+    ATF_REQUIRE_THROW_RE(
+        engine::load_error, "Non-existent.*'one'",
+        engine::kyuafile::load(fs::path("src/Kyuafile"),
+                               utils::make_optional(fs::path("build")),
+                               config::tree(), handle,
+                               utils::make_optional(cache_dir)));
+
+    handle.cleanup();
+}
+
+
 /// Verifies that load raises a load_error on a given input.
 ///
 /// \param file Name of the file to load.
@@ -550,6 +730,44 @@ ATF_TEST_CASE_BODY(kyuafile__load__test_suite__twice)
 }
 
 
+ATF_TEST_CASE_WITHOUT_HEAD(kyuafile__load__include_error);
+ATF_TEST_CASE_BODY(kyuafile__load__include_error)
+{
+    atf::utils::create_file(
+        "config",
+        "syntax(2)\n"
+        "include('dir/config')\n"
+        "syntax(2)\n");
+    fs::mkdir(fs::path("dir"), 0755);
+    atf::utils::create_file("dir/config", "syntax(12)\n");
+
+    do_load_error_test("config", "Load of 'config' failed: Load of "
+                       "'dir/config' failed: Unsupported file version 12");
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(kyuafile__load__include_error__earliest);
+ATF_TEST_CASE_BODY(kyuafile__load__include_error__earliest)
+{
+    std::string contents = "syntax(2)\n";
+    for (int i = 0; i < 10; ++i) {
+        const fs::path dir(F("dir%s") % i);
+        fs::mkdir(dir, 0755);
+        if (i == 3 || i == 7)
+            atf::utils::create_file((dir / "config").str(),
+                                    F("syntax(%s)\n") % (i + 10));
+        else
+            atf::utils::create_file((dir / "config").str(), "syntax(2)\n");
+        contents += F("include('dir%s/config')\n") % i;
+    }
+    contents += "syntax(2)\n";
+    atf::utils::create_file("config", contents);
+
+    do_load_error_test("config", "Load of 'config' failed: Load of "
+                       "'dir3/config' failed: Unsupported file version 13");
+}
+
+
 ATF_TEST_CASE_WITHOUT_HEAD(kyuafile__load__missing_file);
 ATF_TEST_CASE_BODY(kyuafile__load__missing_file)
 {
@@ -593,6 +811,10 @@ ATF_INIT_TEST_CASES(tcs)
     ATF_ADD_TEST_CASE(tcs, kyuafile__load__build_directory);
     ATF_ADD_TEST_CASE(tcs, kyuafile__load__absolute_paths_are_stable);
     ATF_ADD_TEST_CASE(tcs, kyuafile__load__fs_calls_are_relative);
+    ATF_ADD_TEST_CASE(tcs, kyuafile__load__many_includes);
+    ATF_ADD_TEST_CASE(tcs, kyuafile__load__cache__reuse);
+    ATF_ADD_TEST_CASE(tcs, kyuafile__load__cache__changed);
+    ATF_ADD_TEST_CASE(tcs, kyuafile__load__cache__missing_test_program);
     ATF_ADD_TEST_CASE(tcs, kyuafile__load__test_program_not_basename);
     ATF_ADD_TEST_CASE(tcs, kyuafile__load__lua_error);
     ATF_ADD_TEST_CASE(tcs, kyuafile__load__syntax__not_called);
@@ -601,6 +823,8 @@ ATF_INIT_TEST_CASES(tcs)
     ATF_ADD_TEST_CASE(tcs, kyuafile__load__syntax__bad_version);
     ATF_ADD_TEST_CASE(tcs, kyuafile__load__test_suite__missing);
     ATF_ADD_TEST_CASE(tcs, kyuafile__load__test_suite__twice);
+    ATF_ADD_TEST_CASE(tcs, kyuafile__load__include_error);
+    ATF_ADD_TEST_CASE(tcs, kyuafile__load__include_error__earliest);
     ATF_ADD_TEST_CASE(tcs, kyuafile__load__missing_file);
     ATF_ADD_TEST_CASE(tcs, kyuafile__load__missing_test_program);
 }
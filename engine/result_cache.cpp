@@ -0,0 +1,451 @@
+// Copyright 2026 The Kyua Authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// * Neither the name of Google Inc. nor the names of its contributors
+//   may be used to endorse or promote products derived from this software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "engine/result_cache.hpp"
+
+extern "C" {
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include <unistd.h>
+}
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+#include "utils/format/macros.hpp"
+#include "utils/fs/directory.hpp"
+#include "utils/fs/exceptions.hpp"
+#include "utils/fs/operations.hpp"
+#include "utils/logging/macros.hpp"
+#include "utils/noncopyable.hpp"
+#include "utils/optional.ipp"
+#include "utils/text/exceptions.hpp"
+#include "utils/text/operations.ipp"
+#include "utils/units.hpp"
+
+namespace datetime = utils::datetime;
+namespace fs = utils::fs;
+namespace text = utils::text;
+namespace units = utils::units;
+
+using utils::none;
+using utils::optional;
+
+
+namespace {
+
+
+/// Name of the file that holds the result within a cache entry.
+static const char* const result_name = "result";
+
+
+/// Name of the file that holds the stdout within a cache entry.
+static const char* const stdout_name = "stdout";
+
+
+/// Name of the file that holds the stderr within a cache entry.
+static const char* const stderr_name = "stderr";
+
+
+/// Mapping of result types to their textual representation in the cache.
+static const std::map< model::test_result_type, std::string > type_names = {
+    { model::test_result_broken, "broken" },
+    { model::test_result_expected_failure, "expected_failure" },
+    { model::test_result_failed, "failed" },
+    { model::test_result_passed, "passed" },
+    { model::test_result_skipped, "skipped" },
+};
+
+
+/// Parses the textual representation of a result type.
+///
+/// \param name The name of the result type.
+///
+/// \return The result type, or none if the name is not known.
+static optional< model::test_result_type >
+parse_type(const std::string& name)
+{
+    for (std::map< model::test_result_type, std::string >::const_iterator
+             iter = type_names.begin(); iter != type_names.end(); ++iter) {
+        if ((*iter).second == name)
+            return utils::make_optional((*iter).first);
+    }
+    return none;
+}
+
+
+/// Reads the result file of a cache entry.
+///
+/// \param path Path to the result file.
+///
+/// \return The result and duration stored in the file, or none if the file
+/// does not exist or is invalid.
+static optional< std::pair< model::test_result, datetime::delta > >
+read_result(const fs::path& path)
+{
+    std::ifstream input(path.c_str());
+    if (!input)
+        return none;
+
+    std::string type_name, duration_usec;
+    if (!std::getline(input, type_name) || !std::getline(input, duration_usec)) {
+        LW(F("Ignoring truncated cache entry %s") % path);
+        return none;
+    }
+    std::ostringstream reason;
+    reason << input.rdbuf();
+
+    const optional< model::test_result_type > type = parse_type(type_name);
+    if (!type) {
+        LW(F("Ignoring cache entry %s with unknown result type '%s'") % path %
+           type_name);
+        return none;
+    }
+    int64_t usec;
+    try {
+        usec = text::to_type< int64_t >(duration_usec);
+    } catch (const text::value_error& e) {
+        LW(F("Ignoring cache entry %s with invalid duration: %s") % path %
+           e.what());
+        return none;
+    }
+
+    return utils::make_optional(std::make_pair(
+        model::test_result(type.get(), reason.str()),
+        datetime::delta::from_microseconds(usec)));
+}
+
+
+/// Writes the result file of a cache entry.
+///
+/// \param path Path to the result file to create.
+/// \param result The result to store.
+/// \param duration The time it took to run the test case.
+///
+/// \throw fs::error If the file cannot be written.
+static void
+write_result(const fs::path& path, const model::test_result& result,
+             const datetime::delta& duration)
+{
+    std::ofstream output(path.c_str());
+    if (!output)
+        throw fs::error(F("Cannot create %s") % path);
+    output << (*type_names.find(result.type())).second << '\n'
+           << duration.to_microseconds() << '\n'
+           << result.reason();
+    output.close();
+    if (!output)
+        throw fs::error(F("Failed to write %s") % path);
+}
+
+
+/// Entry of the cache as seen by the eviction algorithm.
+struct entry_info {
+    /// Time of the last access to the entry.
+    struct ::timespec last_access;
+
+    /// Name of the entry.
+    std::string name;
+
+    /// Total size of the files in the entry.
+    std::size_t size;
+
+    /// Orders entries from least to most recently used.
+    ///
+    /// \param other The entry to compare to.
+    ///
+    /// \return True if this entry was used before the other one.
+    bool
+    operator<(const entry_info& other) const
+    {
+        if (last_access.tv_sec != other.last_access.tv_sec)
+            return last_access.tv_sec < other.last_access.tv_sec;
+        if (last_access.tv_nsec != other.last_access.tv_nsec)
+            return last_access.tv_nsec < other.last_access.tv_nsec;
+        return name < other.name;
+    }
+};
+
+
+/// Checks if a directory entry is a temporary entry being written.
+///
+/// \param name The name of the directory entry.
+///
+/// \return True if the entry is a temporary one.
+static bool
+is_temporary(const std::string& name)
+{
+    return name.find(".tmp.") != std::string::npos;
+}
+
+
+}  // anonymous namespace
+
+
+/// Constructor.
+///
+/// \param result_ The result of the test case.
+/// \param duration_ The time it took to run the test case when it was cached.
+/// \param stdout_file_ Path to the cached stdout of the test case.
+/// \param stderr_file_ Path to the cached stderr of the test case.
+engine::cached_result::cached_result(const model::test_result& result_,
+                                     const datetime::delta& duration_,
+                                     const fs::path& stdout_file_,
+                                     const fs::path& stderr_file_) :
+    _result(result_),
+    _duration(duration_),
+    _stdout_file(stdout_file_),
+    _stderr_file(stderr_file_)
+{
+}
+
+
+/// Returns the result of the test case.
+///
+/// \return A test result.
+const model::test_result&
+engine::cached_result::result(void) const
+{
+    return _result;
+}
+
+
+/// Returns the time it took to run the test case when it was cached.
+///
+/// \return A time delta.
+const datetime::delta&
+engine::cached_result::duration(void) const
+{
+    return _duration;
+}
+
+
+/// Returns the path to the cached stdout of the test case.
+///
+/// \return A path that remains valid until the entry is evicted.
+const fs::path&
+engine::cached_result::stdout_file(void) const
+{
+    return _stdout_file;
+}
+
+
+/// Returns the path to the cached stderr of the test case.
+///
+/// \return A path that remains valid until the entry is evicted.
+const fs::path&
+engine::cached_result::stderr_file(void) const
+{
+    return _stderr_file;
+}
+
+
+/// Internal implementation for the result_cache.
+struct engine::result_cache::impl : utils::noncopyable {
+    /// Directory holding the cache entries.
+    fs::path directory;
+
+    /// Maximum total size of the cache entries.
+    units::bytes max_size;
+
+    /// Constructor.
+    ///
+    /// \param directory_ Directory holding the cache entries.
+    /// \param max_size_ Maximum total size of the cache entries.
+    impl(const fs::path& directory_, const units::bytes& max_size_) :
+        directory(directory_),
+        max_size(max_size_)
+    {
+    }
+};
+
+
+/// Constructor.
+///
+/// The cache directory is not created until the first entry is put.
+///
+/// \param directory Directory holding the cache entries.
+/// \param max_size Maximum total size of the cache entries, enforced by trim().
+engine::result_cache::result_cache(const fs::path& directory,
+                                   const units::bytes& max_size) :
+    _pimpl(new impl(directory, max_size))
+{
+}
+
+
+/// Destructor.
+engine::result_cache::~result_cache(void)
+{
+}
+
+
+/// Looks up an entry in the cache.
+///
+/// A successful lookup marks the entry as the most recently used.
+///
+/// \param key The key of the entry, usually the fingerprint of a test case.
+///
+/// \return The cached result, or none if there is no valid entry for the key.
+optional< engine::cached_result >
+engine::result_cache::get(const std::string& key)
+{
+    const fs::path entry = _pimpl->directory / key;
+    const fs::path result_file = entry / result_name;
+
+    const optional< std::pair< model::test_result, datetime::delta > > data =
+        read_result(result_file);
+    if (!data)
+        return none;
+
+    if (::utimes(result_file.c_str(), NULL) == -1) {
+        const int original_errno = errno;
+        LW(F("Failed to update access time of cache entry %s: %s") % entry %
+           std::strerror(original_errno));
+    }
+
+    LD(F("Cache hit for %s") % key);
+    return utils::make_optional(cached_result(
+        data.get().first, data.get().second, entry / stdout_name,
+        entry / stderr_name));
+}
+
+
+/// Adds an entry to the cache.
+///
+/// If an entry for the key already exists, it is left untouched.
+///
+/// \param key The key of the entry, usually the fingerprint of a test case.
+/// \param result The result of the test case.
+/// \param duration The time it took to run the test case.
+/// \param stdout_file Path to the stdout of the test case, which is copied.
+/// \param stderr_file Path to the stderr of the test case, which is copied.
+void
+engine::result_cache::put(const std::string& key,
+                          const model::test_result& result,
+                          const datetime::delta& duration,
+                          const fs::path& stdout_file,
+                          const fs::path& stderr_file)
+{
+    const fs::path entry = _pimpl->directory / key;
+    const fs::path temp_entry = _pimpl->directory / (
+        F("%s.tmp.%s") % key % ::getpid());
+
+    try {
+        fs::mkdir_p(_pimpl->directory, 0755);
+        fs::mkdir(temp_entry, 0755);
+        fs::copy(stdout_file, temp_entry / stdout_name);
+        fs::copy(stderr_file, temp_entry / stderr_name);
+        write_result(temp_entry / result_name, result, duration);
+    } catch (const fs::error& e) {
+        LW(F("Failed to add %s to the result cache: %s") % key % e.what());
+        if (fs::exists(temp_entry))
+            fs::rm_r(temp_entry);
+        return;
+    }
+
+    if (std::rename(temp_entry.c_str(), entry.c_str()) == -1) {
+        const int original_errno = errno;
+        // Another process may have added the same entry in the meantime, in
+        // which case its contents are equivalent to ours.
+        LD(F("Cannot move %s into place: %s") % entry %
+           std::strerror(original_errno));
+        fs::rm_r(temp_entry);
+    } else {
+        LD(F("Added %s to the result cache") % key);
+    }
+}
+
+
+/// Evicts the least recently used entries until the cache fits its size.
+void
+engine::result_cache::trim(void)
+{
+    if (!fs::exists(_pimpl->directory))
+        return;
+
+    std::vector< entry_info > entries;
+    std::size_t total_size = 0;
+    try {
+        const std::set< fs::directory_entry > names = fs::scan_directory(
+            _pimpl->directory);
+        for (std::set< fs::directory_entry >::const_iterator
+                 iter = names.begin(); iter != names.end(); ++iter) {
+            const std::string& name = (*iter).name;
+            if (name == "." || name == ".." || is_temporary(name))
+                continue;
+
+            const fs::path entry = _pimpl->directory / name;
+            entry_info info;
+            info.name = name;
+            info.size = 0;
+            info.last_access.tv_sec = 0;
+            info.last_access.tv_nsec = 0;
+            const char* const files[] = { result_name, stdout_name,
+                                          stderr_name, NULL };
+            for (const char* const* file = files; *file != NULL; ++file) {
+                struct ::stat sb;
+                if (::stat((entry / *file).c_str(), &sb) == -1)
+                    continue;
+                info.size += static_cast< std::size_t >(sb.st_size);
+                if (*file == result_name)
+                    info.last_access = sb.st_mtim;
+            }
+            total_size += info.size;
+            entries.push_back(info);
+        }
+    } catch (const fs::error& e) {
+        LW(F("Failed to scan the result cache: %s") % e.what());
+        return;
+    }
+
+    std::sort(entries.begin(), entries.end());
+    std::size_t evicted = 0;
+    for (std::vector< entry_info >::const_iterator iter = entries.begin();
+         iter != entries.end() && total_size > _pimpl->max_size; ++iter) {
+        try {
+            fs::rm_r(_pimpl->directory / (*iter).name);
+            total_size -= (*iter).size;
+            ++evicted;
+        } catch (const fs::error& e) {
+            LW(F("Failed to evict %s from the result cache: %s") %
+               (*iter).name % e.what());
+        }
+    }
+    if (evicted > 0)
+        LI(F("Evicted %s entries from the result cache") % evicted);
+}
@@ -0,0 +1,107 @@
+// Copyright 2026 The Kyua Authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// * Neither the name of Google Inc. nor the names of its contributors
+//   may be used to endorse or promote products derived from this software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+/// \file engine/result_cache.hpp
+/// Local cache of the results of deterministic test cases.
+///
+/// Test cases that declare themselves as cacheable produce the same result for
+/// as long as their inputs do not change.  The cache maps the fingerprint of
+/// such test cases, which summarizes all of their inputs, to the result and
+/// output of a previous execution so that they need not run again.
+
+#if !defined(ENGINE_RESULT_CACHE_HPP)
+#define ENGINE_RESULT_CACHE_HPP
+
+#include <memory>
+#include <string>
+
+#include "model/test_result.hpp"
+#include "utils/datetime.hpp"
+#include "utils/fs/path.hpp"
+#include "utils/optional_fwd.hpp"
+#include "utils/units_fwd.hpp"
+
+namespace engine {
+
+
+/// Result of a test case as retrieved from the cache.
+class cached_result {
+    /// The result of the test case.
+    model::test_result _result;
+
+    /// The time it took to run the test case when it was cached.
+    utils::datetime::delta _duration;
+
+    /// Path to the cached stdout of the test case.
+    utils::fs::path _stdout_file;
+
+    /// Path to the cached stderr of the test case.
+    utils::fs::path _stderr_file;
+
+public:
+    cached_result(const model::test_result&, const utils::datetime::delta&,
+                  const utils::fs::path&, const utils::fs::path&);
+
+    const model::test_result& result(void) const;
+    const utils::datetime::delta& duration(void) const;
+    const utils::fs::path& stdout_file(void) const;
+    const utils::fs::path& stderr_file(void) const;
+};
+
+
+/// Size-bounded cache of test results, evicted in least-recently-used order.
+///
+/// The cache lives in a local directory with one subdirectory per entry, named
+/// after the key of the entry.  Entries are written to a temporary location
+/// and renamed into place so that concurrent Kyua processes sharing the same
+/// cache never see partial entries.  Problems accessing the cache are logged
+/// and otherwise ignored: the worst that can happen is that a test case runs
+/// when it could have been served from the cache.
+class result_cache {
+    struct impl;
+
+    /// Pointer to the shared internal implementation.
+    std::shared_ptr< impl > _pimpl;
+
+public:
+    result_cache(const utils::fs::path&, const utils::units::bytes&);
+    ~result_cache(void);
+
+    utils::optional< cached_result > get(const std::string&);
+    void put(const std::string&, const model::test_result&,
+             const utils::datetime::delta&, const utils::fs::path&,
+             const utils::fs::path&);
+    void trim(void);
+};
+
+
+}  // namespace engine
+
+
+#endif  // !defined(ENGINE_RESULT_CACHE_HPP)
@@ -0,0 +1,232 @@
+// Copyright 2026 The Kyua Authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// * Neither the name of Google Inc. nor the names of its contributors
+//   may be used to endorse or promote products derived from this software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "engine/result_cache.hpp"
+
+extern "C" {
+#include <sys/time.h>
+}
+
+#include <set>
+
+#include <atf-c++.hpp>
+
+#include "model/test_result.hpp"
+#include "utils/datetime.hpp"
+#include "utils/fs/directory.hpp"
+#include "utils/fs/operations.hpp"
+#include "utils/fs/path.hpp"
+#include "utils/optional.ipp"
+#include "utils/units.hpp"
+
+namespace datetime = utils::datetime;
+namespace fs = utils::fs;
+namespace units = utils::units;
+
+using utils::optional;
+
+
+namespace {
+
+
+/// Adds an entry to a cache with the given output.
+///
+/// \param cache The cache to add the entry to.
+/// \param key The key of the entry.
+/// \param output Contents of the stdout of the entry.
+static void
+put_entry(engine::result_cache& cache, const std::string& key,
+          const std::string& output)
+{
+    atf::utils::create_file("stdout.txt", output);
+    atf::utils::create_file("stderr.txt", "");
+    cache.put(key, model::test_result(model::test_result_passed),
+              datetime::delta(1, 0), fs::path("stdout.txt"),
+              fs::path("stderr.txt"));
+}
+
+
+/// Sets the last access time of a cache entry.
+///
+/// \param key The key of the entry.
+/// \param seconds The access time to set, in seconds since the epoch.
+static void
+set_last_access(const std::string& key, const long seconds)
+{
+    struct ::timeval times[2];
+    times[0].tv_sec = seconds;
+    times[0].tv_usec = 0;
+    times[1] = times[0];
+    ATF_REQUIRE(::utimes((fs::path("cache") / key / "result").c_str(),
+                         times) != -1);
+}
+
+
+}  // anonymous namespace
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(get__missing);
+ATF_TEST_CASE_BODY(get__missing)
+{
+    engine::result_cache cache(fs::path("cache"), units::bytes(1024));
+    ATF_REQUIRE(!cache.get("0123456789abcdef"));
+    ATF_REQUIRE(!fs::exists(fs::path("cache")));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(put_get__roundtrip);
+ATF_TEST_CASE_BODY(put_get__roundtrip)
+{
+    atf::utils::create_file("out", "Some output\n");
+    atf::utils::create_file("err", "Some error\nin two lines\n");
+
+    engine::result_cache cache(fs::path("cache"), units::bytes(1024));
+    const model::test_result result(model::test_result_expected_failure,
+                                    "Known bug\nwith details");
+    cache.put("abcd", result, datetime::delta(3, 250),
+              fs::path("out"), fs::path("err"));
+    cache.put("efgh", model::test_result(model::test_result_passed),
+              datetime::delta(0, 10), fs::path("out"), fs::path("err"));
+
+    const optional< engine::cached_result > cached = cache.get("abcd");
+    ATF_REQUIRE(cached);
+    ATF_REQUIRE_EQ(result, cached.get().result());
+    ATF_REQUIRE_EQ(datetime::delta(3, 250), cached.get().duration());
+    ATF_REQUIRE(atf::utils::compare_file(cached.get().stdout_file().str(),
+                                         "Some output\n"));
+    ATF_REQUIRE(atf::utils::compare_file(cached.get().stderr_file().str(),
+                                         "Some error\nin two lines\n"));
+
+    const optional< engine::cached_result > other = cache.get("efgh");
+    ATF_REQUIRE(other);
+    ATF_REQUIRE_EQ(model::test_result(model::test_result_passed),
+                   other.get().result());
+    ATF_REQUIRE_EQ(datetime::delta(0, 10), other.get().duration());
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(put__existing);
+ATF_TEST_CASE_BODY(put__existing)
+{
+    engine::result_cache cache(fs::path("cache"), units::bytes(1024));
+    put_entry(cache, "abcd", "first");
+    put_entry(cache, "abcd", "second");
+
+    const optional< engine::cached_result > cached = cache.get("abcd");
+    ATF_REQUIRE(cached);
+    ATF_REQUIRE(atf::utils::compare_file(cached.get().stdout_file().str(),
+                                         "first"));
+
+    std::set< fs::directory_entry > expected;
+    expected.insert(fs::directory_entry("."));
+    expected.insert(fs::directory_entry(".."));
+    expected.insert(fs::directory_entry("abcd"));
+    ATF_REQUIRE(expected == fs::scan_directory(fs::path("cache")));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(put__missing_output);
+ATF_TEST_CASE_BODY(put__missing_output)
+{
+    atf::utils::create_file("err", "");
+
+    engine::result_cache cache(fs::path("cache"), units::bytes(1024));
+    cache.put("abcd", model::test_result(model::test_result_passed),
+              datetime::delta(1, 0), fs::path("missing"), fs::path("err"));
+    ATF_REQUIRE(!cache.get("abcd"));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(get__invalid_entry);
+ATF_TEST_CASE_BODY(get__invalid_entry)
+{
+    fs::mkdir_p(fs::path("cache/type"), 0755);
+    atf::utils::create_file("cache/type/result", "unknown\n10\n");
+    fs::mkdir_p(fs::path("cache/duration"), 0755);
+    atf::utils::create_file("cache/duration/result", "passed\nabc\n");
+    fs::mkdir_p(fs::path("cache/truncated"), 0755);
+    atf::utils::create_file("cache/truncated/result", "passed");
+
+    engine::result_cache cache(fs::path("cache"), units::bytes(1024));
+    ATF_REQUIRE(!cache.get("type"));
+    ATF_REQUIRE(!cache.get("duration"));
+    ATF_REQUIRE(!cache.get("truncated"));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(trim__lru);
+ATF_TEST_CASE_BODY(trim__lru)
+{
+    engine::result_cache cache(fs::path("cache"), units::bytes(1024));
+    put_entry(cache, "first", std::string(400, 'a'));
+    put_entry(cache, "second", std::string(400, 'b'));
+    put_entry(cache, "third", std::string(400, 'c'));
+    set_last_access("first", 1000);
+    set_last_access("second", 2000);
+    set_last_access("third", 3000);
+
+    // Using the oldest entry makes the second one the least recently used.
+    ATF_REQUIRE(cache.get("first"));
+
+    cache.trim();
+    ATF_REQUIRE(cache.get("first"));
+    ATF_REQUIRE(!cache.get("second"));
+    ATF_REQUIRE(cache.get("third"));
+
+    cache.trim();
+    ATF_REQUIRE(cache.get("first"));
+    ATF_REQUIRE(cache.get("third"));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(trim__within_limits);
+ATF_TEST_CASE_BODY(trim__within_limits)
+{
+    engine::result_cache cache(fs::path("cache"), units::bytes(1024));
+    cache.trim();
+    ATF_REQUIRE(!fs::exists(fs::path("cache")));
+
+    put_entry(cache, "first", "some output");
+    put_entry(cache, "second", "some output");
+    cache.trim();
+    ATF_REQUIRE(cache.get("first"));
+    ATF_REQUIRE(cache.get("second"));
+}
+
+
+ATF_INIT_TEST_CASES(tcs)
+{
+    ATF_ADD_TEST_CASE(tcs, get__missing);
+    ATF_ADD_TEST_CASE(tcs, put_get__roundtrip);
+    ATF_ADD_TEST_CASE(tcs, put__existing);
+    ATF_ADD_TEST_CASE(tcs, put__missing_output);
+    ATF_ADD_TEST_CASE(tcs, get__invalid_entry);
+    ATF_ADD_TEST_CASE(tcs, trim__lru);
+    ATF_ADD_TEST_CASE(tcs, trim__within_limits);
+}
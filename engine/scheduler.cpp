@@ -34,14 +34,17 @@ extern "C" {
 
 #include <cstdio>
 #include <cstdlib>
+#include <deque>
 #include <fstream>
 #include <memory>
 #include <stdexcept>
+#include <utility>
 
 #include "engine/config.hpp"
 #include "engine/debugger.hpp"
 #include "engine/exceptions.hpp"
 #include "engine/execenv/execenv.hpp"
+#include "engine/execenv/execenv_host.hpp"
 #include "engine/requirements.hpp"
 #include "model/context.hpp"
 #include "model/metadata.hpp"
@@ -58,15 +61,18 @@ extern "C" {
 #include "utils/fs/operations.hpp"
 #include "utils/fs/path.hpp"
 #include "utils/logging/macros.hpp"
+#include "utils/metrics.hpp"
 #include "utils/noncopyable.hpp"
 #include "utils/optional.ipp"
 #include "utils/passwd.hpp"
+#include "utils/process/exec_plan.hpp"
 #include "utils/process/executor.ipp"
 #include "utils/process/status.hpp"
 #include "utils/sanity.hpp"
 #include "utils/stacktrace.hpp"
 #include "utils/stream.hpp"
 #include "utils/text/operations.ipp"
+#include "utils/units.hpp"
 
 namespace config = utils::config;
 namespace datetime = utils::datetime;
@@ -74,10 +80,12 @@ namespace execenv = engine::execenv;
 namespace executor = utils::process::executor;
 namespace fs = utils::fs;
 namespace logging = utils::logging;
+namespace metrics = utils::metrics;
 namespace passwd = utils::passwd;
 namespace process = utils::process;
 namespace scheduler = engine::scheduler;
 namespace text = utils::text;
+namespace units = utils::units;
 
 using utils::none;
 using utils::optional;
@@ -120,6 +128,26 @@ static const int exit_skipped = 84;
 static const char* skipped_cookie = "skipped.txt";
 
 
+/// Maximum number of debuggers that may gather stack traces concurrently.
+///
+/// Debuggers can be memory hungry and slow, so we do not want a burst of
+/// crashing tests to spawn one per test.  Crashed tests in excess of this
+/// limit wait for a slot before their results are reported.
+static const std::size_t max_concurrent_stacktraces = 2;
+
+
+/// Time to query a test program for its list of test cases.
+static metrics::histogram listing_seconds(
+    "kyua_scheduler_listing_seconds",
+    "Time to list the test cases of a test program");
+
+
+/// Number of test cases spawned.
+static metrics::counter spawned_tests(
+    "kyua_scheduler_spawned_tests",
+    "Number of test cases spawned");
+
+
 /// Mapping of interface names to interface definitions.
 typedef std::map< std::string, std::shared_ptr< scheduler::interface > >
     interfaces_map;
@@ -232,6 +260,25 @@ struct test_exec_data : public exec_data {
     /// as indicated by needs_cleanup.
     optional< executor::exit_handle > exit_handle;
 
+    /// Reason for terminating the test case before it completed, if any.
+    ///
+    /// This is set by terminate_test() and overrides the result computed from
+    /// the exit status of the killed subprocess.
+    optional< std::string > termination_reason;
+
+    /// Result to report if the body of the test case times out, if any.
+    ///
+    /// This is set when the timeout of the test case was shortened, be it to
+    /// meet the deadline of the scheduler or to apply an adaptive timeout, so
+    /// that these timeouts are told apart from those declared by the test.
+    optional< model::test_result > timeout_result;
+
+    /// Resources consumed by the subprocesses of this test case so far.
+    scheduler::resource_usage_map resource_usages;
+
+    /// Timestamps of the subprocesses of this test case so far.
+    scheduler::phase_times_map phases;
+
     /// Constructor.
     ///
     /// \param test_program_ Test program data for this test case.
@@ -321,6 +368,29 @@ struct execenv_exec_data : public exec_data {
 };
 
 
+/// Maintenance data held while a stack trace of a crashed process is gathered.
+///
+/// Instances of this object are related to a previous exec_data of any type,
+/// whose processing is resumed once the debugger terminates.
+struct stacktrace_exec_data : public exec_data {
+    /// The exit handle of the crashed process.
+    executor::exit_handle crashed_exit_handle;
+
+    /// Constructor.
+    ///
+    /// \param test_program_ Test program data for this test case.
+    /// \param test_case_name_ Name of the test case.
+    /// \param crashed_exit_handle_ Exit handle of the process that crashed.
+    stacktrace_exec_data(const model::test_program_ptr test_program_,
+                         const std::string& test_case_name_,
+                         const executor::exit_handle& crashed_exit_handle_) :
+        exec_data(test_program_, test_case_name_),
+        crashed_exit_handle(crashed_exit_handle_)
+    {
+    }
+};
+
+
 /// Shared pointer to exec_data.
 ///
 /// We require this because we want exec_data to not be copyable, and thus we
@@ -499,6 +569,180 @@ public:
 };
 
 
+/// Functor to compute the plan to execute a test program in a child process.
+///
+/// This is the counterpart of run_test_program for test cases that can be
+/// spawned without running any code in the subprocess; see can_plan_test().
+class plan_test_program {
+    /// Interface of the test program to execute.
+    std::shared_ptr< scheduler::interface > _interface;
+
+    /// Test program to execute.
+    const model::test_program _test_program;
+
+    /// Name of the test case to execute.
+    const std::string& _test_case_name;
+
+    /// User-provided configuration variables.
+    const config::tree& _user_config;
+
+public:
+    /// Constructor.
+    ///
+    /// \param interface Interface of the test program to execute.
+    /// \param test_program Test program to execute.
+    /// \param test_case_name Name of the test case to execute.
+    /// \param user_config User-provided configuration variables.
+    plan_test_program(
+        const std::shared_ptr< scheduler::interface > interface,
+        const model::test_program_ptr test_program,
+        const std::string& test_case_name,
+        const config::tree& user_config) :
+        _interface(interface),
+        _test_program(force_absolute_paths(*test_program)),
+        _test_case_name(test_case_name),
+        _user_config(user_config)
+    {
+    }
+
+    /// Computes the plan of the subprocess.
+    ///
+    /// \param control_directory The testcase directory where files will be
+    ///     read from.
+    ///
+    /// \return The plan to execute the test case.
+    process::exec_plan
+    operator()(const fs::path& control_directory)
+    {
+        const config::properties_map vars = scheduler::generate_config(
+            _user_config, _test_program.test_suite_name());
+        return _interface->plan_test(_test_program, _test_case_name, vars,
+                                     control_directory);
+    }
+};
+
+
+/// Checks whether a test case can be spawned from a precomputed plan.
+///
+/// Test cases are spawned this way whenever their subprocess would only have
+/// to exec(2) the test program after the executor isolates it: that is, when
+/// the interface knows how to describe the execution, when the test case runs
+/// in the host execution environment and when the requirements check that
+/// run_test_program performs in the subprocess can be resolved upfront.  The
+/// requirements of a test case that has to be skipped are rechecked by
+/// run_test_program so that it records the skip reason as usual.
+///
+/// \param interface Interface of the test program to execute.
+/// \param test_program Test program to execute.
+/// \param test_case_name Name of the test case to execute.
+/// \param user_config User-provided configuration variables.
+///
+/// \return True if the test case can be spawned with plan_test_program; false
+/// if it needs run_test_program.
+static bool
+can_plan_test(const std::shared_ptr< scheduler::interface > interface,
+              const model::test_program_ptr test_program,
+              const std::string& test_case_name,
+              const config::tree& user_config)
+{
+    if (!interface->supports_plan_test())
+        return false;
+
+    const model::test_case& test_case = test_program->find(test_case_name);
+    if (test_case.fake_result())
+        return false;
+
+    const model::metadata& md = test_case.get_metadata();
+    if (md.required_disk_space() > 0) {
+        // The available disk space has to be checked on the file system that
+        // holds the work directory, which does not exist yet.
+        return false;
+    }
+
+    if (dynamic_cast< execenv::execenv_host* >(
+            execenv::get(*test_program, test_case_name).get()) == NULL)
+        return false;
+
+    return engine::check_reqs(md, user_config,
+                              test_program->test_suite_name(),
+                              fs::current_path()).empty();
+}
+
+
+/// Computes the maximum size of each output stream of a test case.
+///
+/// \param md The metadata of the test case.
+/// \param user_config User-provided configuration variables.
+///
+/// \return The limit requested by the test case, or else the configured
+/// default; 0 if the output is not bounded.
+static std::size_t
+output_limit(const model::metadata& md, const config::tree& user_config)
+{
+    if (md.max_output_size() > 0)
+        return static_cast< std::size_t >(md.max_output_size());
+    else if (user_config.is_set("max_output_size"))
+        return user_config.lookup< config::positive_int_node >(
+            "max_output_size");
+    else
+        return 0;
+}
+
+
+/// Configures where the executor captures the output of new subprocesses.
+///
+/// \param [in,out] executor The executor to configure.
+/// \param user_config User-provided configuration variables.
+/// \param limit Maximum number of bytes to keep per output stream, or 0 to
+///     keep all of the output.
+static void
+setup_output_capture(executor::executor_handle& executor,
+                     const config::tree& user_config,
+                     const std::size_t limit)
+{
+    executor.set_in_memory_output(
+        user_config.is_set("in_memory_output") &&
+        user_config.lookup< config::bool_node >("in_memory_output"));
+    executor.set_output_limit(limit);
+}
+
+
+/// Configures where the executor places the work directories of subprocesses.
+///
+/// \param [in,out] executor The executor to configure.
+/// \param user_config User-provided configuration variables.
+/// \param required_disk_space Free disk space needed by the next subprocess,
+///     or 0 if not known.
+static void
+setup_work_directories(executor::executor_handle& executor,
+                       const config::tree& user_config,
+                       const units::bytes& required_disk_space)
+{
+    if (user_config.is_set("work_directory_tmpfs_size"))
+        executor.use_tmpfs(user_config.lookup< engine::bytes_node >(
+            "work_directory_tmpfs_size"));
+    executor.set_required_disk_space(required_disk_space);
+}
+
+
+/// Configures how the executor isolates subprocesses from each other.
+///
+/// \param [in,out] executor The executor to configure.
+/// \param user_config User-provided configuration variables.
+/// \param required_memory Memory needed by the next subprocess, or 0 if not
+///     known.
+static void
+setup_isolation(executor::executor_handle& executor,
+                const config::tree& user_config,
+                const units::bytes& required_memory)
+{
+    if (user_config.is_set("use_cgroups") &&
+        user_config.lookup< config::bool_node >("use_cgroups"))
+        executor.use_cgroups();
+    executor.set_memory_limit(required_memory);
+}
+
+
 /// Functor to execute a test program in a child process.
 class run_test_cleanup {
     /// Interface of the test program to execute.
@@ -598,6 +842,28 @@ find_interface(const std::string& name)
 }  // anonymous namespace
 
 
+bool
+scheduler::interface::supports_plan_test(void) const
+{
+    // Only the interfaces that know how to describe their test case executions
+    // as plans can avoid running code in the subprocess, so default to the
+    // conservative behavior.
+    return false;
+}
+
+
+process::exec_plan
+scheduler::interface::plan_test(
+    const model::test_program& /* test_program */,
+    const std::string& /* test_case_name */,
+    const config::properties_map& /* vars */,
+    const utils::fs::path& /* control_directory */) const
+{
+    UNREACHABLE_MSG("plan_test not implemented for an interface that "
+                    "supports plans");
+}
+
+
 void
 scheduler::interface::exec_cleanup(
     const model::test_program& /* test_program */,
@@ -623,6 +889,9 @@ struct engine::scheduler::lazy_test_program::impl : utils::noncopyable {
     /// Scheduler context to use to load test cases.
     scheduler::scheduler_handle& _scheduler_handle;
 
+    /// Start and end times of the listing of the test cases, once loaded.
+    optional< scheduler::phase_times > _listing_times;
+
     /// Constructor.
     ///
     /// \param user_config_ User configuration to pass to the test program list
@@ -671,8 +940,13 @@ scheduler::lazy_test_program::test_cases(void) const
     _pimpl->_scheduler_handle.check_interrupt();
 
     if (!_pimpl->_loaded) {
+        const datetime::timestamp start_time = datetime::timestamp::now();
         const model::test_cases_map tcs = _pimpl->_scheduler_handle.list_tests(
             this, _pimpl->_user_config);
+        const datetime::timestamp end_time = datetime::timestamp::now();
+        _pimpl->_listing_times = utils::make_optional(std::make_pair(
+            start_time, end_time));
+        listing_seconds.observe(end_time - start_time);
 
         // Due to the restrictions on when set_test_cases() may be called (as a
         // way to lazily initialize the test cases list before it is ever
@@ -689,6 +963,17 @@ scheduler::lazy_test_program::test_cases(void) const
 }
 
 
+/// Gets the start and end times of the listing of the test cases.
+///
+/// \return The times of the listing operation, or none if the test cases have
+/// not been loaded yet.
+const optional< scheduler::phase_times >&
+scheduler::lazy_test_program::listing_times(void) const
+{
+    return _pimpl->_listing_times;
+}
+
+
 /// Internal implementation for the result_handle class.
 struct engine::scheduler::result_handle::bimpl : utils::noncopyable {
     /// Generic executor exit handle for this result handle.
@@ -824,17 +1109,30 @@ struct engine::scheduler::test_result_handle::impl : utils::noncopyable {
     /// The actual result of the test execution.
     const model::test_result test_result;
 
+    /// Resources consumed by the subprocesses of the test.
+    const scheduler::resource_usage_map resource_usages;
+
+    /// Timestamps of the subprocesses of the test.
+    const scheduler::phase_times_map phases;
+
     /// Constructor.
     ///
     /// \param test_program_ Test program data for this test case.
     /// \param test_case_name_ Name of the test case.
     /// \param test_result_ The actual result of the test execution.
+    /// \param resource_usages_ Resources consumed by the subprocesses of the
+    ///     test.
+    /// \param phases_ Timestamps of the subprocesses of the test.
     impl(const model::test_program_ptr test_program_,
          const std::string& test_case_name_,
-         const model::test_result& test_result_) :
+         const model::test_result& test_result_,
+         const scheduler::resource_usage_map& resource_usages_,
+         const scheduler::phase_times_map& phases_) :
         test_program(test_program_),
         test_case_name(test_case_name_),
-        test_result(test_result_)
+        test_result(test_result_),
+        resource_usages(resource_usages_),
+        phases(phases_)
     {
     }
 };
@@ -887,6 +1185,26 @@ scheduler::test_result_handle::test_result(void) const
 }
 
 
+/// Returns the resources consumed by the subprocesses of the test.
+///
+/// \return A collection of resource usage records keyed by phase name.
+const scheduler::resource_usage_map&
+scheduler::test_result_handle::resource_usages(void) const
+{
+    return _pimpl->resource_usages;
+}
+
+
+/// Returns the timestamps of the subprocesses of the test.
+///
+/// \return A collection of start and end times keyed by phase name.
+const scheduler::phase_times_map&
+scheduler::test_result_handle::phases(void) const
+{
+    return _pimpl->phases;
+}
+
+
 /// Internal implementation for the scheduler_handle.
 struct engine::scheduler::scheduler_handle::impl : utils::noncopyable {
     /// Generic executor instance encapsulated by this one.
@@ -898,8 +1216,25 @@ struct engine::scheduler::scheduler_handle::impl : utils::noncopyable {
     /// Collection of test_exec_data objects.
     typedef std::vector< const test_exec_data* > test_exec_data_vector;
 
+    /// Number of debuggers currently gathering stack traces.
+    std::size_t running_stacktraces;
+
+    /// Crashed processes waiting for a debugger slot to become available.
+    std::deque< std::pair< exec_data_ptr, executor::exit_handle > >
+        pending_stacktraces;
+
+    /// Crashed processes whose stack trace gathering has already concluded
+    /// but that have not yet been returned by wait_any().
+    std::deque< executor::exit_handle > ready_handles;
+
+    /// Time by which all test bodies must be done, if any.
+    optional< datetime::timestamp > deadline;
+
+    /// Reason to report for the test cases terminated at the deadline.
+    std::string deadline_reason;
+
     /// Constructor.
-    impl(void) : generic(executor::setup())
+    impl(void) : generic(executor::setup()), running_stacktraces(0)
     {
     }
 
@@ -1119,6 +1454,96 @@ struct engine::scheduler::scheduler_handle::impl : utils::noncopyable {
 
         return handle;
     }
+
+    /// Forks a debugger to gather the stack trace of a crashed process.
+    ///
+    /// \param data The exec data of the process that crashed.
+    /// \param crashed_handle The exit handle of the process that crashed.
+    ///
+    /// \return True if the debugger was spawned, in which case the processing
+    /// of the crashed process must be resumed once the debugger terminates;
+    /// false if no stack trace can be gathered.
+    bool
+    spawn_stacktrace(const exec_data_ptr data,
+                     const executor::exit_handle& crashed_handle)
+    {
+        LI(F("Spawning %s:%s (stacktrace)") %
+           data->test_program->absolute_path() % data->test_case_name);
+
+        const optional< executor::exec_handle > handle =
+            utils::start_stacktrace(data->test_program->absolute_path(),
+                                    generic, crashed_handle);
+        if (!handle)
+            return false;
+
+        const exec_data_ptr stacktrace_data(new stacktrace_exec_data(
+            data->test_program, data->test_case_name, crashed_handle));
+        LD(F("Inserting %s into all_exec_data (stacktrace)") %
+           handle.get().pid());
+        INV_MSG(all_exec_data.find(handle.get().pid()) == all_exec_data.end(),
+                F("PID %s already in all_exec_data; not properly cleaned "
+                  "up or reused too fast") % handle.get().pid());
+        all_exec_data.insert(exec_data_map::value_type(handle.get().pid(),
+                                                       stacktrace_data));
+        ++running_stacktraces;
+        return true;
+    }
+
+    /// Defers the processing of a crashed process until its stack trace is
+    /// available.
+    ///
+    /// Debuggers run asynchronously alongside any other subprocesses, but only
+    /// up to max_concurrent_stacktraces at once: any further crashed processes
+    /// are queued until a debugger terminates.
+    ///
+    /// \param data The exec data of the process that terminated.
+    /// \param handle The exit handle of the process that terminated.
+    ///
+    /// \return True if the processing of the process has been deferred; false
+    /// if it did not dump core or if no stack trace can be gathered for it.
+    bool
+    defer_for_stacktrace(const exec_data_ptr data,
+                         const executor::exit_handle& handle)
+    {
+        const optional< process::status >& status = handle.status();
+        if (!status || !status.get().signaled() || !status.get().coredump())
+            return false;
+
+        test_exec_data* test_data = dynamic_cast< test_exec_data* >(
+            data.get());
+        if (test_data != NULL) {
+            // Record the exit handle now so that the cleanup routines can
+            // still be run if we are terminated while waiting for the debugger.
+            test_data->exit_handle = handle;
+        }
+
+        if (running_stacktraces >= max_concurrent_stacktraces) {
+            LD(F("Queuing stacktrace for %s") % handle.original_pid());
+            pending_stacktraces.push_back(std::make_pair(data, handle));
+            return true;
+        }
+        return spawn_stacktrace(data, handle);
+    }
+
+    /// Accounts for the termination of a debugger and starts queued ones.
+    ///
+    /// Crashed processes for which no debugger can be spawned are moved to
+    /// ready_handles so that wait_any() returns them next.
+    void
+    stacktrace_done(void)
+    {
+        PRE(running_stacktraces > 0);
+        --running_stacktraces;
+
+        while (running_stacktraces < max_concurrent_stacktraces &&
+               !pending_stacktraces.empty()) {
+            const std::pair< exec_data_ptr, executor::exit_handle > pending =
+                pending_stacktraces.front();
+            pending_stacktraces.pop_front();
+            if (!spawn_stacktrace(pending.first, pending.second))
+                ready_handles.push_back(pending.second);
+        }
+    }
 };
 
 
@@ -1235,6 +1660,10 @@ scheduler::scheduler_handle::list_tests(
     const std::shared_ptr< scheduler::interface > interface = find_interface(
         test_program->interface_name());
 
+    // The list of test cases must be parsed in full, so never bound it.
+    setup_output_capture(_pimpl->generic, user_config, 0);
+    setup_work_directories(_pimpl->generic, user_config, units::bytes());
+    setup_isolation(_pimpl->generic, user_config, units::bytes());
     try {
         const executor::exec_handle exec_handle = _pimpl->generic.spawn(
             list_test_cases(interface, test_program, user_config),
@@ -1276,6 +1705,12 @@ scheduler::scheduler_handle::list_tests(
 /// \param test_program The container test program.
 /// \param test_case_name The name of the test case to run.
 /// \param user_config User-provided configuration variables.
+/// \param stdout_target If not none, file into which to capture the stdout.
+/// \param stderr_target If not none, file into which to capture the stderr.
+/// \param adaptive_timeout If not none, timeout derived from the past runs of
+///     the test case.  It only applies if it is shorter than the timeout
+///     declared by the test case, and the test case is reported as broken with
+///     a distinct reason if it runs into it.
 ///
 /// \return A handle for the background operation.  Used to match the result of
 /// the execution returned by wait_any() with this invocation.
@@ -1285,7 +1720,8 @@ scheduler::scheduler_handle::spawn_test(
     const std::string& test_case_name,
     const config::tree& user_config,
     const utils::optional<utils::fs::path>& stdout_target,
-    const utils::optional<utils::fs::path>& stderr_target)
+    const utils::optional<utils::fs::path>& stderr_target,
+    const utils::optional<datetime::delta>& adaptive_timeout)
 {
     _pimpl->generic.check_interrupt();
 
@@ -1303,20 +1739,57 @@ scheduler::scheduler_handle::spawn_test(
             "unprivileged_user");
     }
 
-    const executor::exec_handle handle = _pimpl->generic.spawn(
-        run_test_program(interface, test_program, test_case_name,
-                         user_config),
-        test_case.get_metadata().timeout(),
-        unprivileged_user, stdout_target, stderr_target);
+    setup_output_capture(_pimpl->generic, user_config,
+                         output_limit(test_case.get_metadata(), user_config));
+    setup_work_directories(_pimpl->generic, user_config,
+                           test_case.get_metadata().required_disk_space());
+    setup_isolation(_pimpl->generic, user_config,
+                    test_case.get_metadata().required_memory());
+
+    const datetime::delta declared_timeout =
+        test_case.get_metadata().timeout();
+    datetime::delta timeout = declared_timeout;
+    optional< model::test_result > timeout_result;
+    if (adaptive_timeout && adaptive_timeout.get() < timeout) {
+        timeout = adaptive_timeout.get();
+        timeout_result = model::test_result(
+            model::test_result_broken,
+            F("Test case body timed out after %s seconds (adaptive timeout; "
+              "declared timeout is %s seconds)") % timeout.seconds %
+            declared_timeout.seconds);
+    }
+    if (_pimpl->deadline) {
+        const datetime::delta remaining =
+            _pimpl->deadline.get() - datetime::timestamp::now();
+        if (remaining < timeout) {
+            timeout = remaining;
+            timeout_result = model::test_result(model::test_result_skipped,
+                                                _pimpl->deadline_reason);
+        }
+    }
+
+    const executor::exec_handle handle =
+        can_plan_test(interface, test_program, test_case_name, user_config) ?
+        _pimpl->generic.spawn_plan(
+            plan_test_program(interface, test_program, test_case_name,
+                              user_config),
+            timeout, unprivileged_user, stdout_target, stderr_target) :
+        _pimpl->generic.spawn(
+            run_test_program(interface, test_program, test_case_name,
+                             user_config),
+            timeout, unprivileged_user, stdout_target, stderr_target);
 
     const exec_data_ptr data(new test_exec_data(
         test_program, test_case_name, interface, user_config, handle.pid()));
+    dynamic_cast< test_exec_data& >(*data.get()).timeout_result =
+        timeout_result;
     LD(F("Inserting %s into all_exec_data") % handle.pid());
     INV_MSG(
         _pimpl->all_exec_data.find(handle.pid()) == _pimpl->all_exec_data.end(),
         F("PID %s already in all_exec_data; not cleaned up or reused too fast")
         % handle.pid());;
     _pimpl->all_exec_data.insert(exec_data_map::value_type(handle.pid(), data));
+    spawned_tests.add();
 
     return handle.pid();
 }
@@ -1335,14 +1808,42 @@ scheduler::scheduler_handle::wait_any(void)
 {
     _pimpl->generic.check_interrupt();
 
-    executor::exit_handle handle = _pimpl->generic.wait_any();
+    const bool resumed = !_pimpl->ready_handles.empty();
+    executor::exit_handle handle = resumed ?
+        _pimpl->ready_handles.front() : _pimpl->generic.wait_any();
+    if (resumed)
+        _pimpl->ready_handles.pop_front();
 
     const exec_data_map::iterator iter = _pimpl->all_exec_data.find(
         handle.original_pid());
     exec_data_ptr data = (*iter).second;
 
-    utils::dump_stacktrace_if_available(data->test_program->absolute_path(),
-                                        _pimpl->generic, handle);
+    // stack trace of a crashed process
+    try {
+        const stacktrace_exec_data* stacktrace_data =
+            &dynamic_cast< const stacktrace_exec_data& >(*data.get());
+        LD(F("Got %s from all_exec_data (stacktrace)") % handle.original_pid());
+
+        // The debugger ran in the context of the crashed process and its
+        // output has already been appended to the crashed process' stderr.
+        // Resume the processing of the latter as if it had just terminated.
+        utils::finish_stacktrace(handle);
+
+        LD(F("Removing %s from all_exec_data (stacktrace) in favor of %s")
+           % handle.original_pid()
+           % stacktrace_data->crashed_exit_handle.original_pid());
+        _pimpl->all_exec_data.erase(handle.original_pid());
+        handle = stacktrace_data->crashed_exit_handle;
+        data = (*_pimpl->all_exec_data.find(handle.original_pid())).second;
+
+        _pimpl->stacktrace_done();
+    } catch (const std::bad_cast& e) {
+        if (!resumed && _pimpl->defer_for_stacktrace(data, handle)) {
+            // Gathering the stack trace may take a long time, so keep
+            // processing other terminated subprocesses in the meantime.
+            return wait_any();
+        }
+    }
 
     optional< model::test_result > result;
 
@@ -1353,6 +1854,10 @@ scheduler::scheduler_handle::wait_any(void)
         LD(F("Got %s from all_exec_data") % handle.original_pid());
 
         test_data->exit_handle = handle;
+        if (handle.usage())
+            test_data->resource_usages["body"] = handle.usage().get();
+        test_data->phases.insert(std::make_pair(
+            "body", std::make_pair(handle.start_time(), handle.end_time())));
 
         const model::test_case& test_case = test_data->test_program->find(
             test_data->test_case_name);
@@ -1394,6 +1899,13 @@ scheduler::scheduler_handle::wait_any(void)
         }
         INV(result);
 
+        if (test_data->termination_reason) {
+            result = model::test_result(model::test_result_skipped,
+                                        test_data->termination_reason.get());
+        } else if (!handle.status() && test_data->timeout_result) {
+            result = test_data->timeout_result;
+        }
+
         if (!result.get().good()) {
             append_files_listing(handle.work_directory(),
                                  handle.stderr_file());
@@ -1474,6 +1986,10 @@ scheduler::scheduler_handle::wait_any(void)
            % cleanup_data->body_exit_handle.original_pid());
         _pimpl->all_exec_data.erase(handle.original_pid());
 
+        const optional< process::resource_usage > cleanup_usage =
+            handle.usage();
+        const scheduler::phase_times cleanup_times = std::make_pair(
+            handle.start_time(), handle.end_time());
         handle = cleanup_data->body_exit_handle;
 
         const exec_data_map::iterator it = _pimpl->all_exec_data.find(
@@ -1482,6 +1998,9 @@ scheduler::scheduler_handle::wait_any(void)
             exec_data_ptr d = (*it).second;
             test_exec_data* test_data = &dynamic_cast< test_exec_data& >(
                 *d.get());
+            if (cleanup_usage)
+                test_data->resource_usages["cleanup"] = cleanup_usage.get();
+            test_data->phases.insert(std::make_pair("cleanup", cleanup_times));
             const model::test_case& test_case =
                 cleanup_data->test_program->find(cleanup_data->test_case_name);
             test_data->needs_cleanup = false;
@@ -1529,18 +2048,48 @@ scheduler::scheduler_handle::wait_any(void)
            % execenv_data->body_exit_handle.original_pid());
         _pimpl->all_exec_data.erase(handle.original_pid());
 
+        const optional< process::resource_usage > execenv_usage =
+            handle.usage();
+        const scheduler::phase_times execenv_times = std::make_pair(
+            handle.start_time(), handle.end_time());
         handle = execenv_data->body_exit_handle;
+
+        const exec_data_map::iterator it = _pimpl->all_exec_data.find(
+            handle.original_pid());
+        if (it != _pimpl->all_exec_data.end()) {
+            test_exec_data* test_data = &dynamic_cast< test_exec_data& >(
+                *(*it).second.get());
+            if (execenv_usage)
+                test_data->resource_usages["execenv_cleanup"] =
+                    execenv_usage.get();
+            test_data->phases.insert(std::make_pair("execenv_cleanup",
+                                                    execenv_times));
+        }
     } catch (const std::bad_cast& e) {
         // ok, it was one of the types above
     }
 
     INV(result);
 
+    resource_usage_map resource_usages;
+    phase_times_map phases;
+    {
+        const exec_data_map::const_iterator it = _pimpl->all_exec_data.find(
+            handle.original_pid());
+        if (it != _pimpl->all_exec_data.end()) {
+            const test_exec_data* test_data =
+                &dynamic_cast< const test_exec_data& >(*(*it).second.get());
+            resource_usages = test_data->resource_usages;
+            phases = test_data->phases;
+        }
+    }
+
     std::shared_ptr< result_handle::bimpl > result_handle_bimpl(
         new result_handle::bimpl(handle, _pimpl->all_exec_data));
     std::shared_ptr< test_result_handle::impl > test_result_handle_impl(
         new test_result_handle::impl(
-            data->test_program, data->test_case_name, result.get()));
+            data->test_program, data->test_case_name, result.get(),
+            resource_usages, phases));
     return result_handle_ptr(new test_result_handle(result_handle_bimpl,
                                                     test_result_handle_impl));
 }
@@ -1600,6 +2149,48 @@ scheduler::scheduler_handle::debug_test(
 }
 
 
+/// Terminates a running test case before it completes.
+///
+/// The test case must still be waited for with wait_any(), which runs its
+/// cleanup routine as usual and reports it as skipped with the given reason.
+/// This is a no-op if the body of the test case has already finished.
+///
+/// \param exec_handle The handle returned by spawn_test().
+/// \param reason Explanation of why the test case did not run to completion.
+void
+scheduler::scheduler_handle::terminate_test(const exec_handle exec_handle,
+                                            const std::string& reason)
+{
+    const exec_data_map::iterator iter = _pimpl->all_exec_data.find(
+        exec_handle);
+    PRE(iter != _pimpl->all_exec_data.end());
+    test_exec_data* test_data = &dynamic_cast< test_exec_data& >(
+        *(*iter).second.get());
+
+    if (test_data->exit_handle || test_data->termination_reason)
+        return;
+    test_data->termination_reason = reason;
+    _pimpl->generic.terminate(exec_handle);
+}
+
+
+/// Sets a deadline by which the bodies of all test cases must be done.
+///
+/// Test cases spawned from now on have their timeout shortened as necessary
+/// to meet the deadline.  Those that reach the deadline are reported as skipped
+/// with the given reason instead of as timed out.
+///
+/// \param deadline Time at which to terminate any test bodies still running.
+/// \param reason Explanation of why the test cases did not run to completion.
+void
+scheduler::scheduler_handle::set_deadline(const datetime::timestamp& deadline,
+                                          const std::string& reason)
+{
+    _pimpl->deadline = deadline;
+    _pimpl->deadline_reason = reason;
+}
+
+
 /// Checks if an interrupt has fired.
 ///
 /// Calls to this function should be sprinkled in strategic places through the
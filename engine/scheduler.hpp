@@ -57,9 +57,11 @@
 
 #include "engine/scheduler_fwd.hpp"
 
+#include <map>
 #include <memory>
 #include <set>
 #include <string>
+#include <utility>
 
 #include "model/context_fwd.hpp"
 #include "model/metadata_fwd.hpp"
@@ -71,7 +73,9 @@
 #include "utils/defs.hpp"
 #include "utils/fs/path_fwd.hpp"
 #include "utils/optional.hpp"
+#include "utils/process/exec_plan_fwd.hpp"
 #include "utils/process/executor_fwd.hpp"
+#include "utils/process/resource_usage_fwd.hpp"
 #include "utils/process/status_fwd.hpp"
 
 using utils::none;
@@ -80,6 +84,26 @@ namespace engine {
 namespace scheduler {
 
 
+/// Resources consumed by the subprocesses of a test, keyed by phase name.
+///
+/// The phases are "body" for the test case itself, "cleanup" for its cleanup
+/// routine and "execenv_cleanup" for the cleanup of its execution environment.
+/// Phases that did not run or whose usage could not be collected are missing.
+typedef std::map< std::string, utils::process::resource_usage >
+    resource_usage_map;
+
+
+/// Start and end times of a phase in the execution of a test.
+typedef std::pair< utils::datetime::timestamp, utils::datetime::timestamp >
+    phase_times;
+
+
+/// Timestamps of the subprocesses of a test, keyed by phase name.
+///
+/// The phase names match those of resource_usage_map.
+typedef std::map< std::string, phase_times > phase_times_map;
+
+
 /// Abstract interface of a test program scheduler interface.
 ///
 /// This interface defines the test program-specific operations that need to be
@@ -132,6 +156,33 @@ public:
                            const utils::fs::path& control_directory)
         const UTILS_NORETURN = 0;
 
+    /// Checks whether plan_test() is implemented by this interface.
+    ///
+    /// \return True if the test cases of the test program can be executed
+    /// from a precomputed plan; false otherwise.
+    virtual bool supports_plan_test(void) const;
+
+    /// Computes how to execute a test case of the test program.
+    ///
+    /// This method is intended to be called within the parent process and
+    /// describes, without running it, what exec_test() would do so that the
+    /// scheduler can spawn the test case without running any code in the
+    /// subprocess.  Only needs to be implemented if supports_plan_test()
+    /// returns true.
+    ///
+    /// \param test_program The test program to execute.
+    /// \param test_case_name Name of the test case to invoke.
+    /// \param vars User-provided variables to pass to the test program.
+    /// \param control_directory Directory where the interface may place control
+    ///     files.
+    ///
+    /// \return The plan to execute the test case.
+    virtual utils::process::exec_plan plan_test(
+        const model::test_program& test_program,
+        const std::string& test_case_name,
+        const utils::config::properties_map& vars,
+        const utils::fs::path& control_directory) const;
+
     /// Executes a test cleanup routine of the test program.
     ///
     /// This method is intended to be called within a subprocess and is expected
@@ -182,6 +233,7 @@ public:
                       scheduler_handle&);
 
     const model::test_cases_map& test_cases(void) const;
+    const utils::optional< phase_times >& listing_times(void) const;
 };
 
 
@@ -227,6 +279,8 @@ public:
     const model::test_program_ptr test_program(void) const;
     const std::string& test_case_name(void) const;
     const model::test_result& test_result(void) const;
+    const resource_usage_map& resource_usages(void) const;
+    const phase_times_map& phases(void) const;
 };
 
 
@@ -252,8 +306,12 @@ public:
                            const std::string&,
                            const utils::config::tree&,
                            const utils::optional<utils::fs::path>& = none,
-                           const utils::optional<utils::fs::path>& = none);
+                           const utils::optional<utils::fs::path>& = none,
+                           const utils::optional<
+                               utils::datetime::delta >& = none);
     result_handle_ptr wait_any(void);
+    void terminate_test(const exec_handle, const std::string&);
+    void set_deadline(const utils::datetime::timestamp&, const std::string&);
 
     result_handle_ptr debug_test(const model::test_program_ptr,
                                  const std::string&,
@@ -29,6 +29,7 @@
 #include "engine/scheduler.hpp"
 
 extern "C" {
+#include <sys/stat.h>
 #include <sys/types.h>
 
 #include <signal.h>
@@ -39,6 +40,7 @@ extern "C" {
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <utility>
 
 #include <atf-c++.hpp>
 
@@ -59,6 +61,7 @@ extern "C" {
 #include "utils/fs/path.hpp"
 #include "utils/optional.ipp"
 #include "utils/passwd.hpp"
+#include "utils/process/exec_plan.hpp"
 #include "utils/process/status.hpp"
 #include "utils/sanity.hpp"
 #include "utils/stacktrace.hpp"
@@ -345,6 +348,9 @@ public:
             exec_print_params(test_program, test_case_name, vars);
         } else if (starts_with(test_case_name, "skip_body_pass_cleanup")) {
             exec_exit(EXIT_SUCCESS);
+        } else if (starts_with(test_case_name, "sleep")) {
+            ::sleep(100);
+            std::abort();
         } else {
             std::cerr << "Unknown test case " << test_case_name << '\n';
             std::abort();
@@ -456,6 +462,54 @@ public:
 };
 
 
+/// Mock interface that describes the execution of its test cases as plans.
+///
+/// The test cases of this interface run a shell script that mimics what the
+/// "exit N" test cases of mock_interface do, so that the results can be
+/// computed in the same way.
+class mock_plan_interface : public mock_interface {
+public:
+    /// Checks whether plan_test() is implemented by this interface.
+    ///
+    /// \return Always true.
+    bool
+    supports_plan_test(void) const
+    {
+        return true;
+    }
+
+    /// Computes how to execute a test case of the test program.
+    ///
+    /// \param test_case_name Name of the test case to invoke.
+    /// \param vars User-provided variables to pass to the test program.
+    /// \param control_directory Directory where the interface may place control
+    ///     files.
+    ///
+    /// \return The plan to execute the test case.
+    process::exec_plan
+    plan_test(const model::test_program& /* test_program */,
+              const std::string& test_case_name,
+              const config::properties_map& vars,
+              const fs::path& control_directory) const
+    {
+        process::args_vector args;
+        args.push_back("-c");
+        args.push_back("printf '%s' \"${1}\" >\"${2}\"; "
+                       "echo \"pid=$$ var=${MOCK_VAR}\"; exit \"${3}\"");
+        args.push_back("sh");
+        args.push_back(test_case_name);
+        args.push_back((control_directory / "exec_test_was_called").str());
+        args.push_back(F("%s") % suffix_to_int(test_case_name, "exit "));
+
+        process::exec_plan plan(fs::path("/bin/sh"), args);
+        const config::properties_map::const_iterator iter = vars.find("var");
+        if (iter != vars.end())
+            plan.set_env("MOCK_VAR", (*iter).second);
+        return plan;
+    }
+};
+
+
 }  // anonymous namespace
 
 
@@ -499,6 +553,32 @@ ATF_TEST_CASE_BODY(integration__list_some)
 }
 
 
+ATF_TEST_CASE_WITHOUT_HEAD(integration__list_lazy__listing_times);
+ATF_TEST_CASE_BODY(integration__list_lazy__listing_times)
+{
+    config::tree user_config = engine::empty_config();
+    user_config.set_string("test_suites.the-suite.first", "test");
+
+    scheduler::scheduler_handle handle = scheduler::setup();
+    const scheduler::lazy_test_program program(
+        "mock", fs::path("vars"), fs::path("."), "the-suite",
+        model::metadata_builder().build(), user_config, handle);
+    ATF_REQUIRE(!program.listing_times());
+
+    const datetime::timestamp before = datetime::timestamp::now();
+    ATF_REQUIRE_EQ(1, program.test_cases().size());
+    const datetime::timestamp after = datetime::timestamp::now();
+
+    ATF_REQUIRE(program.listing_times());
+    const scheduler::phase_times& times = program.listing_times().get();
+    ATF_REQUIRE(before <= times.first);
+    ATF_REQUIRE(times.first <= times.second);
+    ATF_REQUIRE(times.second <= after);
+
+    handle.cleanup();
+}
+
+
 ATF_TEST_CASE_WITHOUT_HEAD(integration__list_check_paths);
 ATF_TEST_CASE_BODY(integration__list_check_paths)
 {
@@ -580,6 +660,85 @@ ATF_TEST_CASE_BODY(integration__run_one)
     ATF_REQUIRE_EQ(exec_handle, result_handle->original_pid());
     ATF_REQUIRE_EQ(model::test_result(model::test_result_passed, "Exit 41"),
                    test_result_handle->test_result());
+    ATF_REQUIRE_EQ(1, test_result_handle->resource_usages().size());
+    ATF_REQUIRE_EQ(1, test_result_handle->resource_usages().count("body"));
+    ATF_REQUIRE_EQ(1, test_result_handle->phases().size());
+    ATF_REQUIRE(test_result_handle->phases().find("body")->second ==
+                std::make_pair(result_handle->start_time(),
+                               result_handle->end_time()));
+    result_handle->cleanup();
+    result_handle.reset();
+
+    handle.cleanup();
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(integration__run_plan);
+ATF_TEST_CASE_BODY(integration__run_plan)
+{
+    scheduler::register_interface(
+        "mock_plan", std::shared_ptr< scheduler::interface >(
+            new mock_plan_interface()));
+
+    const model::test_program_ptr program = model::test_program_builder(
+        "mock_plan", fs::path("the-program"), fs::current_path(), "the-suite")
+        .add_test_case("exit 42").build_ptr();
+
+    config::tree user_config = engine::empty_config();
+    user_config.set_string("test_suites.the-suite.var", "some value");
+
+    scheduler::scheduler_handle handle = scheduler::setup();
+
+    const scheduler::exec_handle exec_handle = handle.spawn_test(
+        program, "exit 42", user_config);
+
+    scheduler::result_handle_ptr result_handle = handle.wait_any();
+    const scheduler::test_result_handle* test_result_handle =
+        dynamic_cast< const scheduler::test_result_handle* >(
+            result_handle.get());
+    ATF_REQUIRE_EQ(exec_handle, result_handle->original_pid());
+    ATF_REQUIRE_EQ(model::test_result(model::test_result_passed, "Exit 42"),
+                   test_result_handle->test_result());
+    ATF_REQUIRE(atf::utils::compare_file(
+        result_handle->stdout_file().str(),
+        F("pid=%s var=some value\n") % exec_handle));
+    result_handle->cleanup();
+    result_handle.reset();
+
+    handle.cleanup();
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(integration__run_plan__skipped);
+ATF_TEST_CASE_BODY(integration__run_plan__skipped)
+{
+    scheduler::register_interface(
+        "mock_plan", std::shared_ptr< scheduler::interface >(
+            new mock_plan_interface()));
+
+    const model::test_program_ptr program = model::test_program_builder(
+        "mock_plan", fs::path("the-program"), fs::current_path(), "the-suite")
+        .add_test_case("exit 0",
+                       model::metadata_builder()
+                       .add_required_config("variable-that-does-not-exist")
+                       .build())
+        .build_ptr();
+
+    const config::tree user_config = engine::empty_config();
+
+    scheduler::scheduler_handle handle = scheduler::setup();
+
+    (void)handle.spawn_test(program, "exit 0", user_config);
+
+    scheduler::result_handle_ptr result_handle = handle.wait_any();
+    const scheduler::test_result_handle* test_result_handle =
+        dynamic_cast< const scheduler::test_result_handle* >(
+            result_handle.get());
+    ATF_REQUIRE_EQ(model::test_result(
+                       model::test_result_skipped,
+                       "Required configuration property "
+                       "'variable-that-does-not-exist' not defined"),
+                   test_result_handle->test_result());
     result_handle->cleanup();
     result_handle.reset();
 
@@ -868,6 +1027,10 @@ do_cleanup_test(const char* test_case,
     ATF_REQUIRE(atf::utils::compare_file(
         result_handle->stdout_file().str(),
         "exec_cleanup was called\n"));
+    ATF_REQUIRE_EQ(1, test_result_handle->resource_usages().count("body"));
+    ATF_REQUIRE_EQ(1, test_result_handle->resource_usages().count("cleanup"));
+    ATF_REQUIRE_EQ(1, test_result_handle->phases().count("body"));
+    ATF_REQUIRE_EQ(1, test_result_handle->phases().count("cleanup"));
     result_handle->cleanup();
     result_handle.reset();
 
@@ -923,6 +1086,124 @@ ATF_TEST_CASE_BODY(integration__cleanup__timeout)
 }
 
 
+ATF_TEST_CASE_WITHOUT_HEAD(integration__terminate_test);
+ATF_TEST_CASE_BODY(integration__terminate_test)
+{
+    const model::test_program_ptr program = model::test_program_builder(
+        "mock", fs::path("the-program"), fs::current_path(), "the-suite")
+        .add_test_case("sleep").add_test_case("exit 0").build_ptr();
+
+    const config::tree user_config = engine::empty_config();
+
+    scheduler::scheduler_handle handle = scheduler::setup();
+
+    const datetime::timestamp start_time = datetime::timestamp::now();
+    const scheduler::exec_handle sleep_handle = handle.spawn_test(
+        program, "sleep", user_config);
+    const scheduler::exec_handle exit_handle = handle.spawn_test(
+        program, "exit 0", user_config);
+
+    {
+        scheduler::result_handle_ptr result_handle = handle.wait_any();
+        ATF_REQUIRE_EQ(exit_handle, result_handle->original_pid());
+        result_handle->cleanup();
+    }
+
+    handle.terminate_test(sleep_handle, "Stopped early");
+    handle.terminate_test(sleep_handle, "Stopped twice");
+    {
+        scheduler::result_handle_ptr result_handle = handle.wait_any();
+        ATF_REQUIRE_EQ(sleep_handle, result_handle->original_pid());
+        const scheduler::test_result_handle* test_result_handle =
+            dynamic_cast< const scheduler::test_result_handle* >(
+                result_handle.get());
+        ATF_REQUIRE_EQ(model::test_result(model::test_result_skipped,
+                                          "Stopped early"),
+                       test_result_handle->test_result());
+        result_handle->cleanup();
+    }
+    ATF_REQUIRE(datetime::timestamp::now() - start_time <
+                datetime::delta(10, 0));
+
+    handle.cleanup();
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(integration__deadline);
+ATF_TEST_CASE_BODY(integration__deadline)
+{
+    const model::test_program_ptr program = model::test_program_builder(
+        "mock", fs::path("the-program"), fs::current_path(), "the-suite")
+        .add_test_case("sleep").add_test_case("exit 0").build_ptr();
+
+    const config::tree user_config = engine::empty_config();
+
+    scheduler::scheduler_handle handle = scheduler::setup();
+
+    const datetime::timestamp start_time = datetime::timestamp::now();
+    handle.set_deadline(start_time + datetime::delta(1, 0), "Out of time");
+    const scheduler::exec_handle sleep_handle = handle.spawn_test(
+        program, "sleep", user_config);
+    const scheduler::exec_handle exit_handle = handle.spawn_test(
+        program, "exit 0", user_config);
+
+    for (int i = 0; i < 2; i++) {
+        scheduler::result_handle_ptr result_handle = handle.wait_any();
+        const scheduler::test_result_handle* test_result_handle =
+            dynamic_cast< const scheduler::test_result_handle* >(
+                result_handle.get());
+        if (result_handle->original_pid() == sleep_handle) {
+            ATF_REQUIRE_EQ(model::test_result(model::test_result_skipped,
+                                              "Out of time"),
+                           test_result_handle->test_result());
+        } else {
+            ATF_REQUIRE_EQ(exit_handle, result_handle->original_pid());
+            ATF_REQUIRE_EQ(model::test_result(model::test_result_passed,
+                                              "Exit 0"),
+                           test_result_handle->test_result());
+        }
+        result_handle->cleanup();
+    }
+    ATF_REQUIRE(datetime::timestamp::now() - start_time <
+                datetime::delta(10, 0));
+
+    handle.cleanup();
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(integration__adaptive_timeout);
+ATF_TEST_CASE_BODY(integration__adaptive_timeout)
+{
+    const model::test_program_ptr program = model::test_program_builder(
+        "mock", fs::path("the-program"), fs::current_path(), "the-suite")
+        .add_test_case("sleep").build_ptr();
+
+    const config::tree user_config = engine::empty_config();
+
+    scheduler::scheduler_handle handle = scheduler::setup();
+
+    const datetime::timestamp start_time = datetime::timestamp::now();
+    (void)handle.spawn_test(program, "sleep", user_config, none, none,
+                            utils::make_optional(datetime::delta(1, 0)));
+
+    scheduler::result_handle_ptr result_handle = handle.wait_any();
+    const scheduler::test_result_handle* test_result_handle =
+        dynamic_cast< const scheduler::test_result_handle* >(
+            result_handle.get());
+    ATF_REQUIRE_EQ(model::test_result(model::test_result_broken,
+                                      "Test case body timed out after 1 "
+                                      "seconds (adaptive timeout; declared "
+                                      "timeout is 300 seconds)"),
+                   test_result_handle->test_result());
+    result_handle->cleanup();
+    result_handle.reset();
+    ATF_REQUIRE(datetime::timestamp::now() - start_time <
+                datetime::delta(10, 0));
+
+    handle.cleanup();
+}
+
+
 ATF_TEST_CASE_WITHOUT_HEAD(integration__check_requirements);
 ATF_TEST_CASE_BODY(integration__check_requirements)
 {
@@ -987,6 +1268,71 @@ ATF_TEST_CASE_BODY(integration__stacktrace)
 }
 
 
+ATF_TEST_CASE_WITHOUT_HEAD(integration__stacktrace__many);
+ATF_TEST_CASE_BODY(integration__stacktrace__many)
+{
+    utils::prepare_coredump_test(this);
+
+    atf::utils::create_file("fake-gdb", "#! /bin/sh\n"
+                            "sleep 1; echo 'frame 1'; exit 0\n");
+    ATF_REQUIRE(::chmod("fake-gdb", 0755) != -1);
+    const std::string gdb = (fs::current_path() / "fake-gdb").str();
+    utils::builtin_gdb = gdb.c_str();
+
+    const model::test_program_ptr program = model::test_program_builder(
+        "mock", fs::path("the-program"), fs::current_path(), "the-suite")
+        .add_test_case("unknown-dumps-core-1")
+        .add_test_case("unknown-dumps-core-2")
+        .add_test_case("unknown-dumps-core-3")
+        .add_test_case("exit 0").build_ptr();
+
+    const config::tree user_config = engine::empty_config();
+
+    scheduler::scheduler_handle handle = scheduler::setup();
+
+    (void)handle.spawn_test(program, "unknown-dumps-core-1", user_config);
+    (void)handle.spawn_test(program, "unknown-dumps-core-2", user_config);
+    (void)handle.spawn_test(program, "unknown-dumps-core-3", user_config);
+    (void)handle.spawn_test(program, "exit 0", user_config);
+
+    std::size_t crashed = 0;
+    for (int i = 0; i < 4; ++i) {
+        scheduler::result_handle_ptr result_handle = handle.wait_any();
+        const scheduler::test_result_handle* test_result_handle =
+            dynamic_cast< const scheduler::test_result_handle* >(
+                result_handle.get());
+
+        if (test_result_handle->test_case_name() == "exit 0") {
+            // The passing test must not wait for any of the debuggers.
+            ATF_REQUIRE_EQ(0, crashed);
+            ATF_REQUIRE_EQ(model::test_result(model::test_result_passed,
+                                              "Exit 0"),
+                           test_result_handle->test_result());
+        } else {
+            ATF_REQUIRE_EQ(model::test_result(model::test_result_failed,
+                                              F("Signal %s") % SIGABRT),
+                           test_result_handle->test_result());
+            const std::string stderr_file =
+                result_handle->stderr_file().str();
+            ATF_REQUIRE(atf::utils::grep_file(
+                "attempting to gather stack trace", stderr_file));
+            // If a core file was found, the stack trace must be complete by
+            // the time the result is returned.
+            if (atf::utils::grep_file("^frame 1$", stderr_file))
+                ATF_REQUIRE(atf::utils::grep_file("GDB exited successfully",
+                                                  stderr_file));
+            ++crashed;
+        }
+
+        result_handle->cleanup();
+        result_handle.reset();
+    }
+    ATF_REQUIRE_EQ(3, crashed);
+
+    handle.cleanup();
+}
+
+
 /// Runs a test to verify the dumping of the list of existing files on failure.
 ///
 /// \param test_case The name of the test case to invoke.
@@ -1206,12 +1552,15 @@ ATF_INIT_TEST_CASES(tcs)
         "mock", std::shared_ptr< scheduler::interface >(new mock_interface()));
 
     ATF_ADD_TEST_CASE(tcs, integration__list_some);
+    ATF_ADD_TEST_CASE(tcs, integration__list_lazy__listing_times);
     ATF_ADD_TEST_CASE(tcs, integration__list_check_paths);
     ATF_ADD_TEST_CASE(tcs, integration__list_timeout);
     ATF_ADD_TEST_CASE(tcs, integration__list_fail);
     ATF_ADD_TEST_CASE(tcs, integration__list_empty);
 
     ATF_ADD_TEST_CASE(tcs, integration__run_one);
+    ATF_ADD_TEST_CASE(tcs, integration__run_plan);
+    ATF_ADD_TEST_CASE(tcs, integration__run_plan__skipped);
     ATF_ADD_TEST_CASE(tcs, integration__run_many);
 
     ATF_ADD_TEST_CASE(tcs, integration__run_check_paths);
@@ -1224,8 +1573,12 @@ ATF_INIT_TEST_CASES(tcs)
     ATF_ADD_TEST_CASE(tcs, integration__cleanup__body_bad__cleanup_ok);
     ATF_ADD_TEST_CASE(tcs, integration__cleanup__body_bad__cleanup_bad);
     ATF_ADD_TEST_CASE(tcs, integration__cleanup__timeout);
+    ATF_ADD_TEST_CASE(tcs, integration__terminate_test);
+    ATF_ADD_TEST_CASE(tcs, integration__deadline);
+    ATF_ADD_TEST_CASE(tcs, integration__adaptive_timeout);
     ATF_ADD_TEST_CASE(tcs, integration__check_requirements);
     ATF_ADD_TEST_CASE(tcs, integration__stacktrace);
+    ATF_ADD_TEST_CASE(tcs, integration__stacktrace__many);
     ATF_ADD_TEST_CASE(tcs, integration__list_files_on_failure__none);
     ATF_ADD_TEST_CASE(tcs, integration__list_files_on_failure__some);
     ATF_ADD_TEST_CASE(tcs, integration__prevent_clobbering_control_files);
@@ -41,9 +41,9 @@ extern "C" {
 #include "model/test_program.hpp"
 #include "model/test_result.hpp"
 #include "utils/defs.hpp"
-#include "utils/env.hpp"
 #include "utils/format/macros.hpp"
 #include "utils/optional.ipp"
+#include "utils/process/exec_plan.hpp"
 #include "utils/process/operations.hpp"
 #include "utils/process/status.hpp"
 #include "utils/sanity.hpp"
@@ -129,17 +129,25 @@ engine::tap_interface::parse_list(
 }
 
 
-/// Executes a test case of the test program.
+/// Checks whether plan_test() is implemented by this interface.
 ///
-/// This method is intended to be called within a subprocess and is expected
-/// to terminate execution either by exec(2)ing the test program or by
-/// exiting with a failure.
+/// \return Always true.
+bool
+engine::tap_interface::supports_plan_test(void) const
+{
+    return true;
+}
+
+
+/// Computes how to execute a test case of the test program.
 ///
 /// \param test_program The test program to execute.
 /// \param test_case_name Name of the test case to invoke.
 /// \param vars User-provided variables to pass to the test program.
-void
-engine::tap_interface::exec_test(
+///
+/// \return The plan to execute the test case.
+process::exec_plan
+engine::tap_interface::plan_test(
     const model::test_program& test_program,
     const std::string& test_case_name,
     const config::properties_map& vars,
@@ -147,16 +155,41 @@ engine::tap_interface::exec_test(
 {
     PRE(test_case_name == "main");
 
+    process::exec_plan plan(test_program.absolute_path(),
+                            process::args_vector());
     for (config::properties_map::const_iterator iter = vars.begin();
          iter != vars.end(); ++iter) {
-        utils::setenv(F("TEST_ENV_%s") % (*iter).first, (*iter).second);
+        plan.set_env(F("TEST_ENV_%s") % (*iter).first, (*iter).second);
     }
+    return plan;
+}
+
 
-    process::args_vector args;
+/// Executes a test case of the test program.
+///
+/// This method is intended to be called within a subprocess and is expected
+/// to terminate execution either by exec(2)ing the test program or by
+/// exiting with a failure.
+///
+/// \param test_program The test program to execute.
+/// \param test_case_name Name of the test case to invoke.
+/// \param vars User-provided variables to pass to the test program.
+/// \param control_directory Directory where the interface may place control
+///     files.
+void
+engine::tap_interface::exec_test(
+    const model::test_program& test_program,
+    const std::string& test_case_name,
+    const config::properties_map& vars,
+    const fs::path& control_directory) const
+{
+    const process::exec_plan plan = plan_test(test_program, test_case_name,
+                                              vars, control_directory);
+    plan.apply();
 
     auto e = execenv::get(test_program, test_case_name);
     e->init();
-    e->exec(args);
+    e->exec(plan.args());
     __builtin_unreachable();
 }
 
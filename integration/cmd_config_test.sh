@@ -43,9 +43,13 @@ all_body() {
 syntax(2)
 architecture = "my-architecture"
 execenvs = "my-env1 my-env2"
+in_memory_output = true
+max_output_size = 4096
 parallelism = 256
 platform = "my-platform"
 unprivileged_user = "$(id -u -n)"
+use_cgroups = true
+work_directory_tmpfs_size = "64M"
 test_suites.suite1.the_variable = "value1"
 test_suites.suite2.the_variable = "value2"
 EOF
@@ -53,11 +57,15 @@ EOF
     cat >expout <<EOF
 architecture = my-architecture
 execenvs = my-env1 my-env2
+in_memory_output = true
+max_output_size = 4096
 parallelism = 256
 platform = my-platform
 test_suites.suite1.the_variable = value1
 test_suites.suite2.the_variable = value2
 unprivileged_user = $(id -u -n)
+use_cgroups = true
+work_directory_tmpfs_size = 64.00M
 EOF
 
     atf_check -s exit:0 -o file:expout -e empty kyua config
@@ -105,13 +105,29 @@ upgrade__from_v2_body() {
 }
 
 
+utils_test_case upgrade__from_v3
+upgrade__from_v3_head() {
+    atf_set require.files \
+        "${KYUA_STORETESTDATADIR}/schema_v3.sql" \
+        "${KYUA_STORETESTDATADIR}/testdata_v3_1.sql" \
+        "${KYUA_STOREDIR}/migrate_v3_v4.sql"
+    atf_set require.progs "sqlite3"
+}
+upgrade__from_v3_body() {
+    create_results_file "${KYUA_STORETESTDATADIR}/schema_v3.sql" \
+        "${KYUA_STORETESTDATADIR}/testdata_v3_1.sql"
+    atf_check -s exit:0 -o empty -e empty kyua db-migrate
+    atf_check -s exit:0 -o ignore -e empty kyua report
+}
+
+
 utils_test_case already_up_to_date
 already_up_to_date_head() {
-    atf_set require.files "${KYUA_STOREDIR}/schema_v3.sql"
+    atf_set require.files "${KYUA_STOREDIR}/schema_v4.sql"
     atf_set require.progs "sqlite3"
 }
 already_up_to_date_body() {
-    create_results_file "${KYUA_STOREDIR}/schema_v3.sql"
+    create_results_file "${KYUA_STOREDIR}/schema_v4.sql"
     atf_check -s exit:1 -o empty -e match:"already at schema version" \
         kyua db-migrate
 }
@@ -157,6 +173,7 @@ EOF
 atf_init_test_cases() {
     atf_add_test_case upgrade__from_v1
     atf_add_test_case upgrade__from_v2
+    atf_add_test_case upgrade__from_v3
     atf_add_test_case already_up_to_date
     atf_add_test_case need_upgrade
 
@@ -111,7 +111,8 @@ default_behavior__ok_body() {
     atf_check -o match:"2 TESTS FAILING" cat html/index.html
 
     check_in_file html/simple_all_pass_skip.html \
-        "This is the stdout of skip" "This is the stderr of skip"
+        "This is the stdout of skip" "This is the stderr of skip" \
+        "Resource usage" "<td>body</td>"
     check_not_in_file html/simple_all_pass_skip.html \
         "This is the stdout of pass" "This is the stderr of pass" \
         "This is the stdout of fail" "This is the stderr of fail" \
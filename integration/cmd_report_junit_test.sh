@@ -89,6 +89,9 @@ mock1 new line" unused_dbfile_name
 CONTENTS STRIPPED BY TEST
 </properties>
 <testcase classname="simple_all_pass" name="pass" time="S.UUU">
+<properties>
+CONTENTS STRIPPED BY TEST
+</properties>
 <system-out>This is the stdout of pass
 </system-out>
 <system-err>Test case metadata
@@ -100,7 +103,10 @@ description is empty
 execenv is empty
 execenv_jail_params is empty
 has_cleanup = false
+is_cacheable = false
 is_exclusive = false
+max_output_size = 0
+max_retries = 0
 required_configs is empty
 required_disk_space = 0
 required_files is empty
@@ -125,6 +131,9 @@ This is the stderr of pass
 </testcase>
 <testcase classname="simple_all_pass" name="skip" time="S.UUU">
 <skipped/>
+<properties>
+CONTENTS STRIPPED BY TEST
+</properties>
 <system-out>This is the stdout of skip
 </system-out>
 <system-err>Skipped result details
@@ -141,7 +150,10 @@ description is empty
 execenv is empty
 execenv_jail_params is empty
 has_cleanup = false
+is_cacheable = false
 is_exclusive = false
+max_output_size = 0
+max_retries = 0
 required_configs is empty
 required_disk_space = 0
 required_files is empty
@@ -209,6 +221,9 @@ output__explicit_body() {
 CONTENTS STRIPPED BY TEST
 </properties>
 <testcase classname="simple_all_pass" name="pass" time="S.UUU">
+<properties>
+CONTENTS STRIPPED BY TEST
+</properties>
 <system-out>This is the stdout of pass
 </system-out>
 <system-err>Test case metadata
@@ -220,7 +235,10 @@ description is empty
 execenv is empty
 execenv_jail_params is empty
 has_cleanup = false
+is_cacheable = false
 is_exclusive = false
+max_output_size = 0
+max_retries = 0
 required_configs is empty
 required_disk_space = 0
 required_files is empty
@@ -245,6 +263,9 @@ This is the stderr of pass
 </testcase>
 <testcase classname="simple_all_pass" name="skip" time="S.UUU">
 <skipped/>
+<properties>
+CONTENTS STRIPPED BY TEST
+</properties>
 <system-out>This is the stdout of skip
 </system-out>
 <system-err>Skipped result details
@@ -261,7 +282,10 @@ description is empty
 execenv is empty
 execenv_jail_params is empty
 has_cleanup = false
+is_cacheable = false
 is_exclusive = false
+max_output_size = 0
+max_retries = 0
 required_configs is empty
 required_disk_space = 0
 required_files is empty
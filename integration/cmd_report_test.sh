@@ -254,7 +254,10 @@ Metadata:
     execenv is empty
     execenv_jail_params is empty
     has_cleanup = false
+    is_cacheable = false
     is_exclusive = false
+    max_output_size = 0
+    max_retries = 0
     required_configs is empty
     required_disk_space = 0
     required_files is empty
@@ -264,6 +267,15 @@ Metadata:
     required_user is empty
     timeout = 300
 
+Resource usage (body):
+    user_time = S.UUUs
+    system_time = S.UUUs
+    max_rss = N
+    block_input = N
+    block_output = N
+    voluntary_ctxsw = N
+    involuntary_ctxsw = N
+
 Standard output:
 This is the stdout of skip
 
@@ -279,7 +291,8 @@ End time:   YYYY-MM-DDTHH:MM:SS.ssssssZ
 Total time: S.UUUs
 EOF
     atf_check -s exit:0 -o file:expout -e empty -x kyua report --verbose \
-        "| ${utils_strip_times_but_not_ids}"
+        "| ${utils_strip_times_but_not_ids}" \
+        "| sed -E -e 's,^(    [a-z_]+(rss|input|output|ctxsw) = )[0-9]+$,\1N,'"
 }
 
 
@@ -0,0 +1,107 @@
+# Copyright 2026 The Kyua Authors.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are
+# met:
+#
+# * Redistributions of source code must retain the above copyright
+#   notice, this list of conditions and the following disclaimer.
+# * Redistributions in binary form must reproduce the above copyright
+#   notice, this list of conditions and the following disclaimer in the
+#   documentation and/or other materials provided with the distribution.
+# * Neither the name of Google Inc. nor the names of its contributors
+#   may be used to endorse or promote products derived from this software
+#   without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+# "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+# A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+# OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+# LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+# DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+# THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+# Executes a mock test suite to generate data in the database.
+#
+# \param dbfile_name File to which to write the path to the generated database
+#     file.
+run_tests() {
+    local dbfile_name="${1}"; shift
+
+    cat >Kyuafile <<EOF
+syntax(2)
+test_suite("integration")
+atf_test_program{name="simple_all_pass"}
+EOF
+
+    utils_cp_helper simple_all_pass .
+    atf_check -s exit:0 -o save:stdout -e empty kyua test
+    grep '^Results saved to ' stdout | cut -d ' ' -f 4 >"${dbfile_name}"
+    rm stdout
+
+    # Ensure the results of 'report-trace' come from the database.
+    rm Kyuafile simple_all_pass
+}
+
+
+utils_test_case default_behavior__ok
+default_behavior__ok_body() {
+    run_tests unused_dbfile_name
+
+    atf_check -s exit:0 -o save:trace.json -e empty kyua report-trace
+
+    atf_check -s exit:0 -o match:'^{"traceEvents":\[$' \
+        -o match:'^"displayTimeUnit":"ms"}$' -e empty cat trace.json
+    atf_check -s exit:0 -o inline:'1\n' -e empty \
+        grep -c '"name":"simple_all_pass","cat":"listing",.*"tid":0}' trace.json
+    for tc in pass skip; do
+        for phase in body store workdir_cleanup; do
+            local event="simple_all_pass:${tc}\",\"cat\":\"${phase}\""
+            atf_check -s exit:0 -o inline:'1\n' -e empty \
+                grep -c "${event}" trace.json
+        done
+    done
+    atf_check -s exit:0 -o ignore -e empty \
+        grep '"thread_name",.*"tid":1,"args":{"name":"slot 1"}' trace.json
+}
+
+
+utils_test_case default_behavior__no_store
+default_behavior__no_store_body() {
+    echo 'kyua: E: No previous results file found for test suite' \
+        "$(utils_test_suite_id)." >experr
+    atf_check -s exit:2 -o empty -e file:experr kyua report-trace
+}
+
+
+utils_test_case results_file__not_found
+results_file__not_found_body() {
+    atf_check -s exit:2 -o empty -e match:"kyua: E: No previous results.*foo" \
+        kyua report-trace --results-file=foo
+}
+
+
+utils_test_case output__explicit
+output__explicit_body() {
+    run_tests dbfile_name
+
+    atf_check -s exit:0 -o empty -e empty kyua report-trace \
+        --results-file="$(cat dbfile_name)" --output=my-file
+    atf_check -s exit:0 -o match:'"cat":"body"' -e empty cat my-file
+}
+
+
+atf_init_test_cases() {
+    atf_add_test_case default_behavior__ok
+    atf_add_test_case default_behavior__no_store
+
+    atf_add_test_case results_file__not_found
+
+    atf_add_test_case output__explicit
+}
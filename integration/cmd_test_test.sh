@@ -722,6 +722,680 @@ EOF
 }
 
 
+utils_test_case rerun_failed__explicit
+rerun_failed__explicit_body() {
+    utils_install_stable_test_wrapper
+
+    cat >Kyuafile <<EOF
+syntax(2)
+test_suite("integration")
+atf_test_program{name="simple_all_pass"}
+atf_test_program{name="simple_some_fail"}
+EOF
+    utils_cp_helper simple_all_pass .
+    utils_cp_helper simple_some_fail .
+    atf_check -s exit:1 -o ignore -e empty kyua test -r first.db
+
+    cat >expout <<EOF
+simple_some_fail:fail  ->  failed: This fails on purpose  [S.UUUs]
+
+Results saved to second.db
+
+0/1 passed (1 failed)
+EOF
+    atf_check -s exit:1 -o file:expout -e empty \
+        kyua test -r second.db --rerun-failed=first.db
+
+    echo "$(pwd)/first.db" >expout
+    atf_check -s exit:0 -o file:expout -e empty \
+        kyua db-exec -r second.db --no-headers \
+        "SELECT original_results_file FROM reruns"
+}
+
+
+utils_test_case rerun_failed__latest
+rerun_failed__latest_body() {
+    utils_install_stable_test_wrapper
+
+    cat >Kyuafile <<EOF
+syntax(2)
+test_suite("integration")
+atf_test_program{name="simple_all_pass"}
+atf_test_program{name="simple_some_fail"}
+EOF
+    utils_cp_helper simple_all_pass .
+    utils_cp_helper simple_some_fail .
+    atf_check -s exit:1 -o ignore -e empty kyua test
+
+    atf_check -s exit:1 -o match:"simple_some_fail:fail  ->  failed" \
+        -o not-match:"passed  \[" -o match:"0/1 passed" -e empty \
+        kyua test --rerun-failed
+}
+
+
+utils_test_case rerun_failed__filters
+rerun_failed__filters_body() {
+    utils_install_stable_test_wrapper
+
+    cat >Kyuafile <<EOF
+syntax(2)
+test_suite("integration")
+atf_test_program{name="simple_all_pass"}
+atf_test_program{name="simple_some_fail"}
+EOF
+    utils_cp_helper simple_all_pass .
+    utils_cp_helper simple_some_fail .
+    atf_check -s exit:1 -o ignore -e empty kyua test -r first.db
+
+    echo "No failed test cases to rerun in $(pwd)/first.db" >expout
+    atf_check -s exit:0 -o file:expout -e empty \
+        kyua test -r second.db --rerun-failed=first.db simple_all_pass
+    test ! -f second.db || atf_fail "Results file created without tests"
+
+    atf_check -s exit:1 -o match:"simple_some_fail:fail  ->  failed" \
+        -o match:"0/1 passed" -e empty \
+        kyua test -r third.db --rerun-failed=first.db simple_some_fail
+}
+
+
+utils_test_case rerun_failed__missing
+rerun_failed__missing_body() {
+    cat >Kyuafile <<EOF
+syntax(2)
+atf_test_program{name="simple_all_pass", test_suite="integration"}
+EOF
+    utils_cp_helper simple_all_pass .
+
+    atf_check -s exit:2 -o empty -e match:"No previous results.*missing" \
+        kyua test --rerun-failed=missing
+}
+
+
+utils_test_case skip_unchanged__reuse
+skip_unchanged__reuse_body() {
+    utils_install_stable_test_wrapper
+
+    cat >Kyuafile <<EOF
+syntax(2)
+test_suite("integration")
+atf_test_program{name="simple_all_pass"}
+atf_test_program{name="simple_some_fail"}
+EOF
+    utils_cp_helper simple_all_pass .
+    utils_cp_helper simple_some_fail .
+    atf_check -s exit:1 -o ignore -e empty kyua test -r first.db
+
+    atf_check -s exit:1 \
+        -o match:"simple_all_pass:pass  ->  passed  \[S.UUUs, reused\]" \
+        -o match:"simple_all_pass:skip  ->  skipped: .*, reused\]" \
+        -o match:"simple_some_fail:fail  ->  failed: This fails on purpose  \[S.UUUs\]$" \
+        -o match:"3/4 passed" -e empty \
+        kyua test -r second.db --skip-unchanged=first.db
+
+    cat >expout <<EOF
+2|$(pwd)/first.db
+EOF
+    atf_check -s exit:0 -o file:expout -e empty \
+        kyua db-exec -r second.db --no-headers \
+        "SELECT COUNT(*), original_results_file FROM reused_results"
+}
+
+
+utils_test_case skip_unchanged__changed
+skip_unchanged__changed_body() {
+    utils_install_stable_test_wrapper
+
+    cat >Kyuafile <<EOF
+syntax(2)
+test_suite("integration")
+atf_test_program{name="simple_all_pass"}
+EOF
+    utils_cp_helper simple_all_pass .
+    atf_check -s exit:0 -o ignore -e empty kyua test
+
+    echo "# Modified." >>simple_all_pass
+    atf_check -s exit:0 -o match:"simple_all_pass:pass  ->  passed  \[S.UUUs\]" \
+        -o not-match:"reused" -e empty kyua test --skip-unchanged
+}
+
+
+utils_test_case result_cache__hit
+result_cache__hit_body() {
+    utils_install_stable_test_wrapper
+
+    cat >Kyuafile <<EOF
+syntax(2)
+test_suite("integration")
+atf_test_program{name="simple_all_pass", is_cacheable=true}
+atf_test_program{name="simple_some_fail"}
+EOF
+    utils_cp_helper simple_all_pass .
+    utils_cp_helper simple_some_fail .
+
+    atf_check -s exit:1 -o not-match:"cached" -e empty \
+        kyua -v result_cache_dir="$(pwd)/cache" test -r first.db
+    test -d cache || atf_fail "Result cache not created"
+
+    atf_check -s exit:1 \
+        -o match:"simple_all_pass:pass  ->  passed  \[S.UUUs, cached\]" \
+        -o match:"simple_all_pass:skip  ->  skipped: .*  \[S.UUUs\]$" \
+        -o match:"simple_some_fail:pass  ->  passed  \[S.UUUs\]$" \
+        -o match:"3/4 passed \(1 failed, 1 cached\)" -e empty \
+        kyua -v result_cache_dir="$(pwd)/cache" test -r second.db
+
+    atf_check -s exit:0 -o match:"Cache hits: 1" -e empty \
+        kyua report -r second.db
+    atf_check -s exit:0 -o not-match:"Cache hits" -e empty \
+        kyua report -r first.db
+}
+
+
+utils_test_case result_cache__changed
+result_cache__changed_body() {
+    utils_install_stable_test_wrapper
+
+    cat >Kyuafile <<EOF
+syntax(2)
+test_suite("integration")
+atf_test_program{name="simple_all_pass", is_cacheable=true}
+EOF
+    utils_cp_helper simple_all_pass .
+
+    atf_check -s exit:0 -o ignore -e empty \
+        kyua -v result_cache_dir="$(pwd)/cache" test
+    echo "# Modified." >>simple_all_pass
+    atf_check -s exit:0 -o not-match:"cached" -e empty \
+        kyua -v result_cache_dir="$(pwd)/cache" test
+    atf_check -s exit:0 -o match:"cached" -e empty \
+        kyua -v result_cache_dir="$(pwd)/cache" test
+}
+
+
+utils_test_case result_cache__disabled
+result_cache__disabled_body() {
+    utils_install_stable_test_wrapper
+
+    cat >Kyuafile <<EOF
+syntax(2)
+test_suite("integration")
+atf_test_program{name="simple_all_pass", is_cacheable=true}
+EOF
+    utils_cp_helper simple_all_pass .
+
+    for i in 1 2; do
+        atf_check -s exit:0 -o not-match:"cached" -e empty \
+            kyua -v result_cache_dir="$(pwd)/cache" -v result_cache_size=0 test
+    done
+    test ! -d cache || atf_fail "Result cache created while disabled"
+}
+
+
+utils_test_case retries__flaky
+retries__flaky_body() {
+    utils_install_stable_test_wrapper
+
+    cat >Kyuafile <<EOF
+syntax(2)
+test_suite("integration")
+atf_test_program{name="simple_all_pass"}
+plain_test_program{name="flaky"}
+EOF
+    utils_cp_helper simple_all_pass .
+    cat >flaky <<EOF
+#! /bin/sh
+test -f "$(pwd)/attempted" && exit 0
+touch "$(pwd)/attempted"
+exit 1
+EOF
+    chmod +x flaky
+
+    cat >expout <<EOF
+flaky:main  ->  failed: Returned non-success exit status 1  [S.UUUs, retrying]
+flaky:main  ->  passed  [S.UUUs, flaky]
+simple_all_pass:pass  ->  passed  [S.UUUs]
+simple_all_pass:skip  ->  skipped: The reason for skipping is this  [S.UUUs]
+
+Results file id is $(utils_results_id)
+Results saved to $(utils_results_file)
+
+3/3 passed (0 failed, 1 flaky)
+EOF
+    atf_check -s exit:0 -o file:expout -e empty kyua test --retries=2
+
+    atf_check -s exit:0 -o match:"===> Flaky tests" \
+        -o match:"flaky:main  ->  passed" -o match:"Flaky tests: 1" -e empty \
+        kyua report
+    atf_check -s exit:0 -o match:"<flakyFailure message=\"Returned" \
+        -e empty kyua report-junit
+}
+
+
+utils_test_case retries__exhausted
+retries__exhausted_body() {
+    utils_install_stable_test_wrapper
+
+    cat >Kyuafile <<EOF
+syntax(2)
+test_suite("integration")
+plain_test_program{name="broken"}
+EOF
+    echo '#! /bin/sh' >broken
+    echo 'exit 1' >>broken
+    chmod +x broken
+
+    cat >expout <<EOF
+broken:main  ->  failed: Returned non-success exit status 1  [S.UUUs, retrying]
+broken:main  ->  failed: Returned non-success exit status 1  [S.UUUs, retrying]
+broken:main  ->  failed: Returned non-success exit status 1  [S.UUUs]
+
+Results file id is $(utils_results_id)
+Results saved to $(utils_results_file)
+
+0/1 passed (1 failed)
+EOF
+    atf_check -s exit:1 -o file:expout -e empty kyua test -r results.db \
+        --retries=2
+
+    echo "2" >expout
+    atf_check -s exit:0 -o file:expout -e empty \
+        kyua db-exec -r results.db --no-headers \
+        "SELECT COUNT(*) FROM test_result_attempts"
+}
+
+
+utils_test_case retries__metadata
+retries__metadata_body() {
+    utils_install_stable_test_wrapper
+
+    cat >Kyuafile <<EOF
+syntax(2)
+test_suite("integration")
+plain_test_program{name="flaky", max_retries=1}
+EOF
+    cat >flaky <<EOF
+#! /bin/sh
+test -f "$(pwd)/attempted" && exit 0
+touch "$(pwd)/attempted"
+exit 1
+EOF
+    chmod +x flaky
+
+    atf_check -s exit:0 -o match:"flaky:main  ->  passed  \[S.UUUs, flaky\]" \
+        -o match:"1/1 passed \(0 failed, 1 flaky\)" -e empty kyua test
+}
+
+
+utils_test_case retries__negative
+retries__negative_body() {
+    cat >Kyuafile <<EOF
+syntax(2)
+atf_test_program{name="simple_all_pass", test_suite="integration"}
+EOF
+    utils_cp_helper simple_all_pass .
+
+    atf_check -s exit:3 -o empty -e match:"retries cannot be negative" \
+        kyua test --retries=-1
+}
+
+
+utils_test_case repeat__count
+repeat__count_body() {
+    utils_install_stable_test_wrapper
+
+    cat >Kyuafile <<EOF
+syntax(2)
+test_suite("integration")
+atf_test_program{name="simple_all_pass"}
+EOF
+    utils_cp_helper simple_all_pass .
+
+    cat >expout <<EOF
+simple_all_pass:pass  ->  passed  [S.UUUs, 3 runs]
+simple_all_pass:skip  ->  skipped: The reason for skipping is this  [S.UUUs, 3 runs]
+
+Results file id is $(utils_results_id)
+Results saved to $(utils_results_file)
+
+2/2 passed (0 failed)
+EOF
+    atf_check -s exit:0 -o file:expout -e empty kyua test -r results.db \
+        --repeat=3
+
+    cat >expout <<EOF
+3|0
+3|0
+EOF
+    atf_check -s exit:0 -o file:expout -e empty \
+        kyua db-exec -r results.db --no-headers \
+        "SELECT runs, failures FROM test_case_repetitions"
+}
+
+
+utils_test_case repeat__failures
+repeat__failures_body() {
+    utils_install_stable_test_wrapper
+
+    cat >Kyuafile <<EOF
+syntax(2)
+test_suite("integration")
+plain_test_program{name="broken"}
+EOF
+    echo '#! /bin/sh' >broken
+    echo 'echo "Some output"' >>broken
+    echo 'exit 1' >>broken
+    chmod +x broken
+
+    cat >expout <<EOF
+broken:main  ->  failed: Returned non-success exit status 1  [S.UUUs, 3 of 3 runs failed]
+
+Results file id is $(utils_results_id)
+Results saved to $(utils_results_file)
+
+0/1 passed (1 failed)
+EOF
+    atf_check -s exit:1 -o file:expout -e empty kyua test -r results.db \
+        --repeat=3
+
+    echo "2" >expout
+    atf_check -s exit:0 -o file:expout -e empty \
+        kyua db-exec -r results.db --no-headers \
+        "SELECT COUNT(*) FROM test_result_attempt_files"
+
+    atf_check -s exit:1 -o match:"Runs:       3 \(3 failed\)" \
+        -o match:"Other failed runs:" -e empty \
+        kyua report -r results.db --verbose
+}
+
+
+utils_test_case repeat__until_fail
+repeat__until_fail_body() {
+    utils_install_stable_test_wrapper
+
+    cat >Kyuafile <<EOF
+syntax(2)
+test_suite("integration")
+plain_test_program{name="racy"}
+EOF
+    cat >racy <<EOF
+#! /bin/sh
+echo run >>"$(pwd)/runs"
+test \$(wc -l <"$(pwd)/runs") -lt 3
+EOF
+    chmod +x racy
+
+    atf_check -s exit:1 \
+        -o match:"racy:main  ->  failed: .*  \[S.UUUs, 1 of 3 runs failed\]" \
+        -e empty kyua -v parallelism=1 test --repeat-until-fail
+    test $(wc -l <runs) -eq 3 || atf_fail "Repetitions did not stop"
+}
+
+
+utils_test_case repeat__invalid
+repeat__invalid_body() {
+    cat >Kyuafile <<EOF
+syntax(2)
+atf_test_program{name="simple_all_pass", test_suite="integration"}
+EOF
+    utils_cp_helper simple_all_pass .
+
+    atf_check -s exit:3 -o empty -e match:"repetitions must be positive" \
+        kyua test --repeat=0
+    atf_check -s exit:3 -o empty -e match:"retries cannot be used" \
+        kyua test --repeat=2 --retries=1
+}
+
+
+utils_test_case fail_fast__stops
+fail_fast__stops_body() {
+    utils_install_stable_test_wrapper
+
+    cat >Kyuafile <<EOF
+syntax(2)
+test_suite("integration")
+plain_test_program{name="broken"}
+atf_test_program{name="simple_all_pass"}
+EOF
+    echo '#! /bin/sh' >broken
+    echo 'exit 1' >>broken
+    chmod +x broken
+    utils_cp_helper simple_all_pass .
+
+    cat >expout <<EOF
+broken:main  ->  failed: Returned non-success exit status 1  [S.UUUs]
+
+Results file id is $(utils_results_id)
+Results saved to $(utils_results_file)
+
+0/1 passed (1 failed)
+Stopped early due to --fail-fast; not all test cases ran
+EOF
+    atf_check -s exit:1 -o file:expout -e empty \
+        kyua -v parallelism=1 test --fail-fast=1
+}
+
+
+utils_test_case fail_fast__terminates
+fail_fast__terminates_body() {
+    utils_install_stable_test_wrapper
+
+    cat >Kyuafile <<EOF
+syntax(2)
+test_suite("integration")
+plain_test_program{name="slow"}
+plain_test_program{name="broken"}
+EOF
+    echo '#! /bin/sh' >slow
+    echo 'sleep 600' >>slow
+    chmod +x slow
+    echo '#! /bin/sh' >broken
+    echo 'exit 1' >>broken
+    chmod +x broken
+
+    cat >expout <<EOF
+broken:main  ->  failed: Returned non-success exit status 1  [S.UUUs]
+slow:main  ->  skipped: Terminated because too many other tests failed  [S.UUUs]
+
+Results file id is $(utils_results_id)
+Results saved to $(utils_results_file)
+
+1/2 passed (1 failed)
+Stopped early due to --fail-fast; not all test cases ran
+EOF
+    atf_check -s exit:1 -o file:expout -e empty \
+        kyua -v parallelism=2 test -r results.db --fail-fast=1
+
+    echo "2" >expout
+    atf_check -s exit:0 -o file:expout -e empty \
+        kyua db-exec -r results.db --no-headers \
+        "SELECT COUNT(*) FROM test_results"
+}
+
+
+utils_test_case fail_fast__invalid
+fail_fast__invalid_body() {
+    cat >Kyuafile <<EOF
+syntax(2)
+atf_test_program{name="simple_all_pass", test_suite="integration"}
+EOF
+    utils_cp_helper simple_all_pass .
+
+    atf_check -s exit:3 -o empty -e match:"fail-fast must be positive" \
+        kyua test --fail-fast=0
+}
+
+
+utils_test_case prioritize_failures__order
+prioritize_failures__order_body() {
+    cat >Kyuafile <<EOF
+syntax(2)
+test_suite("integration")
+atf_test_program{name="simple_all_pass"}
+plain_test_program{name="broken"}
+EOF
+    utils_cp_helper simple_all_pass .
+    echo '#! /bin/sh' >broken
+    echo 'exit 1' >>broken
+    chmod +x broken
+
+    atf_check -s exit:1 -o save:stdout -e empty \
+        kyua -v parallelism=1 test
+    head -n 1 stdout | grep '^simple_all_pass:' >/dev/null \
+        || atf_fail "Tests did not run in Kyuafile order"
+
+    atf_check -s exit:1 -o save:stdout -e empty \
+        kyua -v parallelism=1 test --prioritize-failures
+    head -n 1 stdout | grep '^broken:main' >/dev/null \
+        || atf_fail "Failed test did not run first"
+    grep 'simple_all_pass:pass  ->  passed' stdout >/dev/null \
+        || atf_fail "Other tests did not run"
+
+    atf_check -s exit:0 -o save:stdout -e empty \
+        kyua -v parallelism=1 test --prioritize-failures simple_all_pass
+    grep 'broken' stdout >/dev/null \
+        && atf_fail "Prioritized test ran despite not matching the filters"
+    true
+}
+
+
+utils_test_case prioritize_failures__missing
+prioritize_failures__missing_body() {
+    cat >Kyuafile <<EOF
+syntax(2)
+atf_test_program{name="simple_all_pass", test_suite="integration"}
+EOF
+    utils_cp_helper simple_all_pass .
+
+    atf_check -s exit:0 -o match:"2/2 passed" \
+        -e match:"W: Not prioritizing any test cases: .*missing" \
+        kyua test --prioritize-failures=missing
+}
+
+
+utils_test_case time_budget__history
+time_budget__history_body() {
+    utils_install_stable_test_wrapper
+
+    cat >Kyuafile <<EOF
+syntax(2)
+test_suite("integration")
+atf_test_program{name="simple_all_pass"}
+plain_test_program{name="slow"}
+EOF
+    utils_cp_helper simple_all_pass .
+    echo '#! /bin/sh' >slow
+    echo 'sleep 5' >>slow
+    chmod +x slow
+    atf_check -s exit:0 -o ignore -e empty kyua test
+
+    cat >expout <<EOF
+simple_all_pass:pass  ->  passed  [S.UUUs]
+simple_all_pass:skip  ->  skipped: The reason for skipping is this  [S.UUUs]
+slow:main  ->  not run (budget)
+
+Results file id is $(utils_results_id)
+Results saved to $(utils_results_file)
+
+2/2 passed (0 failed, 1 not run)
+EOF
+    atf_check -s exit:0 -o file:expout -e empty kyua test --time-budget=3s
+
+    atf_check -s exit:0 -o match:"slow:main  ->  skipped: Not run: does not fit" \
+        -e empty kyua report
+}
+
+
+utils_test_case time_budget__terminate
+time_budget__terminate_body() {
+    utils_install_stable_test_wrapper
+
+    cat >Kyuafile <<EOF
+syntax(2)
+test_suite("integration")
+plain_test_program{name="slow"}
+EOF
+    echo '#! /bin/sh' >slow
+    echo 'sleep 600' >>slow
+    chmod +x slow
+
+    cat >expout <<EOF
+slow:main  ->  skipped: Terminated at the end of the time budget  [S.UUUs]
+
+Results file id is $(utils_results_id)
+Results saved to $(utils_results_file)
+
+1/1 passed (0 failed)
+EOF
+    atf_check -s exit:0 -o file:expout \
+        -e match:"W: Cannot estimate the duration of the test cases" \
+        kyua test --time-budget=3
+}
+
+
+utils_test_case adaptive_timeout
+adaptive_timeout_body() {
+    utils_install_stable_test_wrapper
+
+    cat >Kyuafile <<EOF
+syntax(2)
+test_suite("integration")
+plain_test_program{name="hang"}
+EOF
+    cat >hang <<EOF
+#! /bin/sh
+test -f "$(pwd)/hang.enabled" && sleep 600
+exit 0
+EOF
+    chmod +x hang
+    atf_check -s exit:0 -o ignore -e empty kyua test
+
+    touch hang.enabled
+    cat >expout <<EOF
+hang:main  ->  broken: Test case body timed out after 1 seconds (adaptive timeout; declared timeout is 300 seconds)  [S.UUUs]
+
+Results file id is $(utils_results_id)
+Results saved to $(utils_results_file)
+
+0/1 passed (1 failed)
+EOF
+    atf_check -s exit:1 -o file:expout -e empty kyua \
+        -v adaptive_timeout_factor=2 -v adaptive_timeout_floor=1 test
+}
+
+
+utils_test_case time_budget__invalid
+time_budget__invalid_body() {
+    cat >Kyuafile <<EOF
+syntax(2)
+atf_test_program{name="simple_all_pass", test_suite="integration"}
+EOF
+    utils_cp_helper simple_all_pass .
+
+    atf_check -s exit:3 -o empty -e match:"Invalid time budget" \
+        kyua test --time-budget=foo
+    atf_check -s exit:3 -o empty -e match:"time budget must be positive" \
+        kyua test --time-budget=0m
+}
+
+
+utils_test_case metrics_file
+metrics_file_body() {
+    cat >Kyuafile <<EOF
+syntax(2)
+atf_test_program{name="simple_all_pass", test_suite="integration"}
+EOF
+    utils_cp_helper simple_all_pass .
+
+    atf_check -s exit:0 -o ignore -e empty kyua test --metrics-file=metrics.txt
+    atf_check -s exit:0 \
+        -o match:'^# TYPE kyua_executor_spawn_seconds histogram$' \
+        -o match:'^kyua_run_store_seconds_count 2$' \
+        -o match:'^kyua_scheduler_listing_seconds_count 1$' \
+        -o match:'^kyua_scheduler_spawned_tests_total 2$' \
+        -o match:'^# EOF$' \
+        -e empty cat metrics.txt
+}
+
+
 utils_test_case build_root_flag
 build_root_flag_body() {
     utils_install_stable_test_wrapper
@@ -1091,6 +1765,35 @@ atf_init_test_cases() {
     atf_add_test_case results_file__fail
     atf_add_test_case results_file__reuse
 
+    atf_add_test_case rerun_failed__explicit
+    atf_add_test_case rerun_failed__latest
+    atf_add_test_case rerun_failed__filters
+    atf_add_test_case rerun_failed__missing
+    atf_add_test_case skip_unchanged__reuse
+    atf_add_test_case skip_unchanged__changed
+    atf_add_test_case result_cache__hit
+    atf_add_test_case result_cache__changed
+    atf_add_test_case result_cache__disabled
+    atf_add_test_case retries__flaky
+    atf_add_test_case retries__exhausted
+    atf_add_test_case retries__metadata
+    atf_add_test_case retries__negative
+    atf_add_test_case repeat__count
+    atf_add_test_case repeat__failures
+    atf_add_test_case repeat__until_fail
+    atf_add_test_case repeat__invalid
+    atf_add_test_case fail_fast__stops
+    atf_add_test_case fail_fast__terminates
+    atf_add_test_case fail_fast__invalid
+    atf_add_test_case prioritize_failures__order
+    atf_add_test_case prioritize_failures__missing
+    atf_add_test_case time_budget__history
+    atf_add_test_case time_budget__terminate
+    atf_add_test_case adaptive_timeout
+    atf_add_test_case time_budget__invalid
+
+    atf_add_test_case metrics_file
+
     atf_add_test_case build_root_flag
 
     atf_add_test_case kyuafile_flag__no_args
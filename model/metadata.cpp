@@ -185,6 +185,35 @@ class user_node : public config::string_node {
 };
 
 
+/// A leaf node that holds a number of retries.
+///
+/// This node is just an integer, but it rejects negative values.
+class retries_node : public config::int_node {
+    /// Copies the node.
+    ///
+    /// \return A dynamically-allocated node.
+    virtual base_node*
+    deep_copy(void) const
+    {
+        std::unique_ptr< retries_node > new_node(new retries_node());
+        new_node->_value = _value;
+        return new_node.release();
+    }
+
+    /// Checks a given number of retries for validity.
+    ///
+    /// \param retries The value to validate.
+    ///
+    /// \throw config::value_error If the value is not valid.
+    void
+    validate(const value_type& retries) const
+    {
+        if (retries < 0)
+            throw config::value_error("Number of retries cannot be negative");
+    }
+};
+
+
 /// A leaf node that holds a set of paths.
 ///
 /// This node type is used to represent the value of the required files and
@@ -251,7 +280,10 @@ init_tree(config::tree& tree)
     tree.define< config::string_node >("execenv");
     tree.define< config::string_node >("execenv_jail_params");
     tree.define< config::bool_node >("has_cleanup");
+    tree.define< config::bool_node >("is_cacheable");
     tree.define< config::bool_node >("is_exclusive");
+    tree.define< bytes_node >("max_output_size");
+    tree.define< retries_node >("max_retries");
     tree.define< config::strings_set_node >("required_configs");
     tree.define< bytes_node >("required_disk_space");
     tree.define< paths_set_node >("required_files");
@@ -277,7 +309,10 @@ set_defaults(config::tree& tree)
     tree.set< config::string_node >("execenv", "");
     tree.set< config::string_node >("execenv_jail_params", "");
     tree.set< config::bool_node >("has_cleanup", false);
+    tree.set< config::bool_node >("is_cacheable", false);
     tree.set< config::bool_node >("is_exclusive", false);
+    tree.set< bytes_node >("max_output_size", units::bytes(0));
+    tree.set< retries_node >("max_retries", 0);
     tree.set< config::strings_set_node >("required_configs",
                                          model::strings_set());
     tree.set< bytes_node >("required_disk_space", units::bytes(0));
@@ -526,6 +561,21 @@ model::metadata::has_execenv(void) const
 }
 
 
+/// Returns whether the results of the test can be cached or not.
+///
+/// \return True if the test is deterministic, so that its result can be reused
+/// as long as its inputs do not change; false otherwise.
+bool
+model::metadata::is_cacheable(void) const
+{
+    if (_pimpl->props.is_set("is_cacheable")) {
+        return _pimpl->props.lookup< config::bool_node >("is_cacheable");
+    } else {
+        return get_defaults().lookup< config::bool_node >("is_cacheable");
+    }
+}
+
+
 /// Returns whether the test is exclusive or not.
 ///
 /// \return True if the test has to be run on its own, not concurrently with any
@@ -541,6 +591,34 @@ model::metadata::is_exclusive(void) const
 }
 
 
+/// Returns the maximum amount of output the test may keep per stream.
+///
+/// \return Number of bytes, or 0 if the test does not set a limit.
+const units::bytes&
+model::metadata::max_output_size(void) const
+{
+    if (_pimpl->props.is_set("max_output_size")) {
+        return _pimpl->props.lookup< bytes_node >("max_output_size");
+    } else {
+        return get_defaults().lookup< bytes_node >("max_output_size");
+    }
+}
+
+
+/// Returns the number of times to retry the test if it fails.
+///
+/// \return Number of retries, or 0 if the test does not override the default.
+int
+model::metadata::max_retries(void) const
+{
+    if (_pimpl->props.is_set("max_retries")) {
+        return _pimpl->props.lookup< retries_node >("max_retries");
+    } else {
+        return get_defaults().lookup< retries_node >("max_retries");
+    }
+}
+
+
 /// Returns the list of configuration variables needed by the test.
 ///
 /// \return Set of configuration variables.
@@ -999,6 +1077,21 @@ model::metadata_builder::set_has_cleanup(const bool cleanup)
 }
 
 
+/// Sets whether the results of the test can be cached or not.
+///
+/// \param cacheable True if the test is deterministic; false otherwise.
+///
+/// \return A reference to this builder.
+///
+/// \throw model::error If the value is invalid.
+model::metadata_builder&
+model::metadata_builder::set_is_cacheable(const bool cacheable)
+{
+    set< config::bool_node >(_pimpl->props, "is_cacheable", cacheable);
+    return *this;
+}
+
+
 /// Sets whether the test is exclusive or not.
 ///
 /// \param exclusive True if the test is exclusive; false otherwise.
@@ -1014,6 +1107,36 @@ model::metadata_builder::set_is_exclusive(const bool exclusive)
 }
 
 
+/// Sets the maximum amount of output the test may keep per stream.
+///
+/// \param bytes Number of bytes, or 0 to not set a limit.
+///
+/// \return A reference to this builder.
+///
+/// \throw model::error If the value is invalid.
+model::metadata_builder&
+model::metadata_builder::set_max_output_size(const units::bytes& bytes)
+{
+    set< bytes_node >(_pimpl->props, "max_output_size", bytes);
+    return *this;
+}
+
+
+/// Sets the number of times to retry the test if it fails.
+///
+/// \param retries Number of retries, or 0 to not override the default.
+///
+/// \return A reference to this builder.
+///
+/// \throw model::error If the value is invalid.
+model::metadata_builder&
+model::metadata_builder::set_max_retries(const int retries)
+{
+    set< retries_node >(_pimpl->props, "max_retries", retries);
+    return *this;
+}
+
+
 /// Sets the list of configuration variables needed by the test.
 ///
 /// \param vars Set of configuration variables.
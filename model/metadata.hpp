@@ -71,7 +71,10 @@ public:
     const std::string& execenv_jail_params(void) const;
     bool has_cleanup(void) const;
     bool has_execenv(void) const;
+    bool is_cacheable(void) const;
     bool is_exclusive(void) const;
+    const utils::units::bytes& max_output_size(void) const;
+    int max_retries(void) const;
     const strings_set& required_configs(void) const;
     const utils::units::bytes& required_disk_space(void) const;
     const paths_set& required_files(void) const;
@@ -117,7 +120,10 @@ public:
     metadata_builder& set_execenv(const std::string&);
     metadata_builder& set_execenv_jail_params(const std::string&);
     metadata_builder& set_has_cleanup(const bool);
+    metadata_builder& set_is_cacheable(const bool);
     metadata_builder& set_is_exclusive(const bool);
+    metadata_builder& set_max_output_size(const utils::units::bytes&);
+    metadata_builder& set_max_retries(const int);
     metadata_builder& set_required_configs(const strings_set&);
     metadata_builder& set_required_disk_space(const utils::units::bytes&);
     metadata_builder& set_required_files(const paths_set&);
@@ -53,7 +53,10 @@ ATF_TEST_CASE_BODY(defaults)
     ATF_REQUIRE(md.custom().empty());
     ATF_REQUIRE(md.description().empty());
     ATF_REQUIRE(!md.has_cleanup());
+    ATF_REQUIRE(!md.is_cacheable());
     ATF_REQUIRE(!md.is_exclusive());
+    ATF_REQUIRE_EQ(units::bytes(0), md.max_output_size());
+    ATF_REQUIRE_EQ(0, md.max_retries());
     ATF_REQUIRE(md.required_configs().empty());
     ATF_REQUIRE_EQ(units::bytes(0), md.required_disk_space());
     ATF_REQUIRE(md.required_files().empty());
@@ -193,6 +196,8 @@ ATF_TEST_CASE_BODY(override_all_with_setters)
 
     const units::bytes memory(12345);
 
+    const units::bytes output_size(4096);
+
     model::paths_set programs;
     programs.insert(fs::path("the-programs"));
 
@@ -206,7 +211,10 @@ ATF_TEST_CASE_BODY(override_all_with_setters)
         .set_custom(custom)
         .set_description(description)
         .set_has_cleanup(true)
+        .set_is_cacheable(true)
         .set_is_exclusive(true)
+        .set_max_output_size(output_size)
+        .set_max_retries(3)
         .set_required_configs(configs)
         .set_required_disk_space(disk_space)
         .set_required_files(files)
@@ -221,7 +229,10 @@ ATF_TEST_CASE_BODY(override_all_with_setters)
     ATF_REQUIRE(custom == md.custom());
     ATF_REQUIRE_EQ(description, md.description());
     ATF_REQUIRE(md.has_cleanup());
+    ATF_REQUIRE(md.is_cacheable());
     ATF_REQUIRE(md.is_exclusive());
+    ATF_REQUIRE_EQ(output_size, md.max_output_size());
+    ATF_REQUIRE_EQ(3, md.max_retries());
     ATF_REQUIRE(configs == md.required_configs());
     ATF_REQUIRE_EQ(disk_space, md.required_disk_space());
     ATF_REQUIRE(files == md.required_files());
@@ -260,6 +271,8 @@ ATF_TEST_CASE_BODY(override_all_with_set_string)
 
     const units::bytes memory(1024 * 1024);
 
+    const units::bytes output_size(2 * 1024);
+
     model::paths_set programs;
     programs.insert(fs::path("program"));
     programs.insert(fs::path("/absolute/prog"));
@@ -274,7 +287,10 @@ ATF_TEST_CASE_BODY(override_all_with_set_string)
         .set_string("custom.user-defined", "the-value")
         .set_string("description", "Another long text")
         .set_string("has_cleanup", "true")
+        .set_string("is_cacheable", "true")
         .set_string("is_exclusive", "true")
+        .set_string("max_output_size", "2K")
+        .set_string("max_retries", "3")
         .set_string("required_configs", "config-var")
         .set_string("required_disk_space", "16G")
         .set_string("required_files", "plain /absolute/path")
@@ -289,7 +305,10 @@ ATF_TEST_CASE_BODY(override_all_with_set_string)
     ATF_REQUIRE(custom == md.custom());
     ATF_REQUIRE_EQ(description, md.description());
     ATF_REQUIRE(md.has_cleanup());
+    ATF_REQUIRE(md.is_cacheable());
     ATF_REQUIRE(md.is_exclusive());
+    ATF_REQUIRE_EQ(output_size, md.max_output_size());
+    ATF_REQUIRE_EQ(3, md.max_retries());
     ATF_REQUIRE(configs == md.required_configs());
     ATF_REQUIRE_EQ(disk_space, md.required_disk_space());
     ATF_REQUIRE(files == md.required_files());
@@ -319,7 +338,10 @@ ATF_TEST_CASE_BODY(to_properties)
     props["execenv"] = "";
     props["execenv_jail_params"] = "";
     props["has_cleanup"] = "false";
+    props["is_cacheable"] = "false";
     props["is_exclusive"] = "false";
+    props["max_output_size"] = "0";
+    props["max_retries"] = "0";
     props["required_configs"] = "";
     props["required_disk_space"] = "0";
     props["required_files"] = "bar foo";
@@ -411,8 +433,9 @@ ATF_TEST_CASE_BODY(output__defaults)
     str << model::metadata_builder().build();
     ATF_REQUIRE_EQ("metadata{allowed_architectures='', allowed_platforms='', "
                    "description='', execenv='', execenv_jail_params='', "
-                   "has_cleanup='false', is_exclusive='false', "
-                   "required_configs='', "
+                   "has_cleanup='false', is_cacheable='false', "
+                   "is_exclusive='false', max_output_size='0', "
+                   "max_retries='0', required_configs='', "
                    "required_disk_space='0', required_files='', "
                    "required_kmods='', required_memory='0', "
                    "required_programs='', required_user='', timeout='300'}",
@@ -434,8 +457,8 @@ ATF_TEST_CASE_BODY(output__some_values)
     ATF_REQUIRE_EQ(
         "metadata{allowed_architectures='abc', allowed_platforms='', "
         "description='', execenv='', execenv_jail_params='', "
-        "has_cleanup='false', is_exclusive='true', "
-        "required_configs='', "
+        "has_cleanup='false', is_cacheable='false', is_exclusive='true', "
+        "max_output_size='0', max_retries='0', required_configs='', "
         "required_disk_space='0', required_files='bar foo', "
         "required_kmods='', required_memory='1.00K', "
         "required_programs='', required_user='', timeout='300'}",
@@ -202,9 +202,9 @@ ATF_TEST_CASE_BODY(test_case__output)
         "metadata=metadata{allowed_architectures='', allowed_platforms='foo', "
         "custom.bar='baz', description='', execenv='', execenv_jail_params='', "
         "has_cleanup='false', "
-        "is_exclusive='false', "
-        "required_configs='', required_disk_space='0', required_files='', "
-        "required_kmods='', required_memory='0', "
+        "is_cacheable='false', is_exclusive='false', max_output_size='0', "
+        "max_retries='0', required_configs='', required_disk_space='0', "
+        "required_files='', required_kmods='', required_memory='0', "
         "required_programs='', required_user='', timeout='300'}}",
         str.str());
 }
@@ -545,7 +545,8 @@ check_output__no_test_cases(void)
         "root='/the/root', test_suite='suite-name', "
         "metadata=metadata{allowed_architectures='a', allowed_platforms='', "
         "description='', execenv='', execenv_jail_params='', "
-        "has_cleanup='false', is_exclusive='false', "
+        "has_cleanup='false', is_cacheable='false', is_exclusive='false', "
+        "max_output_size='0', max_retries='0', "
         "required_configs='', required_disk_space='0', required_files='', "
         "required_kmods='', required_memory='0', "
         "required_programs='', required_user='', timeout='300'}, "
@@ -595,7 +596,8 @@ check_output__some_test_cases(void)
         "root='/the/root', test_suite='suite-name', "
         "metadata=metadata{allowed_architectures='a', allowed_platforms='', "
         "description='', execenv='', execenv_jail_params='', "
-        "has_cleanup='false', is_exclusive='false', "
+        "has_cleanup='false', is_cacheable='false', is_exclusive='false', "
+        "max_output_size='0', max_retries='0', "
         "required_configs='', required_disk_space='0', required_files='', "
         "required_kmods='', required_memory='0', "
         "required_programs='', required_user='', timeout='300'}, "
@@ -603,14 +605,16 @@ check_output__some_test_cases(void)
         "another-name=test_case{name='another-name', "
         "metadata=metadata{allowed_architectures='a', allowed_platforms='', "
         "description='', execenv='', execenv_jail_params='', "
-        "has_cleanup='false', is_exclusive='false', "
+        "has_cleanup='false', is_cacheable='false', is_exclusive='false', "
+        "max_output_size='0', max_retries='0', "
         "required_configs='', required_disk_space='0', required_files='', "
         "required_kmods='', required_memory='0', "
         "required_programs='', required_user='', timeout='300'}}, "
         "the-name=test_case{name='the-name', "
         "metadata=metadata{allowed_architectures='a', allowed_platforms='foo', "
         "custom.bar='baz', description='', execenv='', execenv_jail_params='', "
-        "has_cleanup='false', is_exclusive='false', "
+        "has_cleanup='false', is_cacheable='false', is_exclusive='false', "
+        "max_output_size='0', max_retries='0', "
         "required_configs='', required_disk_space='0', required_files='', "
         "required_kmods='', required_memory='0', "
         "required_programs='', required_user='', timeout='300'}})}",
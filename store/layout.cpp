@@ -30,6 +30,7 @@
 
 #include <algorithm>
 #include <cstring>
+#include <functional>
 
 #include "store/exceptions.hpp"
 #include "utils/datetime.hpp"
@@ -50,6 +51,7 @@ namespace fs = utils::fs;
 namespace layout = store::layout;
 namespace text = utils::text;
 
+using utils::none;
 using utils::optional;
 
 
@@ -67,39 +69,12 @@ namespace {
 static fs::path
 find_latest(const std::string& test_suite)
 {
-    const fs::path store_dir = layout::query_store_dir();
-    try {
-        const text::regex preg = text::regex::compile(
-            F("^results.%s.[0-9]{8}-[0-9]{6}-[0-9]{6}.db$") % test_suite, 0);
-
-        std::string latest;
-
-        const fs::directory dir(store_dir);
-        for (fs::directory::const_iterator iter = dir.begin();
-             iter != dir.end(); ++iter) {
-            const text::regex_matches matches = preg.match(iter->name);
-            if (matches) {
-                if (latest.empty() || iter->name > latest) {
-                    latest = iter->name;
-                }
-            } else {
-                // Not a database file; skip.
-            }
-        }
-
-        if (latest.empty())
-            throw store::error(
-                F("No previous results file found for test suite %s")
-                % test_suite);
-
-        return store_dir / latest;
-    } catch (const fs::system_error& e) {
-        LW(F("Failed to open store dir %s: %s") % store_dir % e.what());
+    const std::vector< fs::path > recent = layout::find_recent_results(
+        test_suite, 1);
+    if (recent.empty())
         throw store::error(F("No previous results file found for test suite %s")
                            % test_suite);
-    } catch (const text::regex_error& e) {
-        throw store::error(e.what());
-    }
+    return recent[0];
 }
 
 
@@ -172,6 +147,54 @@ layout::find_results(const std::string& id)
 }
 
 
+/// Finds the results files for the most recent runs of the given test suite.
+///
+/// \param test_suite Identifier of the test suite to query.
+/// \param max_count Maximum number of results files to return.
+///
+/// \return Paths to the located databases, most recent first.  The collection
+/// is empty if there are none.
+///
+/// \throw store::error If the test suite identifier is invalid.
+std::vector< fs::path >
+layout::find_recent_results(const std::string& test_suite,
+                            const std::size_t max_count)
+{
+    const fs::path store_dir = layout::query_store_dir();
+    try {
+        const text::regex preg = text::regex::compile(
+            F("^results.%s.[0-9]{8}-[0-9]{6}-[0-9]{6}.db$") % test_suite, 0);
+
+        std::vector< std::string > names;
+
+        const fs::directory dir(store_dir);
+        for (fs::directory::const_iterator iter = dir.begin();
+             iter != dir.end(); ++iter) {
+            const text::regex_matches matches = preg.match(iter->name);
+            if (matches) {
+                names.push_back(iter->name);
+            } else {
+                // Not a database file; skip.
+            }
+        }
+        std::sort(names.begin(), names.end(), std::greater< std::string >());
+        if (names.size() > max_count)
+            names.resize(max_count);
+
+        std::vector< fs::path > recent;
+        for (std::vector< std::string >::const_iterator iter = names.begin();
+             iter != names.end(); ++iter)
+            recent.push_back(store_dir / *iter);
+        return recent;
+    } catch (const fs::system_error& e) {
+        LW(F("Failed to open store dir %s: %s") % store_dir % e.what());
+        return std::vector< fs::path >();
+    } catch (const text::regex_error& e) {
+        throw store::error(e.what());
+    }
+}
+
+
 /// Computes the path to a new database for the given test suite.
 ///
 /// \param id Identifier of the test suite to create.
@@ -220,6 +243,57 @@ layout::new_db_for_migration(const fs::path& root,
 }
 
 
+/// Gets the path to the default directory of the result cache.
+///
+/// Note that this function does not create the determined directory.  It is the
+/// responsibility of the caller to do so.
+///
+/// \return Path to the directory holding the result cache, or none if HOME is
+/// not defined.  Unlike the store, the cache is never placed in the current
+/// directory because it is shared across test suites.
+optional< fs::path >
+layout::query_cache_dir(void)
+{
+    const optional< fs::path > home = utils::get_home();
+    if (home) {
+        const fs::path& home_path = home.get();
+        if (home_path.is_absolute())
+            return utils::make_optional(home_path / ".kyua/cache");
+        else
+            return utils::make_optional(home_path.to_absolute() /
+                                        ".kyua/cache");
+    } else {
+        LW("HOME not defined; not using the result cache");
+        return none;
+    }
+}
+
+
+/// Gets the path to the default directory of the cache of evaluated Kyuafiles.
+///
+/// Note that this function does not create the determined directory.  It is the
+/// responsibility of the caller to do so.
+///
+/// \return Path to the directory holding the Kyuafile cache, or none if HOME is
+/// not defined.
+optional< fs::path >
+layout::query_kyuafile_cache_dir(void)
+{
+    const optional< fs::path > home = utils::get_home();
+    if (home) {
+        const fs::path& home_path = home.get();
+        if (home_path.is_absolute())
+            return utils::make_optional(home_path / ".kyua/kyuafiles");
+        else
+            return utils::make_optional(home_path.to_absolute() /
+                                        ".kyua/kyuafiles");
+    } else {
+        LW("HOME not defined; not caching the evaluated Kyuafiles");
+        return none;
+    }
+}
+
+
 /// Gets the path to the store directory.
 ///
 /// Note that this function does not create the determined directory.  It is the
@@ -59,9 +59,11 @@
 #include "store/layout_fwd.hpp"
 
 #include <string>
+#include <vector>
 
 #include "utils/datetime_fwd.hpp"
 #include "utils/fs/path_fwd.hpp"
+#include "utils/optional_fwd.hpp"
 
 namespace store {
 namespace layout {
@@ -71,9 +73,13 @@ extern const char* results_auto_create_name;
 extern const char* results_auto_open_name;
 
 utils::fs::path find_results(const std::string&);
+std::vector< utils::fs::path > find_recent_results(const std::string&,
+                                                   const std::size_t);
 results_id_file_pair new_db(const std::string&, const utils::fs::path&);
 utils::fs::path new_db_for_migration(const utils::fs::path&,
                                      const utils::datetime::timestamp&);
+utils::optional< utils::fs::path > query_cache_dir(void);
+utils::optional< utils::fs::path > query_kyuafile_cache_dir(void);
 utils::fs::path query_store_dir(void);
 std::string test_suite_for_path(const utils::fs::path&);
 
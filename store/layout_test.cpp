@@ -33,6 +33,7 @@ extern "C" {
 }
 
 #include <iostream>
+#include <vector>
 
 #include <atf-c++.hpp>
 
@@ -40,13 +41,17 @@ extern "C" {
 #include "store/layout.hpp"
 #include "utils/datetime.hpp"
 #include "utils/env.hpp"
+#include "utils/format/containers.ipp"
 #include "utils/fs/operations.hpp"
 #include "utils/fs/path.hpp"
+#include "utils/optional.ipp"
 
 namespace datetime = utils::datetime;
 namespace fs = utils::fs;
 namespace layout = store::layout;
 
+using utils::optional;
+
 
 ATF_TEST_CASE_WITHOUT_HEAD(find_results__latest);
 ATF_TEST_CASE_BODY(find_results__latest)
@@ -227,6 +232,40 @@ ATF_TEST_CASE_BODY(find_results__not_found)
 }
 
 
+ATF_TEST_CASE_WITHOUT_HEAD(find_recent_results__some);
+ATF_TEST_CASE_BODY(find_recent_results__some)
+{
+    const fs::path store_dir = layout::query_store_dir();
+    fs::mkdir_p(store_dir, 0755);
+
+    const std::string base = (store_dir / "results.the_suite.").str();
+    atf::utils::create_file(base + "20140613-194515-000000.db", "");
+    atf::utils::create_file(base + "20140614-194515-123456.db", "");
+    atf::utils::create_file(base + "20130614-194515-999999.db", "");
+    atf::utils::create_file(base + "invalid.db", "");
+    atf::utils::create_file((store_dir / "results.other_suite."
+                             "20150614-194515-000000.db").str(), "");
+
+    std::vector< fs::path > exp_recent;
+    exp_recent.push_back(fs::path(base + "20140614-194515-123456.db"));
+    exp_recent.push_back(fs::path(base + "20140613-194515-000000.db"));
+    ATF_REQUIRE_EQ(exp_recent, layout::find_recent_results("the_suite", 2));
+
+    exp_recent.push_back(fs::path(base + "20130614-194515-999999.db"));
+    ATF_REQUIRE_EQ(exp_recent, layout::find_recent_results("the_suite", 10));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(find_recent_results__none);
+ATF_TEST_CASE_BODY(find_recent_results__none)
+{
+    ATF_REQUIRE(layout::find_recent_results("the_suite", 10).empty());
+
+    fs::mkdir_p(layout::query_store_dir(), 0755);
+    ATF_REQUIRE(layout::find_recent_results("the_suite", 10).empty());
+}
+
+
 ATF_TEST_CASE_WITHOUT_HEAD(new_db__new);
 ATF_TEST_CASE_BODY(new_db__new)
 {
@@ -275,6 +314,56 @@ ATF_TEST_CASE_BODY(new_db_for_migration)
 }
 
 
+ATF_TEST_CASE_WITHOUT_HEAD(query_cache_dir__home_absolute);
+ATF_TEST_CASE_BODY(query_cache_dir__home_absolute)
+{
+    const fs::path home = fs::current_path() / "homedir";
+    utils::setenv("HOME", home.str());
+    const optional< fs::path > cache_dir = layout::query_cache_dir();
+    ATF_REQUIRE(cache_dir);
+    ATF_REQUIRE_EQ(home / ".kyua/cache", cache_dir.get());
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(query_cache_dir__home_relative);
+ATF_TEST_CASE_BODY(query_cache_dir__home_relative)
+{
+    const fs::path home("homedir");
+    utils::setenv("HOME", home.str());
+    const optional< fs::path > cache_dir = layout::query_cache_dir();
+    ATF_REQUIRE(cache_dir);
+    ATF_REQUIRE(cache_dir.get().is_absolute());
+    ATF_REQUIRE_MATCH((home / ".kyua/cache").str(), cache_dir.get().str());
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(query_cache_dir__no_home);
+ATF_TEST_CASE_BODY(query_cache_dir__no_home)
+{
+    utils::unsetenv("HOME");
+    ATF_REQUIRE(!layout::query_cache_dir());
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(query_kyuafile_cache_dir__home_absolute);
+ATF_TEST_CASE_BODY(query_kyuafile_cache_dir__home_absolute)
+{
+    const fs::path home = fs::current_path() / "homedir";
+    utils::setenv("HOME", home.str());
+    const optional< fs::path > cache_dir = layout::query_kyuafile_cache_dir();
+    ATF_REQUIRE(cache_dir);
+    ATF_REQUIRE_EQ(home / ".kyua/kyuafiles", cache_dir.get());
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(query_kyuafile_cache_dir__no_home);
+ATF_TEST_CASE_BODY(query_kyuafile_cache_dir__no_home)
+{
+    utils::unsetenv("HOME");
+    ATF_REQUIRE(!layout::query_kyuafile_cache_dir());
+}
+
+
 ATF_TEST_CASE_WITHOUT_HEAD(query_store_dir__home_absolute);
 ATF_TEST_CASE_BODY(query_store_dir__home_absolute)
 {
@@ -336,11 +425,20 @@ ATF_INIT_TEST_CASES(tcs)
     ATF_ADD_TEST_CASE(tcs, find_results__id_with_timestamp);
     ATF_ADD_TEST_CASE(tcs, find_results__not_found);
 
+    ATF_ADD_TEST_CASE(tcs, find_recent_results__some);
+    ATF_ADD_TEST_CASE(tcs, find_recent_results__none);
+
     ATF_ADD_TEST_CASE(tcs, new_db__new);
     ATF_ADD_TEST_CASE(tcs, new_db__explicit);
 
     ATF_ADD_TEST_CASE(tcs, new_db_for_migration);
 
+    ATF_ADD_TEST_CASE(tcs, query_cache_dir__home_absolute);
+    ATF_ADD_TEST_CASE(tcs, query_cache_dir__home_relative);
+    ATF_ADD_TEST_CASE(tcs, query_cache_dir__no_home);
+    ATF_ADD_TEST_CASE(tcs, query_kyuafile_cache_dir__home_absolute);
+    ATF_ADD_TEST_CASE(tcs, query_kyuafile_cache_dir__no_home);
+
     ATF_ADD_TEST_CASE(tcs, query_store_dir__home_absolute);
     ATF_ADD_TEST_CASE(tcs, query_store_dir__home_relative);
     ATF_ADD_TEST_CASE(tcs, query_store_dir__no_home);
@@ -282,6 +282,13 @@ store::migrate_schema(const utils::fs::path& file)
     for (i = version_from; i < first_chunked_schema_version - 1; ++i) {
         migrate_schema_step(file, i, i + 1);
     }
-    chunk_database(file);
-    INV(version_to == first_chunked_schema_version);
+    if (i < first_chunked_schema_version) {
+        // The results files extracted from the historical database are
+        // created with the current schema, so there is nothing else to do.
+        chunk_database(file);
+        return;
+    }
+    for (; i < version_to; ++i) {
+        migrate_schema_step(file, i, i + 1);
+    }
 }
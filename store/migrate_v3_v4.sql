@@ -0,0 +1,131 @@
+-- Copyright 2026 The Kyua Authors.
+-- All rights reserved.
+--
+-- Redistribution and use in source and binary forms, with or without
+-- modification, are permitted provided that the following conditions are
+-- met:
+--
+-- * Redistributions of source code must retain the above copyright
+--   notice, this list of conditions and the following disclaimer.
+-- * Redistributions in binary form must reproduce the above copyright
+--   notice, this list of conditions and the following disclaimer in the
+--   documentation and/or other materials provided with the distribution.
+-- * Neither the name of Google Inc. nor the names of its contributors
+--   may be used to endorse or promote products derived from this software
+--   without specific prior written permission.
+--
+-- THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+-- "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+-- LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+-- A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+-- OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+-- SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+-- LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+-- DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+-- THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+-- (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+-- OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+-- \file store/migrate_v3_v4.sql
+-- Migration of a database with version 3 of the schema to version 4.
+--
+-- Version 4 appeared in version 0.15 and its changes were:
+--
+-- * Addition of the test_resource_usage table.
+--
+-- * Addition of the phases table.
+--
+-- * Addition of the reruns table.
+--
+-- * Addition of the test_program_fingerprints and reused_results tables.
+--
+-- * Addition of the cached_results table.
+--
+-- * Addition of the test_result_attempts and test_result_attempt_files tables.
+--
+-- * Addition of the test_case_repetitions table.
+
+
+CREATE TABLE test_resource_usage (
+    test_case_id INTEGER NOT NULL REFERENCES test_cases,
+    phase TEXT NOT NULL,
+    user_time INTEGER NOT NULL,
+    system_time INTEGER NOT NULL,
+    max_rss INTEGER NOT NULL,
+    block_input INTEGER NOT NULL,
+    block_output INTEGER NOT NULL,
+    voluntary_ctxsw INTEGER NOT NULL,
+    involuntary_ctxsw INTEGER NOT NULL,
+    PRIMARY KEY (test_case_id, phase)
+);
+
+
+CREATE TABLE phases (
+    phase_id INTEGER PRIMARY KEY,
+    test_program_id INTEGER NOT NULL REFERENCES test_programs,
+    test_case_id INTEGER REFERENCES test_cases,
+    name TEXT NOT NULL,
+    slot INTEGER NOT NULL,
+    start_time TIMESTAMP NOT NULL,
+    end_time TIMESTAMP NOT NULL
+);
+
+
+CREATE INDEX index_phases_by_start_time
+    ON phases (start_time);
+
+
+CREATE TABLE reruns (
+    original_results_file TEXT NOT NULL
+);
+
+
+CREATE TABLE test_program_fingerprints (
+    test_program_id INTEGER PRIMARY KEY REFERENCES test_programs,
+    fingerprint TEXT NOT NULL
+);
+
+
+CREATE TABLE reused_results (
+    test_case_id INTEGER PRIMARY KEY REFERENCES test_cases,
+    original_results_file TEXT NOT NULL
+);
+
+
+CREATE TABLE cached_results (
+    test_case_id INTEGER PRIMARY KEY REFERENCES test_cases,
+    cache_key TEXT NOT NULL
+);
+
+
+CREATE TABLE test_result_attempts (
+    test_case_id INTEGER NOT NULL REFERENCES test_cases,
+    attempt INTEGER NOT NULL CHECK (attempt >= 1),
+    result_type TEXT NOT NULL,
+    result_reason TEXT,
+    start_time TIMESTAMP NOT NULL,
+    end_time TIMESTAMP NOT NULL,
+    PRIMARY KEY (test_case_id, attempt)
+);
+
+
+CREATE TABLE test_result_attempt_files (
+    test_case_id INTEGER NOT NULL,
+    attempt INTEGER NOT NULL,
+    file_name TEXT NOT NULL,
+    file_id INTEGER NOT NULL REFERENCES files,
+    PRIMARY KEY (test_case_id, attempt, file_name),
+    FOREIGN KEY (test_case_id, attempt) REFERENCES test_result_attempts
+);
+
+
+CREATE TABLE test_case_repetitions (
+    test_case_id INTEGER PRIMARY KEY REFERENCES test_cases,
+    runs INTEGER NOT NULL CHECK (runs >= 1),
+    failures INTEGER NOT NULL CHECK (failures >= 0 AND failures <= runs)
+);
+
+
+INSERT INTO metadata (timestamp, schema_version)
+    VALUES (strftime('%s', 'now'), 4);
+
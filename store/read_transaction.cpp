@@ -49,6 +49,7 @@ extern "C" {
 #include "utils/logging/macros.hpp"
 #include "utils/noncopyable.hpp"
 #include "utils/optional.ipp"
+#include "utils/process/resource_usage.hpp"
 #include "utils/sanity.hpp"
 #include "utils/sqlite/database.hpp"
 #include "utils/sqlite/exceptions.hpp"
@@ -59,6 +60,7 @@ namespace datetime = utils::datetime;
 namespace fs = utils::fs;
 namespace sqlite = utils::sqlite;
 
+using utils::none;
 using utils::optional;
 
 
@@ -437,6 +439,244 @@ store::results_iterator::stderr_contents(void) const
 }
 
 
+/// Gets the resources consumed by the phases of a test case.
+///
+/// \return A collection of resource usage records keyed by phase name.  This
+/// is empty if the test case ran on a system that did not report them.
+///
+/// \throw integrity_error If there is any problem in the loaded data.
+std::map< std::string, utils::process::resource_usage >
+store::results_iterator::resource_usages(void) const
+{
+    std::map< std::string, utils::process::resource_usage > usages;
+    try {
+        sqlite::statement stmt = _pimpl->_backend.database().create_statement(
+            "SELECT phase, user_time, system_time, max_rss, block_input, "
+            "    block_output, voluntary_ctxsw, involuntary_ctxsw "
+            "FROM test_resource_usage WHERE test_case_id == :test_case_id");
+        stmt.bind(":test_case_id",
+                  _pimpl->_stmt.safe_column_int64("test_case_id"));
+        while (stmt.step()) {
+            usages[stmt.safe_column_text("phase")] =
+                utils::process::resource_usage(
+                    column_delta(stmt, "user_time"),
+                    column_delta(stmt, "system_time"),
+                    stmt.safe_column_int64("max_rss"),
+                    stmt.safe_column_int64("block_input"),
+                    stmt.safe_column_int64("block_output"),
+                    stmt.safe_column_int64("voluntary_ctxsw"),
+                    stmt.safe_column_int64("involuntary_ctxsw"));
+        }
+    } catch (const sqlite::error& e) {
+        throw store::integrity_error(e.what());
+    }
+    return usages;
+}
+
+
+/// Checks whether the result of the test case was served from the cache.
+///
+/// \return True if the test case did not run because its result was found in
+/// the result cache; false otherwise.
+///
+/// \throw integrity_error If there is any problem in the loaded data.
+bool
+store::results_iterator::is_cached(void) const
+{
+    try {
+        sqlite::statement stmt = _pimpl->_backend.database().create_statement(
+            "SELECT test_case_id FROM cached_results "
+            "WHERE test_case_id == :test_case_id");
+        stmt.bind(":test_case_id",
+                  _pimpl->_stmt.safe_column_int64("test_case_id"));
+        return stmt.step();
+    } catch (const sqlite::error& e) {
+        throw store::integrity_error(e.what());
+    }
+}
+
+
+/// Gets the results of the attempts of the test case that were retried.
+///
+/// \return The results of the superseded attempts, in the order in which they
+/// ran.  This is empty if the test case was not retried.  The test case is
+/// flaky if this is not empty and result() is good.  For repeated test cases,
+/// these are the failed repetitions other than the one in result().
+///
+/// \throw integrity_error If there is any problem in the loaded data.
+std::vector< model::test_result >
+store::results_iterator::previous_attempts(void) const
+{
+    std::vector< model::test_result > attempts;
+    try {
+        sqlite::statement stmt = _pimpl->_backend.database().create_statement(
+            "SELECT result_type, result_reason FROM test_result_attempts "
+            "WHERE test_case_id == :test_case_id ORDER BY attempt");
+        stmt.bind(":test_case_id",
+                  _pimpl->_stmt.safe_column_int64("test_case_id"));
+        while (stmt.step())
+            attempts.push_back(parse_result(stmt, "result_type",
+                                            "result_reason"));
+    } catch (const sqlite::error& e) {
+        throw store::integrity_error(e.what());
+    }
+    return attempts;
+}
+
+
+/// Gets how many times the test case ran when the user asked to repeat it.
+///
+/// \return The number of runs and the number of those that did not yield a
+/// good result, or none if the test case was not repeated.
+///
+/// \throw integrity_error If there is any problem in the loaded data.
+optional< std::pair< int, int > >
+store::results_iterator::repetitions(void) const
+{
+    try {
+        sqlite::statement stmt = _pimpl->_backend.database().create_statement(
+            "SELECT runs, failures FROM test_case_repetitions "
+            "WHERE test_case_id == :test_case_id");
+        stmt.bind(":test_case_id",
+                  _pimpl->_stmt.safe_column_int64("test_case_id"));
+        if (!stmt.step())
+            return none;
+        return utils::make_optional(std::make_pair(
+            stmt.safe_column_int("runs"), stmt.safe_column_int("failures")));
+    } catch (const sqlite::error& e) {
+        throw store::integrity_error(e.what());
+    }
+}
+
+
+/// Internal implementation details for a phases_iterator.
+struct store::phases_iterator::impl : utils::noncopyable {
+    /// The statement to iterate on.
+    sqlite::statement _stmt;
+
+    /// Whether the iterator is still valid or not.
+    bool _valid;
+
+    /// Constructor.
+    ///
+    /// \param backend_ The store backend implementation.
+    impl(store::read_backend& backend_) :
+        _stmt(backend_.database().create_statement(
+            "SELECT test_programs.relative_path, test_cases.name AS tc_name, "
+            "    phases.name AS phase_name, phases.slot, "
+            "    phases.start_time, phases.end_time "
+            "FROM phases "
+            "    JOIN test_programs "
+            "    ON phases.test_program_id = test_programs.test_program_id "
+            "    LEFT JOIN test_cases "
+            "    ON phases.test_case_id = test_cases.test_case_id "
+            "ORDER BY phases.start_time, phases.phase_id"))
+    {
+        _valid = _stmt.step();
+    }
+};
+
+
+/// Constructor.
+///
+/// \param pimpl_ The internal implementation details of the iterator.
+store::phases_iterator::phases_iterator(std::shared_ptr< impl > pimpl_) :
+    _pimpl(pimpl_)
+{
+}
+
+
+/// Destructor.
+store::phases_iterator::~phases_iterator(void)
+{
+}
+
+
+/// Moves the iterator forward by one phase.
+///
+/// \return The iterator itself.
+store::phases_iterator&
+store::phases_iterator::operator++(void)
+{
+    _pimpl->_valid = _pimpl->_stmt.step();
+    return *this;
+}
+
+
+/// Checks whether the iterator is still valid.
+///
+/// \return True if there is more elements to iterate on, false otherwise.
+store::phases_iterator::operator bool(void) const
+{
+    return _pimpl->_valid;
+}
+
+
+/// Gets the path of the test program this phase belongs to.
+///
+/// \return The path to the test program relative to the test suite root.
+fs::path
+store::phases_iterator::test_program_path(void) const
+{
+    return fs::path(_pimpl->_stmt.safe_column_text("relative_path"));
+}
+
+
+/// Gets the name of the test case this phase belongs to.
+///
+/// \return The name of the test case, or none if the phase belongs to the
+/// test program as a whole.
+optional< std::string >
+store::phases_iterator::test_case_name(void) const
+{
+    const int id = _pimpl->_stmt.column_id("tc_name");
+    if (_pimpl->_stmt.column_type(id) == sqlite::type_null)
+        return none;
+    return utils::make_optional(_pimpl->_stmt.safe_column_text("tc_name"));
+}
+
+
+/// Gets the name of the phase.
+///
+/// \return The name of the phase, such as "listing" or "body".
+std::string
+store::phases_iterator::name(void) const
+{
+    return _pimpl->_stmt.safe_column_text("phase_name");
+}
+
+
+/// Gets the execution slot in which the phase ran.
+///
+/// \return The slot number, starting at 1, or 0 if the phase ran within the
+/// kyua process itself.
+int
+store::phases_iterator::slot(void) const
+{
+    return _pimpl->_stmt.safe_column_int("slot");
+}
+
+
+/// Gets the time when the phase started.
+///
+/// \return The start time of the phase.
+datetime::timestamp
+store::phases_iterator::start_time(void) const
+{
+    return column_timestamp(_pimpl->_stmt, "start_time");
+}
+
+
+/// Gets the time when the phase finished.
+///
+/// \return The end time of the phase.
+datetime::timestamp
+store::phases_iterator::end_time(void) const
+{
+    return column_timestamp(_pimpl->_stmt, "end_time");
+}
+
+
 /// Internal implementation for a store read-only transaction.
 struct store::read_transaction::impl : utils::noncopyable {
     /// The backend instance.
@@ -515,6 +755,55 @@ store::read_transaction::get_context(void)
 }
 
 
+/// Retrieves the results file whose failures this run retried.
+///
+/// \return The path to the original results file, or none if this run was not
+/// a rerun of a previous one.
+///
+/// \throw error If there is a problem loading the link.
+optional< fs::path >
+store::read_transaction::get_rerun_of(void)
+{
+    try {
+        sqlite::statement stmt = _pimpl->_db.create_statement(
+            "SELECT original_results_file FROM reruns");
+        if (!stmt.step())
+            return none;
+        return utils::make_optional(fs::path(
+            stmt.safe_column_text("original_results_file")));
+    } catch (const sqlite::error& e) {
+        throw error(F("Error loading rerun information: %s") % e.what());
+    }
+}
+
+
+/// Retrieves the fingerprints of the test programs.
+///
+/// \return A mapping of the relative paths of the test programs to their
+/// fingerprints.  Test programs without a fingerprint are not included.
+///
+/// \throw error If there is a problem loading the fingerprints.
+std::map< fs::path, std::string >
+store::read_transaction::get_test_program_fingerprints(void)
+{
+    std::map< fs::path, std::string > fingerprints;
+    try {
+        sqlite::statement stmt = _pimpl->_db.create_statement(
+            "SELECT relative_path, fingerprint "
+            "FROM test_programs NATURAL JOIN test_program_fingerprints");
+        while (stmt.step()) {
+            fingerprints.insert(std::make_pair(
+                fs::path(stmt.safe_column_text("relative_path")),
+                stmt.safe_column_text("fingerprint")));
+        }
+    } catch (const sqlite::error& e) {
+        throw error(F("Error loading test program fingerprints: %s") %
+                    e.what());
+    }
+    return fingerprints;
+}
+
+
 /// Creates a new iterator to scan tests results.
 ///
 /// \return The constructed iterator.
@@ -530,3 +819,20 @@ store::read_transaction::get_results(void)
         throw error(e.what());
     }
 }
+
+
+/// Creates a new iterator to scan the timeline of the action.
+///
+/// \return The constructed iterator.
+///
+/// \throw error If there is any problem constructing the iterator.
+store::phases_iterator
+store::read_transaction::get_phases(void)
+{
+    try {
+        return phases_iterator(std::shared_ptr< phases_iterator::impl >(
+           new phases_iterator::impl(_pimpl->_backend)));
+    } catch (const sqlite::error& e) {
+        throw error(e.what());
+    }
+}
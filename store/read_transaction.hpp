@@ -38,8 +38,11 @@ extern "C" {
 #include <stdint.h>
 }
 
+#include <map>
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "model/context_fwd.hpp"
 #include "model/test_program_fwd.hpp"
@@ -47,6 +50,9 @@ extern "C" {
 #include "store/read_backend_fwd.hpp"
 #include "store/read_transaction_fwd.hpp"
 #include "utils/datetime_fwd.hpp"
+#include "utils/fs/path_fwd.hpp"
+#include "utils/optional_fwd.hpp"
+#include "utils/process/resource_usage_fwd.hpp"
 
 namespace store {
 
@@ -89,6 +95,38 @@ public:
 
     std::string stdout_contents(void) const;
     std::string stderr_contents(void) const;
+    std::map< std::string, utils::process::resource_usage >
+    resource_usages(void) const;
+    bool is_cached(void) const;
+    std::vector< model::test_result > previous_attempts(void) const;
+    utils::optional< std::pair< int, int > > repetitions(void) const;
+};
+
+
+/// Iterator for the timeline of the phases of an action.
+///
+/// The phases are returned in chronological order of their start times.
+class phases_iterator {
+    struct impl;
+
+    /// Pointer to the shared internal implementation.
+    std::shared_ptr< impl > _pimpl;
+
+    friend class read_transaction;
+    phases_iterator(std::shared_ptr< impl >);
+
+public:
+    ~phases_iterator(void);
+
+    phases_iterator& operator++(void);
+    operator bool(void) const;
+
+    utils::fs::path test_program_path(void) const;
+    utils::optional< std::string > test_case_name(void) const;
+    std::string name(void) const;
+    int slot(void) const;
+    utils::datetime::timestamp start_time(void) const;
+    utils::datetime::timestamp end_time(void) const;
 };
 
 
@@ -111,7 +149,11 @@ public:
     void finish(void);
 
     model::context get_context(void);
+    utils::optional< utils::fs::path > get_rerun_of(void);
+    std::map< utils::fs::path, std::string > get_test_program_fingerprints(
+        void);
     results_iterator get_results(void);
+    phases_iterator get_phases(void);
 };
 
 
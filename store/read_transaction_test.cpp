@@ -45,6 +45,7 @@
 #include "utils/fs/path.hpp"
 #include "utils/logging/operations.hpp"
 #include "utils/optional.ipp"
+#include "utils/process/resource_usage.hpp"
 #include "utils/sqlite/database.hpp"
 #include "utils/sqlite/statement.ipp"
 
@@ -150,6 +151,100 @@ ATF_TEST_CASE_BODY(get_context__invalid_env_vars)
 }
 
 
+ATF_TEST_CASE(get_rerun_of__none);
+ATF_TEST_CASE_HEAD(get_rerun_of__none)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(get_rerun_of__none)
+{
+    store::write_backend::open_rw(fs::path("test.db"));  // Create database.
+    store::read_backend backend = store::read_backend::open_ro(
+        fs::path("test.db"));
+    store::read_transaction tx = backend.start_read();
+    ATF_REQUIRE(!tx.get_rerun_of());
+}
+
+
+ATF_TEST_CASE(get_rerun_of__some);
+ATF_TEST_CASE_HEAD(get_rerun_of__some)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(get_rerun_of__some)
+{
+    {
+        store::write_backend backend = store::write_backend::open_rw(
+            fs::path("test.db"));
+        store::write_transaction tx = backend.start_write();
+        tx.put_rerun_of(fs::path("/some/results.db"));
+        tx.commit();
+    }
+
+    store::read_backend backend = store::read_backend::open_ro(
+        fs::path("test.db"));
+    store::read_transaction tx = backend.start_read();
+    const utils::optional< fs::path > rerun_of = tx.get_rerun_of();
+    ATF_REQUIRE(rerun_of);
+    ATF_REQUIRE_EQ(fs::path("/some/results.db"), rerun_of.get());
+}
+
+
+ATF_TEST_CASE(get_test_program_fingerprints__none);
+ATF_TEST_CASE_HEAD(get_test_program_fingerprints__none)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(get_test_program_fingerprints__none)
+{
+    store::write_backend::open_rw(fs::path("test.db"));  // Create database.
+    store::read_backend backend = store::read_backend::open_ro(
+        fs::path("test.db"));
+    store::read_transaction tx = backend.start_read();
+    ATF_REQUIRE(tx.get_test_program_fingerprints().empty());
+}
+
+
+ATF_TEST_CASE(get_test_program_fingerprints__some);
+ATF_TEST_CASE_HEAD(get_test_program_fingerprints__some)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(get_test_program_fingerprints__some)
+{
+    {
+        store::write_backend backend = store::write_backend::open_rw(
+            fs::path("test.db"));
+        store::write_transaction tx = backend.start_write();
+        const int64_t id1 = tx.put_test_program(model::test_program_builder(
+            "plain", fs::path("a/prog1"), fs::path("/the/root"), "suite1")
+            .build());
+        tx.put_test_program(model::test_program_builder(
+            "plain", fs::path("a/prog2"), fs::path("/the/root"), "suite1")
+            .build());
+        const int64_t id3 = tx.put_test_program(model::test_program_builder(
+            "plain", fs::path("prog3"), fs::path("/the/root"), "suite1")
+            .build());
+        tx.put_test_program_fingerprint(id1, "first");
+        tx.put_test_program_fingerprint(id3, "third");
+        tx.commit();
+    }
+
+    store::read_backend backend = store::read_backend::open_ro(
+        fs::path("test.db"));
+    store::read_transaction tx = backend.start_read();
+
+    std::map< fs::path, std::string > exp_fingerprints;
+    exp_fingerprints[fs::path("a/prog1")] = "first";
+    exp_fingerprints[fs::path("prog3")] = "third";
+    ATF_REQUIRE(exp_fingerprints == tx.get_test_program_fingerprints());
+}
+
+
 ATF_TEST_CASE(get_results__none);
 ATF_TEST_CASE_HEAD(get_results__none)
 {
@@ -200,13 +295,18 @@ ATF_TEST_CASE_BODY(get_results__many)
         .add_test_case("main")
         .build();
     const model::test_result result_1(model::test_result_passed);
+    const model::test_result attempt_1(model::test_result_broken, "Crashed");
+    const utils::process::resource_usage usage_1(
+        datetime::delta(2, 0), datetime::delta(0, 300), 1024, 5, 6, 7, 8);
     {
         const int64_t tp_id = tx.put_test_program(test_program_1);
         const int64_t tc_id = tx.put_test_case(test_program_1, "main", tp_id);
         atf::utils::create_file("prog1.out", "stdout of prog1\n");
         tx.put_test_case_file("__STDOUT__", fs::path("prog1.out"), tc_id);
         tx.put_test_case_file("unused.txt", fs::path("unused.txt"), tc_id);
+        tx.put_attempt(attempt_1, tc_id, 1, start_time1, start_time1);
         tx.put_result(result_1, tc_id, start_time1, end_time1);
+        tx.put_resource_usage(tc_id, "body", usage_1);
     }
 
     const model::test_program test_program_2 = model::test_program_builder(
@@ -222,6 +322,8 @@ ATF_TEST_CASE_BODY(get_results__many)
         tx.put_test_case_file("__STDERR__", fs::path("prog2.err"), tc_id);
         tx.put_test_case_file("unused.txt", fs::path("unused.txt"), tc_id);
         tx.put_result(result_2, tc_id, start_time2, end_time2);
+        tx.put_cached_result(tc_id, "0123456789abcdef");
+        tx.put_repetitions(tc_id, 10, 1);
     }
 
     tx.commit();
@@ -239,6 +341,12 @@ ATF_TEST_CASE_BODY(get_results__many)
     ATF_REQUIRE_EQ(result_1, iter.result());
     ATF_REQUIRE_EQ(start_time1, iter.start_time());
     ATF_REQUIRE_EQ(end_time1, iter.end_time());
+    ATF_REQUIRE_EQ(1, iter.resource_usages().size());
+    ATF_REQUIRE_EQ(usage_1, iter.resource_usages()["body"]);
+    ATF_REQUIRE(!iter.is_cached());
+    ATF_REQUIRE_EQ(1, iter.previous_attempts().size());
+    ATF_REQUIRE_EQ(attempt_1, iter.previous_attempts()[0]);
+    ATF_REQUIRE(!iter.repetitions());
     ATF_REQUIRE(++iter);
     ATF_REQUIRE_EQ(test_program_2, *iter.test_program());
     ATF_REQUIRE_EQ("main", iter.test_case_name());
@@ -247,6 +355,83 @@ ATF_TEST_CASE_BODY(get_results__many)
     ATF_REQUIRE_EQ(result_2, iter.result());
     ATF_REQUIRE_EQ(start_time2, iter.start_time());
     ATF_REQUIRE_EQ(end_time2, iter.end_time());
+    ATF_REQUIRE(iter.resource_usages().empty());
+    ATF_REQUIRE(iter.is_cached());
+    ATF_REQUIRE(iter.previous_attempts().empty());
+    ATF_REQUIRE(iter.repetitions());
+    ATF_REQUIRE_EQ(10, iter.repetitions().get().first);
+    ATF_REQUIRE_EQ(1, iter.repetitions().get().second);
+    ATF_REQUIRE(!++iter);
+}
+
+
+ATF_TEST_CASE(get_phases__none);
+ATF_TEST_CASE_HEAD(get_phases__none)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(get_phases__none)
+{
+    store::write_backend::open_rw(fs::path("test.db"));  // Create database.
+    store::read_backend backend = store::read_backend::open_ro(
+        fs::path("test.db"));
+    store::read_transaction tx = backend.start_read();
+    store::phases_iterator iter = tx.get_phases();
+    ATF_REQUIRE(!iter);
+}
+
+
+ATF_TEST_CASE(get_phases__many);
+ATF_TEST_CASE_HEAD(get_phases__many)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(get_phases__many)
+{
+    store::write_backend backend = store::write_backend::open_rw(
+        fs::path("test.db"));
+
+    store::write_transaction tx = backend.start_write();
+
+    const model::test_program test_program = model::test_program_builder(
+        "plain", fs::path("a/prog1"), fs::path("/the/root"), "suite1")
+        .add_test_case("main")
+        .build();
+    const int64_t tp_id = tx.put_test_program(test_program);
+    const int64_t tc_id = tx.put_test_case(test_program, "main", tp_id);
+
+    const datetime::timestamp time1 = datetime::timestamp::from_values(
+        2012, 01, 30, 22, 10, 00, 0);
+    const datetime::timestamp time2 = datetime::timestamp::from_values(
+        2012, 01, 30, 22, 10, 01, 0);
+    const datetime::timestamp time3 = datetime::timestamp::from_values(
+        2012, 01, 30, 22, 10, 05, 500);
+    tx.put_phase(tp_id, utils::make_optional(tc_id), "body", 2, time2, time3);
+    tx.put_phase(tp_id, utils::none, "listing", 0, time1, time2);
+
+    tx.commit();
+    backend.close();
+
+    store::read_backend backend2 = store::read_backend::open_ro(
+        fs::path("test.db"));
+    store::read_transaction tx2 = backend2.start_read();
+    store::phases_iterator iter = tx2.get_phases();
+    ATF_REQUIRE(iter);
+    ATF_REQUIRE_EQ(fs::path("a/prog1"), iter.test_program_path());
+    ATF_REQUIRE(!iter.test_case_name());
+    ATF_REQUIRE_EQ("listing", iter.name());
+    ATF_REQUIRE_EQ(0, iter.slot());
+    ATF_REQUIRE_EQ(time1, iter.start_time());
+    ATF_REQUIRE_EQ(time2, iter.end_time());
+    ATF_REQUIRE(++iter);
+    ATF_REQUIRE_EQ(fs::path("a/prog1"), iter.test_program_path());
+    ATF_REQUIRE_EQ("main", iter.test_case_name().get());
+    ATF_REQUIRE_EQ("body", iter.name());
+    ATF_REQUIRE_EQ(2, iter.slot());
+    ATF_REQUIRE_EQ(time2, iter.start_time());
+    ATF_REQUIRE_EQ(time3, iter.end_time());
     ATF_REQUIRE(!++iter);
 }
 
@@ -257,6 +442,15 @@ ATF_INIT_TEST_CASES(tcs)
     ATF_ADD_TEST_CASE(tcs, get_context__invalid_cwd);
     ATF_ADD_TEST_CASE(tcs, get_context__invalid_env_vars);
 
+    ATF_ADD_TEST_CASE(tcs, get_rerun_of__none);
+    ATF_ADD_TEST_CASE(tcs, get_rerun_of__some);
+
+    ATF_ADD_TEST_CASE(tcs, get_test_program_fingerprints__none);
+    ATF_ADD_TEST_CASE(tcs, get_test_program_fingerprints__some);
+
     ATF_ADD_TEST_CASE(tcs, get_results__none);
     ATF_ADD_TEST_CASE(tcs, get_results__many);
+
+    ATF_ADD_TEST_CASE(tcs, get_phases__none);
+    ATF_ADD_TEST_CASE(tcs, get_phases__many);
 }
@@ -41,6 +41,7 @@
 #include "utils/datetime.hpp"
 #include "utils/env.hpp"
 #include "utils/format/macros.hpp"
+#include "utils/fs/operations.hpp"
 #include "utils/fs/path.hpp"
 #include "utils/logging/operations.hpp"
 #include "utils/sqlite/database.hpp"
@@ -480,6 +481,36 @@ MIGRATE_SCHEMA_TEST(1);
 MIGRATE_SCHEMA_TEST(2);
 
 
+ATF_TEST_CASE(migrate_schema__from_v3);
+ATF_TEST_CASE_HEAD(migrate_schema__from_v3)
+{
+    logging::set_inmemory();
+
+    std::string required_files =
+        testdata_file("schema_v3.sql").str() + " " +
+        testdata_file("testdata_v3_2.sql").str();
+    for (int i = 3; i < store::detail::current_schema_version; ++i)
+        required_files += " " + store::detail::migration_file(i, i + 1).str();
+
+    set_md_var("require.files", required_files);
+}
+ATF_TEST_CASE_BODY(migrate_schema__from_v3)
+{
+    const fs::path testpath("test.db");
+
+    sqlite::database db = sqlite::database::open(
+        testpath, sqlite::open_readwrite | sqlite::open_create);
+    db.exec(utils::read_file(testdata_file("schema_v3.sql")));
+    db.exec(utils::read_file(testdata_file("testdata_v3_2.sql")));
+    db.close();
+
+    store::migrate_schema(testpath);
+
+    ATF_REQUIRE(fs::exists(fs::path("test.db.v3.backup")));
+    check_action_2(testpath);
+}
+
+
 ATF_INIT_TEST_CASES(tcs)
 {
     ATF_ADD_TEST_CASE(tcs, current_schema_1);
@@ -489,4 +520,5 @@ ATF_INIT_TEST_CASES(tcs)
 
     ATF_ADD_TEST_CASE(tcs, migrate_schema__from_v1);
     ATF_ADD_TEST_CASE(tcs, migrate_schema__from_v2);
+    ATF_ADD_TEST_CASE(tcs, migrate_schema__from_v3);
 }
@@ -50,6 +50,7 @@ extern "C" {
 #include "utils/logging/macros.hpp"
 #include "utils/noncopyable.hpp"
 #include "utils/optional.ipp"
+#include "utils/process/resource_usage.hpp"
 #include "utils/sanity.hpp"
 #include "utils/stream.hpp"
 #include "utils/sqlite/database.hpp"
@@ -157,9 +158,13 @@ put_file(sqlite::database& db, const fs::path& path)
     if (!input)
         throw store::error(F("Cannot open file %s") % path);
 
+    optional< std::size_t > length;
     try {
-        if (utils::stream_length(input) == 0)
+        const std::size_t size = utils::stream_length(input);
+        if (size == 0)
             return none;
+        if (input.good())
+            length = size;
     } catch (const std::runtime_error& e) {
         // Skipping empty files is an optimization.  If we fail to calculate the
         // size of the file, just ignore the problem.  If there are real issues
@@ -171,7 +176,17 @@ put_file(sqlite::database& db, const fs::path& path)
     // consumption if we decide to store arbitrary files in the database (other
     // than stdout or stderr).  Should this happen, we need to investigate a
     // better way to feel blobs into SQLite.
-    const std::string contents = utils::read_stream(input);
+    std::string contents;
+    if (length) {
+        // Read the file in one go straight into its final buffer, which the
+        // statement below binds without copying.  The file may still be
+        // written to by leftover subprocesses, so only store what we sized.
+        contents.resize(length.get());
+        input.read(&contents[0], length.get());
+        contents.resize(input.gcount());
+    } else {
+        contents = utils::read_stream(input);
+    }
 
     sqlite::statement stmt = db.create_statement(
         "INSERT INTO files (contents) VALUES (:contents)");
@@ -275,6 +290,29 @@ store::write_transaction::put_context(const model::context& context)
 }
 
 
+/// Records that this run retries the test cases of a previous run.
+///
+/// \pre The original results file has not been put yet.
+///
+/// \param original_results_file Path to the results file from which the test
+///     cases to run were selected.
+///
+/// \throw error If there is any problem when talking to the database.
+void
+store::write_transaction::put_rerun_of(const fs::path& original_results_file)
+{
+    try {
+        sqlite::statement stmt = _pimpl->_db.create_statement(
+            "INSERT INTO reruns (original_results_file) "
+            "VALUES (:original_results_file)");
+        stmt.bind(":original_results_file", original_results_file.str());
+        stmt.step_without_results();
+    } catch (const sqlite::error& e) {
+        throw error(e.what());
+    }
+}
+
+
 /// Puts a test program into the database.
 ///
 /// \pre The test program has not been put yet.
@@ -316,6 +354,30 @@ store::write_transaction::put_test_program(
 }
 
 
+/// Puts the fingerprint of a test program into the database.
+///
+/// \param test_program_id The test program the fingerprint corresponds to.
+/// \param fingerprint The fingerprint of the test program.
+///
+/// \throw error If there is any problem when talking to the database.
+void
+store::write_transaction::put_test_program_fingerprint(
+    const int64_t test_program_id, const std::string& fingerprint)
+{
+    try {
+        sqlite::statement stmt = _pimpl->_db.create_statement(
+            "INSERT INTO test_program_fingerprints (test_program_id, "
+            "                                       fingerprint) "
+            "VALUES (:test_program_id, :fingerprint)");
+        stmt.bind(":test_program_id", test_program_id);
+        stmt.bind(":fingerprint", fingerprint);
+        stmt.step_without_results();
+    } catch (const sqlite::error& e) {
+        throw error(e.what());
+    }
+}
+
+
 /// Puts a test case into the database.
 ///
 /// \pre The test case has not been put yet.
@@ -438,3 +500,264 @@ store::write_transaction::put_result(const model::test_result& result,
         throw error(e.what());
     }
 }
+
+
+/// Stores the result of an attempt of a test case that was retried.
+///
+/// \param result The result of the superseded attempt.
+/// \param test_case_id The test case the attempt belongs to.
+/// \param attempt Number of the attempt, starting at 1.
+/// \param start_time The time when the attempt started to run.
+/// \param end_time The time when the attempt finished running.
+///
+/// \throw error If there is any problem when talking to the database.
+void
+store::write_transaction::put_attempt(const model::test_result& result,
+                                      const int64_t test_case_id,
+                                      const int attempt,
+                                      const datetime::timestamp& start_time,
+                                      const datetime::timestamp& end_time)
+{
+    PRE(attempt >= 1);
+
+    try {
+        sqlite::statement stmt = _pimpl->_db.create_statement(
+            "INSERT INTO test_result_attempts (test_case_id, attempt, "
+            "                                  result_type, result_reason, "
+            "                                  start_time, end_time) "
+            "VALUES (:test_case_id, :attempt, :result_type, :result_reason, "
+            "        :start_time, :end_time)");
+        stmt.bind(":test_case_id", test_case_id);
+        stmt.bind(":attempt", attempt);
+
+        store::bind_test_result_type(stmt, ":result_type", result.type());
+        if (result.reason().empty())
+            stmt.bind(":result_reason", sqlite::null());
+        else
+            stmt.bind(":result_reason", result.reason());
+
+        store::bind_timestamp(stmt, ":start_time", start_time);
+        store::bind_timestamp(stmt, ":end_time", end_time);
+
+        stmt.step_without_results();
+    } catch (const sqlite::error& e) {
+        throw error(e.what());
+    }
+}
+
+
+/// Stores a file generated by an attempt of a test case as a BLOB.
+///
+/// \pre The attempt has been put already.
+///
+/// \param name The name of the file to store in the database.  This needs to be
+///     unique per attempt and follows the same conventions as the names given
+///     to put_test_case_file().
+/// \param path The path to the file to be stored.
+/// \param test_case_id The identifier of the test case the attempt belongs to.
+/// \param attempt Number of the attempt this file belongs to.
+///
+/// \return The identifier of the stored file, or none if the file was empty.
+///
+/// \throw store::error If there are problems writing to the database.
+optional< int64_t >
+store::write_transaction::put_attempt_file(const std::string& name,
+                                           const fs::path& path,
+                                           const int64_t test_case_id,
+                                           const int attempt)
+{
+    LD(F("Storing %s (%s) of attempt %s of test case %s") % name % path %
+       attempt % test_case_id);
+    try {
+        const optional< int64_t > file_id = put_file(_pimpl->_db, path);
+        if (!file_id) {
+            LD("Not storing empty file");
+            return none;
+        }
+
+        sqlite::statement stmt = _pimpl->_db.create_statement(
+            "INSERT INTO test_result_attempt_files (test_case_id, attempt, "
+            "                                       file_name, file_id) "
+            "VALUES (:test_case_id, :attempt, :file_name, :file_id)");
+        stmt.bind(":test_case_id", test_case_id);
+        stmt.bind(":attempt", attempt);
+        stmt.bind(":file_name", name);
+        stmt.bind(":file_id", file_id.get());
+        stmt.step_without_results();
+
+        return optional< int64_t >(_pimpl->_db.last_insert_rowid());
+    } catch (const sqlite::error& e) {
+        throw error(e.what());
+    }
+}
+
+
+/// Records how many times a repeated test case ran and failed.
+///
+/// \pre The result of the test case has been put already.
+///
+/// \param test_case_id The test case that was repeated.
+/// \param runs Number of times the test case ran.
+/// \param failures Number of runs that did not yield a good result.
+///
+/// \throw error If there is any problem when talking to the database.
+void
+store::write_transaction::put_repetitions(const int64_t test_case_id,
+                                          const int runs, const int failures)
+{
+    PRE(runs >= 1);
+    PRE(failures >= 0 && failures <= runs);
+
+    try {
+        sqlite::statement stmt = _pimpl->_db.create_statement(
+            "INSERT INTO test_case_repetitions (test_case_id, runs, failures) "
+            "VALUES (:test_case_id, :runs, :failures)");
+        stmt.bind(":test_case_id", test_case_id);
+        stmt.bind(":runs", runs);
+        stmt.bind(":failures", failures);
+        stmt.step_without_results();
+    } catch (const sqlite::error& e) {
+        throw error(e.what());
+    }
+}
+
+
+/// Marks the result of a test case as carried over from a previous run.
+///
+/// \pre The result of the test case has been put already.
+///
+/// \param test_case_id The test case whose result was reused.
+/// \param original_results_file Path to the results file that holds the run
+///     from which the result was taken.
+///
+/// \throw error If there is any problem when talking to the database.
+void
+store::write_transaction::put_reused_result(
+    const int64_t test_case_id, const fs::path& original_results_file)
+{
+    try {
+        sqlite::statement stmt = _pimpl->_db.create_statement(
+            "INSERT INTO reused_results (test_case_id, original_results_file) "
+            "VALUES (:test_case_id, :original_results_file)");
+        stmt.bind(":test_case_id", test_case_id);
+        stmt.bind(":original_results_file", original_results_file.str());
+        stmt.step_without_results();
+    } catch (const sqlite::error& e) {
+        throw error(e.what());
+    }
+}
+
+
+/// Marks the result of a test case as served from the result cache.
+///
+/// \pre The result of the test case has been put already.
+///
+/// \param test_case_id The test case whose result comes from the cache.
+/// \param cache_key The key of the cache entry that held the result.
+///
+/// \throw error If there is any problem when talking to the database.
+void
+store::write_transaction::put_cached_result(const int64_t test_case_id,
+                                            const std::string& cache_key)
+{
+    try {
+        sqlite::statement stmt = _pimpl->_db.create_statement(
+            "INSERT INTO cached_results (test_case_id, cache_key) "
+            "VALUES (:test_case_id, :cache_key)");
+        stmt.bind(":test_case_id", test_case_id);
+        stmt.bind(":cache_key", cache_key);
+        stmt.step_without_results();
+    } catch (const sqlite::error& e) {
+        throw error(e.what());
+    }
+}
+
+
+/// Puts the resources consumed by one phase of a test case into the database.
+///
+/// \pre The usage for the given phase has not been put yet.
+///
+/// \param test_case_id The test case this usage corresponds to.
+/// \param phase Name of the phase that consumed the resources, such as "body"
+///     or "cleanup".
+/// \param usage The resources consumed by the phase.
+///
+/// \throw error If there is any problem when talking to the database.
+void
+store::write_transaction::put_resource_usage(
+    const int64_t test_case_id, const std::string& phase,
+    const utils::process::resource_usage& usage)
+{
+    try {
+        sqlite::statement stmt = _pimpl->_db.create_statement(
+            "INSERT INTO test_resource_usage (test_case_id, phase, "
+            "                                 user_time, system_time, "
+            "                                 max_rss, block_input, "
+            "                                 block_output, voluntary_ctxsw, "
+            "                                 involuntary_ctxsw) "
+            "VALUES (:test_case_id, :phase, :user_time, :system_time, "
+            "        :max_rss, :block_input, :block_output, "
+            "        :voluntary_ctxsw, :involuntary_ctxsw)");
+        stmt.bind(":test_case_id", test_case_id);
+        stmt.bind(":phase", phase);
+        store::bind_delta(stmt, ":user_time", usage.user_time);
+        store::bind_delta(stmt, ":system_time", usage.system_time);
+        stmt.bind(":max_rss", static_cast< int64_t >(usage.max_rss));
+        stmt.bind(":block_input", static_cast< int64_t >(usage.block_input));
+        stmt.bind(":block_output", static_cast< int64_t >(usage.block_output));
+        stmt.bind(":voluntary_ctxsw",
+                  static_cast< int64_t >(usage.voluntary_ctxsw));
+        stmt.bind(":involuntary_ctxsw",
+                  static_cast< int64_t >(usage.involuntary_ctxsw));
+        stmt.step_without_results();
+    } catch (const sqlite::error& e) {
+        throw error(e.what());
+    }
+}
+
+
+/// Puts a phase of the execution timeline into the database.
+///
+/// \param test_program_id The test program this phase corresponds to.
+/// \param test_case_id The test case this phase corresponds to, or none if the
+///     phase belongs to the test program as a whole.
+/// \param name Name of the phase, such as "listing" or "body".
+/// \param slot Execution slot in which the phase ran, starting at 1, or 0 if
+///     the phase ran synchronously within the caller.
+/// \param start_time The time when the phase started.
+/// \param end_time The time when the phase finished.
+///
+/// \return The identifier of the inserted phase.
+///
+/// \throw error If there is any problem when talking to the database.
+int64_t
+store::write_transaction::put_phase(const int64_t test_program_id,
+                                    const optional< int64_t > test_case_id,
+                                    const std::string& name,
+                                    const int slot,
+                                    const datetime::timestamp& start_time,
+                                    const datetime::timestamp& end_time)
+{
+    PRE(slot >= 0);
+
+    try {
+        sqlite::statement stmt = _pimpl->_db.create_statement(
+            "INSERT INTO phases (test_program_id, test_case_id, name, slot, "
+            "                    start_time, end_time) "
+            "VALUES (:test_program_id, :test_case_id, :name, :slot, "
+            "        :start_time, :end_time)");
+        stmt.bind(":test_program_id", test_program_id);
+        if (test_case_id)
+            stmt.bind(":test_case_id", test_case_id.get());
+        else
+            stmt.bind(":test_case_id", sqlite::null());
+        stmt.bind(":name", name);
+        stmt.bind(":slot", slot);
+        store::bind_timestamp(stmt, ":start_time", start_time);
+        store::bind_timestamp(stmt, ":end_time", end_time);
+        stmt.step_without_results();
+        return _pimpl->_db.last_insert_rowid();
+    } catch (const sqlite::error& e) {
+        throw error(e.what());
+    }
+}
@@ -48,6 +48,7 @@ extern "C" {
 #include "utils/datetime_fwd.hpp"
 #include "utils/fs/path_fwd.hpp"
 #include "utils/optional_fwd.hpp"
+#include "utils/process/resource_usage_fwd.hpp"
 
 namespace store {
 
@@ -72,7 +73,9 @@ public:
     void rollback(void);
 
     void put_context(const model::context&);
+    void put_rerun_of(const utils::fs::path&);
     int64_t put_test_program(const model::test_program&);
+    void put_test_program_fingerprint(const int64_t, const std::string&);
     int64_t put_test_case(const model::test_program&, const std::string&,
                           const int64_t);
     utils::optional< int64_t > put_test_case_file(const std::string&,
@@ -81,6 +84,21 @@ public:
     int64_t put_result(const model::test_result&, const int64_t,
                        const utils::datetime::timestamp&,
                        const utils::datetime::timestamp&);
+    void put_attempt(const model::test_result&, const int64_t, const int,
+                     const utils::datetime::timestamp&,
+                     const utils::datetime::timestamp&);
+    utils::optional< int64_t > put_attempt_file(const std::string&,
+                                                const utils::fs::path&,
+                                                const int64_t, const int);
+    void put_repetitions(const int64_t, const int, const int);
+    void put_reused_result(const int64_t, const utils::fs::path&);
+    void put_cached_result(const int64_t, const std::string&);
+    void put_resource_usage(const int64_t, const std::string&,
+                            const utils::process::resource_usage&);
+    int64_t put_phase(const int64_t, const utils::optional< int64_t >,
+                      const std::string&, const int,
+                      const utils::datetime::timestamp&,
+                      const utils::datetime::timestamp&);
 };
 
 
@@ -45,6 +45,7 @@
 #include "utils/fs/path.hpp"
 #include "utils/logging/operations.hpp"
 #include "utils/optional.ipp"
+#include "utils/process/resource_usage.hpp"
 #include "utils/sqlite/database.hpp"
 #include "utils/sqlite/exceptions.hpp"
 #include "utils/sqlite/statement.ipp"
@@ -54,6 +55,7 @@ namespace fs = utils::fs;
 namespace logging = utils::logging;
 namespace sqlite = utils::sqlite;
 
+using utils::none;
 using utils::optional;
 
 
@@ -168,6 +170,28 @@ ATF_TEST_CASE_BODY(rollback__ok)
 }
 
 
+ATF_TEST_CASE(put_rerun_of__ok);
+ATF_TEST_CASE_HEAD(put_rerun_of__ok)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(put_rerun_of__ok)
+{
+    store::write_backend backend = store::write_backend::open_rw(
+        fs::path("test.db"));
+    store::write_transaction tx = backend.start_write();
+    tx.put_rerun_of(fs::path("/a/results.db"));
+    tx.commit();
+
+    sqlite::statement stmt = backend.database().create_statement(
+        "SELECT original_results_file FROM reruns");
+    ATF_REQUIRE(stmt.step());
+    ATF_REQUIRE_EQ("/a/results.db", stmt.column_text(0));
+    ATF_REQUIRE(!stmt.step());
+}
+
+
 ATF_TEST_CASE(put_test_program__ok);
 ATF_TEST_CASE_HEAD(put_test_program__ok)
 {
@@ -208,6 +232,30 @@ ATF_TEST_CASE_BODY(put_test_program__ok)
 }
 
 
+ATF_TEST_CASE(put_test_program_fingerprint__ok);
+ATF_TEST_CASE_HEAD(put_test_program_fingerprint__ok)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(put_test_program_fingerprint__ok)
+{
+    store::write_backend backend = store::write_backend::open_rw(
+        fs::path("test.db"));
+    backend.database().exec("PRAGMA foreign_keys = OFF");
+    store::write_transaction tx = backend.start_write();
+    tx.put_test_program_fingerprint(15, "0123456789abcdef");
+    tx.commit();
+
+    sqlite::statement stmt = backend.database().create_statement(
+        "SELECT test_program_id, fingerprint FROM test_program_fingerprints");
+    ATF_REQUIRE(stmt.step());
+    ATF_REQUIRE_EQ(15, stmt.column_int64(0));
+    ATF_REQUIRE_EQ("0123456789abcdef", stmt.column_text(1));
+    ATF_REQUIRE(!stmt.step());
+}
+
+
 ATF_TEST_CASE(put_test_case__fail);
 ATF_TEST_CASE_HEAD(put_test_case__fail)
 {
@@ -395,13 +443,300 @@ ATF_TEST_CASE_BODY(put_result__fail)
 }
 
 
+ATF_TEST_CASE(put_attempt__ok);
+ATF_TEST_CASE_HEAD(put_attempt__ok)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(put_attempt__ok)
+{
+    store::write_backend backend = store::write_backend::open_rw(
+        fs::path("test.db"));
+    backend.database().exec("PRAGMA foreign_keys = OFF");
+    store::write_transaction tx = backend.start_write();
+    const datetime::timestamp zero = datetime::timestamp::from_microseconds(0);
+    tx.put_attempt(model::test_result(model::test_result_failed, "First"),
+                   312, 1, zero, zero);
+    tx.put_attempt(model::test_result(model::test_result_broken, "Second"),
+                   312, 2, zero, zero);
+    tx.commit();
+
+    sqlite::statement stmt = backend.database().create_statement(
+        "SELECT test_case_id, attempt, result_type, result_reason "
+        "FROM test_result_attempts ORDER BY attempt");
+    ATF_REQUIRE(stmt.step());
+    ATF_REQUIRE_EQ(312, stmt.column_int64(0));
+    ATF_REQUIRE_EQ(1, stmt.column_int(1));
+    ATF_REQUIRE_EQ("failed", stmt.column_text(2));
+    ATF_REQUIRE_EQ("First", stmt.column_text(3));
+    ATF_REQUIRE(stmt.step());
+    ATF_REQUIRE_EQ(312, stmt.column_int64(0));
+    ATF_REQUIRE_EQ(2, stmt.column_int(1));
+    ATF_REQUIRE_EQ("broken", stmt.column_text(2));
+    ATF_REQUIRE_EQ("Second", stmt.column_text(3));
+    ATF_REQUIRE(!stmt.step());
+}
+
+
+ATF_TEST_CASE(put_attempt__fail);
+ATF_TEST_CASE_HEAD(put_attempt__fail)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(put_attempt__fail)
+{
+    const model::test_result result(model::test_result_broken, "foo");
+
+    store::write_backend backend = store::write_backend::open_rw(
+        fs::path("test.db"));
+    store::write_transaction tx = backend.start_write();
+    const datetime::timestamp zero = datetime::timestamp::from_microseconds(0);
+    ATF_REQUIRE_THROW(store::error, tx.put_attempt(result, -1, 1, zero, zero));
+    tx.commit();
+}
+
+
+ATF_TEST_CASE(put_attempt_file__some);
+ATF_TEST_CASE_HEAD(put_attempt_file__some)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(put_attempt_file__some)
+{
+    const char contents[] = "This is a test!";
+
+    atf::utils::create_file("input.txt", contents);
+    atf::utils::create_file("empty.txt", "");
+
+    store::write_backend backend = store::write_backend::open_rw(
+        fs::path("test.db"));
+    backend.database().exec("PRAGMA foreign_keys = OFF");
+    store::write_transaction tx = backend.start_write();
+    ATF_REQUIRE(tx.put_attempt_file("__STDOUT__", fs::path("input.txt"),
+                                    312, 2));
+    ATF_REQUIRE(!tx.put_attempt_file("__STDERR__", fs::path("empty.txt"),
+                                     312, 2));
+    tx.commit();
+
+    sqlite::statement stmt = backend.database().create_statement(
+        "SELECT test_case_id, attempt, file_name, contents "
+        "FROM test_result_attempt_files NATURAL JOIN files");
+    ATF_REQUIRE(stmt.step());
+    ATF_REQUIRE_EQ(312, stmt.column_int64(0));
+    ATF_REQUIRE_EQ(2, stmt.column_int(1));
+    ATF_REQUIRE_EQ("__STDOUT__", stmt.column_text(2));
+    const sqlite::blob blob = stmt.column_blob(3);
+    ATF_REQUIRE(std::strlen(contents) == static_cast< std::size_t >(blob.size));
+    ATF_REQUIRE(std::memcmp(contents, blob.memory, blob.size) == 0);
+    ATF_REQUIRE(!stmt.step());
+}
+
+
+ATF_TEST_CASE(put_repetitions__ok);
+ATF_TEST_CASE_HEAD(put_repetitions__ok)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(put_repetitions__ok)
+{
+    store::write_backend backend = store::write_backend::open_rw(
+        fs::path("test.db"));
+    backend.database().exec("PRAGMA foreign_keys = OFF");
+    store::write_transaction tx = backend.start_write();
+    tx.put_repetitions(312, 500, 3);
+    tx.commit();
+
+    sqlite::statement stmt = backend.database().create_statement(
+        "SELECT test_case_id, runs, failures FROM test_case_repetitions");
+    ATF_REQUIRE(stmt.step());
+    ATF_REQUIRE_EQ(312, stmt.column_int64(0));
+    ATF_REQUIRE_EQ(500, stmt.column_int(1));
+    ATF_REQUIRE_EQ(3, stmt.column_int(2));
+    ATF_REQUIRE(!stmt.step());
+}
+
+
+ATF_TEST_CASE(put_reused_result__ok);
+ATF_TEST_CASE_HEAD(put_reused_result__ok)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(put_reused_result__ok)
+{
+    store::write_backend backend = store::write_backend::open_rw(
+        fs::path("test.db"));
+    backend.database().exec("PRAGMA foreign_keys = OFF");
+    store::write_transaction tx = backend.start_write();
+    tx.put_reused_result(312, fs::path("/a/results.db"));
+    tx.commit();
+
+    sqlite::statement stmt = backend.database().create_statement(
+        "SELECT test_case_id, original_results_file FROM reused_results");
+    ATF_REQUIRE(stmt.step());
+    ATF_REQUIRE_EQ(312, stmt.column_int64(0));
+    ATF_REQUIRE_EQ("/a/results.db", stmt.column_text(1));
+    ATF_REQUIRE(!stmt.step());
+}
+
+
+ATF_TEST_CASE(put_cached_result__ok);
+ATF_TEST_CASE_HEAD(put_cached_result__ok)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(put_cached_result__ok)
+{
+    store::write_backend backend = store::write_backend::open_rw(
+        fs::path("test.db"));
+    backend.database().exec("PRAGMA foreign_keys = OFF");
+    store::write_transaction tx = backend.start_write();
+    tx.put_cached_result(312, "0123456789abcdef");
+    tx.commit();
+
+    sqlite::statement stmt = backend.database().create_statement(
+        "SELECT test_case_id, cache_key FROM cached_results");
+    ATF_REQUIRE(stmt.step());
+    ATF_REQUIRE_EQ(312, stmt.column_int64(0));
+    ATF_REQUIRE_EQ("0123456789abcdef", stmt.column_text(1));
+    ATF_REQUIRE(!stmt.step());
+}
+
+
+ATF_TEST_CASE(put_resource_usage__ok);
+ATF_TEST_CASE_HEAD(put_resource_usage__ok)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(put_resource_usage__ok)
+{
+    store::write_backend backend = store::write_backend::open_rw(
+        fs::path("test.db"));
+    backend.database().exec("PRAGMA foreign_keys = OFF");
+    store::write_transaction tx = backend.start_write();
+    tx.put_resource_usage(
+        312, "body", utils::process::resource_usage(
+            datetime::delta(1, 500), datetime::delta(0, 20), 4096, 1, 2, 3, 4));
+    tx.put_resource_usage(
+        312, "cleanup", utils::process::resource_usage());
+    tx.commit();
+
+    sqlite::statement stmt = backend.database().create_statement(
+        "SELECT test_case_id, phase, user_time, system_time, max_rss, "
+        "    block_input, block_output, voluntary_ctxsw, involuntary_ctxsw "
+        "FROM test_resource_usage ORDER BY phase");
+
+    ATF_REQUIRE(stmt.step());
+    ATF_REQUIRE_EQ(312, stmt.column_int64(0));
+    ATF_REQUIRE_EQ("body", stmt.column_text(1));
+    ATF_REQUIRE_EQ(1000500, stmt.column_int64(2));
+    ATF_REQUIRE_EQ(20, stmt.column_int64(3));
+    ATF_REQUIRE_EQ(4096, stmt.column_int64(4));
+    ATF_REQUIRE_EQ(1, stmt.column_int64(5));
+    ATF_REQUIRE_EQ(2, stmt.column_int64(6));
+    ATF_REQUIRE_EQ(3, stmt.column_int64(7));
+    ATF_REQUIRE_EQ(4, stmt.column_int64(8));
+    ATF_REQUIRE(stmt.step());
+    ATF_REQUIRE_EQ(312, stmt.column_int64(0));
+    ATF_REQUIRE_EQ("cleanup", stmt.column_text(1));
+    ATF_REQUIRE(!stmt.step());
+}
+
+
+ATF_TEST_CASE(put_resource_usage__fail);
+ATF_TEST_CASE_HEAD(put_resource_usage__fail)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(put_resource_usage__fail)
+{
+    store::write_backend backend = store::write_backend::open_rw(
+        fs::path("test.db"));
+    store::write_transaction tx = backend.start_write();
+    ATF_REQUIRE_THROW(store::error, tx.put_resource_usage(
+        -1, "body", utils::process::resource_usage()));
+    tx.commit();
+}
+
+
+ATF_TEST_CASE(put_phase__ok);
+ATF_TEST_CASE_HEAD(put_phase__ok)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(put_phase__ok)
+{
+    store::write_backend backend = store::write_backend::open_rw(
+        fs::path("test.db"));
+    backend.database().exec("PRAGMA foreign_keys = OFF");
+    store::write_transaction tx = backend.start_write();
+    const datetime::timestamp start_time = datetime::timestamp::from_values(
+        2012, 01, 30, 22, 10, 00, 0);
+    const datetime::timestamp end_time = datetime::timestamp::from_values(
+        2012, 01, 30, 22, 15, 30, 123456);
+    const int64_t id1 = tx.put_phase(15, none, "listing", 0, start_time,
+                                     end_time);
+    const int64_t id2 = tx.put_phase(15, utils::make_optional(int64_t(312)),
+                                     "body", 3, start_time, end_time);
+    tx.commit();
+
+    sqlite::statement stmt = backend.database().create_statement(
+        "SELECT phase_id, test_program_id, test_case_id, name, slot, "
+        "    start_time, end_time FROM phases ORDER BY phase_id");
+
+    ATF_REQUIRE(stmt.step());
+    ATF_REQUIRE_EQ(id1, stmt.column_int64(0));
+    ATF_REQUIRE_EQ(15, stmt.column_int64(1));
+    ATF_REQUIRE(stmt.column_type(2) == sqlite::type_null);
+    ATF_REQUIRE_EQ("listing", stmt.column_text(3));
+    ATF_REQUIRE_EQ(0, stmt.column_int(4));
+    ATF_REQUIRE_EQ(start_time.to_microseconds(), stmt.column_int64(5));
+    ATF_REQUIRE_EQ(end_time.to_microseconds(), stmt.column_int64(6));
+    ATF_REQUIRE(stmt.step());
+    ATF_REQUIRE_EQ(id2, stmt.column_int64(0));
+    ATF_REQUIRE_EQ(312, stmt.column_int64(2));
+    ATF_REQUIRE_EQ("body", stmt.column_text(3));
+    ATF_REQUIRE_EQ(3, stmt.column_int(4));
+    ATF_REQUIRE(!stmt.step());
+}
+
+
+ATF_TEST_CASE(put_phase__fail);
+ATF_TEST_CASE_HEAD(put_phase__fail)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(put_phase__fail)
+{
+    store::write_backend backend = store::write_backend::open_rw(
+        fs::path("test.db"));
+    store::write_transaction tx = backend.start_write();
+    const datetime::timestamp zero = datetime::timestamp::from_microseconds(0);
+    ATF_REQUIRE_THROW(store::error, tx.put_phase(-1, none, "listing", 0, zero,
+                                                 zero));
+    tx.commit();
+}
+
+
 ATF_INIT_TEST_CASES(tcs)
 {
     ATF_ADD_TEST_CASE(tcs, commit__ok);
     ATF_ADD_TEST_CASE(tcs, commit__fail);
     ATF_ADD_TEST_CASE(tcs, rollback__ok);
 
+    ATF_ADD_TEST_CASE(tcs, put_rerun_of__ok);
+
     ATF_ADD_TEST_CASE(tcs, put_test_program__ok);
+    ATF_ADD_TEST_CASE(tcs, put_test_program_fingerprint__ok);
     ATF_ADD_TEST_CASE(tcs, put_test_case__fail);
     ATF_ADD_TEST_CASE(tcs, put_test_case_file__empty);
     ATF_ADD_TEST_CASE(tcs, put_test_case_file__some);
@@ -413,4 +748,18 @@ ATF_INIT_TEST_CASES(tcs)
     ATF_ADD_TEST_CASE(tcs, put_result__ok__passed);
     ATF_ADD_TEST_CASE(tcs, put_result__ok__skipped);
     ATF_ADD_TEST_CASE(tcs, put_result__fail);
+
+    ATF_ADD_TEST_CASE(tcs, put_attempt__ok);
+    ATF_ADD_TEST_CASE(tcs, put_attempt__fail);
+    ATF_ADD_TEST_CASE(tcs, put_attempt_file__some);
+    ATF_ADD_TEST_CASE(tcs, put_repetitions__ok);
+
+    ATF_ADD_TEST_CASE(tcs, put_reused_result__ok);
+    ATF_ADD_TEST_CASE(tcs, put_cached_result__ok);
+
+    ATF_ADD_TEST_CASE(tcs, put_resource_usage__ok);
+    ATF_ADD_TEST_CASE(tcs, put_resource_usage__fail);
+
+    ATF_ADD_TEST_CASE(tcs, put_phase__ok);
+    ATF_ADD_TEST_CASE(tcs, put_phase__fail);
 }
@@ -63,7 +63,8 @@ cmdline::base_option::base_option(const char short_name_,
     _description(description_),
     _arg_name(arg_name_ == NULL ? "" : arg_name_),
     _has_default_value(default_value_ != NULL),
-    _default_value(default_value_ == NULL ? "" : default_value_)
+    _default_value(default_value_ == NULL ? "" : default_value_),
+    _optional_arg(false)
 {
     INV(short_name_ != '\0');
 }
@@ -78,17 +79,24 @@ cmdline::base_option::base_option(const char short_name_,
 ///     purposes.
 /// \param default_value_ If not NULL, specifies that the option has a default
 ///     value for the mandatory argument.
+/// \param optional_arg_ If true, the argument can be omitted from the command
+///     line, in which case the option takes the default value.  Otherwise, the
+///     default value is used only when the option is not given at all.
 cmdline::base_option::base_option(const char* long_name_,
                                   const char* description_,
                                   const char* arg_name_,
-                                  const char* default_value_) :
+                                  const char* default_value_,
+                                  const bool optional_arg_) :
     _short_name('\0'),
     _long_name(long_name_),
     _description(description_),
     _arg_name(arg_name_ == NULL ? "" : arg_name_),
     _has_default_value(default_value_ != NULL),
-    _default_value(default_value_ == NULL ? "" : default_value_)
+    _default_value(default_value_ == NULL ? "" : default_value_),
+    _optional_arg(optional_arg_)
 {
+    PRE_MSG(!optional_arg_ || (arg_name_ != NULL && default_value_ != NULL),
+            "Optional arguments need a default value");
 }
 
 
@@ -164,6 +172,17 @@ cmdline::base_option::arg_name(void) const
 }
 
 
+/// Checks whether the argument of the option can be omitted.
+///
+/// \return True if the option accepts being given without an argument, in
+/// which case its value is the default one; false otherwise.
+bool
+cmdline::base_option::has_optional_arg(void) const
+{
+    return _optional_arg;
+}
+
+
 /// Checks whether the option has a default value for its argument.
 ///
 /// \pre needs_arg() must be true.
@@ -213,7 +232,10 @@ std::string
 cmdline::base_option::format_long_name(void) const
 {
     if (needs_arg()) {
-        return F("--%s=%s") % long_name() % arg_name();
+        if (has_optional_arg())
+            return F("--%s[=%s]") % long_name() % arg_name();
+        else
+            return F("--%s=%s") % long_name() % arg_name();
     } else {
         return F("--%s") % long_name();
     }
@@ -573,11 +595,15 @@ cmdline::string_option::string_option(const char short_name_,
 ///     purposes.
 /// \param default_value_ If not NULL, the default value for the mandatory
 ///     argument.
+/// \param optional_arg_ If true, the argument can be omitted from the command
+///     line, in which case the option takes the default value.
 cmdline::string_option::string_option(const char* long_name_,
                                       const char* description_,
                                       const char* arg_name_,
-                                      const char* default_value_) :
-    base_option(long_name_, description_, arg_name_, default_value_)
+                                      const char* default_value_,
+                                      const bool optional_arg_) :
+    base_option(long_name_, description_, arg_name_, default_value_,
+                optional_arg_)
 {
 }
 
@@ -99,11 +99,15 @@ class base_option {
     /// If _has_default_value is true, the default value.
     std::string _default_value;
 
+    /// Whether the argument can be omitted, in which case the default value is
+    /// used.
+    bool _optional_arg;
+
 public:
     base_option(const char, const char*, const char*, const char* = NULL,
                 const char* = NULL);
     base_option(const char*, const char*, const char* = NULL,
-                const char* = NULL);
+                const char* = NULL, const bool = false);
     virtual ~base_option(void);
 
     bool has_short_name(void) const;
@@ -113,6 +117,7 @@ public:
 
     bool needs_arg(void) const;
     const std::string& arg_name(void) const;
+    bool has_optional_arg(void) const;
 
     bool has_default_value(void) const;
     const std::string& default_value(void) const;
@@ -220,7 +225,8 @@ class string_option : public base_option {
 public:
     string_option(const char, const char*, const char*, const char*,
                   const char* = NULL);
-    string_option(const char*, const char*, const char*, const char* = NULL);
+    string_option(const char*, const char*, const char*, const char* = NULL,
+                  const bool = false);
     virtual ~string_option(void) {}
 
     /// The data type of this option.
@@ -68,10 +68,13 @@ public:
     ///     purposes.
     /// \param default_value_ If not NULL, specifies that the option has a
     ///     default value for the mandatory argument.
+    /// \param optional_arg_ If true, the argument can be omitted.
     mock_option(const char* long_name_,
                   const char* description_, const char* arg_name_ = NULL,
-                  const char* default_value_ = NULL) :
-        base_option(long_name_, description_, arg_name_, default_value_) {}
+                  const char* default_value_ = NULL,
+                  const bool optional_arg_ = false) :
+        base_option(long_name_, description_, arg_name_, default_value_,
+                    optional_arg_) {}
 
     /// The data type of this option.
     typedef std::string option_type;
@@ -190,6 +193,21 @@ ATF_TEST_CASE_BODY(base_option__long_name__with_arg__with_default)
 }
 
 
+ATF_TEST_CASE_WITHOUT_HEAD(base_option__long_name__with_optional_arg);
+ATF_TEST_CASE_BODY(base_option__long_name__with_optional_arg)
+{
+    const mock_option o("input", "Input file", "file", "-", true);
+    ATF_REQUIRE(!o.has_short_name());
+    ATF_REQUIRE_EQ("input", o.long_name());
+    ATF_REQUIRE(o.needs_arg());
+    ATF_REQUIRE(o.has_optional_arg());
+    ATF_REQUIRE_EQ("file", o.arg_name());
+    ATF_REQUIRE(o.has_default_value());
+    ATF_REQUIRE_EQ("-", o.default_value());
+    ATF_REQUIRE_EQ("--input[=file]", o.format_long_name());
+}
+
+
 ATF_TEST_CASE_WITHOUT_HEAD(bool_option__short_name);
 ATF_TEST_CASE_BODY(bool_option__short_name)
 {
@@ -500,6 +518,7 @@ ATF_INIT_TEST_CASES(tcs)
     ATF_ADD_TEST_CASE(tcs, base_option__long_name__no_arg);
     ATF_ADD_TEST_CASE(tcs, base_option__long_name__with_arg__no_default);
     ATF_ADD_TEST_CASE(tcs, base_option__long_name__with_arg__with_default);
+    ATF_ADD_TEST_CASE(tcs, base_option__long_name__with_optional_arg);
 
     ATF_ADD_TEST_CASE(tcs, bool_option__short_name);
     ATF_ADD_TEST_CASE(tcs, bool_option__long_name);
@@ -87,7 +87,9 @@ options_to_getopt_data(const cmdline::options_vector& options,
         ::option& long_option = data.long_options[i];
 
         long_option.name = option->long_name().c_str();
-        if (option->needs_arg())
+        if (option->needs_arg() && option->has_optional_arg())
+            long_option.has_arg = optional_argument;
+        else if (option->needs_arg())
             long_option.has_arg = required_argument;
         else
             long_option.has_arg = no_argument;
@@ -320,7 +322,8 @@ cmdline::parse(const int argc, const char* const* argv,
     for (cmdline::options_vector::const_iterator iter = options.begin();
          iter != options.end(); iter++) {
         const cmdline::base_option* option = *iter;
-        if (option->needs_arg() && option->has_default_value())
+        if (option->needs_arg() && option->has_default_value() &&
+            !option->has_optional_arg())
             option_values[option->long_name()].push_back(
                 option->default_value());
     }
@@ -357,8 +360,11 @@ cmdline::parse(const int argc, const char* const* argv,
                 if (::optarg != NULL) {
                     option->validate(::optarg);
                     option_values[option->long_name()].push_back(::optarg);
-                } else
-                    INV(option->has_default_value());
+                } else {
+                    INV(option->has_optional_arg());
+                    option_values[option->long_name()].push_back(
+                        option->default_value());
+                }
             } else {
                 option_values[option->long_name()].push_back("");
             }
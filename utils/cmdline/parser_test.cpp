@@ -404,6 +404,34 @@ ATF_TEST_CASE_BODY(some_options__multi)
 }
 
 
+ATF_TEST_CASE_WITHOUT_HEAD(some_options__optional_arg);
+ATF_TEST_CASE_BODY(some_options__optional_arg)
+{
+    const string_option a("a_long", "Description", "arg", "default", true);
+    const string_option b("b_long", "Description", "arg", "default", true);
+    const string_option c("c_long", "Description", "arg", "default", true);
+    std::vector< const base_option* > options;
+    options.push_back(&a);
+    options.push_back(&b);
+    options.push_back(&c);
+
+    const int argc = 5;
+    const char* const argv[] = {
+        "progname", "--a_long", "--b_long=value", "arg1", "arg2", NULL,
+    };
+    const parsed_cmdline cmdline = parse(argc, argv, options);
+
+    ATF_REQUIRE(cmdline.has_option("a_long"));
+    ATF_REQUIRE_EQ("default", cmdline.get_option< string_option >("a_long"));
+    ATF_REQUIRE(cmdline.has_option("b_long"));
+    ATF_REQUIRE_EQ("value", cmdline.get_option< string_option >("b_long"));
+    ATF_REQUIRE(!cmdline.has_option("c_long"));
+    ATF_REQUIRE_EQ(2, cmdline.arguments().size());
+    ATF_REQUIRE_EQ("arg1", cmdline.arguments()[0]);
+    ATF_REQUIRE_EQ("arg2", cmdline.arguments()[1]);
+}
+
+
 ATF_TEST_CASE_WITHOUT_HEAD(subcommands);
 ATF_TEST_CASE_BODY(subcommands)
 {
@@ -674,6 +702,7 @@ ATF_INIT_TEST_CASES(tcs)
     ATF_ADD_TEST_CASE(tcs, some_args__some_options);
     ATF_ADD_TEST_CASE(tcs, some_options__all_known);
     ATF_ADD_TEST_CASE(tcs, some_options__multi);
+    ATF_ADD_TEST_CASE(tcs, some_options__optional_arg);
     ATF_ADD_TEST_CASE(tcs, subcommands);
     ATF_ADD_TEST_CASE(tcs, missing_option_argument_error__short);
     ATF_ADD_TEST_CASE(tcs, missing_option_argument_error__shortblock);
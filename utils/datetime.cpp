@@ -40,6 +40,8 @@ extern "C" {
 #include "utils/optional.ipp"
 #include "utils/noncopyable.hpp"
 #include "utils/sanity.hpp"
+#include "utils/text/exceptions.hpp"
+#include "utils/text/operations.ipp"
 
 namespace datetime = utils::datetime;
 
@@ -103,6 +105,51 @@ datetime::delta::from_microseconds(const int64_t useconds)
 }
 
 
+/// Parses a time delta from a user-provided string.
+///
+/// \param in_str The string to parse.  This is an amount of seconds, optionally
+///     followed by one of the 's', 'm', 'h' or 'd' suffixes to express the
+///     amount in seconds, minutes, hours or days respectively.
+///
+/// \return The parsed time delta.
+///
+/// \throw std::runtime_error If the input string is empty or invalid.
+datetime::delta
+datetime::delta::parse(const std::string& in_str)
+{
+    if (in_str.empty())
+        throw std::runtime_error("Time delta cannot be empty");
+
+    int64_t multiplier;
+    std::string str = in_str;
+    {
+        const char unit = str[str.length() - 1];
+        switch (unit) {
+        case 'd': multiplier = 24 * 60 * 60; break;
+        case 'h': multiplier = 60 * 60; break;
+        case 'm': multiplier = 60; break;
+        case 's': multiplier = 1; break;
+        default: multiplier = 0;
+        }
+        if (multiplier != 0)
+            str.erase(str.length() - 1);
+        else
+            multiplier = 1;
+    }
+
+    int64_t count;
+    try {
+        count = text::to_type< int64_t >(str);
+    } catch (const text::value_error& e) {
+        throw std::runtime_error(F("Invalid time delta '%s'") % in_str);
+    }
+    if (count < 0)
+        throw std::runtime_error(F("Invalid time delta '%s'") % in_str);
+
+    return delta(count * multiplier, 0);
+}
+
+
 /// Convers the delta to a flat representation expressed in microseconds.
 ///
 /// \return The amount of microseconds that corresponds to this delta.
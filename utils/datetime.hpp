@@ -64,6 +64,7 @@ public:
     delta(const int64_t, const unsigned long);
 
     static delta from_microseconds(const int64_t);
+    static delta parse(const std::string&);
     int64_t to_microseconds(void) const;
 
     bool operator==(const delta&) const;
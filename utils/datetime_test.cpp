@@ -102,6 +102,36 @@ ATF_TEST_CASE_BODY(delta__from_microseconds)
 }
 
 
+ATF_TEST_CASE_WITHOUT_HEAD(delta__parse__ok);
+ATF_TEST_CASE_BODY(delta__parse__ok)
+{
+    ATF_REQUIRE_EQ(datetime::delta(0, 0), datetime::delta::parse("0"));
+    ATF_REQUIRE_EQ(datetime::delta(45, 0), datetime::delta::parse("45"));
+    ATF_REQUIRE_EQ(datetime::delta(45, 0), datetime::delta::parse("45s"));
+    ATF_REQUIRE_EQ(datetime::delta(120, 0), datetime::delta::parse("2m"));
+    ATF_REQUIRE_EQ(datetime::delta(10800, 0), datetime::delta::parse("3h"));
+    ATF_REQUIRE_EQ(datetime::delta(86400, 0), datetime::delta::parse("1d"));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(delta__parse__bad);
+ATF_TEST_CASE_BODY(delta__parse__bad)
+{
+    ATF_REQUIRE_THROW_RE(std::runtime_error, "cannot be empty",
+                         datetime::delta::parse(""));
+    ATF_REQUIRE_THROW_RE(std::runtime_error, "Invalid time delta 'm'",
+                         datetime::delta::parse("m"));
+    ATF_REQUIRE_THROW_RE(std::runtime_error, "Invalid time delta '-5'",
+                         datetime::delta::parse("-5"));
+    ATF_REQUIRE_THROW_RE(std::runtime_error, "Invalid time delta '1.5h'",
+                         datetime::delta::parse("1.5h"));
+    ATF_REQUIRE_THROW_RE(std::runtime_error, "Invalid time delta '5 m'",
+                         datetime::delta::parse("5 m"));
+    ATF_REQUIRE_THROW_RE(std::runtime_error, "Invalid time delta '2w'",
+                         datetime::delta::parse("2w"));
+}
+
+
 ATF_TEST_CASE_WITHOUT_HEAD(delta__to_microseconds);
 ATF_TEST_CASE_BODY(delta__to_microseconds)
 {
@@ -561,6 +591,8 @@ ATF_INIT_TEST_CASES(tcs)
     ATF_ADD_TEST_CASE(tcs, delta__defaults);
     ATF_ADD_TEST_CASE(tcs, delta__overrides);
     ATF_ADD_TEST_CASE(tcs, delta__from_microseconds);
+    ATF_ADD_TEST_CASE(tcs, delta__parse__ok);
+    ATF_ADD_TEST_CASE(tcs, delta__parse__bad);
     ATF_ADD_TEST_CASE(tcs, delta__to_microseconds);
     ATF_ADD_TEST_CASE(tcs, delta__equals);
     ATF_ADD_TEST_CASE(tcs, delta__differs);
@@ -26,11 +26,13 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
-#include "utils/format/formatter.hpp"
+#include "utils/format/formatter.ipp"
 
-#include <memory>
+#include <cstring>
 #include <string>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "utils/format/exceptions.hpp"
 #include "utils/sanity.hpp"
@@ -44,177 +46,273 @@ namespace text = utils::text;
 namespace {
 
 
+/// A formatting placeholder within a parsed format string.
+struct placeholder {
+    /// Literal text between the previous placeholder and this one.
+    ///
+    /// Any '%%' in the original format string has already been replaced by a
+    /// single '%'.
+    std::string prefix;
+
+    /// Position of the placeholder in the original format string.
+    std::string::size_type position;
+
+    /// Whether the placeholder is a bare '%s' that needs no stream tweaks.
+    bool plain;
+
+    /// Whether the value has to be padded with zeros instead of spaces.
+    bool zero_fill;
+
+    /// The minimum width of the value, or -1 if not specified.
+    int width;
+
+    /// The precision of floating point values, or -1 if not specified.
+    int precision;
+};
+
+
+}  // anonymous namespace
+
+
+/// Representation of a format string parsed ahead of time.
+///
+/// Errors in the format string are not raised during parsing.  Instead, they
+/// are recorded and raised once the formatter reaches the problematic
+/// placeholder, just as if the format string was parsed incrementally.  This
+/// allows callers to build partial expansions of malformed strings.
+struct utils::format::detail::compiled_format {
+    /// The original format string provided by the user.
+    std::string format;
+
+    /// The valid placeholders in the format string, in order.
+    std::vector< placeholder > placeholders;
+
+    /// Literal text after the last placeholder, with '%%' already replaced.
+    std::string suffix;
+
+    /// Error found after the last valid placeholder, if any.
+    std::string error;
+
+    /// Parses a format string.
+    ///
+    /// \param format_ The format string to parse.
+    explicit compiled_format(const std::string& format_);
+};
+
+
+namespace {
+
+
+/// Maximum number of parsed format strings to keep in the cache.
+///
+/// The cache is keyed by the address of the format string, so this bounds the
+/// memory used if the caller feeds dynamically-allocated format strings.
+static const std::size_t max_cached_formats = 1024;
+
+
+/// Cache of parsed format strings keyed by the address of the C string.
+///
+/// Note that this is a raw pointer that we intentionally leak, for the same
+/// reasons as the global state of the logging module: formatters may be used
+/// from destructors that run after the destruction of static objects.
+static std::unordered_map< const char*,
+    std::shared_ptr< const format::detail::compiled_format > >* cache = NULL;
+
+
 /// Finds the next placeholder in a string.
 ///
-/// \param format The original format string provided by the user; needed for
-///     error reporting purposes only.
-/// \param expansion The string containing the placeholder to look for.  Any
-///     '%%' in the string will be skipped, and they must be stripped later by
-///     strip_double_percent().
+/// \param format The format string to scan.  Any '%%' in the string will be
+///     skipped, and they must be stripped later by strip_double_percent().
 /// \param begin The position from which to start looking for the next
 ///     placeholder.
+/// \param [out] spec The placeholder found, if any.
+/// \param [out] error Description of the problem, if any.
 ///
-/// \return The position in the string in which the placeholder is located and
-/// the placeholder itself.  If there are no placeholders left, this returns
-/// the length of the string and an empty string.
-///
-/// \throw bad_format_error If the input string contains a trailing formatting
-///     character.  We cannot detect any other kind of invalid formatter because
-///     we do not implement a full parser for them.
-static std::pair< std::string::size_type, std::string >
-find_next_placeholder(const std::string& format,
-                      const std::string& expansion,
-                      std::string::size_type begin)
+/// \return The position in the string in which the placeholder is located, or
+/// the length of the string if there are no placeholders left or if an error
+/// was found.  In the latter case, error is set.
+static std::string::size_type
+find_next_placeholder(const std::string& format, std::string::size_type begin,
+                      std::string& spec, std::string& error)
 {
-    begin = expansion.find('%', begin);
-    while (begin != std::string::npos && expansion[begin + 1] == '%')
-        begin = expansion.find('%', begin + 2);
+    begin = format.find('%', begin);
+    while (begin != std::string::npos && format[begin + 1] == '%')
+        begin = format.find('%', begin + 2);
     if (begin == std::string::npos)
-        return std::make_pair(expansion.length(), "");
-    if (begin == expansion.length() - 1)
-        throw format::bad_format_error(format, "Trailing %");
+        return format.length();
+    if (begin == format.length() - 1) {
+        error = "Trailing %";
+        return format.length();
+    }
 
     std::string::size_type end = begin + 1;
-    while (end < expansion.length() && expansion[end] != 's')
+    while (end < format.length() && format[end] != 's')
         end++;
-    const std::string placeholder = expansion.substr(begin, end - begin + 1);
-    if (end == expansion.length() ||
-        placeholder.find('%', 1) != std::string::npos)
-        throw format::bad_format_error(format, "Unterminated placeholder '" +
-                                       placeholder + "'");
-    return std::make_pair(begin, placeholder);
+    spec = format.substr(begin, end - begin + 1);
+    if (end == format.length() || spec.find('%', 1) != std::string::npos) {
+        error = "Unterminated placeholder '" + spec + "'";
+        return format.length();
+    }
+    return begin;
 }
 
 
 /// Converts a string to an integer.
 ///
-/// \param format The format string; for error reporting purposes only.
 /// \param str The string to conver.
 /// \param what The name of the field this integer belongs to; for error
 ///     reporting purposes only.
+/// \param [out] value The parsed integer.
+/// \param [out] error Description of the problem, if any.
 ///
-/// \return An integer representing the input string.
-inline int
-to_int(const std::string& format, const std::string& str, const char* what)
+/// \return True if the conversion succeeded; false otherwise.
+static bool
+to_int(const std::string& str, const char* what, int& value,
+       std::string& error)
 {
     try {
-        return text::to_type< int >(str);
-    } catch (const text::value_error& e) {
-        throw format::bad_format_error(format, "Invalid " + std::string(what) +
-                                       "specifier");
+        value = text::to_type< int >(str);
+        return true;
+    } catch (const text::value_error& unused_error) {
+        error = "Invalid " + std::string(what) + "specifier";
+        return false;
     }
 }
 
 
-/// Constructs an std::ostringstream based on a formatting placeholder.
-///
-/// \param format The format placeholder; may be empty.
+/// Parses the modifiers of a formatting placeholder.
 ///
-/// \return A new std::ostringstream that is prepared to format a single
-/// object in the manner specified by the format placeholder.
+/// \param spec The format placeholder, including the '%' and 's' delimiters.
+/// \param [out] result The placeholder to fill in.
+/// \param [out] error Description of the problem, if any.
 ///
-/// \throw bad_format_error If the format string is bad.  We do minimal
-///     validation on this string though.
-static std::ostringstream*
-new_ostringstream(const std::string& format)
+/// \return True if the placeholder is valid; false otherwise.
+static bool
+parse_placeholder(const std::string& spec, placeholder& result,
+                  std::string& error)
 {
-    std::unique_ptr< std::ostringstream > output(new std::ostringstream());
-
-    if (format.length() <= 2) {
-        // If the format is empty, we create a new stream so that we don't have
-        // to check for NULLs later on.  We rarely should hit this condition
-        // (and when we do it's a bug in the caller), so this is not a big deal.
-        //
-        // Otherwise, if the format is a regular '%s', then we don't have to do
-        // any processing for additional formatters.  So this is just a "fast
-        // path".
-    } else {
-        std::string partial = format.substr(1, format.length() - 2);
-        if (partial[0] == '0') {
-            output->fill('0');
-            partial.erase(0, 1);
-        }
-        if (!partial.empty()) {
-            const std::string::size_type dot = partial.find('.');
-            if (dot != 0)
-                output->width(to_int(format, partial.substr(0, dot), "width"));
-            if (dot != std::string::npos) {
-                output->setf(std::ios::fixed, std::ios::floatfield);
-                output->precision(to_int(format, partial.substr(dot + 1),
-                                         "precision"));
-            }
-        }
+    result.plain = true;
+    result.zero_fill = false;
+    result.width = -1;
+    result.precision = -1;
+
+    if (spec.length() <= 2)
+        return true;
+
+    std::string partial = spec.substr(1, spec.length() - 2);
+    if (partial[0] == '0') {
+        result.plain = false;
+        result.zero_fill = true;
+        partial.erase(0, 1);
     }
+    if (!partial.empty()) {
+        result.plain = false;
+        const std::string::size_type dot = partial.find('.');
+        if (dot != 0 && !to_int(partial.substr(0, dot), "width", result.width,
+                                error))
+            return false;
+        if (dot != std::string::npos && !to_int(partial.substr(dot + 1),
+                                                "precision", result.precision,
+                                                error))
+            return false;
+    }
+    return true;
+}
 
-    return output.release();
+
+/// Appends a range of a string to another, replacing '%%' by '%'.
+///
+/// \param in The input string.
+/// \param begin The position at which to start copying.
+/// \param end The position at which to stop copying.
+/// \param [in,out] out The string to append to.
+static void
+strip_double_percent(const std::string& in, std::string::size_type begin,
+                     const std::string::size_type end, std::string& out)
+{
+    while (begin < end) {
+        out += in[begin];
+        if (in[begin] == '%' && begin + 1 < end && in[begin + 1] == '%')
+            begin += 2;
+        else
+            begin++;
+    }
 }
 
 
-/// Replaces '%%' by '%' in a given string range.
+/// Parses a C format string, reusing a previous result if possible.
 ///
-/// \param in The input string to be rewritten.
-/// \param begin The position at which to start the replacement.
-/// \param end The position at which to end the replacement.
+/// \param format The format string.
 ///
-/// \return The modified string and the amount of characters removed.
-static std::pair< std::string, int >
-strip_double_percent(const std::string& in, const std::string::size_type begin,
-                     std::string::size_type end)
+/// \return The parsed format string.
+static std::shared_ptr< const format::detail::compiled_format >
+compile_cached(const char* format)
 {
-    std::string part = in.substr(begin, end - begin);
-
-    int removed = 0;
-    std::string::size_type pos = part.find("%%");
-    while (pos != std::string::npos) {
-        part.erase(pos, 1);
-        ++removed;
-        pos = part.find("%%", pos + 1);
+    if (cache == NULL) {
+        cache = new std::unordered_map< const char*, std::shared_ptr<
+            const format::detail::compiled_format > >();
     }
 
-    return std::make_pair(in.substr(0, begin) + part + in.substr(end), removed);
+    const auto iter = cache->find(format);
+    if (iter != cache->end() &&
+        std::strcmp((*iter).second->format.c_str(), format) == 0)
+        return (*iter).second;
+
+    if (cache->size() >= max_cached_formats)
+        cache->clear();
+    std::shared_ptr< const format::detail::compiled_format > compiled(
+        new format::detail::compiled_format(format));
+    (*cache)[format] = compiled;
+    return compiled;
 }
 
 
 }  // anonymous namespace
 
 
-/// Performs internal initialization of the formatter.
+/// Parses a format string.
 ///
-/// This is separate from the constructor just because it is shared by different
-/// overloaded constructors.
-void
-format::formatter::init(void)
+/// \param format_ The format string to parse.
+format::detail::compiled_format::compiled_format(const std::string& format_) :
+    format(format_)
 {
-    const std::pair< std::string::size_type, std::string > placeholder =
-        find_next_placeholder(_format, _expansion, _last_pos);
-    const std::pair< std::string, int > no_percents =
-        strip_double_percent(_expansion, _last_pos, placeholder.first);
-
-    _oss = new_ostringstream(placeholder.second);
+    std::string::size_type last_pos = 0;
+    for (;;) {
+        std::string spec;
+        const std::string::size_type pos = find_next_placeholder(
+            format, last_pos, spec, error);
+        if (pos == format.length()) {
+            if (error.empty())
+                strip_double_percent(format, last_pos, pos, suffix);
+            break;
+        }
 
-    _expansion = no_percents.first;
-    _placeholder_pos = placeholder.first - no_percents.second;
-    _placeholder = placeholder.second;
+        placeholder current;
+        if (!parse_placeholder(spec, current, error))
+            break;
+        strip_double_percent(format, last_pos, pos, current.prefix);
+        current.position = pos;
+        placeholders.push_back(current);
+        last_pos = pos + spec.length();
+    }
 }
 
 
-/// Constructs a new formatter object (internal).
+/// Constructs a new formatter object from a C string.
 ///
-/// \param format The format string.
-/// \param expansion The format string with any replacements performed so far.
-/// \param last_pos The position from which to start looking for formatting
-///     placeholders.  This must be maintained in case one of the replacements
-///     introduced a new placeholder, which must be ignored.  Think, for
-///     example, replacing a "%s" string with "foo %s".
-format::formatter::formatter(const std::string& format,
-                             const std::string& expansion,
-                             const std::string::size_type last_pos) :
-    _format(format),
-    _expansion(expansion),
-    _last_pos(last_pos),
-    _oss(NULL)
+/// The result of parsing the format string is cached, so using the same
+/// string literal repeatedly, as the F() macro does, is cheap.
+///
+/// \param format The format string.  The formatters in the string are not
+///     validated during construction, but will cause errors when used later if
+///     they are invalid.
+format::formatter::formatter(const char* format) :
+    _compiled(compile_cached(format)),
+    _expanded_length(0),
+    _next(0)
 {
-    init();
+    _expansion.reserve(_compiled->format.length() * 2);
+    advance();
 }
 
 
@@ -224,70 +322,245 @@ format::formatter::formatter(const std::string& format,
 ///     validated during construction, but will cause errors when used later if
 ///     they are invalid.
 format::formatter::formatter(const std::string& format) :
-    _format(format),
-    _expansion(format),
-    _last_pos(0),
-    _oss(NULL)
+    _compiled(new detail::compiled_format(format)),
+    _expanded_length(0),
+    _next(0)
 {
-    init();
+    _expansion.reserve(format.length() * 2);
+    advance();
 }
 
 
-format::formatter::~formatter(void)
+/// Moves past the literal text that precedes the next placeholder.
+///
+/// \pre _expansion contains exactly the expanded text so far.
+///
+/// \throw bad_format_error If the next placeholder is invalid.
+void
+format::formatter::advance(void)
 {
-    delete _oss;
+    const detail::compiled_format& compiled = *_compiled;
+    if (_next < compiled.placeholders.size()) {
+        const placeholder& next = compiled.placeholders[_next];
+        _expansion += next.prefix;
+        _expanded_length = _expansion.length();
+        _expansion.append(compiled.format, next.position, std::string::npos);
+    } else {
+        if (!compiled.error.empty())
+            throw format::bad_format_error(compiled.format, compiled.error);
+        _expansion += compiled.suffix;
+        _expanded_length = _expansion.length();
+    }
 }
 
 
-/// Returns the formatted string.
+/// Checks if the next placeholder is a bare '%s'.
 ///
-/// \return A string representation of the formatted string.
-const std::string&
-format::formatter::str(void) const
+/// \return True if values can be inserted verbatim; false if they have to go
+/// through a stream configured by configure().
+bool
+format::formatter::plain_placeholder(void) const
 {
-    return _expansion;
+    return _next < _compiled->placeholders.size() &&
+        _compiled->placeholders[_next].plain;
 }
 
 
-/// Automatic conversion of formatter objects to strings.
+/// Prepares a stream to format a value for the next placeholder.
 ///
-/// This is provided to allow painless injection of formatter objects into
-/// streams, without having to manually call the str() method.
-format::formatter::operator const std::string&(void) const
+/// \param output The stream to configure.
+void
+format::formatter::configure(std::ostream& output) const
 {
-    return _expansion;
+    if (_next == _compiled->placeholders.size())
+        return;
+
+    const placeholder& next = _compiled->placeholders[_next];
+    if (next.zero_fill)
+        output.fill('0');
+    if (next.width != -1)
+        output.width(next.width);
+    if (next.precision != -1) {
+        output.setf(std::ios::fixed, std::ios::floatfield);
+        output.precision(next.precision);
+    }
+}
+
+
+/// Replaces the next formatting placeholder with a value.
+///
+/// \param arg The replacement string.
+/// \param length The length of arg.
+///
+/// \throw utils::format::extra_args_error If there are no more formatting
+///     placeholders in the input string.
+/// \throw bad_format_error If the placeholder that follows is invalid.
+void
+format::formatter::replace(const char* arg, const std::size_t length)
+{
+    if (_next == _compiled->placeholders.size())
+        throw format::extra_args_error(_compiled->format,
+                                       std::string(arg, length));
+
+    _expansion.erase(_expanded_length);
+    _expansion.append(arg, length);
+    _next++;
+    advance();
 }
 
 
-/// Specialization of operator% for booleans.
+/// Replaces the next placeholder with a boolean.
 ///
 /// \param value The boolean to inject into the format string.
+void
+format::formatter::replace_value(const bool& value)
+{
+    const char* formatted = value ? "true" : "false";
+    if (plain_placeholder())
+        replace(formatted, std::strlen(formatted));
+    else
+        replace_streamed(formatted);
+}
+
+
+/// Replaces the next placeholder with a character.
+///
+/// \param value The character to inject into the format string.
+void
+format::formatter::replace_value(const char& value)
+{
+    if (plain_placeholder())
+        replace(&value, 1);
+    else
+        replace_streamed(value);
+}
+
+
+/// Replaces the next placeholder with a C string.
 ///
-/// \return A new formatter that has one less format placeholder.
-format::formatter
-format::formatter::operator%(const bool& value) const
+/// \param value The string to inject into the format string.
+void
+format::formatter::replace_value(const char* value)
 {
-    (*_oss) << (value ? "true" : "false");
-    return replace(_oss->str());
+    if (plain_placeholder())
+        replace(value, std::strlen(value));
+    else
+        replace_streamed(value);
 }
 
 
-/// Replaces the first formatting placeholder with a value.
+/// Replaces the next placeholder with a string.
 ///
-/// \param arg The replacement string.
+/// \param value The string to inject into the format string.
+void
+format::formatter::replace_value(const std::string& value)
+{
+    if (plain_placeholder())
+        replace(value.data(), value.length());
+    else
+        replace_streamed(value);
+}
+
+
+/// Replaces the next placeholder with an integer.
 ///
-/// \return A new formatter in which the first formatting placeholder has been
-///     replaced by arg and is ready to replace the next item.
+/// \param value The integer to inject into the format string.
+void
+format::formatter::replace_value(const int& value)
+{
+    if (plain_placeholder()) {
+        const std::string formatted = std::to_string(value);
+        replace(formatted.data(), formatted.length());
+    } else
+        replace_streamed(value);
+}
+
+
+/// Replaces the next placeholder with an integer.
 ///
-/// \throw utils::format::extra_args_error If there are no more formatting
-///     placeholders in the input string, or if the placeholder is invalid.
-format::formatter
-format::formatter::replace(const std::string& arg) const
+/// \param value The integer to inject into the format string.
+void
+format::formatter::replace_value(const long& value)
 {
-    if (_placeholder_pos == _expansion.length())
-        throw format::extra_args_error(_format, arg);
+    if (plain_placeholder()) {
+        const std::string formatted = std::to_string(value);
+        replace(formatted.data(), formatted.length());
+    } else
+        replace_streamed(value);
+}
+
+
+/// Replaces the next placeholder with an integer.
+///
+/// \param value The integer to inject into the format string.
+void
+format::formatter::replace_value(const long long& value)
+{
+    if (plain_placeholder()) {
+        const std::string formatted = std::to_string(value);
+        replace(formatted.data(), formatted.length());
+    } else
+        replace_streamed(value);
+}
+
 
-    const std::string expansion = _expansion.substr(0, _placeholder_pos)
-        + arg + _expansion.substr(_placeholder_pos + _placeholder.length());
-    return formatter(_format, expansion, _placeholder_pos + arg.length());
+/// Replaces the next placeholder with an integer.
+///
+/// \param value The integer to inject into the format string.
+void
+format::formatter::replace_value(const unsigned int& value)
+{
+    if (plain_placeholder()) {
+        const std::string formatted = std::to_string(value);
+        replace(formatted.data(), formatted.length());
+    } else
+        replace_streamed(value);
+}
+
+
+/// Replaces the next placeholder with an integer.
+///
+/// \param value The integer to inject into the format string.
+void
+format::formatter::replace_value(const unsigned long& value)
+{
+    if (plain_placeholder()) {
+        const std::string formatted = std::to_string(value);
+        replace(formatted.data(), formatted.length());
+    } else
+        replace_streamed(value);
+}
+
+
+/// Replaces the next placeholder with an integer.
+///
+/// \param value The integer to inject into the format string.
+void
+format::formatter::replace_value(const unsigned long long& value)
+{
+    if (plain_placeholder()) {
+        const std::string formatted = std::to_string(value);
+        replace(formatted.data(), formatted.length());
+    } else
+        replace_streamed(value);
+}
+
+
+/// Returns the formatted string.
+///
+/// \return A string representation of the formatted string.
+const std::string&
+format::formatter::str(void) const
+{
+    return _expansion;
+}
+
+
+/// Automatic conversion of formatter objects to strings.
+///
+/// This is provided to allow painless injection of formatter objects into
+/// streams, without having to manually call the str() method.
+format::formatter::operator const std::string&(void) const
+{
+    return _expansion;
 }
@@ -48,19 +48,29 @@
 
 #include "utils/format/formatter_fwd.hpp"
 
-#include <sstream>
+#include <cstddef>
+#include <memory>
+#include <ostream>
 #include <string>
 
 namespace utils {
 namespace format {
 
 
+namespace detail {
+
+
+struct compiled_format;
+
+
+}  // namespace detail
+
+
 /// Mechanism to format strings similar to printf.
 ///
-/// A formatter always maintains the original format string but also holds a
-/// partial expansion.  The partial expansion is immutable in the context of a
-/// formatter instance, but calls to operator% return new formatter objects with
-/// one less formatting placeholder.
+/// A formatter holds a parsed representation of the format string and a
+/// partial expansion of it.  Every call to operator% replaces the next
+/// formatting placeholder with the given argument.
 ///
 /// In general, one can format a string in the following manner:
 ///
@@ -76,43 +86,59 @@ namespace format {
 /// const formatter f3 = f2 % 5;
 /// const std::string s = f3.str();
 /// \endcode
+///
+/// Applying operator% to a named formatter leaves it untouched and returns a
+/// new formatter with one less placeholder, so the same partial expansion can
+/// be reused.  Applying it to a temporary, which is what the F() macro
+/// produces, updates the temporary in place so that a chain of arguments is
+/// expanded into a single buffer.
+///
+/// Format strings given as C strings are parsed only once: the result of the
+/// parsing is cached and shared by all formatters constructed from the same
+/// string.
 class formatter {
-    /// The original format string provided by the user.
-    std::string _format;
+    /// The parsed format string.
+    std::shared_ptr< const detail::compiled_format > _compiled;
 
-    /// The current "expansion" of the format string.
+    /// The current expansion of the format string.
     ///
-    /// This field gets updated on every call to operator%() to have one less
-    /// formatting placeholder.
+    /// This contains the expanded text up to the next formatting placeholder
+    /// followed by the unprocessed remainder of the format string.
     std::string _expansion;
 
-    /// The position of _expansion from which to scan for placeholders.
-    std::string::size_type _last_pos;
-
-    /// The position of the first placeholder in the current expansion.
-    std::string::size_type _placeholder_pos;
-
-    /// The first placeholder in the current expansion.
-    std::string _placeholder;
-
-    /// Stream used to format any possible argument supplied by operator%().
-    std::ostringstream* _oss;
-
-    formatter replace(const std::string&) const;
-
-    void init(void);
-    formatter(const std::string&, const std::string&,
-              const std::string::size_type);
+    /// The position in _expansion at which the unprocessed remainder starts.
+    std::string::size_type _expanded_length;
+
+    /// The index of the next placeholder to replace.
+    std::size_t _next;
+
+    void advance(void);
+    bool plain_placeholder(void) const;
+    void configure(std::ostream&) const;
+    void replace(const char*, const std::size_t);
+
+    template< typename Type > void replace_streamed(const Type&);
+    template< typename Type > void replace_value(const Type&);
+    void replace_value(const bool&);
+    void replace_value(const char&);
+    void replace_value(const char*);
+    void replace_value(const std::string&);
+    void replace_value(const int&);
+    void replace_value(const long&);
+    void replace_value(const long long&);
+    void replace_value(const unsigned int&);
+    void replace_value(const unsigned long&);
+    void replace_value(const unsigned long long&);
 
 public:
+    explicit formatter(const char*);
     explicit formatter(const std::string&);
-    ~formatter(void);
 
     const std::string& str(void) const;
     operator const std::string&(void) const;
 
-    template< typename Type > formatter operator%(const Type&) const;
-    formatter operator%(const bool&) const;
+    template< typename Type > formatter operator%(const Type&) const &;
+    template< typename Type > formatter operator%(const Type&) &&;
 };
 
 
@@ -29,14 +29,45 @@
 #if !defined(UTILS_FORMAT_FORMATTER_IPP)
 #define UTILS_FORMAT_FORMATTER_IPP
 
-#include <ostream>
-
 #include "utils/format/formatter.hpp"
 
+#include <ostream>
+#include <sstream>
+#include <utility>
+
 namespace utils {
 namespace format {
 
 
+/// Replaces the next placeholder with a value formatted by a stream.
+///
+/// This honors the width, precision and padding of the placeholder and is the
+/// fallback for any type that does not have a specialized overload.
+///
+/// \param arg The argument to use as replacement for the format placeholder.
+template< typename Type >
+inline void
+formatter::replace_streamed(const Type& arg)
+{
+    std::ostringstream output;
+    configure(output);
+    output << arg;
+    const std::string formatted = output.str();
+    replace(formatted.data(), formatted.length());
+}
+
+
+/// Replaces the next placeholder with an arbitrary value.
+///
+/// \param arg The argument to use as replacement for the format placeholder.
+template< typename Type >
+inline void
+formatter::replace_value(const Type& arg)
+{
+    replace_streamed(arg);
+}
+
+
 /// Replaces the first format placeholder in a formatter.
 ///
 /// Constructs a new formatter object that has one less formatting placeholder,
@@ -49,10 +80,28 @@ namespace format {
 /// \return A new formatter that has one less format placeholder.
 template< typename Type >
 inline formatter
-formatter::operator%(const Type& arg) const
+formatter::operator%(const Type& arg) const &
+{
+    formatter copy(*this);
+    copy.replace_value(arg);
+    return copy;
+}
+
+
+/// Replaces the first format placeholder in a temporary formatter.
+///
+/// This is the same as the operator above but, given that nobody else can see
+/// the current formatter, the replacement happens in place.
+///
+/// \param arg The argument to use as replacement for the format placeholder.
+///
+/// \return The current formatter, with one less format placeholder.
+template< typename Type >
+inline formatter
+formatter::operator%(const Type& arg) &&
 {
-    (*_oss) << arg;
-    return replace(_oss->str());
+    replace_value(arg);
+    return std::move(*this);
 }
 
 
@@ -28,7 +28,9 @@
 
 #include "utils/format/formatter.hpp"
 
+#include <cstring>
 #include <ostream>
+#include <string>
 
 #include <atf-c++.hpp>
 
@@ -247,6 +249,61 @@ ATF_TEST_CASE_BODY(format__error)
 }
 
 
+ATF_TEST_CASE_WITHOUT_HEAD(reuse_partial);
+ATF_TEST_CASE_BODY(reuse_partial)
+{
+    const format::formatter f1("%s-%s");
+    const format::formatter f2 = f1 % "a";
+    EQ("a-b", f2 % "b");
+    EQ("a-c", f2 % "c");
+    EQ("a-%s", f2);
+    EQ("%s-%s", f1);
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(partial_expansion);
+ATF_TEST_CASE_BODY(partial_expansion)
+{
+    EQ("a %s %% %s", F("a %s %% %s"));
+    EQ("% x %s %%", F("%% %s %s %%") % "x");
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(reused_buffer);
+ATF_TEST_CASE_BODY(reused_buffer)
+{
+    char buffer[16];
+    std::strcpy(buffer, "A%s");
+    EQ("Az", F(buffer) % "z");
+    std::strcpy(buffer, "B%s!");
+    EQ("Bz!", F(buffer) % "z");
+    std::strcpy(buffer, "%s%%");
+    EQ("z%", F(buffer) % "z");
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(std_string_format);
+ATF_TEST_CASE_BODY(std_string_format)
+{
+    const std::string format_string("%s and %s");
+    EQ("foo and 5", F(format_string) % "foo" % 5);
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(common_patterns);
+ATF_TEST_CASE_BODY(common_patterns)
+{
+    for (int i = 0; i < 2; i++) {
+        EQ("20110221-183000 D 1234 file.cpp:56: message",
+           F("%s %s %s %s:%s: %s") % "20110221-183000" % 'D' % 1234 %
+           "file.cpp" % 56 % std::string("message"));
+        EQ("/tmp/kyua.XXXX/12345/work",
+           F("%s/%s/%s") % "/tmp/kyua.XXXX" % 12345U % "work");
+        EQ("00042 3.142 true", F("%05s %.3s %s") % 42 % 3.14159 % true);
+    }
+}
+
+
 ATF_INIT_TEST_CASES(tcs)
 {
     ATF_ADD_TEST_CASE(tcs, no_fields);
@@ -262,4 +319,10 @@ ATF_INIT_TEST_CASES(tcs)
     ATF_ADD_TEST_CASE(tcs, format__float);
     ATF_ADD_TEST_CASE(tcs, format__int);
     ATF_ADD_TEST_CASE(tcs, format__error);
+
+    ATF_ADD_TEST_CASE(tcs, reuse_partial);
+    ATF_ADD_TEST_CASE(tcs, partial_expansion);
+    ATF_ADD_TEST_CASE(tcs, reused_buffer);
+    ATF_ADD_TEST_CASE(tcs, std_string_format);
+    ATF_ADD_TEST_CASE(tcs, common_patterns);
 }
@@ -0,0 +1,313 @@
+// Copyright 2026 The Kyua Authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// * Neither the name of Google Inc. nor the names of its contributors
+//   may be used to endorse or promote products derived from this software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "utils/jobserver.hpp"
+
+extern "C" {
+#include <fcntl.h>
+#include <unistd.h>
+}
+
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+#include "utils/env.hpp"
+#include "utils/format/macros.hpp"
+#include "utils/logging/macros.hpp"
+#include "utils/noncopyable.hpp"
+#include "utils/optional.ipp"
+#include "utils/sanity.hpp"
+#include "utils/text/exceptions.hpp"
+#include "utils/text/operations.ipp"
+
+namespace text = utils::text;
+
+using utils::none;
+using utils::optional;
+
+
+namespace {
+
+
+/// Locates the jobserver specification in a MAKEFLAGS value.
+///
+/// make(1) may list the jobserver flags more than once if the variable was
+/// extended by recursive invocations; the last occurrence takes precedence.
+/// Variable assignments following a standalone "--" word are ignored.
+///
+/// \param makeflags The contents of the MAKEFLAGS variable.
+///
+/// \return The value of the --jobserver-auth or --jobserver-fds flag, or none
+/// if there is none.
+static optional< std::string >
+find_jobserver_auth(const std::string& makeflags)
+{
+    static const char* const prefixes[] = {
+        "--jobserver-auth=", "--jobserver-fds=", NULL };
+
+    optional< std::string > auth;
+    const std::vector< std::string > words = text::split(makeflags, ' ');
+    for (std::vector< std::string >::const_iterator iter = words.begin();
+         iter != words.end(); ++iter) {
+        const std::string& word = *iter;
+        if (word == "--")
+            break;
+        for (const char* const* prefix = prefixes; *prefix != NULL;
+             ++prefix) {
+            const std::size_t length = std::strlen(*prefix);
+            if (word.compare(0, length, *prefix) == 0)
+                auth = word.substr(length);
+        }
+    }
+    return auth;
+}
+
+
+/// Checks if a file descriptor inherited from our parent is open.
+///
+/// \param fd The file descriptor to validate.
+///
+/// \return True if the descriptor is valid; false otherwise.
+static bool
+is_open_fd(const int fd)
+{
+    return ::fcntl(fd, F_GETFD) != -1;
+}
+
+
+}  // anonymous namespace
+
+
+/// Internal implementation for the jobserver.
+struct utils::jobserver::impl : utils::noncopyable {
+    /// Private, non-blocking descriptor from which to read tokens.
+    int _read_fd;
+
+    /// Descriptor to which to write tokens back.
+    ///
+    /// This is either the same as _read_fd or a descriptor inherited from our
+    /// parent, so it is not owned by this object.
+    int _write_fd;
+
+    /// The tokens we currently hold, in the order in which we got them.
+    ///
+    /// make(1) may encode information in the token values so we must return
+    /// the exact same bytes that we got.
+    std::string _tokens;
+
+    /// Constructor.
+    ///
+    /// \param read_fd_ Private, non-blocking descriptor from which to read
+    ///     tokens.  Ownership is transferred to this object.
+    /// \param write_fd_ Descriptor to which to write tokens back.  Ownership
+    ///     is not transferred.
+    impl(const int read_fd_, const int write_fd_) :
+        _read_fd(read_fd_),
+        _write_fd(write_fd_)
+    {
+    }
+
+    /// Destructor.
+    ///
+    /// Returns any tokens still held back to the jobserver so that make(1)
+    /// does not lose part of its concurrency budget.
+    ~impl(void)
+    {
+        while (!_tokens.empty())
+            release();
+        ::close(_read_fd);
+    }
+
+    /// Returns the most recently acquired token to the jobserver.
+    void
+    release(void)
+    {
+        PRE(!_tokens.empty());
+        const char token = _tokens[_tokens.length() - 1];
+        _tokens.erase(_tokens.length() - 1);
+
+        ssize_t ret;
+        while ((ret = ::write(_write_fd, &token, 1)) == -1 && errno == EINTR) {
+            // Retry.
+        }
+        if (ret != 1) {
+            const int original_errno = errno;
+            LW(F("Failed to return token to the jobserver: %s") %
+               std::strerror(original_errno));
+        }
+    }
+};
+
+
+/// Constructs a new jobserver from its internal implementation.
+///
+/// \param pimpl The internal implementation.
+utils::jobserver::jobserver(std::shared_ptr< impl > pimpl) :
+    _pimpl(pimpl)
+{
+}
+
+
+/// Destructor.
+utils::jobserver::~jobserver(void)
+{
+}
+
+
+/// Connects to the jobserver described by a MAKEFLAGS value.
+///
+/// Both the named pipe ("fifo:PATH") and the anonymous pipe ("R,W") forms of
+/// the --jobserver-auth flag are supported, as is the older --jobserver-fds
+/// flag.  For the anonymous pipe, the read end is reopened to get a private
+/// non-blocking file description without altering the one shared with other
+/// jobserver clients.
+///
+/// Any problem connecting to the jobserver is not fatal: make(1) hides the
+/// jobserver from commands it does not consider recursive, in which case the
+/// caller should just proceed without it.  Such problems are logged.
+///
+/// \param makeflags The contents of the MAKEFLAGS variable.
+///
+/// \return A connection to the jobserver, or none if there is no jobserver or
+/// if it is unusable.
+optional< utils::jobserver >
+utils::jobserver::from_makeflags(const std::string& makeflags)
+{
+    const optional< std::string > auth = find_jobserver_auth(makeflags);
+    if (!auth)
+        return none;
+
+    if (auth.get().compare(0, 5, "fifo:") == 0) {
+        const std::string fifo = auth.get().substr(5);
+        const int fd = ::open(fifo.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+        if (fd == -1) {
+            const int original_errno = errno;
+            LW(F("Cannot open jobserver fifo %s: %s") % fifo %
+               std::strerror(original_errno));
+            return none;
+        }
+        LI(F("Using jobserver fifo %s") % fifo);
+        return utils::make_optional(jobserver(
+            std::shared_ptr< impl >(new impl(fd, fd))));
+    }
+
+    const std::vector< std::string > fds = text::split(auth.get(), ',');
+    int read_fd, write_fd;
+    try {
+        if (fds.size() != 2)
+            throw text::value_error("Expected two descriptors");
+        read_fd = text::to_type< int >(fds[0]);
+        write_fd = text::to_type< int >(fds[1]);
+    } catch (const text::value_error& e) {
+        LW(F("Invalid jobserver specification '%s': %s") % auth.get() %
+           e.what());
+        return none;
+    }
+    if (read_fd < 0 || write_fd < 0 || !is_open_fd(read_fd) ||
+        !is_open_fd(write_fd)) {
+        LW(F("Jobserver descriptors %s,%s are not open; ignoring jobserver") %
+           read_fd % write_fd);
+        return none;
+    }
+
+    const std::string read_path = F("/dev/fd/%s") % read_fd;
+    const int private_fd = ::open(read_path.c_str(),
+                                  O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (private_fd == -1) {
+        const int original_errno = errno;
+        LW(F("Cannot reopen jobserver descriptor %s: %s; ignoring jobserver") %
+           read_fd % std::strerror(original_errno));
+        return none;
+    }
+    LI(F("Using jobserver descriptors %s,%s") % read_fd % write_fd);
+    return utils::make_optional(jobserver(
+        std::shared_ptr< impl >(new impl(private_fd, write_fd))));
+}
+
+
+/// Connects to the jobserver described by the MAKEFLAGS environment variable.
+///
+/// \return A connection to the jobserver, or none if there is no jobserver or
+/// if it is unusable.
+optional< utils::jobserver >
+utils::jobserver::from_environment(void)
+{
+    const optional< std::string > makeflags = utils::getenv("MAKEFLAGS");
+    if (!makeflags)
+        return none;
+    return from_makeflags(makeflags.get());
+}
+
+
+/// Attempts to acquire a token from the jobserver without blocking.
+///
+/// Note that the caller's implicit token is not accounted for here: a client
+/// must only call this to run jobs beyond the first.
+///
+/// \return True if a token was acquired; false if none are available right
+/// now.
+bool
+utils::jobserver::try_acquire(void)
+{
+    char token;
+    ssize_t ret;
+    while ((ret = ::read(_pimpl->_read_fd, &token, 1)) == -1 &&
+           errno == EINTR) {
+        // Retry.
+    }
+    if (ret == 1) {
+        _pimpl->_tokens.push_back(token);
+        return true;
+    } else if (ret == -1 && errno != EAGAIN && errno != EWOULDBLOCK) {
+        const int original_errno = errno;
+        LW(F("Failed to read token from the jobserver: %s") %
+           std::strerror(original_errno));
+    }
+    return false;
+}
+
+
+/// Returns a previously-acquired token to the jobserver.
+///
+/// \pre The client must hold at least one token.
+void
+utils::jobserver::release(void)
+{
+    _pimpl->release();
+}
+
+
+/// Gets the number of tokens held by this client.
+///
+/// \return The number of acquired tokens, excluding the implicit one.
+std::size_t
+utils::jobserver::held(void) const
+{
+    return _pimpl->_tokens.length();
+}
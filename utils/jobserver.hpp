@@ -0,0 +1,77 @@
+// Copyright 2026 The Kyua Authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// * Neither the name of Google Inc. nor the names of its contributors
+//   may be used to endorse or promote products derived from this software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/// \file utils/jobserver.hpp
+/// Client for the GNU make jobserver protocol.
+///
+/// The jobserver allows a process started from within a parallel make(1)
+/// invocation to share the global concurrency budget of the build.  Every
+/// client owns an implicit token that allows it to run one job at any time;
+/// any further concurrent job requires acquiring a token from the jobserver and
+/// releasing it once the job completes.
+
+#if !defined(UTILS_JOBSERVER_HPP)
+#define UTILS_JOBSERVER_HPP
+
+#include "utils/jobserver_fwd.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "utils/optional_fwd.hpp"
+
+namespace utils {
+
+
+/// Handle to a jobserver inherited from make(1).
+///
+/// This class is reference-counted.  The destruction of the last instance
+/// returns any tokens still held by the client back to the jobserver.
+class jobserver {
+    struct impl;
+    /// Reference-counted, shared implementation.
+    std::shared_ptr< impl > _pimpl;
+
+    explicit jobserver(std::shared_ptr< impl >);
+
+public:
+    ~jobserver(void);
+
+    static optional< jobserver > from_makeflags(const std::string&);
+    static optional< jobserver > from_environment(void);
+
+    bool try_acquire(void);
+    void release(void);
+    std::size_t held(void) const;
+};
+
+
+}  // namespace utils
+
+#endif  // !defined(UTILS_JOBSERVER_HPP)
@@ -0,0 +1,230 @@
+// Copyright 2026 The Kyua Authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// * Neither the name of Google Inc. nor the names of its contributors
+//   may be used to endorse or promote products derived from this software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "utils/jobserver.hpp"
+
+extern "C" {
+#include <sys/stat.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+}
+
+#include <string>
+
+#include <atf-c++.hpp>
+
+#include "utils/format/macros.hpp"
+#include "utils/optional.ipp"
+
+using utils::optional;
+
+
+namespace {
+
+
+/// Creates a pipe preloaded with a set of tokens.
+///
+/// \param tokens The tokens to write into the pipe.
+/// \param [out] fds The read and write ends of the pipe.
+static void
+setup_pipe(const std::string& tokens, int fds[2])
+{
+    ATF_REQUIRE(::pipe(fds) != -1);
+    ATF_REQUIRE_EQ(static_cast< ssize_t >(tokens.length()),
+                   ::write(fds[1], tokens.c_str(), tokens.length()));
+}
+
+
+/// Drains all tokens available in a pipe without blocking.
+///
+/// \param fd The read end of the pipe.
+///
+/// \return The tokens that were in the pipe.
+static std::string
+drain_pipe(const int fd)
+{
+    ATF_REQUIRE(::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK) != -1);
+    std::string tokens;
+    char token;
+    while (::read(fd, &token, 1) == 1)
+        tokens.push_back(token);
+    return tokens;
+}
+
+
+}  // anonymous namespace
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(from_makeflags__none);
+ATF_TEST_CASE_BODY(from_makeflags__none)
+{
+    ATF_REQUIRE(!utils::jobserver::from_makeflags(""));
+    ATF_REQUIRE(!utils::jobserver::from_makeflags("k"));
+    ATF_REQUIRE(!utils::jobserver::from_makeflags(" -j4 -k"));
+    ATF_REQUIRE(!utils::jobserver::from_makeflags(
+        " -- FOO=--jobserver-auth=3,4"));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(from_makeflags__pipe);
+ATF_TEST_CASE_BODY(from_makeflags__pipe)
+{
+    int fds[2];
+    setup_pipe("+-", fds);
+
+    {
+        optional< utils::jobserver > jobserver =
+            utils::jobserver::from_makeflags(
+                F(" -j3 --jobserver-auth=%s,%s") % fds[0] % fds[1]);
+        ATF_REQUIRE(jobserver);
+        ATF_REQUIRE_EQ(0, jobserver.get().held());
+        ATF_REQUIRE(jobserver.get().try_acquire());
+        ATF_REQUIRE(jobserver.get().try_acquire());
+        ATF_REQUIRE(!jobserver.get().try_acquire());
+        ATF_REQUIRE_EQ(2, jobserver.get().held());
+
+        jobserver.get().release();
+        ATF_REQUIRE_EQ(1, jobserver.get().held());
+        ATF_REQUIRE(jobserver.get().try_acquire());
+        ATF_REQUIRE_EQ(2, jobserver.get().held());
+    }
+
+    ATF_REQUIRE_EQ("-+", drain_pipe(fds[0]));
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(from_makeflags__legacy_fds);
+ATF_TEST_CASE_BODY(from_makeflags__legacy_fds)
+{
+    int fds[2];
+    setup_pipe("+", fds);
+
+    {
+        optional< utils::jobserver > jobserver =
+            utils::jobserver::from_makeflags(
+                F(" -j --jobserver-fds=%s,%s") % fds[0] % fds[1]);
+        ATF_REQUIRE(jobserver);
+        ATF_REQUIRE(jobserver.get().try_acquire());
+        ATF_REQUIRE(!jobserver.get().try_acquire());
+    }
+
+    ATF_REQUIRE_EQ("+", drain_pipe(fds[0]));
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(from_makeflags__last_wins);
+ATF_TEST_CASE_BODY(from_makeflags__last_wins)
+{
+    int fds[2];
+    setup_pipe("+", fds);
+
+    {
+        optional< utils::jobserver > jobserver =
+            utils::jobserver::from_makeflags(
+                F(" --jobserver-auth=foo --jobserver-auth=%s,%s") %
+                fds[0] % fds[1]);
+        ATF_REQUIRE(jobserver);
+        ATF_REQUIRE(jobserver.get().try_acquire());
+    }
+
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(from_makeflags__fifo);
+ATF_TEST_CASE_BODY(from_makeflags__fifo)
+{
+    ATF_REQUIRE(::mkfifo("jobserver", 0600) != -1);
+    const int fd = ::open("jobserver", O_RDWR | O_NONBLOCK);
+    ATF_REQUIRE(fd != -1);
+    ATF_REQUIRE_EQ(1, ::write(fd, "+", 1));
+
+    {
+        optional< utils::jobserver > jobserver =
+            utils::jobserver::from_makeflags(
+                " -j2 --jobserver-auth=fifo:jobserver");
+        ATF_REQUIRE(jobserver);
+        ATF_REQUIRE(jobserver.get().try_acquire());
+        ATF_REQUIRE(!jobserver.get().try_acquire());
+        ATF_REQUIRE_EQ(1, jobserver.get().held());
+    }
+
+    ATF_REQUIRE_EQ("+", drain_pipe(fd));
+    ::close(fd);
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(from_makeflags__missing_fifo);
+ATF_TEST_CASE_BODY(from_makeflags__missing_fifo)
+{
+    ATF_REQUIRE(!utils::jobserver::from_makeflags(
+        " --jobserver-auth=fifo:missing"));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(from_makeflags__closed_fds);
+ATF_TEST_CASE_BODY(from_makeflags__closed_fds)
+{
+    int fds[2];
+    ATF_REQUIRE(::pipe(fds) != -1);
+    ::close(fds[0]);
+    ::close(fds[1]);
+
+    ATF_REQUIRE(!utils::jobserver::from_makeflags(
+        F(" --jobserver-auth=%s,%s") % fds[0] % fds[1]));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(from_makeflags__invalid);
+ATF_TEST_CASE_BODY(from_makeflags__invalid)
+{
+    ATF_REQUIRE(!utils::jobserver::from_makeflags(" --jobserver-auth="));
+    ATF_REQUIRE(!utils::jobserver::from_makeflags(" --jobserver-auth=3"));
+    ATF_REQUIRE(!utils::jobserver::from_makeflags(" --jobserver-auth=a,b"));
+    ATF_REQUIRE(!utils::jobserver::from_makeflags(" --jobserver-auth=1,2,3"));
+    ATF_REQUIRE(!utils::jobserver::from_makeflags(" --jobserver-auth=-1,4"));
+}
+
+
+ATF_INIT_TEST_CASES(tcs)
+{
+    ATF_ADD_TEST_CASE(tcs, from_makeflags__none);
+    ATF_ADD_TEST_CASE(tcs, from_makeflags__pipe);
+    ATF_ADD_TEST_CASE(tcs, from_makeflags__legacy_fds);
+    ATF_ADD_TEST_CASE(tcs, from_makeflags__last_wins);
+    ATF_ADD_TEST_CASE(tcs, from_makeflags__fifo);
+    ATF_ADD_TEST_CASE(tcs, from_makeflags__missing_fifo);
+    ATF_ADD_TEST_CASE(tcs, from_makeflags__closed_fds);
+    ATF_ADD_TEST_CASE(tcs, from_makeflags__invalid);
+}
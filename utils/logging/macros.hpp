@@ -30,6 +30,10 @@
 /// Convenience macros to simplify usage of the logging library.
 ///
 /// This file <em>must not be included from other header files</em>.
+///
+/// The macros only evaluate their message argument if the message would be
+/// recorded by the current log level, so callers can build expensive messages
+/// without worrying about the cost when debugging is disabled.
 
 #if !defined(UTILS_LOGGING_MACROS_HPP)
 #define UTILS_LOGGING_MACROS_HPP
@@ -40,29 +44,45 @@
 /// Logs a debug message.
 ///
 /// \param message The message to log.
-#define LD(message) utils::logging::log(utils::logging::level_debug, \
-                                        __FILE__, __LINE__, message)
+#define LD(message) \
+    do { \
+        if (utils::logging::is_enabled(utils::logging::level_debug)) \
+            utils::logging::log(utils::logging::level_debug, \
+                                __FILE__, __LINE__, message); \
+    } while (false)
 
 
 /// Logs an error message.
 ///
 /// \param message The message to log.
-#define LE(message) utils::logging::log(utils::logging::level_error, \
-                                        __FILE__, __LINE__, message)
+#define LE(message) \
+    do { \
+        if (utils::logging::is_enabled(utils::logging::level_error)) \
+            utils::logging::log(utils::logging::level_error, \
+                                __FILE__, __LINE__, message); \
+    } while (false)
 
 
 /// Logs an informational message.
 ///
 /// \param message The message to log.
-#define LI(message) utils::logging::log(utils::logging::level_info, \
-                                        __FILE__, __LINE__, message)
+#define LI(message) \
+    do { \
+        if (utils::logging::is_enabled(utils::logging::level_info)) \
+            utils::logging::log(utils::logging::level_info, \
+                                __FILE__, __LINE__, message); \
+    } while (false)
 
 
 /// Logs a warning message.
 ///
 /// \param message The message to log.
-#define LW(message) utils::logging::log(utils::logging::level_warning, \
-                                        __FILE__, __LINE__, message)
+#define LW(message) \
+    do { \
+        if (utils::logging::is_enabled(utils::logging::level_warning)) \
+            utils::logging::log(utils::logging::level_warning, \
+                                __FILE__, __LINE__, message); \
+    } while (false)
 
 
 #endif  // !defined(UTILS_LOGGING_MACROS_HPP)
@@ -42,6 +42,27 @@ namespace fs = utils::fs;
 namespace logging = utils::logging;
 
 
+namespace {
+
+
+/// Number of times message() has been called.
+static int message_calls = 0;
+
+
+/// Generates a log message and records that it was called.
+///
+/// \return A log message.
+static std::string
+message(void)
+{
+    message_calls++;
+    return "Lazy message";
+}
+
+
+}  // anonymous namespace
+
+
 ATF_TEST_CASE_WITHOUT_HEAD(ld);
 ATF_TEST_CASE_BODY(ld)
 {
@@ -106,10 +127,32 @@ ATF_TEST_CASE_BODY(lw)
 }
 
 
+ATF_TEST_CASE_WITHOUT_HEAD(disabled_level_not_evaluated);
+ATF_TEST_CASE_BODY(disabled_level_not_evaluated)
+{
+    logging::set_persistency("info", fs::path("test.log"));
+
+    LD(message());
+    ATF_REQUIRE_EQ(0, message_calls);
+    LI(message());
+    ATF_REQUIRE_EQ(1, message_calls);
+
+    std::ifstream input("test.log");
+    ATF_REQUIRE(input);
+
+    std::string line;
+    ATF_REQUIRE(std::getline(input, line).good());
+    ATF_REQUIRE_MATCH(" I .*: Lazy message", line);
+    ATF_REQUIRE(!std::getline(input, line).good());
+}
+
+
 ATF_INIT_TEST_CASES(tcs)
 {
     ATF_ADD_TEST_CASE(tcs, ld);
     ATF_ADD_TEST_CASE(tcs, le);
     ATF_ADD_TEST_CASE(tcs, li);
     ATF_ADD_TEST_CASE(tcs, lw);
+
+    ATF_ADD_TEST_CASE(tcs, disabled_level_not_evaluated);
 }
@@ -29,9 +29,12 @@
 #include "utils/logging/operations.hpp"
 
 extern "C" {
+#include <pthread.h>
 #include <unistd.h>
 }
 
+#include <cstdint>
+#include <cstdlib>
 #include <stdexcept>
 #include <string>
 #include <utility>
@@ -107,9 +110,23 @@ struct global_state {
     /// Stream to the currently open log file.
     std::unique_ptr< std::ostream > logfile;
 
+    /// Size of the write buffer for the log file; 0 if unbuffered.
+    std::size_t buffer_size;
+
+    /// Log entries pending to be written to the log file.
+    std::string buffer;
+
+    /// Second of the most recent timestamp formatted by log().
+    int64_t last_second;
+
+    /// Formatted representation of last_second.
+    std::string last_timestamp;
+
     global_state() :
         log_level(logging::level_debug),
-        auto_set_persistency(true)
+        auto_set_persistency(true),
+        buffer_size(0),
+        last_second(-1)
     {
     }
 };
@@ -158,6 +175,54 @@ level_to_char(const logging::level level)
 }
 
 
+/// Formats the timestamp of a log entry.
+///
+/// Log entries only have a resolution of seconds, so we reuse the result of
+/// the previous call if it was for the same second to avoid the cost of
+/// strftime(3) on every entry.
+///
+/// \param globals The global state of the logging module.
+/// \param now The timestamp to format.
+///
+/// \return The formatted timestamp.
+static const std::string&
+format_timestamp(struct global_state* globals, const datetime::timestamp& now)
+{
+    const int64_t second = now.to_seconds();
+    if (second != globals->last_second) {
+        globals->last_timestamp = now.strftime(timestamp_format);
+        globals->last_second = second;
+    }
+    return globals->last_timestamp;
+}
+
+
+/// Writes any buffered log entries to the log file.
+///
+/// \param globals The global state of the logging module.
+static void
+flush_buffer(struct global_state* globals)
+{
+    if (globals->logfile.get() == NULL || globals->buffer.empty())
+        return;
+    (*globals->logfile) << globals->buffer;
+    globals->logfile->flush();
+    globals->buffer.clear();
+}
+
+
+/// Hook to write buffered log entries before the process exits or forks.
+///
+/// Flushing before fork(2) ensures the child does not inherit pending entries
+/// that would later be written twice.
+static void
+flush_hook(void)
+{
+    if (globals_singleton != NULL)
+        flush_buffer(globals_singleton);
+}
+
+
 }  // anonymous namespace
 
 
@@ -218,12 +283,27 @@ logging::log(const level message_level, const char* file, const int line,
         return;
 
     // Update doc/troubleshooting.texi if you change the log format.
-    const std::string message = F("%s %s %s %s:%s: %s") %
-        now.strftime(timestamp_format) % level_to_char(message_level) %
-        ::getpid() % file % line % user_message;
+    std::string message = format_timestamp(globals, now);
+    message += ' ';
+    message += level_to_char(message_level);
+    message += ' ';
+    message += std::to_string(::getpid());
+    message += ' ';
+    message += file;
+    message += ':';
+    message += std::to_string(line);
+    message += ": ";
+    message += user_message;
     if (globals->logfile.get() == NULL)
         globals->backlog.push_back(std::make_pair(message_level, message));
-    else {
+    else if (globals->buffer_size > 0) {
+        INV(globals->backlog.empty());
+        globals->buffer += message;
+        globals->buffer += '\n';
+        if (globals->buffer.length() >= globals->buffer_size ||
+            message_level == level_error)
+            flush_buffer(globals);
+    } else {
         INV(globals->backlog.empty());
         (*globals->logfile) << message << '\n';
         globals->logfile->flush();
@@ -231,6 +311,63 @@ logging::log(const level message_level, const char* file, const int line,
 }
 
 
+/// Checks whether a message of the given level would be recorded.
+///
+/// The logging macros use this to avoid building messages that would be
+/// discarded anyway.
+///
+/// \param message_level The level to check.
+///
+/// \return True if log() would record a message of this level.
+bool
+logging::is_enabled(const level message_level)
+{
+    return message_level <= get_globals()->log_level;
+}
+
+
+/// Writes any buffered log entries to the log file.
+///
+/// This is also called automatically when the program exits, before it forks
+/// and when it crashes, so there is rarely a need to call it explicitly.
+void
+logging::flush(void)
+{
+    flush_buffer(get_globals());
+}
+
+
+/// Enables or disables the buffering of log entries.
+///
+/// While buffering is enabled, log entries sent to the log file are
+/// accumulated in memory and written out in batches once the buffer fills up,
+/// when an error is logged, when flush() is called or when the program exits
+/// or forks.  This keeps the cost of logging off the hot paths of the program
+/// at the expense of losing the most recent entries if the program is killed
+/// abruptly.
+///
+/// \param size The size of the buffer in bytes.  0 disables buffering and
+///     writes any pending entries out.
+void
+logging::set_buffered(const std::size_t size)
+{
+    struct global_state* globals = get_globals();
+
+    static bool hooks_installed = false;
+    if (size > 0 && !hooks_installed) {
+        std::atexit(flush_hook);
+        ::pthread_atfork(flush_hook, NULL, NULL);
+        hooks_installed = true;
+    }
+
+    globals->buffer_size = size;
+    if (size == 0)
+        flush_buffer(globals);
+    else
+        globals->buffer.reserve(size);
+}
+
+
 /// Sets the logging to record messages in memory for later flushing.
 ///
 /// Can be called after set_persistency to flush logs and set recording to be
@@ -244,6 +381,7 @@ logging::set_inmemory(void)
 
     if (globals->logfile.get() != NULL) {
         INV(globals->backlog.empty());
+        flush_buffer(globals);
         globals->logfile->flush();
         globals->logfile.reset();
     }
@@ -34,6 +34,7 @@
 
 #include "utils/logging/operations_fwd.hpp"
 
+#include <cstddef>
 #include <string>
 
 #include "utils/fs/path_fwd.hpp"
@@ -42,8 +43,11 @@ namespace utils {
 namespace logging {
 
 
+void flush(void);
 fs::path generate_log_name(const fs::path&, const std::string&);
+bool is_enabled(const level);
 void log(const level, const char*, const int, const std::string&);
+void set_buffered(const std::size_t);
 void set_inmemory(void);
 void set_persistency(const std::string&, const fs::path&);
 
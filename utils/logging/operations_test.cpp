@@ -29,9 +29,12 @@
 #include "utils/logging/operations.hpp"
 
 extern "C" {
+#include <sys/wait.h>
+
 #include <unistd.h>
 }
 
+#include <cstdlib>
 #include <fstream>
 #include <string>
 
@@ -47,6 +50,31 @@ namespace fs = utils::fs;
 namespace logging = utils::logging;
 
 
+namespace {
+
+
+/// Counts the number of lines in a file.
+///
+/// \param path The file to read.
+///
+/// \return The number of lines in the file.
+static int
+count_lines(const char* path)
+{
+    std::ifstream input(path);
+    ATF_REQUIRE(input);
+
+    int lines = 0;
+    std::string line;
+    while (std::getline(input, line).good())
+        lines++;
+    return lines;
+}
+
+
+}  // anonymous namespace
+
+
 ATF_TEST_CASE_WITHOUT_HEAD(generate_log_name__before_log);
 ATF_TEST_CASE_BODY(generate_log_name__before_log)
 {
@@ -84,6 +112,20 @@ ATF_TEST_CASE_BODY(generate_log_name__after_log)
 }
 
 
+ATF_TEST_CASE_WITHOUT_HEAD(is_enabled);
+ATF_TEST_CASE_BODY(is_enabled)
+{
+    logging::set_inmemory();
+    ATF_REQUIRE(logging::is_enabled(logging::level_debug));
+
+    logging::set_persistency("warning", fs::path("test.log"));
+    ATF_REQUIRE(logging::is_enabled(logging::level_error));
+    ATF_REQUIRE(logging::is_enabled(logging::level_warning));
+    ATF_REQUIRE(!logging::is_enabled(logging::level_info));
+    ATF_REQUIRE(!logging::is_enabled(logging::level_debug));
+}
+
+
 ATF_TEST_CASE_WITHOUT_HEAD(log);
 ATF_TEST_CASE_BODY(log)
 {
@@ -319,6 +361,94 @@ ATF_TEST_CASE_BODY(set_persistency__some_backlog__warning)
 }
 
 
+ATF_TEST_CASE_WITHOUT_HEAD(set_buffered__delay_writes);
+ATF_TEST_CASE_BODY(set_buffered__delay_writes)
+{
+    logging::set_inmemory();
+    logging::set_persistency("debug", fs::path("test.log"));
+    logging::set_buffered(1024);
+
+    logging::log(logging::level_info, "f1", 1, "First message");
+    logging::log(logging::level_warning, "f2", 2, "Second message");
+    ATF_REQUIRE_EQ(0, count_lines("test.log"));
+
+    logging::flush();
+    ATF_REQUIRE_EQ(2, count_lines("test.log"));
+    ATF_REQUIRE(atf::utils::grep_file("f1:1: First message", "test.log"));
+    ATF_REQUIRE(atf::utils::grep_file("f2:2: Second message", "test.log"));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(set_buffered__flush_when_full);
+ATF_TEST_CASE_BODY(set_buffered__flush_when_full)
+{
+    logging::set_inmemory();
+    logging::set_persistency("debug", fs::path("test.log"));
+    logging::set_buffered(16);
+
+    logging::log(logging::level_info, "f1", 1, "A message longer than 16");
+    ATF_REQUIRE_EQ(1, count_lines("test.log"));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(set_buffered__flush_on_error);
+ATF_TEST_CASE_BODY(set_buffered__flush_on_error)
+{
+    logging::set_inmemory();
+    logging::set_persistency("debug", fs::path("test.log"));
+    logging::set_buffered(1024);
+
+    logging::log(logging::level_debug, "f1", 1, "Debug message");
+    ATF_REQUIRE_EQ(0, count_lines("test.log"));
+    logging::log(logging::level_error, "f2", 2, "Error message");
+    ATF_REQUIRE_EQ(2, count_lines("test.log"));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(set_buffered__flush_on_fork);
+ATF_TEST_CASE_BODY(set_buffered__flush_on_fork)
+{
+    logging::set_inmemory();
+    logging::set_persistency("debug", fs::path("test.log"));
+    logging::set_buffered(1024);
+
+    logging::log(logging::level_info, "f1", 1, "Before fork");
+
+    const pid_t pid = ::fork();
+    ATF_REQUIRE(pid != -1);
+    if (pid == 0) {
+        logging::log(logging::level_info, "f2", 2, "In child");
+        std::exit(EXIT_SUCCESS);
+    }
+    int status;
+    ATF_REQUIRE(::waitpid(pid, &status, 0) != -1);
+    ATF_REQUIRE(WIFEXITED(status));
+    ATF_REQUIRE_EQ(EXIT_SUCCESS, WEXITSTATUS(status));
+
+    logging::flush();
+    ATF_REQUIRE_EQ(2, count_lines("test.log"));
+    ATF_REQUIRE(atf::utils::grep_file("Before fork", "test.log"));
+    ATF_REQUIRE(atf::utils::grep_file("In child", "test.log"));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(set_buffered__disable);
+ATF_TEST_CASE_BODY(set_buffered__disable)
+{
+    logging::set_inmemory();
+    logging::set_persistency("debug", fs::path("test.log"));
+    logging::set_buffered(1024);
+
+    logging::log(logging::level_info, "f1", 1, "First message");
+    ATF_REQUIRE_EQ(0, count_lines("test.log"));
+
+    logging::set_buffered(0);
+    ATF_REQUIRE_EQ(1, count_lines("test.log"));
+    logging::log(logging::level_info, "f2", 2, "Second message");
+    ATF_REQUIRE_EQ(2, count_lines("test.log"));
+}
+
+
 ATF_TEST_CASE(set_persistency__fail);
 ATF_TEST_CASE_HEAD(set_persistency__fail)
 {
@@ -341,6 +471,8 @@ ATF_INIT_TEST_CASES(tcs)
     ATF_ADD_TEST_CASE(tcs, generate_log_name__before_log);
     ATF_ADD_TEST_CASE(tcs, generate_log_name__after_log);
 
+    ATF_ADD_TEST_CASE(tcs, is_enabled);
+
     ATF_ADD_TEST_CASE(tcs, log);
 
     ATF_ADD_TEST_CASE(tcs, set_inmemory__reset);
@@ -351,4 +483,10 @@ ATF_INIT_TEST_CASES(tcs)
     ATF_ADD_TEST_CASE(tcs, set_persistency__some_backlog__info);
     ATF_ADD_TEST_CASE(tcs, set_persistency__some_backlog__warning);
     ATF_ADD_TEST_CASE(tcs, set_persistency__fail);
+
+    ATF_ADD_TEST_CASE(tcs, set_buffered__delay_writes);
+    ATF_ADD_TEST_CASE(tcs, set_buffered__flush_when_full);
+    ATF_ADD_TEST_CASE(tcs, set_buffered__flush_on_error);
+    ATF_ADD_TEST_CASE(tcs, set_buffered__flush_on_fork);
+    ATF_ADD_TEST_CASE(tcs, set_buffered__disable);
 }
@@ -0,0 +1,341 @@
+// Copyright 2026 The Kyua Authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// * Neither the name of Google Inc. nor the names of its contributors
+//   may be used to endorse or promote products derived from this software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "utils/metrics.hpp"
+
+#include <algorithm>
+
+#include "utils/datetime.hpp"
+#include "utils/format/macros.hpp"
+#include "utils/sanity.hpp"
+
+namespace datetime = utils::datetime;
+namespace metrics = utils::metrics;
+
+
+namespace {
+
+
+/// Upper bounds of the histogram buckets, in microseconds.
+static const int64_t bucket_bounds[] = {
+    100, 500, 1000, 5000, 10000, 50000, 100000, 500000, 1000000, 5000000,
+    10000000,
+};
+
+
+/// Textual representation of the upper bounds of the histogram buckets.
+///
+/// This must be kept in sync with bucket_bounds.
+static const char* const bucket_labels[] = {
+    "0.0001", "0.0005", "0.001", "0.005", "0.01", "0.05", "0.1", "0.5", "1.0",
+    "5.0", "10.0",
+};
+
+
+/// Number of explicit histogram buckets; excludes the +Inf bucket.
+static const std::size_t num_buckets =
+    sizeof(bucket_bounds) / sizeof(bucket_bounds[0]);
+
+
+/// Collection of registered metrics.
+typedef std::vector< metrics::metric* > metrics_vector;
+
+
+/// Gets the collection of registered metrics.
+///
+/// This is a function-local static to guarantee that the collection exists
+/// before any statically-allocated metric tries to register itself.
+///
+/// \return A mutable reference to the collection.
+static metrics_vector&
+registry(void)
+{
+    static metrics_vector all_metrics;
+    return all_metrics;
+}
+
+
+/// Compares two metrics by their name.
+///
+/// \param a The first metric.
+/// \param b The second metric.
+///
+/// \return True if a sorts before b.
+static bool
+compare_by_name(const metrics::metric* a, const metrics::metric* b)
+{
+    return a->name() < b->name();
+}
+
+
+/// Formats an amount of microseconds as seconds.
+///
+/// \param usecs The value to format.
+///
+/// \return A string with a decimal representation of the value that does not
+/// lose precision.
+static std::string
+format_seconds(const uint64_t usecs)
+{
+    return F("%s.%06s") % (usecs / 1000000) % (usecs % 1000000);
+}
+
+
+}  // anonymous namespace
+
+
+/// Constructs and registers a new metric.
+///
+/// \param name_ Name of the metric family.  Must be unique across all metrics.
+/// \param help_ Textual description of the metric.
+metrics::metric::metric(const std::string& name_, const std::string& help_) :
+    _name(name_),
+    _help(help_)
+{
+    registry().push_back(this);
+}
+
+
+/// Destructor; unregisters the metric.
+metrics::metric::~metric(void)
+{
+    metrics_vector& all_metrics = registry();
+    const metrics_vector::iterator iter = std::find(
+        all_metrics.begin(), all_metrics.end(), this);
+    INV(iter != all_metrics.end());
+    all_metrics.erase(iter);
+}
+
+
+/// Gets the name of the metric.
+///
+/// \return The name of the metric family.
+const std::string&
+metrics::metric::name(void) const
+{
+    return _name;
+}
+
+
+/// Gets the description of the metric.
+///
+/// \return The textual description.
+const std::string&
+metrics::metric::help(void) const
+{
+    return _help;
+}
+
+
+/// Writes the metric family in OpenMetrics format.
+///
+/// \param output Stream into which to write the metric.
+void
+metrics::metric::write(std::ostream& output) const
+{
+    output << F("# TYPE %s %s\n") % _name % type();
+    output << F("# HELP %s %s\n") % _name % _help;
+    write_samples(output);
+}
+
+
+/// Constructs and registers a new counter.
+///
+/// \param name_ Name of the metric family, without the _total suffix.
+/// \param help_ Textual description of the metric.
+metrics::counter::counter(const std::string& name_, const std::string& help_) :
+    metric(name_, help_),
+    _value(0)
+{
+}
+
+
+/// Increments the counter.
+///
+/// \param delta Amount to add to the counter.
+void
+metrics::counter::add(const uint64_t delta)
+{
+    _value += delta;
+}
+
+
+/// Gets the current value of the counter.
+///
+/// \return The accumulated value.
+uint64_t
+metrics::counter::value(void) const
+{
+    return _value;
+}
+
+
+/// Resets the counter to zero.
+void
+metrics::counter::reset(void)
+{
+    _value = 0;
+}
+
+
+/// Writes the samples of the counter.
+///
+/// \param output Stream into which to write the samples.
+void
+metrics::counter::write_samples(std::ostream& output) const
+{
+    output << F("%s_total %s\n") % name() % _value;
+}
+
+
+/// Gets the OpenMetrics type of this metric.
+///
+/// \return The type of the metric family.
+const char*
+metrics::counter::type(void) const
+{
+    return "counter";
+}
+
+
+/// Constructs and registers a new histogram.
+///
+/// \param name_ Name of the metric family.  Should end in _seconds.
+/// \param help_ Textual description of the metric.
+metrics::histogram::histogram(const std::string& name_,
+                              const std::string& help_) :
+    metric(name_, help_),
+    _buckets(num_buckets + 1, 0),
+    _count(0),
+    _sum(0)
+{
+}
+
+
+/// Records a new observation.
+///
+/// \param value The duration to record.
+void
+metrics::histogram::observe(const datetime::delta& value)
+{
+    const int64_t usecs = value.to_microseconds();
+    PRE(usecs >= 0);
+
+    std::size_t i = 0;
+    while (i < num_buckets && usecs > bucket_bounds[i])
+        ++i;
+    ++_buckets[i];
+    ++_count;
+    _sum += static_cast< uint64_t >(usecs);
+}
+
+
+/// Gets the number of observations.
+///
+/// \return The number of times observe() was called.
+uint64_t
+metrics::histogram::count(void) const
+{
+    return _count;
+}
+
+
+/// Gets the sum of all observations.
+///
+/// \return The accumulated duration in microseconds.
+uint64_t
+metrics::histogram::sum(void) const
+{
+    return _sum;
+}
+
+
+/// Resets the histogram to contain no observations.
+void
+metrics::histogram::reset(void)
+{
+    std::fill(_buckets.begin(), _buckets.end(), 0);
+    _count = 0;
+    _sum = 0;
+}
+
+
+/// Writes the samples of the histogram.
+///
+/// \param output Stream into which to write the samples.
+void
+metrics::histogram::write_samples(std::ostream& output) const
+{
+    uint64_t cumulative = 0;
+    for (std::size_t i = 0; i < num_buckets; ++i) {
+        cumulative += _buckets[i];
+        output << F("%s_bucket{le=\"%s\"} %s\n") % name() % bucket_labels[i] %
+            cumulative;
+    }
+    cumulative += _buckets[num_buckets];
+    INV(cumulative == _count);
+    output << F("%s_bucket{le=\"+Inf\"} %s\n") % name() % cumulative;
+    output << F("%s_count %s\n") % name() % _count;
+    output << F("%s_sum %s\n") % name() % format_seconds(_sum);
+}
+
+
+/// Gets the OpenMetrics type of this metric.
+///
+/// \return The type of the metric family.
+const char*
+metrics::histogram::type(void) const
+{
+    return "histogram";
+}
+
+
+/// Resets all registered metrics to their initial state.
+void
+metrics::reset_all(void)
+{
+    const metrics_vector& all_metrics = registry();
+    for (metrics_vector::const_iterator iter = all_metrics.begin();
+         iter != all_metrics.end(); ++iter)
+        (*iter)->reset();
+}
+
+
+/// Writes all registered metrics in the OpenMetrics text format.
+///
+/// \param output Stream into which to write the metrics.
+void
+metrics::write_openmetrics(std::ostream& output)
+{
+    metrics_vector all_metrics = registry();
+    std::sort(all_metrics.begin(), all_metrics.end(), compare_by_name);
+    for (metrics_vector::const_iterator iter = all_metrics.begin();
+         iter != all_metrics.end(); ++iter)
+        (*iter)->write(output);
+    output << "# EOF\n";
+}
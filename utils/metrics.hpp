@@ -0,0 +1,148 @@
+// Copyright 2026 The Kyua Authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// * Neither the name of Google Inc. nor the names of its contributors
+//   may be used to endorse or promote products derived from this software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/// \file utils/metrics.hpp
+/// Instrumentation of Kyua's own overhead.
+///
+/// Metrics are meant to be defined as static objects in the module that
+/// updates them, which registers them for reporting as soon as the module is
+/// loaded.  All registered metrics can then be dumped at once in the
+/// OpenMetrics text format so that they can be scraped or diffed across runs.
+///
+/// None of the classes in this module are thread-safe.
+
+#if !defined(UTILS_METRICS_HPP)
+#define UTILS_METRICS_HPP
+
+#include "utils/metrics_fwd.hpp"
+
+extern "C" {
+#include <stdint.h>
+}
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "utils/datetime_fwd.hpp"
+#include "utils/noncopyable.hpp"
+
+namespace utils {
+namespace metrics {
+
+
+/// Base class for all metrics.
+class metric : noncopyable {
+    /// Name of the metric family, as exposed in the reports.
+    std::string _name;
+
+    /// Textual description of the metric.
+    std::string _help;
+
+protected:
+    metric(const std::string&, const std::string&);
+
+    /// Writes the samples of this metric.
+    ///
+    /// \param output Stream into which to write the samples.
+    virtual void write_samples(std::ostream& output) const = 0;
+
+    /// Gets the OpenMetrics type of this metric.
+    ///
+    /// \return The type of the metric family.
+    virtual const char* type(void) const = 0;
+
+public:
+    virtual ~metric(void);
+
+    const std::string& name(void) const;
+    const std::string& help(void) const;
+
+    /// Resets the metric to its initial state.
+    virtual void reset(void) = 0;
+
+    void write(std::ostream&) const;
+};
+
+
+/// A monotonically-increasing count of events.
+class counter : public metric {
+    /// The current value of the counter.
+    uint64_t _value;
+
+    void write_samples(std::ostream&) const;
+    const char* type(void) const;
+
+public:
+    counter(const std::string&, const std::string&);
+
+    void add(const uint64_t = 1);
+    uint64_t value(void) const;
+
+    void reset(void);
+};
+
+
+/// A distribution of durations.
+///
+/// The buckets are fixed and cover from a hundred microseconds to ten
+/// seconds, which is the range of interest for the overheads we measure.
+class histogram : public metric {
+    /// Number of observations that fell in each bucket (not cumulative).
+    ///
+    /// The last entry corresponds to the implicit +Inf bucket.
+    std::vector< uint64_t > _buckets;
+
+    /// Total number of observations.
+    uint64_t _count;
+
+    /// Sum of all observations, in microseconds.
+    uint64_t _sum;
+
+    void write_samples(std::ostream&) const;
+    const char* type(void) const;
+
+public:
+    histogram(const std::string&, const std::string&);
+
+    void observe(const datetime::delta&);
+    uint64_t count(void) const;
+    uint64_t sum(void) const;
+
+    void reset(void);
+};
+
+
+void reset_all(void);
+void write_openmetrics(std::ostream&);
+
+
+}  // namespace metrics
+}  // namespace utils
+
+#endif  // !defined(UTILS_METRICS_HPP)
@@ -0,0 +1,175 @@
+// Copyright 2026 The Kyua Authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// * Neither the name of Google Inc. nor the names of its contributors
+//   may be used to endorse or promote products derived from this software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "utils/metrics.hpp"
+
+#include <sstream>
+
+#include <atf-c++.hpp>
+
+#include "utils/datetime.hpp"
+
+namespace datetime = utils::datetime;
+namespace metrics = utils::metrics;
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(counter__add);
+ATF_TEST_CASE_BODY(counter__add)
+{
+    metrics::counter counter("test_events", "Number of test events");
+    ATF_REQUIRE_EQ("test_events", counter.name());
+    ATF_REQUIRE_EQ("Number of test events", counter.help());
+    ATF_REQUIRE_EQ(0, counter.value());
+    counter.add();
+    counter.add(5);
+    ATF_REQUIRE_EQ(6, counter.value());
+    counter.reset();
+    ATF_REQUIRE_EQ(0, counter.value());
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(counter__write);
+ATF_TEST_CASE_BODY(counter__write)
+{
+    metrics::counter counter("test_events", "Number of test events");
+    counter.add(3);
+
+    std::ostringstream output;
+    counter.write(output);
+    ATF_REQUIRE_EQ(
+        "# TYPE test_events counter\n"
+        "# HELP test_events Number of test events\n"
+        "test_events_total 3\n",
+        output.str());
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(histogram__observe);
+ATF_TEST_CASE_BODY(histogram__observe)
+{
+    metrics::histogram histogram("test_seconds", "Duration of test events");
+    ATF_REQUIRE_EQ(0, histogram.count());
+    ATF_REQUIRE_EQ(0, histogram.sum());
+    histogram.observe(datetime::delta(0, 250));
+    histogram.observe(datetime::delta(2, 0));
+    ATF_REQUIRE_EQ(2, histogram.count());
+    ATF_REQUIRE_EQ(2000250, histogram.sum());
+    histogram.reset();
+    ATF_REQUIRE_EQ(0, histogram.count());
+    ATF_REQUIRE_EQ(0, histogram.sum());
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(histogram__write);
+ATF_TEST_CASE_BODY(histogram__write)
+{
+    metrics::histogram histogram("test_seconds", "Duration of test events");
+    histogram.observe(datetime::delta(0, 0));
+    histogram.observe(datetime::delta(0, 100));
+    histogram.observe(datetime::delta(0, 101));
+    histogram.observe(datetime::delta(0, 7000));
+    histogram.observe(datetime::delta(30, 5));
+
+    std::ostringstream output;
+    histogram.write(output);
+    ATF_REQUIRE_EQ(
+        "# TYPE test_seconds histogram\n"
+        "# HELP test_seconds Duration of test events\n"
+        "test_seconds_bucket{le=\"0.0001\"} 2\n"
+        "test_seconds_bucket{le=\"0.0005\"} 3\n"
+        "test_seconds_bucket{le=\"0.001\"} 3\n"
+        "test_seconds_bucket{le=\"0.005\"} 3\n"
+        "test_seconds_bucket{le=\"0.01\"} 4\n"
+        "test_seconds_bucket{le=\"0.05\"} 4\n"
+        "test_seconds_bucket{le=\"0.1\"} 4\n"
+        "test_seconds_bucket{le=\"0.5\"} 4\n"
+        "test_seconds_bucket{le=\"1.0\"} 4\n"
+        "test_seconds_bucket{le=\"5.0\"} 4\n"
+        "test_seconds_bucket{le=\"10.0\"} 4\n"
+        "test_seconds_bucket{le=\"+Inf\"} 5\n"
+        "test_seconds_count 5\n"
+        "test_seconds_sum 30.007206\n",
+        output.str());
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(reset_all);
+ATF_TEST_CASE_BODY(reset_all)
+{
+    metrics::counter counter("test_events", "Number of test events");
+    metrics::histogram histogram("test_seconds", "Duration of test events");
+    counter.add(3);
+    histogram.observe(datetime::delta(1, 0));
+
+    metrics::reset_all();
+    ATF_REQUIRE_EQ(0, counter.value());
+    ATF_REQUIRE_EQ(0, histogram.count());
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(write_openmetrics);
+ATF_TEST_CASE_BODY(write_openmetrics)
+{
+    std::string first_output;
+    {
+        metrics::counter counter2("test_z", "Second counter");
+        metrics::counter counter1("test_a", "First counter");
+
+        std::ostringstream output;
+        metrics::write_openmetrics(output);
+        first_output = output.str();
+
+        const std::string::size_type pos1 = first_output.find(
+            "# TYPE test_a counter\n");
+        const std::string::size_type pos2 = first_output.find(
+            "# TYPE test_z counter\n");
+        ATF_REQUIRE(pos1 != std::string::npos);
+        ATF_REQUIRE(pos2 != std::string::npos);
+        ATF_REQUIRE(pos1 < pos2);
+        ATF_REQUIRE(first_output.length() >= 6);
+        ATF_REQUIRE_EQ("# EOF\n",
+                       first_output.substr(first_output.length() - 6));
+    }
+
+    // Destroyed metrics must not be reported any longer.
+    std::ostringstream output;
+    metrics::write_openmetrics(output);
+    ATF_REQUIRE(output.str().find("test_a") == std::string::npos);
+    ATF_REQUIRE(output.str().find("test_z") == std::string::npos);
+}
+
+
+ATF_INIT_TEST_CASES(tcs)
+{
+    ATF_ADD_TEST_CASE(tcs, counter__add);
+    ATF_ADD_TEST_CASE(tcs, counter__write);
+    ATF_ADD_TEST_CASE(tcs, histogram__observe);
+    ATF_ADD_TEST_CASE(tcs, histogram__write);
+    ATF_ADD_TEST_CASE(tcs, reset_all);
+    ATF_ADD_TEST_CASE(tcs, write_openmetrics);
+}
@@ -0,0 +1,501 @@
+// Copyright 2026 The Kyua Authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// * Neither the name of Google Inc. nor the names of its contributors
+//   may be used to endorse or promote products derived from this software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "utils/process/cgroup.hpp"
+
+extern "C" {
+#include <sys/stat.h>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+}
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include "utils/datetime.hpp"
+#include "utils/format/macros.hpp"
+#include "utils/fs/exceptions.hpp"
+#include "utils/fs/operations.hpp"
+#include "utils/logging/macros.hpp"
+#include "utils/optional.ipp"
+#include "utils/process/exceptions.hpp"
+#include "utils/process/resource_usage.hpp"
+#include "utils/text/exceptions.hpp"
+#include "utils/text/operations.ipp"
+#include "utils/units.hpp"
+
+namespace datetime = utils::datetime;
+namespace fs = utils::fs;
+namespace process = utils::process;
+namespace text = utils::text;
+namespace units = utils::units;
+
+using utils::none;
+using utils::optional;
+
+
+namespace {
+
+
+/// Maximum time to wait for the processes of a killed cgroup to go away.
+static const datetime::delta removal_timeout(1, 0);
+
+
+/// Writes a value to a control file of a cgroup.
+///
+/// Control files must be written in a single write(2) call, which is why we
+/// do not use a stream here.
+///
+/// \param file The control file to write to.
+/// \param value The value to write.
+///
+/// \throw process::system_error If the write fails.
+static void
+write_control(const fs::path& file, const std::string& value)
+{
+    const int fd = ::open(file.c_str(), O_WRONLY | O_CLOEXEC);
+    if (fd == -1) {
+        const int original_errno = errno;
+        throw process::system_error(F("Cannot open %s") % file,
+                                    original_errno);
+    }
+
+    ssize_t ret;
+    while ((ret = ::write(fd, value.c_str(), value.length())) == -1 &&
+           errno == EINTR) {
+        // Retry.
+    }
+    const int original_errno = errno;
+    ::close(fd);
+    if (ret == -1)
+        throw process::system_error(F("Cannot write '%s' to %s") % value %
+                                    file, original_errno);
+}
+
+
+/// Reads the lines of a control file of a cgroup.
+///
+/// \param file The control file to read.
+///
+/// \return The lines of the file, or none if the file cannot be read.
+static optional< std::vector< std::string > >
+read_control(const fs::path& file)
+{
+    std::ifstream input(file.c_str());
+    if (!input)
+        return none;
+
+    std::vector< std::string > lines;
+    std::string line;
+    while (std::getline(input, line))
+        lines.push_back(line);
+    return utils::make_optional(lines);
+}
+
+
+/// Looks up a key in a flat-keyed control file, such as cpu.stat.
+///
+/// \param lines The lines of the control file.
+/// \param key The key to look up.
+///
+/// \return The value of the key, or none if it is not present or invalid.
+static optional< uint64_t >
+find_key(const std::vector< std::string >& lines, const std::string& key)
+{
+    for (std::vector< std::string >::const_iterator iter = lines.begin();
+         iter != lines.end(); ++iter) {
+        const std::vector< std::string > words = text::split(*iter, ' ');
+        if (words.size() == 2 && words[0] == key) {
+            try {
+                return utils::make_optional(
+                    text::to_type< uint64_t >(words[1]));
+            } catch (const text::value_error& e) {
+                LW(F("Invalid value for %s in cgroup: %s") % key % e.what());
+                return none;
+            }
+        }
+    }
+    return none;
+}
+
+
+/// Formats a set of controllers as a cgroup.subtree_control request.
+///
+/// \param controllers The controllers to include.
+/// \param prefix Either "+" to enable the controllers or "-" to disable them.
+///
+/// \return The request to write.
+static std::string
+format_controllers(const std::set< std::string >& controllers,
+                   const char* prefix)
+{
+    std::string request;
+    for (std::set< std::string >::const_iterator iter = controllers.begin();
+         iter != controllers.end(); ++iter) {
+        if (!request.empty())
+            request += ' ';
+        request += prefix + *iter;
+    }
+    return request;
+}
+
+
+}  // anonymous namespace
+
+
+/// Constructs a handle to an existing cgroup.
+///
+/// \param directory_ Path to the directory representing the cgroup.
+process::cgroup::cgroup(const fs::path& directory_) :
+    _directory(directory_)
+{
+}
+
+
+/// Locates the cgroup of the current process.
+///
+/// \param proc_file Path to the /proc/self/cgroup file to parse.
+/// \param mount_point Path to where the cgroup v2 file system is mounted.
+///
+/// \return The cgroup of the current process, or none if the system does not
+/// use the unified cgroup hierarchy.
+optional< process::cgroup >
+process::cgroup::current(const fs::path& proc_file,
+                         const fs::path& mount_point)
+{
+    if (!fs::exists(mount_point / "cgroup.controllers")) {
+        LD(F("No cgroup v2 file system in %s") % mount_point);
+        return none;
+    }
+
+    const optional< std::vector< std::string > > lines = read_control(
+        proc_file);
+    if (!lines) {
+        LD(F("Cannot read %s") % proc_file);
+        return none;
+    }
+
+    for (std::vector< std::string >::const_iterator iter =
+             lines.get().begin(); iter != lines.get().end(); ++iter) {
+        if ((*iter).compare(0, 3, "0::") != 0)
+            continue;
+
+        const std::string path = (*iter).substr(3);
+        if (path.empty() || path[0] != '/' || path.find("/..") !=
+            std::string::npos) {
+            LW(F("Invalid cgroup path '%s'") % path);
+            return none;
+        }
+        const fs::path directory = path == "/" ?
+            mount_point : mount_point / path.substr(1);
+        if (!fs::exists(directory / "cgroup.procs")) {
+            LD(F("cgroup %s not visible in %s") % path % mount_point);
+            return none;
+        }
+        return utils::make_optional(cgroup(directory));
+    }
+    LD("Process is not in a cgroup v2 hierarchy");
+    return none;
+}
+
+
+/// Locates the cgroup of the current process.
+///
+/// This looks for the unified hierarchy in its standard location and in the
+/// location used by systems that run in hybrid mode.
+///
+/// \return The cgroup of the current process, or none if the system does not
+/// provide the unified cgroup hierarchy.
+optional< process::cgroup >
+process::cgroup::current(void)
+{
+    const fs::path proc_file("/proc/self/cgroup");
+    const optional< cgroup > unified = current(proc_file,
+                                               fs::path("/sys/fs/cgroup"));
+    if (unified)
+        return unified;
+    return current(proc_file, fs::path("/sys/fs/cgroup/unified"));
+}
+
+
+/// Gets the directory representing the cgroup.
+///
+/// \return A path.
+const fs::path&
+process::cgroup::directory(void) const
+{
+    return _directory;
+}
+
+
+/// Gets the file to write to in order to move a process into the cgroup.
+///
+/// \return A path.
+fs::path
+process::cgroup::procs_file(void) const
+{
+    return _directory / "cgroup.procs";
+}
+
+
+/// Gets the file to write to in order to kill all processes in the cgroup.
+///
+/// \return A path.
+fs::path
+process::cgroup::kill_file(void) const
+{
+    return _directory / "cgroup.kill";
+}
+
+
+/// Queries the controllers that can be enabled for the children of the cgroup.
+///
+/// \return The names of the controllers.
+std::set< std::string >
+process::cgroup::controllers(void) const
+{
+    std::set< std::string > names;
+    const optional< std::vector< std::string > > lines = read_control(
+        _directory / "cgroup.controllers");
+    if (lines) {
+        for (std::vector< std::string >::const_iterator iter =
+                 lines.get().begin(); iter != lines.get().end(); ++iter) {
+            const std::vector< std::string > words = text::split(*iter, ' ');
+            for (std::vector< std::string >::const_iterator iter2 =
+                     words.begin(); iter2 != words.end(); ++iter2) {
+                if (!(*iter2).empty())
+                    names.insert(*iter2);
+            }
+        }
+    }
+    return names;
+}
+
+
+/// Enables controllers for the children of the cgroup.
+///
+/// \param names The names of the controllers to enable.
+///
+/// \throw process::system_error If the controllers cannot be enabled, such as
+///     when the cgroup holds processes itself.
+void
+process::cgroup::enable_controllers(const std::set< std::string >& names)
+{
+    write_control(_directory / "cgroup.subtree_control",
+                  format_controllers(names, "+"));
+}
+
+
+/// Disables controllers for the children of the cgroup.
+///
+/// \param names The names of the controllers to disable.
+///
+/// \throw process::system_error If the controllers cannot be disabled.
+void
+process::cgroup::disable_controllers(const std::set< std::string >& names)
+{
+    write_control(_directory / "cgroup.subtree_control",
+                  format_controllers(names, "-"));
+}
+
+
+/// Creates a child cgroup.
+///
+/// \param name The name of the child.
+///
+/// \return A handle to the new cgroup.
+///
+/// \throw fs::error If the cgroup cannot be created.
+process::cgroup
+process::cgroup::create_child(const std::string& name) const
+{
+    const fs::path child = _directory / name;
+    fs::mkdir(child, 0755);
+    return cgroup(child);
+}
+
+
+/// Moves a process into the cgroup.
+///
+/// \param pid The process to move.
+///
+/// \throw process::system_error If the process cannot be moved.
+void
+process::cgroup::attach(const int pid)
+{
+    write_control(procs_file(), F("%s") % pid);
+}
+
+
+/// Limits the memory that the processes in the cgroup can use.
+///
+/// \param limit The maximum amount of memory, or 0 for no limit.
+///
+/// \throw process::system_error If the limit cannot be set, such as when the
+///     memory controller is not enabled.
+void
+process::cgroup::set_memory_max(const units::bytes& limit)
+{
+    write_control(_directory / "memory.max",
+                  static_cast< uint64_t >(limit) == 0 ? std::string("max") :
+                  F("%s") % static_cast< uint64_t >(limit));
+}
+
+
+/// Checks if any process is still alive in the cgroup or its children.
+///
+/// \return True if the cgroup is populated; false otherwise.
+bool
+process::cgroup::populated(void) const
+{
+    const optional< std::vector< std::string > > events = read_control(
+        _directory / "cgroup.events");
+    if (events) {
+        const optional< uint64_t > populated = find_key(events.get(),
+                                                        "populated");
+        if (populated)
+            return populated.get() != 0;
+    }
+
+    const optional< std::vector< std::string > > procs = read_control(
+        procs_file());
+    return procs && !procs.get().empty();
+}
+
+
+/// Kills all processes in the cgroup and its children.
+///
+/// This does not wait for the processes to terminate.  On systems without
+/// cgroup.kill, the processes are killed individually, which is subject to
+/// races with processes that fork while we are at it.
+///
+/// \throw process::system_error If the processes cannot be killed.
+void
+process::cgroup::kill(void)
+{
+    try {
+        write_control(kill_file(), "1");
+        return;
+    } catch (const process::system_error& e) {
+        if (e.original_errno() != ENOENT)
+            throw;
+    }
+
+    const optional< std::vector< std::string > > procs = read_control(
+        procs_file());
+    if (!procs)
+        return;
+    for (std::vector< std::string >::const_iterator iter =
+             procs.get().begin(); iter != procs.get().end(); ++iter) {
+        try {
+            (void)::kill(text::to_type< int >(*iter), SIGKILL);
+        } catch (const text::value_error& e) {
+            LW(F("Invalid PID '%s' in %s") % *iter % procs_file());
+        }
+    }
+}
+
+
+/// Kills all processes in the cgroup and deletes it.
+///
+/// \throw fs::error If the cgroup cannot be deleted, such as when one of its
+///     processes refuses to die in a timely manner.
+void
+process::cgroup::remove(void)
+{
+    const datetime::timestamp deadline = datetime::timestamp::now() +
+        removal_timeout;
+    while (populated()) {
+        kill();
+        if (datetime::timestamp::now() > deadline)
+            break;
+        ::usleep(10000);
+    }
+    fs::rmdir(_directory);
+}
+
+
+/// Queries the resources consumed by the processes in the cgroup.
+///
+/// This accounts for all processes that ever ran in the cgroup, including
+/// any that escaped their process group or that are still running.  Only the
+/// CPU times and the peak memory usage are filled in; the latter is only
+/// available if the memory controller is enabled.
+///
+/// \return The resource usage.
+process::resource_usage
+process::cgroup::usage(void) const
+{
+    resource_usage usage;
+
+    const optional< std::vector< std::string > > cpu_stat = read_control(
+        _directory / "cpu.stat");
+    if (cpu_stat) {
+        const optional< uint64_t > user = find_key(cpu_stat.get(),
+                                                   "user_usec");
+        if (user)
+            usage.user_time = datetime::delta::from_microseconds(user.get());
+        const optional< uint64_t > system = find_key(cpu_stat.get(),
+                                                     "system_usec");
+        if (system)
+            usage.system_time = datetime::delta::from_microseconds(
+                system.get());
+    }
+
+    const optional< std::vector< std::string > > peak = read_control(
+        _directory / "memory.peak");
+    if (peak && peak.get().size() == 1) {
+        try {
+            usage.max_rss = text::to_type< uint64_t >(peak.get()[0]);
+        } catch (const text::value_error& e) {
+            LW(F("Invalid memory.peak in cgroup: %s") % e.what());
+        }
+    }
+
+    return usage;
+}
+
+
+/// Moves the current process into a cgroup.
+///
+/// This is intended to be called from a subprocess before it executes the
+/// real payload so that all of its descendants belong to the cgroup as well.
+///
+/// \param procs_file The cgroup.procs file of the cgroup to join.
+///
+/// \throw process::system_error If the process cannot be moved.
+void
+process::join_cgroup(const fs::path& procs_file)
+{
+    write_control(procs_file, "0");
+}
@@ -0,0 +1,94 @@
+// Copyright 2026 The Kyua Authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// * Neither the name of Google Inc. nor the names of its contributors
+//   may be used to endorse or promote products derived from this software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+/// \file utils/process/cgroup.hpp
+/// Control groups to track and constrain subprocesses.
+///
+/// This supports the unified hierarchy of Linux (aka cgroup v2) only.  All
+/// operations are plain accesses to the files of the cgroup file system, so
+/// they fail gracefully on systems that do not provide it.
+
+#if !defined(UTILS_PROCESS_CGROUP_HPP)
+#define UTILS_PROCESS_CGROUP_HPP
+
+#include "utils/process/cgroup_fwd.hpp"
+
+#include <set>
+#include <string>
+
+#include "utils/fs/path.hpp"
+#include "utils/optional_fwd.hpp"
+#include "utils/process/resource_usage_fwd.hpp"
+#include "utils/units_fwd.hpp"
+
+namespace utils {
+namespace process {
+
+
+/// Handle to a control group.
+///
+/// This is a lightweight reference to a directory in the cgroup file system,
+/// so copies of an object refer to the same control group.
+class cgroup {
+    /// Path to the directory representing the control group.
+    fs::path _directory;
+
+public:
+    explicit cgroup(const fs::path&);
+
+    static optional< cgroup > current(const fs::path&, const fs::path&);
+    static optional< cgroup > current(void);
+
+    const fs::path& directory(void) const;
+    fs::path procs_file(void) const;
+    fs::path kill_file(void) const;
+
+    std::set< std::string > controllers(void) const;
+    void enable_controllers(const std::set< std::string >&);
+    void disable_controllers(const std::set< std::string >&);
+
+    cgroup create_child(const std::string&) const;
+    void attach(const int);
+    void set_memory_max(const units::bytes&);
+
+    bool populated(void) const;
+    void kill(void);
+    void remove(void);
+
+    resource_usage usage(void) const;
+};
+
+
+void join_cgroup(const fs::path&);
+
+
+}  // namespace process
+}  // namespace utils
+
+#endif  // !defined(UTILS_PROCESS_CGROUP_HPP)
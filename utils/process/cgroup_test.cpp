@@ -0,0 +1,405 @@
+// Copyright 2026 The Kyua Authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// * Neither the name of Google Inc. nor the names of its contributors
+//   may be used to endorse or promote products derived from this software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "utils/process/cgroup.hpp"
+
+extern "C" {
+#include <signal.h>
+#include <unistd.h>
+}
+
+#include <cstdlib>
+#include <set>
+#include <string>
+
+#include <atf-c++.hpp>
+
+#include "utils/datetime.hpp"
+#include "utils/format/macros.hpp"
+#include "utils/fs/operations.hpp"
+#include "utils/fs/path.hpp"
+#include "utils/optional.ipp"
+#include "utils/process/child.ipp"
+#include "utils/process/exceptions.hpp"
+#include "utils/process/resource_usage.hpp"
+#include "utils/process/status.hpp"
+#include "utils/units.hpp"
+
+namespace datetime = utils::datetime;
+namespace fs = utils::fs;
+namespace process = utils::process;
+namespace units = utils::units;
+
+using utils::optional;
+
+
+namespace {
+
+
+/// Creates a fake cgroup v2 file system.
+///
+/// \param mount_point Directory in which to create the file system.
+/// \param path Path of the cgroup of the current process, relative to the
+///     mount point.
+///
+/// \return The path to the fake /proc/self/cgroup file.
+static fs::path
+create_hierarchy(const fs::path& mount_point, const std::string& path)
+{
+    fs::mkdir_p(mount_point / path, 0755);
+    atf::utils::create_file((mount_point / "cgroup.controllers").str(),
+                            "cpu memory\n");
+    atf::utils::create_file((mount_point / path / "cgroup.procs").str(), "");
+    atf::utils::create_file("proc-cgroup", F("0::/%s\n") % path);
+    return fs::path("proc-cgroup");
+}
+
+
+/// Body of a child process that sleeps and then exits.
+static void
+child_sleep(void)
+{
+    ::sleep(60);
+    std::exit(EXIT_SUCCESS);
+}
+
+
+}  // anonymous namespace
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(current__ok);
+ATF_TEST_CASE_BODY(current__ok)
+{
+    const fs::path proc_file = create_hierarchy(fs::path("mnt"),
+                                                "user.slice/test.scope");
+    const optional< process::cgroup > cgroup = process::cgroup::current(
+        proc_file, fs::path("mnt"));
+    ATF_REQUIRE(cgroup);
+    ATF_REQUIRE_EQ(fs::path("mnt/user.slice/test.scope"),
+                   cgroup.get().directory());
+    ATF_REQUIRE_EQ(fs::path("mnt/user.slice/test.scope/cgroup.procs"),
+                   cgroup.get().procs_file());
+    ATF_REQUIRE_EQ(fs::path("mnt/user.slice/test.scope/cgroup.kill"),
+                   cgroup.get().kill_file());
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(current__root);
+ATF_TEST_CASE_BODY(current__root)
+{
+    fs::mkdir(fs::path("mnt"), 0755);
+    atf::utils::create_file("mnt/cgroup.controllers", "");
+    atf::utils::create_file("mnt/cgroup.procs", "");
+    atf::utils::create_file("proc-cgroup", "0::/\n");
+    const optional< process::cgroup > cgroup = process::cgroup::current(
+        fs::path("proc-cgroup"), fs::path("mnt"));
+    ATF_REQUIRE(cgroup);
+    ATF_REQUIRE_EQ(fs::path("mnt"), cgroup.get().directory());
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(current__hybrid);
+ATF_TEST_CASE_BODY(current__hybrid)
+{
+    create_hierarchy(fs::path("mnt"), "test");
+    atf::utils::create_file("proc-cgroup",
+                            "12:memory:/foo\n"
+                            "1:name=systemd:/foo\n"
+                            "0::/test\n");
+    const optional< process::cgroup > cgroup = process::cgroup::current(
+        fs::path("proc-cgroup"), fs::path("mnt"));
+    ATF_REQUIRE(cgroup);
+    ATF_REQUIRE_EQ(fs::path("mnt/test"), cgroup.get().directory());
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(current__unavailable);
+ATF_TEST_CASE_BODY(current__unavailable)
+{
+    fs::mkdir(fs::path("mnt"), 0755);
+    atf::utils::create_file("proc-cgroup", "0::/\n");
+    ATF_REQUIRE(!process::cgroup::current(fs::path("proc-cgroup"),
+                                          fs::path("mnt")));
+
+    atf::utils::create_file("mnt/cgroup.controllers", "");
+    atf::utils::create_file("proc-cgroup", "1:name=systemd:/\n");
+    ATF_REQUIRE(!process::cgroup::current(fs::path("proc-cgroup"),
+                                          fs::path("mnt")));
+
+    ATF_REQUIRE(!process::cgroup::current(fs::path("missing"),
+                                          fs::path("mnt")));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(current__invalid_path);
+ATF_TEST_CASE_BODY(current__invalid_path)
+{
+    create_hierarchy(fs::path("mnt"), "test");
+
+    atf::utils::create_file("proc-cgroup", "0::test\n");
+    ATF_REQUIRE(!process::cgroup::current(fs::path("proc-cgroup"),
+                                          fs::path("mnt")));
+
+    atf::utils::create_file("proc-cgroup", "0::/test/../..\n");
+    ATF_REQUIRE(!process::cgroup::current(fs::path("proc-cgroup"),
+                                          fs::path("mnt")));
+
+    atf::utils::create_file("proc-cgroup", "0::/other\n");
+    ATF_REQUIRE(!process::cgroup::current(fs::path("proc-cgroup"),
+                                          fs::path("mnt")));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(controllers);
+ATF_TEST_CASE_BODY(controllers)
+{
+    fs::mkdir(fs::path("cg"), 0755);
+    const process::cgroup cgroup(fs::path("cg"));
+    ATF_REQUIRE(cgroup.controllers().empty());
+
+    atf::utils::create_file("cg/cgroup.controllers", "cpuset cpu io memory\n");
+    std::set< std::string > exp_controllers;
+    exp_controllers.insert("cpu");
+    exp_controllers.insert("cpuset");
+    exp_controllers.insert("io");
+    exp_controllers.insert("memory");
+    ATF_REQUIRE(exp_controllers == cgroup.controllers());
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(enable_controllers);
+ATF_TEST_CASE_BODY(enable_controllers)
+{
+    fs::mkdir(fs::path("cg"), 0755);
+    atf::utils::create_file("cg/cgroup.subtree_control", "");
+    process::cgroup cgroup(fs::path("cg"));
+
+    std::set< std::string > controllers;
+    controllers.insert("memory");
+    controllers.insert("cpu");
+    cgroup.enable_controllers(controllers);
+    ATF_REQUIRE(atf::utils::compare_file("cg/cgroup.subtree_control",
+                                         "+cpu +memory"));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(disable_controllers);
+ATF_TEST_CASE_BODY(disable_controllers)
+{
+    fs::mkdir(fs::path("cg"), 0755);
+    atf::utils::create_file("cg/cgroup.subtree_control", "");
+    process::cgroup cgroup(fs::path("cg"));
+
+    std::set< std::string > controllers;
+    controllers.insert("memory");
+    cgroup.disable_controllers(controllers);
+    ATF_REQUIRE(atf::utils::compare_file("cg/cgroup.subtree_control",
+                                         "-memory"));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(enable_controllers__fail);
+ATF_TEST_CASE_BODY(enable_controllers__fail)
+{
+    fs::mkdir(fs::path("cg"), 0755);
+    process::cgroup cgroup(fs::path("cg"));
+
+    std::set< std::string > controllers;
+    controllers.insert("memory");
+    ATF_REQUIRE_THROW_RE(process::system_error, "cgroup.subtree_control",
+                         cgroup.enable_controllers(controllers));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(create_child);
+ATF_TEST_CASE_BODY(create_child)
+{
+    fs::mkdir(fs::path("cg"), 0755);
+    const process::cgroup cgroup(fs::path("cg"));
+
+    const process::cgroup child = cgroup.create_child("foo");
+    ATF_REQUIRE_EQ(fs::path("cg/foo"), child.directory());
+    ATF_REQUIRE(fs::exists(fs::path("cg/foo")));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(attach);
+ATF_TEST_CASE_BODY(attach)
+{
+    fs::mkdir(fs::path("cg"), 0755);
+    atf::utils::create_file("cg/cgroup.procs", "");
+    process::cgroup cgroup(fs::path("cg"));
+
+    cgroup.attach(1234);
+    ATF_REQUIRE(atf::utils::compare_file("cg/cgroup.procs", "1234"));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(set_memory_max);
+ATF_TEST_CASE_BODY(set_memory_max)
+{
+    fs::mkdir(fs::path("cg"), 0755);
+    process::cgroup cgroup(fs::path("cg"));
+
+    atf::utils::create_file("cg/memory.max", "");
+    cgroup.set_memory_max(units::bytes(64 * units::MB));
+    ATF_REQUIRE(atf::utils::compare_file("cg/memory.max", "67108864"));
+
+    atf::utils::create_file("cg/memory.max", "");
+    cgroup.set_memory_max(units::bytes());
+    ATF_REQUIRE(atf::utils::compare_file("cg/memory.max", "max"));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(populated);
+ATF_TEST_CASE_BODY(populated)
+{
+    fs::mkdir(fs::path("cg"), 0755);
+    const process::cgroup cgroup(fs::path("cg"));
+    ATF_REQUIRE(!cgroup.populated());
+
+    atf::utils::create_file("cg/cgroup.procs", "123\n");
+    ATF_REQUIRE(cgroup.populated());
+
+    atf::utils::create_file("cg/cgroup.events", "populated 0\nfrozen 0\n");
+    ATF_REQUIRE(!cgroup.populated());
+
+    atf::utils::create_file("cg/cgroup.events", "populated 1\nfrozen 0\n");
+    ATF_REQUIRE(cgroup.populated());
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(kill);
+ATF_TEST_CASE_BODY(kill)
+{
+    fs::mkdir(fs::path("cg"), 0755);
+    atf::utils::create_file("cg/cgroup.kill", "");
+    process::cgroup cgroup(fs::path("cg"));
+
+    cgroup.kill();
+    ATF_REQUIRE(atf::utils::compare_file("cg/cgroup.kill", "1"));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(kill__no_kill_file);
+ATF_TEST_CASE_BODY(kill__no_kill_file)
+{
+    std::unique_ptr< process::child > child = process::child::fork_capture(
+        child_sleep);
+
+    fs::mkdir(fs::path("cg"), 0755);
+    atf::utils::create_file("cg/cgroup.procs", F("%s\n") % child->pid());
+    process::cgroup cgroup(fs::path("cg"));
+
+    cgroup.kill();
+    const process::status status = child->wait();
+    ATF_REQUIRE(status.signaled());
+    ATF_REQUIRE_EQ(SIGKILL, status.termsig());
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(remove);
+ATF_TEST_CASE_BODY(remove)
+{
+    fs::mkdir(fs::path("cg"), 0755);
+    process::cgroup cgroup(fs::path("cg"));
+
+    cgroup.remove();
+    ATF_REQUIRE(!fs::exists(fs::path("cg")));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(usage);
+ATF_TEST_CASE_BODY(usage)
+{
+    fs::mkdir(fs::path("cg"), 0755);
+    atf::utils::create_file("cg/cpu.stat",
+                            "usage_usec 3500000\n"
+                            "user_usec 2000000\n"
+                            "system_usec 1500000\n"
+                            "nr_periods 0\n");
+    atf::utils::create_file("cg/memory.peak", "1048576\n");
+    const process::cgroup cgroup(fs::path("cg"));
+
+    const process::resource_usage usage = cgroup.usage();
+    ATF_REQUIRE_EQ(datetime::delta(2, 0), usage.user_time);
+    ATF_REQUIRE_EQ(datetime::delta(1, 500000), usage.system_time);
+    ATF_REQUIRE_EQ(1048576, usage.max_rss);
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(usage__unavailable);
+ATF_TEST_CASE_BODY(usage__unavailable)
+{
+    fs::mkdir(fs::path("cg"), 0755);
+    atf::utils::create_file("cg/memory.peak", "garbage\n");
+    const process::cgroup cgroup(fs::path("cg"));
+
+    const process::resource_usage usage = cgroup.usage();
+    ATF_REQUIRE_EQ(datetime::delta(), usage.user_time);
+    ATF_REQUIRE_EQ(datetime::delta(), usage.system_time);
+    ATF_REQUIRE_EQ(0, usage.max_rss);
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(join_cgroup);
+ATF_TEST_CASE_BODY(join_cgroup)
+{
+    atf::utils::create_file("cgroup.procs", "");
+    process::join_cgroup(fs::path("cgroup.procs"));
+    ATF_REQUIRE(atf::utils::compare_file("cgroup.procs", "0"));
+}
+
+
+ATF_INIT_TEST_CASES(tcs)
+{
+    ATF_ADD_TEST_CASE(tcs, current__ok);
+    ATF_ADD_TEST_CASE(tcs, current__root);
+    ATF_ADD_TEST_CASE(tcs, current__hybrid);
+    ATF_ADD_TEST_CASE(tcs, current__unavailable);
+    ATF_ADD_TEST_CASE(tcs, current__invalid_path);
+
+    ATF_ADD_TEST_CASE(tcs, controllers);
+    ATF_ADD_TEST_CASE(tcs, enable_controllers);
+    ATF_ADD_TEST_CASE(tcs, disable_controllers);
+    ATF_ADD_TEST_CASE(tcs, enable_controllers__fail);
+
+    ATF_ADD_TEST_CASE(tcs, create_child);
+    ATF_ADD_TEST_CASE(tcs, attach);
+    ATF_ADD_TEST_CASE(tcs, set_memory_max);
+
+    ATF_ADD_TEST_CASE(tcs, populated);
+    ATF_ADD_TEST_CASE(tcs, kill);
+    ATF_ADD_TEST_CASE(tcs, kill__no_kill_file);
+    ATF_ADD_TEST_CASE(tcs, remove);
+
+    ATF_ADD_TEST_CASE(tcs, usage);
+    ATF_ADD_TEST_CASE(tcs, usage__unavailable);
+
+    ATF_ADD_TEST_CASE(tcs, join_cgroup);
+}
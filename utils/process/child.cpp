@@ -28,7 +28,13 @@
 
 #include "utils/process/child.ipp"
 
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
 extern "C" {
+#include <sys/types.h>
+#include <sys/resource.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
 
@@ -38,8 +44,11 @@ extern "C" {
 }
 
 #include <cerrno>
+#include <cstring>
 #include <iostream>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "utils/defs.hpp"
 #include "utils/format/macros.hpp"
@@ -47,12 +56,14 @@ extern "C" {
 #include "utils/logging/macros.hpp"
 #include "utils/noncopyable.hpp"
 #include "utils/process/exceptions.hpp"
+#include "utils/process/exec_plan.hpp"
 #include "utils/process/fdstream.hpp"
 #include "utils/process/operations.hpp"
 #include "utils/process/system.hpp"
 #include "utils/process/status.hpp"
 #include "utils/sanity.hpp"
 #include "utils/signals/interrupts.hpp"
+#include "utils/signals/misc.hpp"
 
 
 namespace utils {
@@ -143,6 +154,149 @@ log_exec(const fs::path& program, const process::args_vector& args)
 }
 
 
+/// Writes a message to stderr without allocating memory.
+///
+/// \param message The message to write.
+static void
+write_stderr(const char* message)
+{
+    ssize_t ret;
+    while ((ret = ::write(STDERR_FILENO, message, std::strlen(message))) == -1
+           && errno == EINTR) {
+        // Retry.
+    }
+}
+
+
+/// Writes a non-negative integer to stderr without calling into libc.
+///
+/// \param value The number to write.
+static void
+write_stderr_number(int value)
+{
+    char buffer[16];
+    char* digit = &buffer[sizeof(buffer) - 1];
+    *digit = '\0';
+    do {
+        *--digit = static_cast< char >('0' + value % 10);
+        value /= 10;
+    } while (value > 0 && digit != &buffer[0]);
+    write_stderr(digit);
+}
+
+
+/// Reports a failure in a subprocess created by vfork(2) and aborts.
+///
+/// This must not enter the C library beyond raw system calls: strerror(3) may
+/// write to a static buffer shared with the parent and abort(3) takes locks
+/// that the parent may need later, so the error is reported by number and the
+/// process kills itself with SIGABRT instead.  The dispositions of all signals
+/// are the default ones by the time this is called, but SIGABRT may still be
+/// blocked.
+///
+/// \param what Description of the operation that failed.
+/// \param error The errno value of the failure.
+static void
+abort_vforked(const char* what, const int error) UTILS_NORETURN;
+static void
+abort_vforked(const char* what, const int error)
+{
+    write_stderr(what);
+    write_stderr(": errno ");
+    write_stderr_number(error);
+    write_stderr("\n");
+
+    ::sigset_t abort_signal;
+    ::sigemptyset(&abort_signal);
+    ::sigaddset(&abort_signal, SIGABRT);
+    (void)::sigprocmask(SIG_UNBLOCK, &abort_signal, NULL);
+    (void)::kill(::getpid(), SIGABRT);
+    ::_exit(127);
+}
+
+
+/// Body of a subprocess spawned by child::spawn_plan().
+///
+/// This runs in a subprocess that may share the address space of its parent
+/// until it calls exec(2) or terminates, so it must only issue system calls
+/// with the data precomputed by the parent: no memory allocation, no
+/// exceptions and no changes to any global state are allowed.
+///
+/// \param argv The arguments to the binary, including the program name.
+/// \param envp The environment of the binary.
+/// \param cgroup_fd File descriptor of the cgroup.procs file of the cgroup to
+///     join, or -1 to stay in ours.
+/// \param cgroup_error Error message to print if joining the cgroup fails.
+/// \param stdout_fd File descriptor to use as stdout, or -1 to inherit ours.
+/// \param stderr_fd File descriptor to use as stderr, or -1 to inherit ours.
+/// \param work_directory Directory to enter, or NULL to inherit ours.
+/// \param chdir_error Error message to print if entering work_directory fails.
+/// \param core_limit Core size limit to set, or NULL to inherit ours.
+/// \param mask File creation mask to set, or -1 to inherit ours.
+/// \param old_mask Signal mask to restore before executing the binary.
+/// \param exec_error Error message to print if executing the binary fails.
+static void
+exec_vforked(char* const* argv, char* const* envp,
+             const int cgroup_fd, const char* cgroup_error,
+             const int stdout_fd, const int stderr_fd,
+             const char* work_directory, const char* chdir_error,
+             const struct ::rlimit* core_limit, const int mask,
+             const ::sigset_t* old_mask, const char* exec_error)
+    UTILS_NORETURN;
+static void
+exec_vforked(char* const* argv, char* const* envp,
+             const int cgroup_fd, const char* cgroup_error,
+             const int stdout_fd, const int stderr_fd,
+             const char* work_directory, const char* chdir_error,
+             const struct ::rlimit* core_limit, const int mask,
+             const ::sigset_t* old_mask, const char* exec_error)
+{
+    // The dispositions of caught signals would be reset by exec(2) anyway, but
+    // we must not let any of our handlers run in here while we still share
+    // memory with the parent.  Resetting the ignored ones too matches what
+    // isolate_child() does for the fork(2)-based path.
+    struct ::sigaction sa;
+    std::memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = SIG_DFL;
+    ::sigemptyset(&sa.sa_mask);
+    for (int signo = 1; signo <= utils::signals::last_signo; ++signo) {
+        if (signo != SIGKILL && signo != SIGSTOP)
+            (void)::sigaction(signo, &sa, NULL);
+    }
+
+    (void)::setsid();
+
+    if (cgroup_fd != -1) {
+        if (::write(cgroup_fd, "0", 1) == -1)
+            abort_vforked(cgroup_error, errno);
+        ::close(cgroup_fd);
+    }
+
+    if (stdout_fd != -1) {
+        if (process::detail::syscall_dup2(stdout_fd, STDOUT_FILENO) == -1)
+            abort_vforked("Failed to set up subprocess: dup2 failed", errno);
+        ::close(stdout_fd);
+    }
+    if (stderr_fd != -1) {
+        if (process::detail::syscall_dup2(stderr_fd, STDERR_FILENO) == -1)
+            abort_vforked("Failed to set up subprocess: dup2 failed", errno);
+        ::close(stderr_fd);
+    }
+
+    if (work_directory != NULL && ::chdir(work_directory) == -1)
+        abort_vforked(chdir_error, errno);
+    if (core_limit != NULL)
+        (void)::setrlimit(RLIMIT_CORE, core_limit);
+    if (mask != -1)
+        (void)::umask(static_cast< ::mode_t >(mask));
+
+    (void)::sigprocmask(SIG_SETMASK, old_mask, NULL);
+
+    (void)::execve(argv[0], argv, envp);
+    abort_vforked(exec_error, errno);
+}
+
+
 }  // anonymous namespace
 
 
@@ -349,6 +503,159 @@ process::child::spawn_files(const fs::path& program,
 }
 
 
+/// Spawns a new binary as described by a precomputed plan.
+///
+/// Unlike the fork-based methods in this class, the subprocess does not need
+/// to run any code of ours after its creation: the parent computes everything
+/// the subprocess needs, and the subprocess just issues the system calls that
+/// apply the plan before it executes the binary.  This allows using vfork(2),
+/// where available, which saves duplicating the address space of the parent.
+/// The savings are significant when the parent is large and when it spawns
+/// many short-lived subprocesses, as the test scheduler does.
+///
+/// The subprocess is isolated in its own session and its signal dispositions
+/// are reset to their defaults, just like with fork_files().
+///
+/// If the subprocess cannot be completely set up for any reason, it attempts to
+/// dump an error message to its stderr channel and it then calls std::abort().
+///
+/// \param plan The description of the subprocess.
+/// \param stdout_file The name of the file in which to store the stdout.
+///     If this has the magic value /dev/stdout, then the parent's stdout is
+///     reused without applying any redirection.
+/// \param stderr_file The name of the file in which to store the stderr.
+///     If this has the magic value /dev/stderr, then the parent's stderr is
+///     reused without applying any redirection.
+///
+/// \return A new child object, returned as a dynamically-allocated object
+/// because children classes are unique and thus noncopyable.
+///
+/// \throw process::system_error If the process cannot be spawned due to a
+///     system call error.
+std::unique_ptr< process::child >
+process::child::spawn_plan(const exec_plan& plan,
+                           const fs::path& stdout_file,
+                           const fs::path& stderr_file)
+{
+    std::vector< char* > argv;
+    argv.push_back(const_cast< char* >(plan.program().c_str()));
+    for (args_vector::const_iterator iter = plan.args().begin();
+         iter != plan.args().end(); ++iter)
+        argv.push_back(const_cast< char* >((*iter).c_str()));
+    argv.push_back(NULL);
+
+    const std::vector< std::string > environment = plan.environment();
+    std::vector< char* > envp;
+    for (std::vector< std::string >::const_iterator iter = environment.begin();
+         iter != environment.end(); ++iter)
+        envp.push_back(const_cast< char* >((*iter).c_str()));
+    envp.push_back(NULL);
+
+    struct ::rlimit core_limit;
+    bool set_core_limit = false;
+    if (plan.unlimit_core() && ::getrlimit(RLIMIT_CORE, &core_limit) != -1 &&
+        core_limit.rlim_max != 0) {
+        core_limit.rlim_cur = core_limit.rlim_max;
+        set_core_limit = true;
+    }
+
+    const char* work_directory = plan.work_directory() ?
+        plan.work_directory().get().c_str() : NULL;
+    std::string chdir_error;
+    if (plan.work_directory())
+        chdir_error = F("Failed to set up subprocess: chdir(%s) failed") %
+            plan.work_directory().get();
+    const std::string exec_error = F("Failed to execute %s") %
+        plan.program();
+    const int mask = plan.umask() ? plan.umask().get() : -1;
+
+    const int stdout_fd = stdout_file == fs::path("/dev/stdout") ?
+        -1 : open_for_append(stdout_file);
+    int stderr_fd;
+    try {
+        stderr_fd = stderr_file == fs::path("/dev/stderr") ?
+            -1 : open_for_append(stderr_file);
+    } catch (...) {
+        if (stdout_fd != -1)
+            ::close(stdout_fd);
+        throw;
+    }
+
+    int cgroup_fd = -1;
+    std::string cgroup_error;
+    if (plan.cgroup_procs()) {
+        cgroup_fd = process::detail::syscall_open(
+            plan.cgroup_procs().get().c_str(), O_WRONLY | O_CLOEXEC, 0);
+        if (cgroup_fd == -1) {
+            const int original_errno = errno;
+            if (stdout_fd != -1)
+                ::close(stdout_fd);
+            if (stderr_fd != -1)
+                ::close(stderr_fd);
+            throw process::system_error(F("Failed to open %s") %
+                                        plan.cgroup_procs().get(),
+                                        original_errno);
+        }
+        cgroup_error = F("Failed to set up subprocess: cannot join cgroup "
+                         "through %s") % plan.cgroup_procs().get();
+    }
+
+    // Block all signals so that none of our handlers can run in the
+    // subprocess while it shares our address space.  The subprocess restores
+    // the original mask right before executing the binary.
+    ::sigset_t all_signals, old_mask;
+    ::sigfillset(&all_signals);
+    if (::sigprocmask(SIG_SETMASK, &all_signals, &old_mask) == -1) {
+        const int original_errno = errno;
+        if (stdout_fd != -1)
+            ::close(stdout_fd);
+        if (stderr_fd != -1)
+            ::close(stderr_fd);
+        if (cgroup_fd != -1)
+            ::close(cgroup_fd);
+        throw process::system_error("sigprocmask(2) failed", original_errno);
+    }
+
+    std::unique_ptr< signals::interrupts_inhibiter > inhibiter(
+        new signals::interrupts_inhibiter);
+#if defined(HAVE_WORKING_VFORK)
+    const pid_t pid = ::vfork();
+#else
+    const pid_t pid = ::fork();
+#endif
+    if (pid == 0) {
+        exec_vforked(&argv[0], &envp[0], cgroup_fd, cgroup_error.c_str(),
+                     stdout_fd, stderr_fd,
+                     work_directory, chdir_error.c_str(),
+                     set_core_limit ? &core_limit : NULL, mask, &old_mask,
+                     exec_error.c_str());
+    }
+    const int original_errno = errno;
+
+    if (stdout_fd != -1)
+        ::close(stdout_fd);
+    if (stderr_fd != -1)
+        ::close(stderr_fd);
+    if (cgroup_fd != -1)
+        ::close(cgroup_fd);
+
+    if (pid == -1) {
+        inhibiter.reset();
+        (void)::sigprocmask(SIG_SETMASK, &old_mask, NULL);
+        throw process::system_error("vfork(2) failed", original_errno);
+    }
+
+    LD(F("Spawned process %s: stdout=%s, stderr=%s") % pid % stdout_file %
+       stderr_file);
+    signals::add_pid_to_kill(pid);
+    inhibiter.reset();
+    (void)::sigprocmask(SIG_SETMASK, &old_mask, NULL);
+    log_exec(plan.program(), plan.args());
+    return std::unique_ptr< process::child >(
+        new process::child(new impl(pid, NULL)));
+}
+
+
 /// Returns the process identifier of this child.
 ///
 /// \return A process identifier.
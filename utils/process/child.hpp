@@ -55,6 +55,7 @@
 #include "utils/defs.hpp"
 #include "utils/fs/path_fwd.hpp"
 #include "utils/noncopyable.hpp"
+#include "utils/process/exec_plan_fwd.hpp"
 #include "utils/process/operations_fwd.hpp"
 #include "utils/process/status_fwd.hpp"
 
@@ -100,6 +101,8 @@ public:
         const fs::path&, const args_vector&);
     static std::unique_ptr< child > spawn_files(
         const fs::path&, const args_vector&, const fs::path&, const fs::path&);
+    static std::unique_ptr< child > spawn_plan(
+        const exec_plan&, const fs::path&, const fs::path&);
 
     int pid(void) const;
 
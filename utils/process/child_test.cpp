@@ -54,6 +54,7 @@ extern "C" {
 #include "utils/fs/path.hpp"
 #include "utils/logging/macros.hpp"
 #include "utils/process/exceptions.hpp"
+#include "utils/process/exec_plan.hpp"
 #include "utils/process/status.hpp"
 #include "utils/process/system.hpp"
 #include "utils/sanity.hpp"
@@ -787,6 +788,128 @@ ATF_TEST_CASE_BODY(child__spawn__missing_program)
 }
 
 
+ATF_TEST_CASE_WITHOUT_HEAD(child__spawn_plan__ok);
+ATF_TEST_CASE_BODY(child__spawn_plan__ok)
+{
+    std::vector< std::string > args;
+    args.push_back("return-code");
+    args.push_back("15");
+
+    std::unique_ptr< process::child > child = process::child::spawn_plan(
+        process::exec_plan(get_helpers(this), args),
+        fs::path("out"), fs::path("err"));
+
+    const process::status status = child->wait();
+    ATF_REQUIRE(status.exited());
+    ATF_REQUIRE_EQ(15, status.exitstatus());
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(child__spawn_plan__apply);
+ATF_TEST_CASE_BODY(child__spawn_plan__apply)
+{
+    utils::setenv("PLAN_KEPT", "kept value");
+    utils::setenv("PLAN_REMOVED", "removed value");
+    ATF_REQUIRE(::mkdir("work", 0755) != -1);
+
+    std::vector< std::string > args;
+    args.push_back("print-state");
+    args.push_back("PLAN_KEPT");
+    args.push_back("PLAN_REMOVED");
+    args.push_back("PLAN_ADDED");
+
+    process::exec_plan plan(get_helpers(this), args);
+    plan.set_env("PLAN_ADDED", "added value")
+        .unset_env("PLAN_REMOVED")
+        .set_work_directory(fs::current_path() / "work")
+        .set_umask(0027);
+    std::unique_ptr< process::child > child = process::child::spawn_plan(
+        plan, fs::path("out"), fs::path("err"));
+
+    const process::status status = child->wait();
+    ATF_REQUIRE(status.exited());
+    ATF_REQUIRE_EQ(EXIT_SUCCESS, status.exitstatus());
+
+    ATF_REQUIRE(atf::utils::grep_file(
+        F("^cwd = %s$") % (fs::current_path() / "work"), "out"));
+    ATF_REQUIRE(atf::utils::grep_file("^umask = 27$", "out"));
+    ATF_REQUIRE(atf::utils::grep_file("^session = own$", "out"));
+    ATF_REQUIRE(atf::utils::grep_file("^PLAN_KEPT = kept value$", "out"));
+    ATF_REQUIRE(atf::utils::grep_file("^PLAN_REMOVED = \\(unset\\)$", "out"));
+    ATF_REQUIRE(atf::utils::grep_file("^PLAN_ADDED = added value$", "out"));
+
+    // The plan must not have leaked into our own process.
+    ATF_REQUIRE(utils::getenv("PLAN_REMOVED"));
+    ATF_REQUIRE(!utils::getenv("PLAN_ADDED"));
+    ATF_REQUIRE(fs::current_path().leaf_name() != "work");
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(child__spawn_plan__append_output);
+ATF_TEST_CASE_BODY(child__spawn_plan__append_output)
+{
+    atf::utils::create_file("out", "previous contents\n");
+
+    std::vector< std::string > args;
+    args.push_back("print-args");
+    std::unique_ptr< process::child > child = process::child::spawn_plan(
+        process::exec_plan(get_helpers(this), args),
+        fs::path("out"), fs::path("err"));
+
+    const process::status status = child->wait();
+    ATF_REQUIRE(status.exited());
+    ATF_REQUIRE_EQ(EXIT_SUCCESS, status.exitstatus());
+
+    ATF_REQUIRE(atf::utils::grep_file("^previous contents$", "out"));
+    ATF_REQUIRE(atf::utils::grep_file("^argv\\[1\\] = print-args$", "out"));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(child__spawn_plan__missing_program);
+ATF_TEST_CASE_BODY(child__spawn_plan__missing_program)
+{
+    std::unique_ptr< process::child > child = process::child::spawn_plan(
+        process::exec_plan(fs::path("a/b/c"), process::args_vector()),
+        fs::path("out"), fs::path("err"));
+
+    const process::status status = child->wait();
+    ATF_REQUIRE(status.signaled());
+    ATF_REQUIRE_EQ(SIGABRT, status.termsig());
+    ATF_REQUIRE(atf::utils::grep_file(
+        F("^Failed to execute a/b/c: errno %s$") % ENOENT, "err"));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(child__spawn_plan__chdir_fail);
+ATF_TEST_CASE_BODY(child__spawn_plan__chdir_fail)
+{
+    process::exec_plan plan(get_helpers(this), process::args_vector());
+    plan.set_work_directory(fs::path("missing"));
+    std::unique_ptr< process::child > child = process::child::spawn_plan(
+        plan, fs::path("out"), fs::path("err"));
+
+    const process::status status = child->wait();
+    ATF_REQUIRE(status.signaled());
+    ATF_REQUIRE_EQ(SIGABRT, status.termsig());
+    ATF_REQUIRE(atf::utils::grep_file("chdir\\(missing\\) failed", "err"));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(child__spawn_plan__create_stdout_fail);
+ATF_TEST_CASE_BODY(child__spawn_plan__create_stdout_fail)
+{
+    try {
+        process::child::spawn_plan(
+            process::exec_plan(get_helpers(this), process::args_vector()),
+            fs::path("missing/out"), fs::path("err"));
+        fail("system_error not raised");
+    } catch (const process::system_error& e) {
+        ATF_REQUIRE(atf::utils::grep_string("missing/out", e.what()));
+        ATF_REQUIRE_EQ(ENOENT, e.original_errno());
+    }
+}
+
+
 ATF_TEST_CASE_WITHOUT_HEAD(child__pid);
 ATF_TEST_CASE_BODY(child__pid)
 {
@@ -842,5 +965,12 @@ ATF_INIT_TEST_CASES(tcs)
     ATF_ADD_TEST_CASE(tcs, child__spawn__some_args);
     ATF_ADD_TEST_CASE(tcs, child__spawn__missing_program);
 
+    ATF_ADD_TEST_CASE(tcs, child__spawn_plan__ok);
+    ATF_ADD_TEST_CASE(tcs, child__spawn_plan__apply);
+    ATF_ADD_TEST_CASE(tcs, child__spawn_plan__append_output);
+    ATF_ADD_TEST_CASE(tcs, child__spawn_plan__missing_program);
+    ATF_ADD_TEST_CASE(tcs, child__spawn_plan__chdir_fail);
+    ATF_ADD_TEST_CASE(tcs, child__spawn_plan__create_stdout_fail);
+
     ATF_ADD_TEST_CASE(tcs, child__pid);
 }
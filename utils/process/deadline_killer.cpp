@@ -28,7 +28,14 @@
 
 #include "utils/process/deadline_killer.hpp"
 
+extern "C" {
+#include <fcntl.h>
+#include <unistd.h>
+}
+
 #include "utils/datetime.hpp"
+#include "utils/fs/path.hpp"
+#include "utils/optional.ipp"
 #include "utils/process/operations.hpp"
 
 namespace datetime = utils::datetime;
@@ -46,9 +53,31 @@ process::deadline_killer::deadline_killer(const datetime::delta& delta,
 }
 
 
+/// Constructor.
+///
+/// \param delta Time to the timer activation.
+/// \param pid PID of the process (and process group) to kill.
+/// \param kill_file If not none, the cgroup.kill file of the cgroup in which
+///     the process runs.
+process::deadline_killer::deadline_killer(
+    const datetime::delta& delta, const int pid,
+    const optional< fs::path >& kill_file) :
+    signals::timer(delta), _pid(pid),
+    _kill_file(kill_file ? kill_file.get().str() : std::string())
+{
+}
+
+
 /// Timer activation callback.
 void
 process::deadline_killer::callback(void)
 {
+    if (!_kill_file.empty()) {
+        const int fd = ::open(_kill_file.c_str(), O_WRONLY | O_CLOEXEC);
+        if (fd != -1) {
+            (void)::write(fd, "1", 1);
+            ::close(fd);
+        }
+    }
     process::terminate_group(_pid);
 }
@@ -34,6 +34,10 @@
 
 #include "utils/process/deadline_killer_fwd.hpp"
 
+#include <string>
+
+#include "utils/fs/path_fwd.hpp"
+#include "utils/optional_fwd.hpp"
 #include "utils/signals/timer.hpp"
 
 namespace utils {
@@ -41,14 +45,25 @@ namespace process {
 
 
 /// Timer that forcibly kills a process group on activation.
+///
+/// If the process runs in its own cgroup, the whole cgroup is killed as well
+/// to catch any descendants that left the process group.
 class deadline_killer : public utils::signals::timer {
     /// PID of the process (and process group) to kill.
     const int _pid;
 
+    /// The cgroup.kill file of the cgroup to kill, or empty if none.
+    ///
+    /// This is precomputed as a plain string because the callback runs in a
+    /// signal handler.
+    const std::string _kill_file;
+
     void callback(void);
 
 public:
     deadline_killer(const datetime::delta&, const int);
+    deadline_killer(const datetime::delta&, const int,
+                    const utils::optional< utils::fs::path >&);
 };
 
 
@@ -38,10 +38,13 @@ extern "C" {
 #include <atf-c++.hpp>
 
 #include "utils/datetime.hpp"
+#include "utils/fs/path.hpp"
+#include "utils/optional.ipp"
 #include "utils/process/child.ipp"
 #include "utils/process/status.hpp"
 
 namespace datetime = utils::datetime;
+namespace fs = utils::fs;
 namespace process = utils::process;
 
 
@@ -82,6 +85,27 @@ ATF_TEST_CASE_BODY(activation)
 }
 
 
+ATF_TEST_CASE_WITHOUT_HEAD(activation__kill_file);
+ATF_TEST_CASE_BODY(activation__kill_file)
+{
+    atf::utils::create_file("cgroup.kill", "");
+
+    std::unique_ptr< process::child > child = process::child::fork_capture(
+        child_sleep< 60 >);
+
+    process::deadline_killer killer(datetime::delta(1, 0), child->pid(),
+                                    utils::make_optional(
+                                        fs::path("cgroup.kill")));
+    const process::status status = child->wait();
+    killer.unprogram();
+
+    ATF_REQUIRE(killer.fired());
+    ATF_REQUIRE(status.signaled());
+    ATF_REQUIRE_EQ(SIGKILL, status.termsig());
+    ATF_REQUIRE(atf::utils::compare_file("cgroup.kill", "1"));
+}
+
+
 ATF_TEST_CASE_WITHOUT_HEAD(no_activation);
 ATF_TEST_CASE_BODY(no_activation)
 {
@@ -104,5 +128,6 @@ ATF_TEST_CASE_BODY(no_activation)
 ATF_INIT_TEST_CASES(tcs)
 {
     ATF_ADD_TEST_CASE(tcs, activation);
+    ATF_ADD_TEST_CASE(tcs, activation__kill_file);
     ATF_ADD_TEST_CASE(tcs, no_activation);
 }
@@ -0,0 +1,287 @@
+// Copyright 2026 The Kyua Authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// * Neither the name of Google Inc. nor the names of its contributors
+//   may be used to endorse or promote products derived from this software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "utils/process/exec_plan.hpp"
+
+extern "C" {
+#include <sys/stat.h>
+
+#include <unistd.h>
+}
+
+#include <cerrno>
+#include <cstdlib>
+#include <iostream>
+
+#include "utils/env.hpp"
+#include "utils/format/macros.hpp"
+#include "utils/process/cgroup.hpp"
+#include "utils/process/exceptions.hpp"
+#include "utils/process/operations.hpp"
+#include "utils/stacktrace.hpp"
+
+namespace process = utils::process;
+
+using utils::none;
+using utils::optional;
+
+
+/// Constructs a new plan that executes a binary with no further changes.
+///
+/// \param program_ The binary to execute.
+/// \param args_ The arguments to pass to the binary, without the program name.
+process::exec_plan::exec_plan(const fs::path& program_,
+                              const args_vector& args_) :
+    _program(program_),
+    _args(args_),
+    _unlimit_core(false)
+{
+}
+
+
+/// Sets an environment variable for the subprocess.
+///
+/// \param name The name of the variable.
+/// \param value The value of the variable.
+///
+/// \return A reference to this plan, to allow chaining.
+process::exec_plan&
+process::exec_plan::set_env(const std::string& name, const std::string& value)
+{
+    _environment_changes.erase(name);
+    _environment_changes.insert(std::make_pair(name,
+                                               utils::make_optional(value)));
+    return *this;
+}
+
+
+/// Removes an environment variable from the subprocess.
+///
+/// \param name The name of the variable.
+///
+/// \return A reference to this plan, to allow chaining.
+process::exec_plan&
+process::exec_plan::unset_env(const std::string& name)
+{
+    _environment_changes.erase(name);
+    _environment_changes.insert(std::make_pair(name,
+                                               optional< std::string >(none)));
+    return *this;
+}
+
+
+/// Sets the directory in which to execute the subprocess.
+///
+/// \param directory The directory to enter.
+///
+/// \return A reference to this plan, to allow chaining.
+process::exec_plan&
+process::exec_plan::set_work_directory(const fs::path& directory)
+{
+    _work_directory = directory;
+    return *this;
+}
+
+
+/// Sets the file creation mask of the subprocess.
+///
+/// \param mask The new file creation mask.
+///
+/// \return A reference to this plan, to allow chaining.
+process::exec_plan&
+process::exec_plan::set_umask(const int mask)
+{
+    _umask = mask;
+    return *this;
+}
+
+
+/// Requests the soft core size limit of the subprocess to be maximized.
+///
+/// \return A reference to this plan, to allow chaining.
+process::exec_plan&
+process::exec_plan::set_unlimit_core(void)
+{
+    _unlimit_core = true;
+    return *this;
+}
+
+
+/// Requests the subprocess to join a cgroup before executing the binary.
+///
+/// \param procs_file The cgroup.procs file of the cgroup to join.
+///
+/// \return A reference to this plan, to allow chaining.
+process::exec_plan&
+process::exec_plan::set_cgroup(const fs::path& procs_file)
+{
+    _cgroup_procs = procs_file;
+    return *this;
+}
+
+
+/// Gets the binary to execute.
+///
+/// \return A path to the binary.
+const utils::fs::path&
+process::exec_plan::program(void) const
+{
+    return _program;
+}
+
+
+/// Gets the arguments to pass to the binary.
+///
+/// \return The arguments, without the program name.
+const process::args_vector&
+process::exec_plan::args(void) const
+{
+    return _args;
+}
+
+
+/// Computes the full environment of the subprocess.
+///
+/// \return The environment of the current process with the changes of this
+/// plan applied, as a collection of NAME=VALUE strings suitable to be passed
+/// to execve(2).
+std::vector< std::string >
+process::exec_plan::environment(void) const
+{
+    std::map< std::string, std::string > variables = utils::getallenv();
+    for (std::map< std::string, optional< std::string > >::const_iterator
+             iter = _environment_changes.begin();
+         iter != _environment_changes.end(); ++iter) {
+        if ((*iter).second)
+            variables[(*iter).first] = (*iter).second.get();
+        else
+            variables.erase((*iter).first);
+    }
+
+    std::vector< std::string > environment;
+    for (std::map< std::string, std::string >::const_iterator
+             iter = variables.begin(); iter != variables.end(); ++iter)
+        environment.push_back(F("%s=%s") % (*iter).first % (*iter).second);
+    return environment;
+}
+
+
+/// Gets the directory in which to execute the subprocess.
+///
+/// \return A directory or none if the subprocess inherits ours.
+const utils::optional< utils::fs::path >&
+process::exec_plan::work_directory(void) const
+{
+    return _work_directory;
+}
+
+
+/// Gets the file creation mask of the subprocess.
+///
+/// \return A file creation mask or none if the subprocess inherits ours.
+const utils::optional< int >&
+process::exec_plan::umask(void) const
+{
+    return _umask;
+}
+
+
+/// Checks whether the soft core size limit of the subprocess is maximized.
+///
+/// \return True if the limit has to be raised; false otherwise.
+bool
+process::exec_plan::unlimit_core(void) const
+{
+    return _unlimit_core;
+}
+
+
+/// Gets the cgroup that the subprocess joins.
+///
+/// \return The cgroup.procs file of the cgroup, or none if the subprocess
+/// stays in ours.
+const utils::optional< utils::fs::path >&
+process::exec_plan::cgroup_procs(void) const
+{
+    return _cgroup_procs;
+}
+
+
+/// Applies the plan, except for the execution of the binary, to this process.
+///
+/// This is used to run plans in subprocesses that have been created with
+/// fork(2) for any reason, such as when they have to run additional code
+/// before the plan takes effect.
+///
+/// \throw process::system_error If any of the changes cannot be applied.
+void
+process::exec_plan::apply(void) const
+{
+    if (_cgroup_procs)
+        process::join_cgroup(_cgroup_procs.get());
+
+    for (std::map< std::string, optional< std::string > >::const_iterator
+             iter = _environment_changes.begin();
+         iter != _environment_changes.end(); ++iter) {
+        if ((*iter).second)
+            utils::setenv((*iter).first, (*iter).second.get());
+        else
+            utils::unsetenv((*iter).first);
+    }
+
+    if (_work_directory) {
+        if (::chdir(_work_directory.get().c_str()) == -1) {
+            const int original_errno = errno;
+            throw process::system_error(F("chdir(%s) failed") %
+                                        _work_directory.get(), original_errno);
+        }
+    }
+
+    if (_unlimit_core)
+        (void)utils::unlimit_core_size();
+
+    if (_umask)
+        (void)::umask(static_cast< ::mode_t >(_umask.get()));
+}
+
+
+/// Applies the plan to this process and executes the binary.
+///
+/// If the plan cannot be applied, this dumps an error message to stderr and
+/// calls std::abort(), in the same way process::exec() does.
+void
+process::exec_plan::exec(void) const throw()
+{
+    try {
+        apply();
+    } catch (const process::system_error& e) {
+        std::cerr << F("Failed to set up subprocess: %s\n") % e.what();
+        std::abort();
+    }
+    process::exec(_program, _args);
+}
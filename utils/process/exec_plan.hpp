@@ -0,0 +1,108 @@
+// Copyright 2026 The Kyua Authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// * Neither the name of Google Inc. nor the names of its contributors
+//   may be used to endorse or promote products derived from this software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/// \file utils/process/exec_plan.hpp
+/// Provides the utils::process::exec_plan class.
+///
+/// An execution plan describes a subprocess that does not need to run any code
+/// of our own between its creation and the exec(2) of the target binary: all
+/// the preparation it needs can be expressed as a fixed sequence of changes to
+/// the environment, the work directory and a few process attributes.  Such
+/// subprocesses can be spawned without duplicating our address space; see
+/// child::spawn_plan() for details.
+
+#if !defined(UTILS_PROCESS_EXEC_PLAN_HPP)
+#define UTILS_PROCESS_EXEC_PLAN_HPP
+
+#include "utils/process/exec_plan_fwd.hpp"
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "utils/defs.hpp"
+#include "utils/fs/path.hpp"
+#include "utils/optional.ipp"
+#include "utils/process/operations_fwd.hpp"
+
+namespace utils {
+namespace process {
+
+
+/// Precomputed description of how to execute a subprocess.
+class exec_plan {
+    /// The binary to execute.
+    fs::path _program;
+
+    /// The arguments to pass to the binary, without the program name.
+    args_vector _args;
+
+    /// Changes to apply to the inherited environment.
+    ///
+    /// A variable mapped to none is removed from the environment.
+    std::map< std::string, optional< std::string > > _environment_changes;
+
+    /// Directory to enter before executing the binary, if any.
+    optional< fs::path > _work_directory;
+
+    /// File creation mask to set before executing the binary, if any.
+    optional< int > _umask;
+
+    /// Whether to raise the soft core size limit to its maximum.
+    bool _unlimit_core;
+
+    /// The cgroup.procs file of the cgroup to join, if any.
+    optional< fs::path > _cgroup_procs;
+
+public:
+    exec_plan(const fs::path&, const args_vector&);
+
+    exec_plan& set_env(const std::string&, const std::string&);
+    exec_plan& unset_env(const std::string&);
+    exec_plan& set_work_directory(const fs::path&);
+    exec_plan& set_umask(const int);
+    exec_plan& set_unlimit_core(void);
+    exec_plan& set_cgroup(const fs::path&);
+
+    const fs::path& program(void) const;
+    const args_vector& args(void) const;
+    std::vector< std::string > environment(void) const;
+    const optional< fs::path >& work_directory(void) const;
+    const optional< int >& umask(void) const;
+    bool unlimit_core(void) const;
+    const optional< fs::path >& cgroup_procs(void) const;
+
+    void apply(void) const;
+    void exec(void) const throw() UTILS_NORETURN;
+};
+
+
+}  // namespace process
+}  // namespace utils
+
+#endif  // !defined(UTILS_PROCESS_EXEC_PLAN_HPP)
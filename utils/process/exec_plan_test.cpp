@@ -0,0 +1,204 @@
+// Copyright 2026 The Kyua Authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// * Neither the name of Google Inc. nor the names of its contributors
+//   may be used to endorse or promote products derived from this software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "utils/process/exec_plan.hpp"
+
+extern "C" {
+#include <sys/stat.h>
+
+#include <unistd.h>
+}
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <atf-c++.hpp>
+
+#include "utils/env.hpp"
+#include "utils/fs/operations.hpp"
+#include "utils/fs/path.hpp"
+#include "utils/optional.ipp"
+#include "utils/process/exceptions.hpp"
+
+namespace fs = utils::fs;
+namespace process = utils::process;
+
+
+namespace {
+
+
+/// Checks if a NAME=VALUE string is part of an environment.
+///
+/// \param environment The environment to look into.
+/// \param entry The NAME=VALUE string to look for.
+///
+/// \return True if the entry is in the environment; false otherwise.
+static bool
+has_entry(const std::vector< std::string >& environment,
+          const std::string& entry)
+{
+    return std::find(environment.begin(), environment.end(), entry) !=
+        environment.end();
+}
+
+
+/// Checks if a variable is defined in an environment.
+///
+/// \param environment The environment to look into.
+/// \param name The name of the variable to look for.
+///
+/// \return True if the variable is in the environment; false otherwise.
+static bool
+has_variable(const std::vector< std::string >& environment,
+             const std::string& name)
+{
+    for (std::vector< std::string >::const_iterator iter = environment.begin();
+         iter != environment.end(); ++iter) {
+        if ((*iter).compare(0, name.length() + 1, name + "=") == 0)
+            return true;
+    }
+    return false;
+}
+
+
+}  // anonymous namespace
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(defaults);
+ATF_TEST_CASE_BODY(defaults)
+{
+    process::args_vector args;
+    args.push_back("first");
+    args.push_back("second");
+    const process::exec_plan plan(fs::path("/bin/program"), args);
+
+    ATF_REQUIRE_EQ(fs::path("/bin/program"), plan.program());
+    ATF_REQUIRE(args == plan.args());
+    ATF_REQUIRE(!plan.work_directory());
+    ATF_REQUIRE(!plan.umask());
+    ATF_REQUIRE(!plan.unlimit_core());
+    ATF_REQUIRE(!plan.cgroup_procs());
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(setters);
+ATF_TEST_CASE_BODY(setters)
+{
+    process::exec_plan plan(fs::path("program"), process::args_vector());
+    plan.set_work_directory(fs::path("/some/dir"))
+        .set_umask(0027)
+        .set_unlimit_core()
+        .set_cgroup(fs::path("/sys/fs/cgroup/test/cgroup.procs"));
+
+    ATF_REQUIRE_EQ(fs::path("/some/dir"), plan.work_directory().get());
+    ATF_REQUIRE_EQ(0027, plan.umask().get());
+    ATF_REQUIRE(plan.unlimit_core());
+    ATF_REQUIRE_EQ(fs::path("/sys/fs/cgroup/test/cgroup.procs"),
+                   plan.cgroup_procs().get());
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(environment__inherit);
+ATF_TEST_CASE_BODY(environment__inherit)
+{
+    utils::setenv("EXEC_PLAN_TEST", "the value");
+
+    const process::exec_plan plan(fs::path("program"), process::args_vector());
+    const std::vector< std::string > environment = plan.environment();
+    ATF_REQUIRE(has_entry(environment, "EXEC_PLAN_TEST=the value"));
+    ATF_REQUIRE_EQ(utils::getallenv().size(), environment.size());
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(environment__changes);
+ATF_TEST_CASE_BODY(environment__changes)
+{
+    utils::setenv("EXEC_PLAN_KEEP", "keep");
+    utils::setenv("EXEC_PLAN_OVERRIDE", "old");
+    utils::setenv("EXEC_PLAN_REMOVE", "remove");
+
+    process::exec_plan plan(fs::path("program"), process::args_vector());
+    plan.set_env("EXEC_PLAN_OVERRIDE", "new")
+        .unset_env("EXEC_PLAN_REMOVE")
+        .set_env("EXEC_PLAN_ADD", "first")
+        .unset_env("EXEC_PLAN_ADD")
+        .set_env("EXEC_PLAN_ADD", "second");
+
+    const std::vector< std::string > environment = plan.environment();
+    ATF_REQUIRE(has_entry(environment, "EXEC_PLAN_KEEP=keep"));
+    ATF_REQUIRE(has_entry(environment, "EXEC_PLAN_OVERRIDE=new"));
+    ATF_REQUIRE(!has_variable(environment, "EXEC_PLAN_REMOVE"));
+    ATF_REQUIRE(has_entry(environment, "EXEC_PLAN_ADD=second"));
+
+    ATF_REQUIRE_EQ("old", utils::getenv("EXEC_PLAN_OVERRIDE").get());
+    ATF_REQUIRE(utils::getenv("EXEC_PLAN_REMOVE"));
+    ATF_REQUIRE(!utils::getenv("EXEC_PLAN_ADD"));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(apply__ok);
+ATF_TEST_CASE_BODY(apply__ok)
+{
+    utils::setenv("EXEC_PLAN_REMOVE", "remove");
+    fs::mkdir(fs::path("subdir"), 0755);
+    const fs::path subdir = fs::current_path() / "subdir";
+
+    process::exec_plan plan(fs::path("program"), process::args_vector());
+    plan.set_env("EXEC_PLAN_ADD", "added")
+        .unset_env("EXEC_PLAN_REMOVE")
+        .set_work_directory(subdir)
+        .set_umask(0077);
+    plan.apply();
+
+    ATF_REQUIRE_EQ("added", utils::getenv("EXEC_PLAN_ADD").get());
+    ATF_REQUIRE(!utils::getenv("EXEC_PLAN_REMOVE"));
+    ATF_REQUIRE_EQ(subdir, fs::current_path());
+    ATF_REQUIRE_EQ(static_cast< mode_t >(0077), ::umask(0022));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(apply__chdir_fail);
+ATF_TEST_CASE_BODY(apply__chdir_fail)
+{
+    process::exec_plan plan(fs::path("program"), process::args_vector());
+    plan.set_work_directory(fs::path("missing"));
+    ATF_REQUIRE_THROW_RE(process::system_error, "chdir\\(missing\\) failed",
+                         plan.apply());
+}
+
+
+ATF_INIT_TEST_CASES(tcs)
+{
+    ATF_ADD_TEST_CASE(tcs, defaults);
+    ATF_ADD_TEST_CASE(tcs, setters);
+    ATF_ADD_TEST_CASE(tcs, environment__inherit);
+    ATF_ADD_TEST_CASE(tcs, environment__changes);
+    ATF_ADD_TEST_CASE(tcs, apply__ok);
+    ATF_ADD_TEST_CASE(tcs, apply__chdir_fail);
+}
@@ -34,17 +34,31 @@
 
 extern "C" {
 #include <sys/types.h>
+#if defined(HAVE_MEMFD_CREATE)
+#   include <sys/mman.h>
+#endif
 #include <sys/wait.h>
 
+#include <fcntl.h>
+#include <poll.h>
 #include <signal.h>
+#include <stdint.h>
+#include <unistd.h>
 }
 
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <deque>
 #include <forward_list>
 #include <fstream>
 #include <map>
 #include <memory>
+#include <set>
 #include <stdexcept>
+#include <string>
 #include <utility>
+#include <vector>
 
 #include "utils/datetime.hpp"
 #include "utils/format/macros.hpp"
@@ -54,25 +68,33 @@ extern "C" {
 #include "utils/fs/path.hpp"
 #include "utils/logging/macros.hpp"
 #include "utils/logging/operations.hpp"
+#include "utils/metrics.hpp"
 #include "utils/noncopyable.hpp"
 #include "utils/optional.ipp"
 #include "utils/passwd.hpp"
+#include "utils/process/cgroup.hpp"
 #include "utils/process/child.ipp"
 #include "utils/process/deadline_killer.hpp"
+#include "utils/process/exceptions.hpp"
 #include "utils/process/isolation.hpp"
 #include "utils/process/operations.hpp"
+#include "utils/process/resource_usage.hpp"
 #include "utils/process/status.hpp"
 #include "utils/sanity.hpp"
 #include "utils/signals/interrupts.hpp"
+#include "utils/signals/programmer.hpp"
 #include "utils/signals/timer.hpp"
+#include "utils/units.hpp"
 
 namespace datetime = utils::datetime;
 namespace executor = utils::process::executor;
 namespace fs = utils::fs;
 namespace logging = utils::logging;
+namespace metrics = utils::metrics;
 namespace passwd = utils::passwd;
 namespace process = utils::process;
 namespace signals = utils::signals;
+namespace units = utils::units;
 
 using utils::none;
 using utils::optional;
@@ -85,10 +107,530 @@ namespace {
 static const char* work_directory_template = PACKAGE_TARNAME ".XXXXXX";
 
 
+/// Number of control directories to keep ready for new subprocesses.
+static const std::size_t directory_pool_size = 8;
+
+
 /// Mapping of active subprocess PIDs to their execution data.
 typedef std::map< int, executor::exec_handle > exec_handles_map;
 
 
+/// Set of anonymous in-memory files holding the output of a subprocess.
+///
+/// The files are exposed via paths to our own file descriptors so that they
+/// can be used in place of regular files; these paths are only valid for as
+/// long as this object is alive.
+class memory_files : utils::noncopyable {
+    /// Descriptors of the in-memory files, owned by this object.
+    std::vector< int > _fds;
+
+public:
+    /// Destructor; releases the memory held by all the files.
+    ~memory_files(void)
+    {
+        for (std::vector< int >::const_iterator iter = _fds.begin();
+             iter != _fds.end(); ++iter)
+            ::close(*iter);
+    }
+
+    /// Creates a new in-memory file.
+    ///
+    /// \param name Name of the file, for debugging purposes only.
+    ///
+    /// \return The path through which to access the file, or none if the file
+    /// could not be created.
+    optional< fs::path >
+    create(const char* name)
+    {
+#if defined(HAVE_MEMFD_CREATE)
+        const int fd = ::memfd_create(name, MFD_CLOEXEC);
+        if (fd == -1) {
+            const int original_errno = errno;
+            LW(F("Failed to create in-memory file %s: %s") % name %
+               std::strerror(original_errno));
+            return none;
+        }
+        _fds.push_back(fd);
+        return utils::make_optional(fs::path(F("/dev/fd/%s") % fd));
+#else
+        LW(F("Cannot create in-memory file %s: not supported") % name);
+        return none;
+#endif
+    }
+};
+
+
+/// Shared pointer to a set of in-memory files.
+typedef std::shared_ptr< memory_files > memory_files_ptr;
+
+
+/// Checks if in-memory files can be used in place of regular files.
+///
+/// This requires the system to support anonymous in-memory files and to
+/// provide access to our own file descriptors by path.
+///
+/// \return True if in-memory files are usable; false otherwise.
+static bool
+memory_files_work(void)
+{
+    memory_files files;
+    const optional< fs::path > path = files.create("probe");
+    if (!path)
+        return false;
+
+    const int fd = ::open(path.get().c_str(), O_WRONLY | O_APPEND);
+    if (fd == -1) {
+        const int original_errno = errno;
+        LW(F("Cannot reopen in-memory file via %s: %s") % path.get() %
+           std::strerror(original_errno));
+        return false;
+    }
+    ::close(fd);
+    return true;
+}
+
+
+/// Writes a buffer in full to a file descriptor.
+///
+/// \param fd The file descriptor to write to.
+/// \param data The buffer to write.
+/// \param length The number of bytes in the buffer.
+///
+/// \return True if all the data was written; false otherwise.
+static bool
+write_all(const int fd, const char* data, std::size_t length)
+{
+    while (length > 0) {
+        const ssize_t ret = ::write(fd, data, length);
+        if (ret == -1) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        data += ret;
+        length -= ret;
+    }
+    return true;
+}
+
+
+/// Bounded capture of an output stream of a subprocess.
+///
+/// The subprocess writes to a pipe that we drain while it runs.  The first
+/// half of the allowed bytes go straight to the output file, the last half are
+/// kept in a ring buffer and anything in between is discarded; the ring buffer
+/// is flushed to the file, preceded by a marker telling how many bytes were
+/// omitted, once the subprocess terminates.  The output file therefore never
+/// grows beyond the limit plus the size of the marker.
+class output_sink : utils::noncopyable {
+    /// Read end of the pipe, or -1 once closed.
+    int _read_fd;
+
+    /// Write end of the pipe, held until the subprocess has opened it.
+    int _write_fd;
+
+    /// Descriptor of the output file, or -1 once finished.
+    int _file_fd;
+
+    /// Path to the output file.
+    const fs::path _file;
+
+    /// Number of bytes still to be written directly to the output file.
+    std::size_t _head_left;
+
+    /// Ring buffer holding the most recent bytes beyond the head.
+    std::vector< char > _tail;
+
+    /// Position of the oldest byte in the ring buffer.
+    std::size_t _tail_start;
+
+    /// Number of valid bytes in the ring buffer.
+    std::size_t _tail_length;
+
+    /// Number of bytes discarded so far.
+    uint64_t _dropped;
+
+    /// Constructor.
+    ///
+    /// \param read_fd Read end of the pipe.  Ownership is transferred.
+    /// \param write_fd Write end of the pipe.  Ownership is transferred.
+    /// \param file_fd Descriptor of the output file.  Ownership is
+    ///     transferred.
+    /// \param file Path to the output file.
+    /// \param limit Maximum number of bytes to keep.
+    output_sink(const int read_fd, const int write_fd, const int file_fd,
+                const fs::path& file, const std::size_t limit) :
+        _read_fd(read_fd), _write_fd(write_fd), _file_fd(file_fd),
+        _file(file), _head_left(limit / 2), _tail(limit - limit / 2),
+        _tail_start(0), _tail_length(0), _dropped(0)
+    {
+    }
+
+    /// Appends data beyond the head to the ring buffer.
+    ///
+    /// \param data The buffer to append.
+    /// \param length The number of bytes in the buffer.
+    void
+    push_tail(const char* data, std::size_t length)
+    {
+        const std::size_t capacity = _tail.size();
+        if (length >= capacity) {
+            _dropped += _tail_length + (length - capacity);
+            std::copy(data + (length - capacity), data + length,
+                      _tail.begin());
+            _tail_start = 0;
+            _tail_length = capacity;
+            return;
+        }
+
+        if (_tail_length + length > capacity) {
+            const std::size_t overflow = _tail_length + length - capacity;
+            _dropped += overflow;
+            _tail_start = (_tail_start + overflow) % capacity;
+            _tail_length -= overflow;
+        }
+        std::size_t pos = (_tail_start + _tail_length) % capacity;
+        _tail_length += length;
+        while (length > 0) {
+            const std::size_t chunk = std::min(length, capacity - pos);
+            std::copy(data, data + chunk, _tail.begin() + pos);
+            data += chunk;
+            length -= chunk;
+            pos = 0;
+        }
+    }
+
+    /// Processes a chunk of output read from the subprocess.
+    ///
+    /// \param data The buffer read from the pipe.
+    /// \param length The number of bytes in the buffer.
+    void
+    consume(const char* data, std::size_t length)
+    {
+        const std::size_t head = std::min(length, _head_left);
+        if (head > 0) {
+            if (!write_all(_file_fd, data, head)) {
+                const int original_errno = errno;
+                LW(F("Failed to write to %s: %s") % _file %
+                   std::strerror(original_errno));
+            }
+            _head_left -= head;
+            data += head;
+            length -= head;
+        }
+        if (length > 0)
+            push_tail(data, length);
+    }
+
+    /// Closes a descriptor owned by this object.
+    ///
+    /// \param [in,out] fd The descriptor to close; set to -1 on return.
+    static void
+    close_fd(int& fd)
+    {
+        if (fd != -1) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+
+public:
+    /// Destructor.
+    ~output_sink(void)
+    {
+        close_fd(_read_fd);
+        close_fd(_write_fd);
+        close_fd(_file_fd);
+    }
+
+    /// Creates a new sink.
+    ///
+    /// \param file Path to the output file.
+    /// \param limit Maximum number of bytes to keep.  Must be positive.
+    ///
+    /// \return The new sink, or NULL if it could not be created.
+    static std::shared_ptr< output_sink >
+    create(const fs::path& file, const std::size_t limit)
+    {
+        PRE(limit > 0);
+
+        int fds[2];
+        if (::pipe(fds) == -1) {
+            const int original_errno = errno;
+            LW(F("Failed to create output pipe for %s: %s") % file %
+               std::strerror(original_errno));
+            return std::shared_ptr< output_sink >();
+        }
+        for (int i = 0; i < 2; ++i)
+            ::fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+        ::fcntl(fds[0], F_SETFL, ::fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+
+        const int file_fd = ::open(file.c_str(),
+                                   O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (file_fd == -1) {
+            const int original_errno = errno;
+            LW(F("Failed to create %s: %s") % file %
+               std::strerror(original_errno));
+            ::close(fds[0]);
+            ::close(fds[1]);
+            return std::shared_ptr< output_sink >();
+        }
+        ::fcntl(file_fd, F_SETFD, FD_CLOEXEC);
+
+        return std::shared_ptr< output_sink >(
+            new output_sink(fds[0], fds[1], file_fd, file, limit));
+    }
+
+    /// Gets the path through which the subprocess writes to this sink.
+    ///
+    /// \return A path to the write end of the pipe.
+    fs::path
+    child_path(void) const
+    {
+        PRE(_write_fd != -1);
+        return fs::path(F("/dev/fd/%s") % _write_fd);
+    }
+
+    /// Gets the path to the output file.
+    ///
+    /// \return A path.
+    const fs::path&
+    file(void) const
+    {
+        return _file;
+    }
+
+    /// Gets the descriptor to poll for output of the subprocess.
+    ///
+    /// \return The read end of the pipe, or -1 if it has reached end of file.
+    int
+    read_fd(void) const
+    {
+        return _read_fd;
+    }
+
+    /// Releases the write end of the pipe once the subprocess holds it.
+    void
+    close_child_end(void)
+    {
+        close_fd(_write_fd);
+    }
+
+    /// Consumes any output available in the pipe without blocking.
+    void
+    drain(void)
+    {
+        char buffer[64 * 1024];
+        while (_read_fd != -1) {
+            const ssize_t ret = ::read(_read_fd, buffer, sizeof(buffer));
+            if (ret > 0) {
+                consume(buffer, ret);
+            } else if (ret == 0) {
+                close_fd(_read_fd);
+            } else if (errno == EINTR) {
+                continue;
+            } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            } else {
+                const int original_errno = errno;
+                LW(F("Failed to read output for %s: %s") % _file %
+                   std::strerror(original_errno));
+                close_fd(_read_fd);
+            }
+        }
+    }
+
+    /// Completes the output file after the subprocess has terminated.
+    ///
+    /// Any output still sitting in the pipe is consumed first.  Descendants of
+    /// the subprocess that escaped its process group may keep the pipe open,
+    /// so we do not wait for end of file and discard anything they write
+    /// afterwards.
+    void
+    finish(void)
+    {
+        if (_file_fd == -1)
+            return;
+
+        close_child_end();
+        drain();
+        close_fd(_read_fd);
+
+        if (_dropped > 0) {
+            LI(F("Omitted %s bytes of output in %s") % _dropped % _file);
+            const std::string marker = F("\n[%s bytes of output omitted]\n") %
+                _dropped;
+            write_all(_file_fd, marker.c_str(), marker.length());
+        }
+        const std::size_t first = std::min(_tail_length,
+                                           _tail.size() - _tail_start);
+        if (!write_all(_file_fd, &_tail[_tail_start], first) ||
+            !write_all(_file_fd, &_tail[0], _tail_length - first)) {
+            const int original_errno = errno;
+            LW(F("Failed to write to %s: %s") % _file %
+               std::strerror(original_errno));
+        }
+        close_fd(_file_fd);
+        std::vector< char >().swap(_tail);
+        _tail_length = 0;
+    }
+};
+
+
+/// Shared pointer to an output sink.
+typedef std::shared_ptr< output_sink > output_sink_ptr;
+
+
+/// Collection of output sinks of a subprocess.
+typedef std::vector< output_sink_ptr > output_sinks_vector;
+
+
+/// Checks if subprocesses can write to our pipes given a path to them.
+///
+/// \return True if bounded output capture is usable; false otherwise.
+static bool
+output_pipes_work(void)
+{
+    int fds[2];
+    if (::pipe(fds) == -1)
+        return false;
+
+    const std::string path = F("/dev/fd/%s") % fds[1];
+    const int fd = ::open(path.c_str(), O_WRONLY | O_APPEND);
+    const int original_errno = errno;
+    ::close(fds[0]);
+    ::close(fds[1]);
+    if (fd == -1) {
+        LW(F("Cannot reopen pipe via %s: %s") % path %
+           std::strerror(original_errno));
+        return false;
+    }
+    ::close(fd);
+    return true;
+}
+
+
+/// Write end of the pipe used to report SIGCHLD to the poll loop, or -1.
+static int sigchld_write_fd = -1;
+
+
+/// Signal handler for SIGCHLD that wakes up the poll loop.
+static void
+sigchld_handler(const int /* signo */)
+{
+    const int original_errno = errno;
+    (void)::write(sigchld_write_fd, "", 1);
+    errno = original_errno;
+}
+
+
+/// Self-pipe that becomes readable whenever a subprocess terminates.
+///
+/// Allows waiting for the termination of subprocesses and for their output
+/// at once.  Only one instance may be alive at any given time.
+class sigchld_pipe : utils::noncopyable {
+    /// Read end of the pipe.
+    int _read_fd;
+
+    /// Write end of the pipe.
+    int _write_fd;
+
+    /// Programmer of the SIGCHLD handler.
+    std::unique_ptr< signals::programmer > _programmer;
+
+public:
+    /// Constructor; starts listening for SIGCHLD.
+    ///
+    /// \throw process::system_error If the pipe cannot be created.
+    sigchld_pipe(void)
+    {
+        PRE(sigchld_write_fd == -1);
+
+        int fds[2];
+        if (::pipe(fds) == -1) {
+            const int original_errno = errno;
+            throw process::system_error("Failed to create SIGCHLD pipe",
+                                        original_errno);
+        }
+        for (int i = 0; i < 2; ++i) {
+            ::fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+            ::fcntl(fds[i], F_SETFL, ::fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+        }
+        _read_fd = fds[0];
+        _write_fd = fds[1];
+
+        sigchld_write_fd = _write_fd;
+        _programmer.reset(new signals::programmer(SIGCHLD, sigchld_handler));
+    }
+
+    /// Destructor; stops listening for SIGCHLD.
+    ~sigchld_pipe(void)
+    {
+        _programmer->unprogram();
+        sigchld_write_fd = -1;
+        ::close(_read_fd);
+        ::close(_write_fd);
+    }
+
+    /// Gets the descriptor to poll for SIGCHLD notifications.
+    ///
+    /// \return The read end of the pipe.
+    int
+    read_fd(void) const
+    {
+        return _read_fd;
+    }
+
+    /// Discards all pending notifications.
+    void
+    clear(void)
+    {
+        char buffer[64];
+        while (::read(_read_fd, buffer, sizeof(buffer)) > 0) {
+            // Discard.
+        }
+    }
+};
+
+
+/// Time to set up and fork a new subprocess.
+static metrics::histogram spawn_seconds(
+    "kyua_executor_spawn_seconds",
+    "Time to create the control directory of a subprocess and fork it");
+
+
+/// Time blocked waiting for any subprocess to terminate.
+static metrics::histogram wait_seconds(
+    "kyua_executor_wait_seconds",
+    "Time blocked waiting for any subprocess to terminate");
+
+
+/// Time to delete the control directory of a subprocess.
+static metrics::histogram cleanup_seconds(
+    "kyua_executor_cleanup_seconds",
+    "Time to delete the control and work directories of a subprocess");
+
+
+/// Kills all processes in the cgroup of a subprocess and deletes the cgroup.
+///
+/// Errors are logged but otherwise ignored: a leftover cgroup does not affect
+/// the results of the subprocess.
+///
+/// \param cgroup The cgroup to remove.
+static void
+remove_cgroup(process::cgroup cgroup)
+{
+    if (!fs::exists(cgroup.directory()))
+        return;
+    try {
+        cgroup.remove();
+    } catch (const std::runtime_error& e) {
+        LW(F("Failed to remove cgroup %s: %s") % cgroup.directory() %
+           e.what());
+    }
+}
+
+
 }  // anonymous namespace
 
 
@@ -113,13 +655,17 @@ const char* utils::process::executor::detail::work_subdir = "work";
 /// \param unprivileged_user User to switch to if not none.
 /// \param control_directory Path to the subprocess-specific control directory.
 /// \param work_directory Path to the subprocess-specific work directory.
+/// \param cgroup The cgroup.procs file of the cgroup to join, if any.
 void
 utils::process::executor::detail::setup_child(
     const optional< passwd::user > unprivileged_user,
     const fs::path& control_directory,
-    const fs::path& work_directory)
+    const fs::path& work_directory,
+    const optional< fs::path >& cgroup)
 {
     logging::set_inmemory();
+    if (cgroup)
+        process::join_cgroup(cgroup.get());
     process::isolate_path(unprivileged_user, control_directory);
     process::isolate_child(unprivileged_user, work_directory);
 }
@@ -151,6 +697,20 @@ struct utils::process::executor::exec_handle::impl : utils::noncopyable {
     /// Number of owners of the on-disk state.
     executor::detail::refcnt_t state_owners;
 
+    /// In-memory files backing stdout_file and/or stderr_file, if any.
+    memory_files_ptr output_files;
+
+    /// Sinks bounding the output written to stdout_file and/or stderr_file.
+    output_sinks_vector output_sinks;
+
+    /// Control group of the subprocess, if any.
+    ///
+    /// Followup processes share the cgroup of the process they follow.
+    const optional< process::cgroup > cgroup;
+
+    /// Whether this is a followup process.
+    const bool followup;
+
     /// Constructor.
     ///
     /// \param pid_ PID of the forked process.
@@ -166,6 +726,13 @@ struct utils::process::executor::exec_handle::impl : utils::noncopyable {
     ///     For first-time processes, this should be a new counter set to 0;
     ///     for followup processes, this should point to the same counter used
     ///     by the preceding process.
+    /// \param output_files_ In-memory files backing the output of the
+    ///     subprocess, if any.
+    /// \param output_sinks_ Sinks bounding the output of the subprocess.
+    /// \param cgroup_ Control group of the subprocess, if any.
+    /// \param followup_ Whether this is a followup process.  The timeout of a
+    ///     followup process only kills its own process group, not the cgroup
+    ///     shared with the process it follows.
     impl(const int pid_,
          const fs::path& control_directory_,
          const fs::path& stdout_file_,
@@ -173,15 +740,24 @@ struct utils::process::executor::exec_handle::impl : utils::noncopyable {
          const datetime::timestamp& start_time_,
          const datetime::delta& timeout,
          const optional< passwd::user > unprivileged_user_,
-         executor::detail::refcnt_t state_owners_) :
+         executor::detail::refcnt_t state_owners_,
+         memory_files_ptr output_files_,
+         const output_sinks_vector& output_sinks_,
+         const optional< process::cgroup >& cgroup_,
+         const bool followup_) :
         pid(pid_),
         control_directory(control_directory_),
         stdout_file(stdout_file_),
         stderr_file(stderr_file_),
         start_time(start_time_),
         unprivileged_user(unprivileged_user_),
-        timer(timeout, pid_),
-        state_owners(state_owners_)
+        timer(timeout, pid_, cgroup_ && !followup_ ?
+              utils::make_optional(cgroup_.get().kill_file()) : none),
+        state_owners(state_owners_),
+        output_files(output_files_),
+        output_sinks(output_sinks_),
+        cgroup(cgroup_),
+        followup(followup_)
     {
         (*state_owners)++;
         POST(*state_owners > 0);
@@ -269,6 +845,11 @@ struct utils::process::executor::exit_handle::impl : utils::noncopyable {
     /// Termination status of the subprocess, or none if it timed out.
     const optional< process::status > status;
 
+    /// Resources consumed by the subprocess, if known.
+    ///
+    /// This is available even if the subprocess timed out.
+    const optional< process::resource_usage > usage;
+
     /// The user the process ran as, if different than the current one.
     const optional< passwd::user > unprivileged_user;
 
@@ -294,6 +875,18 @@ struct utils::process::executor::exit_handle::impl : utils::noncopyable {
     /// For all other cases, this will hold a higher value.
     detail::refcnt_t state_owners;
 
+    /// In-memory files backing stdout_file and/or stderr_file, if any.
+    ///
+    /// These are released when the last handle referencing them goes away,
+    /// not on cleanup(), so that the output remains readable until then.
+    const memory_files_ptr output_files;
+
+    /// Control group of the subprocess, if any.
+    ///
+    /// The cgroup is removed along with the on-disk state, which kills any
+    /// process left behind by the subprocess.
+    const optional< process::cgroup > cgroup;
+
     /// Mutable pointer to the corresponding executor state.
     ///
     /// This object references a member of the executor_handle that yielded this
@@ -311,6 +904,7 @@ struct utils::process::executor::exit_handle::impl : utils::noncopyable {
     /// \param original_pid_ Original PID of the terminated subprocess.
     /// \param status_ Termination status of the subprocess, or none if
     ///     timed out.
+    /// \param usage_ Resources consumed by the subprocess, if known.
     /// \param unprivileged_user_ The user the process ran as, if different than
     ///     the current one.
     /// \param start_time_ Timestamp of when the subprocess was spawned.
@@ -321,11 +915,15 @@ struct utils::process::executor::exit_handle::impl : utils::noncopyable {
     /// \param stdout_file_ Path to the subprocess's stdout file.
     /// \param stderr_file_ Path to the subprocess's stderr file.
     /// \param [in,out] state_owners_ Number of owners of the on-disk state.
+    /// \param output_files_ In-memory files backing the output of the
+    ///     subprocess, if any.
+    /// \param cgroup_ Control group of the subprocess, if any.
     /// \param [in,out] all_exec_handles_ Global object keeping track of all
     ///     active executions for an executor.  This is a pointer to a member of
     ///     the executor_handle object.
     impl(const int original_pid_,
          const optional< process::status > status_,
+         const optional< process::resource_usage > usage_,
          const optional< passwd::user > unprivileged_user_,
          const datetime::timestamp& start_time_,
          const datetime::timestamp& end_time_,
@@ -333,14 +931,16 @@ struct utils::process::executor::exit_handle::impl : utils::noncopyable {
          const fs::path& stdout_file_,
          const fs::path& stderr_file_,
          detail::refcnt_t state_owners_,
+         memory_files_ptr output_files_,
+         const optional< process::cgroup >& cgroup_,
          exec_handles_map& all_exec_handles_) :
-        original_pid(original_pid_), status(status_),
+        original_pid(original_pid_), status(status_), usage(usage_),
         unprivileged_user(unprivileged_user_),
         start_time(start_time_), end_time(end_time_),
         control_directory(control_directory_),
         stdout_file(stdout_file_), stderr_file(stderr_file_),
-        state_owners(state_owners_),
-        all_exec_handles(all_exec_handles_), cleaned(false)
+        state_owners(state_owners_), output_files(output_files_),
+        cgroup(cgroup_), all_exec_handles(all_exec_handles_), cleaned(false)
     {
     }
 
@@ -368,7 +968,11 @@ struct utils::process::executor::exit_handle::impl : utils::noncopyable {
         PRE(*state_owners > 0);
         if (*state_owners == 1) {
             LI(F("Cleaning up exit_handle for exec_handle %s") % original_pid);
+            const datetime::timestamp start_time = datetime::timestamp::now();
+            if (cgroup)
+                remove_cgroup(cgroup.get());
             fs::rm_r(control_directory);
+            cleanup_seconds.observe(datetime::timestamp::now() - start_time);
         } else {
             LI(F("Not cleaning up exit_handle for exec_handle %s; "
                  "%s owners left") % original_pid % (*state_owners - 1));
@@ -454,6 +1058,19 @@ executor::exit_handle::status(void) const
 }
 
 
+/// Returns the resources consumed by the subprocess.
+///
+/// Unlike status(), this is available for subprocesses that timed out.
+///
+/// \return The resource usage of the subprocess, or none if it could not be
+/// collected.
+const optional< process::resource_usage >&
+executor::exit_handle::usage(void) const
+{
+    return _pimpl->usage;
+}
+
+
 /// Returns the user the process ran as if different than the current one.
 ///
 /// \return None if the credentials of the process were the same as the current
@@ -557,6 +1174,72 @@ struct utils::process::executor::executor_handle::impl : utils::noncopyable {
     /// Used to keep track of explicit calls to the public cleanup().
     bool cleaned;
 
+    /// Timestamp of the last call to spawn_pre() or spawn_followup_pre().
+    ///
+    /// Used to measure the cost of spawning a subprocess.
+    optional< datetime::timestamp > spawn_start_time;
+
+    /// Whether to capture the output of new subprocesses in memory.
+    bool in_memory_output;
+
+    /// Whether in-memory files work on this system, or none if not yet known.
+    optional< bool > memory_files_supported;
+
+    /// In-memory files created for the subprocess being spawned, if any.
+    ///
+    /// These are handed over to the subprocess's exec_handle by spawn_post().
+    memory_files_ptr pending_output_files;
+
+    /// Maximum number of bytes to keep per output stream; 0 for no limit.
+    std::size_t output_limit;
+
+    /// Whether output pipes work on this system, or none if not yet known.
+    optional< bool > output_pipes_supported;
+
+    /// Output sinks created for the subprocess being spawned, if any.
+    ///
+    /// These are handed over to the subprocess's exec_handle by spawn_post().
+    output_sinks_vector pending_output_sinks;
+
+    /// Mount point of the tmpfs holding the control directories, if any.
+    optional< fs::path > tmpfs_directory;
+
+    /// Whether mounting the tmpfs has been attempted yet.
+    bool tmpfs_attempted;
+
+    /// Free disk space required by the subprocesses spawned from now on.
+    units::bytes required_disk_space;
+
+    /// Control directories created ahead of time, in the order to use them.
+    ///
+    /// Creating directories while waiting for subprocesses keeps that work
+    /// off the path between a subprocess terminating and the next one
+    /// being spawned.
+    std::deque< fs::path > directory_pool;
+
+    /// Whether setting up cgroups has been attempted yet.
+    bool cgroups_attempted;
+
+    /// Delegated cgroup in which to create the cgroups of subprocesses, if any.
+    optional< process::cgroup > cgroup_root;
+
+    /// Leaf cgroup into which we moved ourselves, if any.
+    ///
+    /// A cgroup cannot hold processes and enable controllers for its children
+    /// at the same time, so we may have to step aside for the latter.
+    optional< process::cgroup > self_cgroup;
+
+    /// Controllers enabled in cgroup_root for the cgroups of subprocesses.
+    std::set< std::string > enabled_controllers;
+
+    /// Memory limit for the subprocesses spawned from now on; 0 for none.
+    units::bytes memory_limit;
+
+    /// Control group created for the subprocess being spawned, if any.
+    ///
+    /// This is handed over to the subprocess's exec_handle by spawn_post().
+    optional< process::cgroup > pending_cgroup;
+
     /// Constructor.
     impl(void) :
         last_subprocess(0),
@@ -565,7 +1248,11 @@ struct utils::process::executor::executor_handle::impl : utils::noncopyable {
             fs::auto_directory::mkdtemp_public(work_directory_template))),
         all_exec_handles(),
         stale_exec_handles(),
-        cleaned(false)
+        cleaned(false),
+        in_memory_output(false),
+        output_limit(0),
+        tmpfs_attempted(false),
+        cgroups_attempted(false)
     {
     }
 
@@ -601,6 +1288,9 @@ struct utils::process::executor::executor_handle::impl : utils::noncopyable {
                 LW(F("Failed to wait for PID %s") % pid);
             }
 
+            if (data._pimpl->cgroup)
+                remove_cgroup(data._pimpl->cgroup.get());
+
             try {
                 fs::rm_r(data.control_directory());
             } catch (const fs::error& e) {
@@ -621,6 +1311,25 @@ struct utils::process::executor::executor_handle::impl : utils::noncopyable {
         }
         stale_exec_handles.clear();
 
+        if (pending_cgroup) {
+            remove_cgroup(pending_cgroup.get());
+            pending_cgroup = none;
+        }
+        release_cgroups();
+
+        drain_directory_pool();
+
+        if (tmpfs_directory) {
+            try {
+                fs::unmount(tmpfs_directory.get());
+                fs::rmdir(tmpfs_directory.get());
+            } catch (const fs::error& e) {
+                LE(F("Failed to unmount tmpfs %s: %s") %
+                   tmpfs_directory.get() % e.what());
+            }
+            tmpfs_directory = none;
+        }
+
         try {
             // The following only causes the work directory to be deleted, not
             // any of its contents, so we expect this to always succeed.  This
@@ -639,6 +1348,350 @@ struct utils::process::executor::executor_handle::impl : utils::noncopyable {
         interrupts_handler.reset();
     }
 
+    /// Enables the controllers we need for the cgroups of subprocesses.
+    ///
+    /// If the delegated cgroup holds processes, which it does at least for
+    /// ourselves, we move into a leaf cgroup of our own to be allowed to
+    /// enable controllers for its children.  Failures are not fatal: the
+    /// cgroups of subprocesses still track their processes without them.
+    void
+    enable_cgroup_controllers(void)
+    {
+        std::set< std::string > wanted;
+        const std::set< std::string > available = cgroup_root.get().controllers();
+        if (available.find("cpu") != available.end())
+            wanted.insert("cpu");
+        if (available.find("memory") != available.end())
+            wanted.insert("memory");
+        if (wanted.empty()) {
+            LW("No cpu or memory controllers in delegated cgroup; resource "
+               "limits and accounting are unavailable");
+            return;
+        }
+
+        try {
+            cgroup_root.get().enable_controllers(wanted);
+        } catch (const process::system_error& e) {
+            if (e.original_errno() != EBUSY) {
+                LW(F("Cannot enable cgroup controllers: %s; resource limits "
+                     "and accounting are unavailable") % e.what());
+                return;
+            }
+            try {
+                process::cgroup leaf = cgroup_root.get().create_child(
+                    F("kyua.%s") % ::getpid());
+                self_cgroup = leaf;
+                leaf.attach(::getpid());
+                cgroup_root.get().enable_controllers(wanted);
+            } catch (const std::runtime_error& e2) {
+                LW(F("Cannot enable cgroup controllers: %s; resource limits "
+                     "and accounting are unavailable") % e2.what());
+                return;
+            }
+        }
+        enabled_controllers = wanted;
+    }
+
+    /// Undoes the changes done by enable_cgroup_controllers().
+    ///
+    /// The cgroups of all subprocesses must have been removed by now.
+    void
+    release_cgroups(void)
+    {
+        if (!enabled_controllers.empty()) {
+            try {
+                cgroup_root.get().disable_controllers(enabled_controllers);
+            } catch (const process::system_error& e) {
+                LW(F("Failed to disable cgroup controllers: %s") % e.what());
+            }
+            enabled_controllers.clear();
+        }
+
+        if (self_cgroup) {
+            // Do not use cgroup::remove() here: if moving back fails, that
+            // would kill ourselves.
+            try {
+                cgroup_root.get().attach(::getpid());
+                fs::rmdir(self_cgroup.get().directory());
+            } catch (const std::runtime_error& e) {
+                LW(F("Failed to remove cgroup %s: %s") %
+                   self_cgroup.get().directory() % e.what());
+            }
+            self_cgroup = none;
+        }
+    }
+
+    /// Creates the cgroup for a new subprocess.
+    ///
+    /// \param control_directory Control directory of the subprocess, used to
+    ///     derive a unique name for the cgroup.
+    ///
+    /// \return The new cgroup, or none if it cannot be created, in which case
+    /// the subprocess is tracked by its process group only.
+    optional< process::cgroup >
+    create_cgroup(const fs::path& control_directory)
+    {
+        PRE(cgroup_root);
+
+        optional< process::cgroup > cgroup;
+        try {
+            cgroup = cgroup_root.get().create_child(
+                F("kyua.%s.%s") % ::getpid() % control_directory.leaf_name());
+        } catch (const fs::error& e) {
+            LW(F("Cannot create cgroup for subprocess: %s") % e.what());
+            return none;
+        }
+
+        if (memory_limit > 0) {
+            if (enabled_controllers.find("memory") ==
+                enabled_controllers.end()) {
+                LD("Not limiting memory: memory controller not enabled");
+            } else {
+                try {
+                    cgroup.get().set_memory_max(memory_limit);
+                } catch (const process::system_error& e) {
+                    LW(F("Cannot limit memory of subprocess: %s") % e.what());
+                }
+            }
+        }
+        return cgroup;
+    }
+
+    /// Selects the directory in which to create a new control directory.
+    ///
+    /// \param required_disk_space Free disk space needed by the subprocess,
+    ///     or 0 if not known.
+    ///
+    /// \return The tmpfs if there is one with enough free space to satisfy
+    /// the disk requirements of the subprocess; the root work directory
+    /// otherwise.
+    fs::path
+    control_directory_parent(const units::bytes& required_disk_space) const
+    {
+        if (tmpfs_directory) {
+            try {
+                const units::bytes free_space = fs::free_disk_space(
+                    tmpfs_directory.get());
+                if (free_space >= required_disk_space)
+                    return tmpfs_directory.get();
+                LI(F("Only %s bytes free in tmpfs but %s required; using "
+                     "disk") % free_space.format() %
+                   required_disk_space.format());
+            } catch (const fs::error& e) {
+                LW(F("Cannot query free space in tmpfs: %s; using disk") %
+                   e.what());
+            }
+        }
+        return root_work_directory->directory();
+    }
+
+    /// Creates a new, uniquely-named control directory.
+    ///
+    /// \param parent Directory in which to create the control directory.
+    ///
+    /// \return The path to the control directory.
+    ///
+    /// \throw fs::error If the directory cannot be created.
+    fs::path
+    create_control_directory(const fs::path& parent)
+    {
+        ++last_subprocess;
+        const fs::path control_directory =
+            parent / (F("%s") % last_subprocess);
+        fs::mkdir_p(control_directory / executor::detail::work_subdir, 0755);
+        return control_directory;
+    }
+
+    /// Tops up the pool of ready-made control directories.
+    ///
+    /// Errors are not fatal: spawn_pre() creates directories on demand
+    /// when the pool cannot provide them.
+    void
+    refill_directory_pool(void)
+    {
+        const fs::path parent = control_directory_parent(units::bytes());
+        while (directory_pool.size() < directory_pool_size) {
+            try {
+                directory_pool.push_back(create_control_directory(parent));
+            } catch (const fs::error& e) {
+                LW(F("Failed to create pooled control directory: %s") %
+                   e.what());
+                break;
+            }
+        }
+    }
+
+    /// Removes all the control directories in the pool.
+    void
+    drain_directory_pool(void)
+    {
+        for (std::deque< fs::path >::const_iterator iter =
+                 directory_pool.begin(); iter != directory_pool.end();
+             ++iter) {
+            try {
+                fs::rm_r(*iter);
+            } catch (const fs::error& e) {
+                LE(F("Failed to clean up pooled control directory %s: %s") %
+                   *iter % e.what());
+            }
+        }
+        directory_pool.clear();
+    }
+
+    /// Checks if any active subprocess has output pending to be drained.
+    ///
+    /// \return True if any output sink is still open; false otherwise.
+    bool
+    has_open_sinks(void) const
+    {
+        for (exec_handles_map::const_iterator iter = all_exec_handles.begin();
+             iter != all_exec_handles.end(); ++iter) {
+            const output_sinks_vector& sinks =
+                (*iter).second._pimpl->output_sinks;
+            for (output_sinks_vector::const_iterator iter2 = sinks.begin();
+                 iter2 != sinks.end(); ++iter2) {
+                if ((*iter2)->read_fd() != -1)
+                    return true;
+            }
+        }
+        return false;
+    }
+
+    /// Waits for a subprocess to terminate while draining the output of all.
+    ///
+    /// Subprocesses with bounded output write to pipes, so they would stall
+    /// once the pipes fill up if we just blocked in wait(2).  Instead, we
+    /// sleep on the pipes and on a SIGCHLD notification at once.
+    ///
+    /// \param pid The subprocess to wait for, or none for any subprocess.
+    ///
+    /// \return The termination status of the subprocess.
+    ///
+    /// \throw process::system_error If waiting fails.
+    process::status
+    wait_draining(const optional< int > pid)
+    {
+        sigchld_pipe notifier;
+        std::vector< struct ::pollfd > fds;
+        for (;;) {
+            const optional< process::status > status = pid ?
+                process::try_wait(pid.get()) : process::try_wait_any();
+            if (status)
+                return status.get();
+
+            fds.clear();
+            struct ::pollfd notifier_fd;
+            notifier_fd.fd = notifier.read_fd();
+            notifier_fd.events = POLLIN;
+            fds.push_back(notifier_fd);
+            for (exec_handles_map::const_iterator iter =
+                     all_exec_handles.begin();
+                 iter != all_exec_handles.end(); ++iter) {
+                const output_sinks_vector& sinks =
+                    (*iter).second._pimpl->output_sinks;
+                for (output_sinks_vector::const_iterator iter2 = sinks.begin();
+                     iter2 != sinks.end(); ++iter2) {
+                    if ((*iter2)->read_fd() == -1)
+                        continue;
+                    struct ::pollfd sink_fd;
+                    sink_fd.fd = (*iter2)->read_fd();
+                    sink_fd.events = POLLIN;
+                    fds.push_back(sink_fd);
+                }
+            }
+
+            if (::poll(&fds[0], fds.size(), -1) == -1 && errno != EINTR) {
+                const int original_errno = errno;
+                throw process::system_error("Failed to poll for output",
+                                            original_errno);
+            }
+
+            notifier.clear();
+            for (exec_handles_map::const_iterator iter =
+                     all_exec_handles.begin();
+                 iter != all_exec_handles.end(); ++iter) {
+                const output_sinks_vector& sinks =
+                    (*iter).second._pimpl->output_sinks;
+                for (output_sinks_vector::const_iterator iter2 = sinks.begin();
+                     iter2 != sinks.end(); ++iter2)
+                    (*iter2)->drain();
+            }
+        }
+    }
+
+    /// Waits for a subprocess to terminate.
+    ///
+    /// If no subprocess has terminated yet, the time until one does is spent
+    /// refilling the directory pool.
+    ///
+    /// \param pid The subprocess to wait for, or none for any subprocess.
+    ///
+    /// \return The termination status of the subprocess.
+    ///
+    /// \throw process::system_error If waiting fails.
+    process::status
+    wait_for(const optional< int > pid)
+    {
+        if (directory_pool.size() < directory_pool_size) {
+            const optional< process::status > status = pid ?
+                process::try_wait(pid.get()) : process::try_wait_any();
+            if (status)
+                return status.get();
+            refill_directory_pool();
+        }
+
+        if (has_open_sinks())
+            return wait_draining(pid);
+        else if (pid)
+            return process::wait(pid.get());
+        else
+            return process::wait_any();
+    }
+
+    /// Completes the output files of a terminated subprocess.
+    ///
+    /// \param data The execution data of the subprocess.
+    static void
+    finish_sinks(exec_handle& data)
+    {
+        output_sinks_vector& sinks = data._pimpl->output_sinks;
+        for (output_sinks_vector::iterator iter = sinks.begin();
+             iter != sinks.end(); ++iter)
+            (*iter)->finish();
+        sinks.clear();
+    }
+
+    /// Computes the resources consumed by a terminated subprocess.
+    ///
+    /// If the subprocess ran in its own cgroup, the accounting of the cgroup
+    /// takes precedence over the CPU times and the peak memory reported by the
+    /// kernel for the subprocess, as the former includes any descendants that
+    /// were not waited for or that are still running.  Followup processes
+    /// share the cgroup of their base, so they are accounted for as usual.
+    ///
+    /// \param data The execution data of the subprocess.
+    /// \param usage The resources reported by wait(2), if any.
+    ///
+    /// \return The resource usage of the subprocess, if known.
+    static optional< process::resource_usage >
+    cgroup_usage(const exec_handle& data,
+                 const optional< process::resource_usage >& usage)
+    {
+        if (!data._pimpl->cgroup || data._pimpl->followup || !usage)
+            return usage;
+
+        process::resource_usage merged = usage.get();
+        const process::resource_usage cgroup_usage =
+            data._pimpl->cgroup.get().usage();
+        if (cgroup_usage.user_time > merged.user_time)
+            merged.user_time = cgroup_usage.user_time;
+        if (cgroup_usage.system_time > merged.system_time)
+            merged.system_time = cgroup_usage.system_time;
+        if (cgroup_usage.max_rss > merged.max_rss)
+            merged.max_rss = cgroup_usage.max_rss;
+        return utils::make_optional(merged);
+    }
+
     /// Common code to run after any of the wait calls.
     ///
     /// \param original_pid The PID of the terminated subprocess.
@@ -669,6 +1722,7 @@ struct utils::process::executor::executor_handle::impl : utils::noncopyable {
         // this correctly but we don't care because this should not really
         // happen.
 
+        finish_sinks(data);
         if (!fs::exists(data.stdout_file())) {
             std::ofstream new_stdout(data.stdout_file().c_str());
         }
@@ -681,15 +1735,42 @@ struct utils::process::executor::executor_handle::impl : utils::noncopyable {
                 data.pid(),
                 data._pimpl->timer.fired() ?
                     none : utils::make_optional(status),
+                cgroup_usage(data, status.usage()),
                 data._pimpl->unprivileged_user,
                 data._pimpl->start_time, datetime::timestamp::now(),
                 data.control_directory(),
                 data.stdout_file(),
                 data.stderr_file(),
                 data._pimpl->state_owners,
+                data._pimpl->output_files,
+                data._pimpl->cgroup,
                 all_exec_handles)));
     }
 
+    /// Kills a subprocess that is still running.
+    ///
+    /// \param original_pid The PID of the subprocess to kill.
+    void
+    terminate(const pid_t original_pid)
+    {
+        const exec_handles_map::const_iterator iter = all_exec_handles.find(
+            original_pid);
+        PRE(iter != all_exec_handles.end());
+        const exec_handle& data = (*iter).second;
+
+        LI(F("Terminating subprocess with exec_handle %s") % original_pid);
+        if (data._pimpl->cgroup) {
+            process::cgroup cgroup = data._pimpl->cgroup.get();
+            try {
+                cgroup.kill();
+            } catch (const process::system_error& e) {
+                LW(F("Failed to kill cgroup %s: %s") % cgroup.directory() %
+                   e.what());
+            }
+        }
+        process::terminate_group(original_pid);
+    }
+
     executor::exit_handle
     reap(const pid_t original_pid)
     {
@@ -700,6 +1781,7 @@ struct utils::process::executor::executor_handle::impl : utils::noncopyable {
         exec_handle& data = (*iter).second;
         data._pimpl->timer.unprogram();
 
+        finish_sinks(data);
         if (!fs::exists(data.stdout_file())) {
             std::ofstream new_stdout(data.stdout_file().c_str());
         }
@@ -711,12 +1793,15 @@ struct utils::process::executor::executor_handle::impl : utils::noncopyable {
             new exit_handle::impl(
                 data.pid(),
                 none,
+                none,
                 data._pimpl->unprivileged_user,
                 data._pimpl->start_time, datetime::timestamp::now(),
                 data.control_directory(),
                 data.stdout_file(),
                 data.stderr_file(),
                 data._pimpl->state_owners,
+                data._pimpl->output_files,
+                data._pimpl->cgroup,
                 all_exec_handles)));
     }
 };
@@ -760,6 +1845,164 @@ executor::executor_handle::cleanup(void)
 }
 
 
+/// Selects where to capture the output of subprocesses spawned from now on.
+///
+/// By default, the stdout and stderr of subprocesses are written to files in
+/// their control directory.  Capturing them in memory instead avoids the disk
+/// round trip for every subprocess, as the output is written to and read from
+/// anonymous in-memory files that are never linked into the file system.  The
+/// paths returned by the stdout_file() and stderr_file() methods of the
+/// handles remain valid for as long as the handles are alive.
+///
+/// If the system cannot provide in-memory files, this logs a warning and
+/// keeps capturing the output on disk.
+///
+/// \param enable Whether to capture the output in memory.
+void
+executor::executor_handle::set_in_memory_output(const bool enable)
+{
+    if (enable && !_pimpl->memory_files_supported)
+        _pimpl->memory_files_supported = memory_files_work();
+    _pimpl->in_memory_output = enable && _pimpl->memory_files_supported.get();
+}
+
+
+/// Bounds the output captured from subprocesses spawned from now on.
+///
+/// When a limit is set, each output stream of a subprocess is captured through
+/// a pipe and only its first and last halves of the limit are stored, with a
+/// marker telling how many bytes were omitted in between.  This is enforced
+/// while the subprocess runs, so a subprocess that writes without bound cannot
+/// fill the disk or memory.  Streams sent to an explicit target are never
+/// bounded.
+///
+/// If the system cannot provide access to pipes by path, this logs a warning
+/// and keeps capturing the output in full.
+///
+/// \param limit Maximum number of bytes to keep per stream, or 0 to keep all
+///     of the output.
+void
+executor::executor_handle::set_output_limit(const std::size_t limit)
+{
+    if (limit > 0 && !_pimpl->output_pipes_supported)
+        _pimpl->output_pipes_supported = output_pipes_work();
+    _pimpl->output_limit =
+        limit > 0 && _pimpl->output_pipes_supported.get() ? limit : 0;
+}
+
+
+/// Backs the control and work directories of new subprocesses with a tmpfs.
+///
+/// Subprocesses that do a lot of small file operations run much faster on a
+/// memory-backed file system.  A single tmpfs of the given size is mounted
+/// within the root work directory the first time this is called and all
+/// subprocesses share it; later calls have no effect.  The tmpfs is unmounted
+/// by cleanup().
+///
+/// Subprocesses whose required disk space, as set by set_required_disk_space(),
+/// exceeds the free space in the tmpfs get their directories on disk instead.
+/// If the tmpfs cannot be mounted, such as when not running as root, this
+/// logs a warning and keeps all directories on disk.
+///
+/// \param size The size of the tmpfs.
+void
+executor::executor_handle::use_tmpfs(const units::bytes& size)
+{
+    if (_pimpl->tmpfs_attempted)
+        return;
+    _pimpl->tmpfs_attempted = true;
+
+    const fs::path mount_point =
+        _pimpl->root_work_directory->directory() / "tmpfs";
+    try {
+        fs::mkdir(mount_point, 0755);
+    } catch (const fs::error& e) {
+        LW(F("Cannot create tmpfs mount point: %s; using disk") % e.what());
+        return;
+    }
+    try {
+        fs::mount_tmpfs(mount_point, size);
+    } catch (const fs::error& e) {
+        LW(F("Cannot mount tmpfs for work directories: %s; using disk") %
+           e.what());
+        try {
+            fs::rmdir(mount_point);
+        } catch (const fs::error& e2) {
+            LW(F("Failed to remove %s: %s") % mount_point % e2.what());
+        }
+        return;
+    }
+    LI(F("Using %s tmpfs on %s for work directories") % size.format() %
+       mount_point);
+    _pimpl->tmpfs_directory = mount_point;
+    _pimpl->drain_directory_pool();
+}
+
+
+/// Sets the free disk space needed by subprocesses spawned from now on.
+///
+/// This is used to decide whether their directories fit in the tmpfs
+/// configured by use_tmpfs().
+///
+/// \param required_disk_space The required free disk space, or 0 if not known.
+void
+executor::executor_handle::set_required_disk_space(
+    const units::bytes& required_disk_space)
+{
+    _pimpl->required_disk_space = required_disk_space;
+}
+
+
+/// Runs subprocesses spawned from now on in their own cgroups.
+///
+/// Each subprocess gets a child of the cgroup we run in, which must have been
+/// delegated to us (as done by systemd-run --user --scope -p Delegate=yes, for
+/// example).  The cgroup tracks all descendants of the subprocess, even those
+/// that leave its process group, so that all of them are killed when the
+/// subprocess times out and when its on-disk state is cleaned up.  The cgroup
+/// also provides the resource usage of the whole tree of processes and allows
+/// enforcing the limit set by set_memory_limit().
+///
+/// Only the unified hierarchy of Linux (aka cgroup v2) is supported.  If the
+/// cgroup is not usable, this logs a warning and keeps tracking subprocesses
+/// by their process group only.  Later calls have no effect.
+void
+executor::executor_handle::use_cgroups(void)
+{
+    if (_pimpl->cgroups_attempted)
+        return;
+    _pimpl->cgroups_attempted = true;
+
+    const optional< process::cgroup > root = process::cgroup::current();
+    if (!root) {
+        LW("cgroup v2 not available; tracking subprocesses by process group");
+        return;
+    }
+    if (::access(root.get().directory().c_str(), W_OK) == -1 ||
+        ::access(root.get().procs_file().c_str(), W_OK) == -1) {
+        LW(F("cgroup %s not delegated to us; tracking subprocesses by process "
+             "group") % root.get().directory());
+        return;
+    }
+    LI(F("Using cgroup %s for subprocesses") % root.get().directory());
+    _pimpl->cgroup_root = root;
+    _pimpl->enable_cgroup_controllers();
+}
+
+
+/// Sets the memory limit of subprocesses spawned from now on.
+///
+/// This is only enforced if use_cgroups() managed to enable the memory
+/// controller.
+///
+/// \param limit The maximum amount of memory, or 0 for no limit.
+void
+executor::executor_handle::set_memory_limit(const units::bytes& limit)
+{
+    _pimpl->memory_limit = limit;
+}
+
+
 /// Initializes the executor.
 ///
 /// \pre This function can only be called if there is no other executor_handle
@@ -781,17 +2024,86 @@ executor::executor_handle::spawn_pre(void)
 {
     signals::check_interrupt();
 
-    ++_pimpl->last_subprocess;
+    _pimpl->spawn_start_time = datetime::timestamp::now();
+    _pimpl->pending_output_files.reset();
+    _pimpl->pending_output_sinks.clear();
 
-    const fs::path control_directory =
-        _pimpl->root_work_directory->directory() /
-        (F("%s") % _pimpl->last_subprocess);
-    fs::mkdir_p(control_directory / detail::work_subdir, 0755);
+    if (_pimpl->pending_cgroup) {
+        // Left behind by a previous spawn that failed.
+        remove_cgroup(_pimpl->pending_cgroup.get());
+        _pimpl->pending_cgroup = none;
+    }
 
+    const fs::path parent = _pimpl->control_directory_parent(
+        _pimpl->required_disk_space);
+    fs::path control_directory = parent;
+    if (!_pimpl->directory_pool.empty() &&
+        _pimpl->directory_pool.front().branch_path() == parent) {
+        control_directory = _pimpl->directory_pool.front();
+        _pimpl->directory_pool.pop_front();
+    } else {
+        control_directory = _pimpl->create_control_directory(parent);
+    }
+
+    if (_pimpl->cgroup_root)
+        _pimpl->pending_cgroup = _pimpl->create_cgroup(control_directory);
     return control_directory;
 }
 
 
+/// Gets the cgroup that the subprocess being spawned has to join.
+///
+/// \return The cgroup.procs file of the cgroup created by spawn_pre(), or none
+/// if the subprocess does not get a cgroup.
+optional< fs::path >
+executor::executor_handle::child_cgroup(void) const
+{
+    if (_pimpl->pending_cgroup)
+        return utils::make_optional(_pimpl->pending_cgroup.get().procs_file());
+    else
+        return none;
+}
+
+
+/// Computes the file to which to send an output stream of a subprocess.
+///
+/// \param control_directory Control directory as returned by spawn_pre().
+/// \param name Basename of the file to use if the output is not captured in
+///     memory.
+/// \param target If not none, file requested by the caller.
+///
+/// \return The path to which the subprocess has to write.  If the output is
+/// bounded, this is not the file where the output ends up; spawn_post() takes
+/// care of recovering the latter.
+fs::path
+executor::executor_handle::output_file(const fs::path& control_directory,
+                                       const char* name,
+                                       const optional< fs::path >& target)
+{
+    if (target)
+        return target.get();
+
+    optional< fs::path > file;
+    if (_pimpl->in_memory_output) {
+        if (!_pimpl->pending_output_files)
+            _pimpl->pending_output_files.reset(new memory_files());
+        file = _pimpl->pending_output_files->create(name);
+    }
+    if (!file)
+        file = control_directory / name;
+
+    if (_pimpl->output_limit > 0) {
+        const output_sink_ptr sink = output_sink::create(
+            file.get(), _pimpl->output_limit);
+        if (sink) {
+            _pimpl->pending_output_sinks.push_back(sink);
+            return sink->child_path();
+        }
+    }
+    return file.get();
+}
+
+
 /// Post-helper for the spawn() method.
 ///
 /// \param control_directory Control directory as returned by spawn_pre().
@@ -811,16 +2123,43 @@ executor::executor_handle::spawn_post(
     const optional< passwd::user > unprivileged_user,
     std::unique_ptr< process::child > child)
 {
+    const datetime::timestamp start_time = datetime::timestamp::now();
+    if (_pimpl->spawn_start_time) {
+        spawn_seconds.observe(start_time - _pimpl->spawn_start_time.get());
+        _pimpl->spawn_start_time = none;
+    }
+
+    // The subprocess holds its own references to the pipes of the output
+    // sinks by now, so drop ours to be able to detect end of file.
+    fs::path real_stdout_file = stdout_file;
+    fs::path real_stderr_file = stderr_file;
+    for (output_sinks_vector::const_iterator iter =
+             _pimpl->pending_output_sinks.begin();
+         iter != _pimpl->pending_output_sinks.end(); ++iter) {
+        if ((*iter)->child_path() == stdout_file)
+            real_stdout_file = (*iter)->file();
+        if ((*iter)->child_path() == stderr_file)
+            real_stderr_file = (*iter)->file();
+        (*iter)->close_child_end();
+    }
+
     const exec_handle handle(std::shared_ptr< exec_handle::impl >(
         new exec_handle::impl(
             child->pid(),
             control_directory,
-            stdout_file,
-            stderr_file,
-            datetime::timestamp::now(),
+            real_stdout_file,
+            real_stderr_file,
+            start_time,
             timeout,
             unprivileged_user,
-            detail::refcnt_t(new detail::refcnt_t::element_type(0)))));
+            detail::refcnt_t(new detail::refcnt_t::element_type(0)),
+            _pimpl->pending_output_files,
+            _pimpl->pending_output_sinks,
+            _pimpl->pending_cgroup,
+            false)));
+    _pimpl->pending_output_files.reset();
+    _pimpl->pending_output_sinks.clear();
+    _pimpl->pending_cgroup = none;
     const auto value = exec_handles_map::value_type(handle.pid(), handle);
     auto insert_pair = _pimpl->all_exec_handles.insert(value);
     if (!insert_pair.second) {
@@ -837,10 +2176,20 @@ executor::executor_handle::spawn_post(
 
 
 /// Pre-helper for the spawn_followup() method.
-void
-executor::executor_handle::spawn_followup_pre(void)
+///
+/// \param base Exit handle of the subprocess to use as context.
+///
+/// \return The cgroup.procs file of the cgroup of the base subprocess, or none
+/// if it did not get a cgroup.
+optional< fs::path >
+executor::executor_handle::spawn_followup_pre(const exit_handle& base)
 {
     signals::check_interrupt();
+    _pimpl->spawn_start_time = datetime::timestamp::now();
+    if (base._pimpl->cgroup)
+        return utils::make_optional(base._pimpl->cgroup.get().procs_file());
+    else
+        return none;
 }
 
 
@@ -858,16 +2207,26 @@ executor::executor_handle::spawn_followup_post(
     std::unique_ptr< process::child > child)
 {
     INV(*base.state_owners() > 0);
+    const datetime::timestamp start_time = datetime::timestamp::now();
+    if (_pimpl->spawn_start_time) {
+        spawn_seconds.observe(start_time - _pimpl->spawn_start_time.get());
+        _pimpl->spawn_start_time = none;
+    }
+
     const exec_handle handle(std::shared_ptr< exec_handle::impl >(
         new exec_handle::impl(
             child->pid(),
             base.control_directory(),
             base.stdout_file(),
             base.stderr_file(),
-            datetime::timestamp::now(),
+            start_time,
             timeout,
             base.unprivileged_user(),
-            base.state_owners())));
+            base.state_owners(),
+            base._pimpl->output_files,
+            output_sinks_vector(),
+            base._pimpl->cgroup,
+            true)));
     const auto value = exec_handles_map::value_type(handle.pid(), handle);
     auto insert_pair = _pimpl->all_exec_handles.insert(value);
     if (!insert_pair.second) {
@@ -892,7 +2251,8 @@ executor::exit_handle
 executor::executor_handle::wait(const exec_handle exec_handle)
 {
     signals::check_interrupt();
-    const process::status status = process::wait(exec_handle.pid());
+    const process::status status = _pimpl->wait_for(
+        utils::make_optional(exec_handle.pid()));
     return _pimpl->post_wait(exec_handle.pid(), status);
 }
 
@@ -904,11 +2264,26 @@ executor::exit_handle
 executor::executor_handle::wait_any(void)
 {
     signals::check_interrupt();
-    const process::status status = process::wait_any();
+    const datetime::timestamp start_time = datetime::timestamp::now();
+    const process::status status = _pimpl->wait_for(none);
+    wait_seconds.observe(datetime::timestamp::now() - start_time);
     return _pimpl->post_wait(status.dead_pid(), status);
 }
 
 
+/// Forcibly terminates a running subprocess before it exits on its own.
+///
+/// The subprocess must still be waited for as usual, and its exit status then
+/// reflects the signal that killed it.
+///
+/// \param pid The PID of the subprocess, as returned by exec_handle::pid().
+void
+executor::executor_handle::terminate(const int pid)
+{
+    _pimpl->terminate(pid);
+}
+
+
 /// Forms exit_handle for the given PID subprocess.
 ///
 /// Can be used in the cases when we want to do cleanup(s) of a killed test
@@ -72,7 +72,9 @@
 #include "utils/optional.hpp"
 #include "utils/passwd_fwd.hpp"
 #include "utils/process/child_fwd.hpp"
+#include "utils/process/resource_usage_fwd.hpp"
 #include "utils/process/status_fwd.hpp"
+#include "utils/units_fwd.hpp"
 
 namespace utils {
 namespace process {
@@ -92,7 +94,8 @@ typedef std::shared_ptr< std::size_t > refcnt_t;
 
 
 void setup_child(const utils::optional< utils::passwd::user >,
-                 const utils::fs::path&, const utils::fs::path&);
+                 const utils::fs::path&, const utils::fs::path&,
+                 const utils::optional< utils::fs::path >&);
 
 
 }   // namespace detail
@@ -158,6 +161,7 @@ public:
 
     int original_pid(void) const;
     const utils::optional< utils::process::status >& status(void) const;
+    const utils::optional< utils::process::resource_usage >& usage(void) const;
     const utils::optional< utils::passwd::user >& unprivileged_user(void) const;
     const utils::datetime::timestamp& start_time() const;
     const utils::datetime::timestamp& end_time() const;
@@ -182,6 +186,9 @@ class executor_handle {
     executor_handle(void) throw();
 
     utils::fs::path spawn_pre(void);
+    utils::fs::path output_file(const utils::fs::path&, const char*,
+                                const utils::optional< utils::fs::path >&);
+    utils::optional< utils::fs::path > child_cgroup(void) const;
     exec_handle spawn_post(const utils::fs::path&,
                            const utils::fs::path&,
                            const utils::fs::path&,
@@ -189,7 +196,7 @@ class executor_handle {
                            const utils::optional< utils::passwd::user >,
                            std::unique_ptr< utils::process::child >);
 
-    void spawn_followup_pre(void);
+    utils::optional< utils::fs::path > spawn_followup_pre(const exit_handle&);
     exec_handle spawn_followup_post(const exit_handle&,
                                     const utils::datetime::delta&,
                                     std::unique_ptr< utils::process::child >);
@@ -201,6 +208,13 @@ public:
 
     void cleanup(void);
 
+    void set_in_memory_output(const bool);
+    void set_output_limit(const std::size_t);
+    void use_tmpfs(const utils::units::bytes&);
+    void set_required_disk_space(const utils::units::bytes&);
+    void use_cgroups(void);
+    void set_memory_limit(const utils::units::bytes&);
+
     template< class Hook >
     exec_handle spawn(Hook,
                       const datetime::delta&,
@@ -208,6 +222,15 @@ public:
                       const utils::optional< utils::fs::path > = utils::none,
                       const utils::optional< utils::fs::path > = utils::none);
 
+    template< class Planner >
+    exec_handle spawn_plan(Planner,
+                           const datetime::delta&,
+                           const utils::optional< utils::passwd::user >,
+                           const utils::optional< utils::fs::path > =
+                               utils::none,
+                           const utils::optional< utils::fs::path > =
+                               utils::none);
+
     template< class Hook >
     exec_handle spawn_followup(Hook,
                                const exit_handle&,
@@ -216,6 +239,7 @@ public:
     exit_handle wait(const exec_handle);
     exit_handle wait_any(void);
     exit_handle reap(const pid_t);
+    void terminate(const pid_t);
 
     void check_interrupt(void) const;
 };
@@ -35,6 +35,8 @@
 #include "utils/optional.ipp"
 #include "utils/passwd.hpp"
 #include "utils/process/child.ipp"
+#include "utils/process/exec_plan.hpp"
+#include "utils/process/isolation.hpp"
 
 namespace utils {
 namespace process {
@@ -68,6 +70,9 @@ class run_child {
     /// the control and work directories will be writable by this user.
     const optional< passwd::user > _unprivileged_user;
 
+    /// The cgroup.procs file of the cgroup to join, if any.
+    const optional< fs::path > _cgroup;
+
 public:
     /// Constructor.
     ///
@@ -75,14 +80,17 @@ public:
     /// \param control_directory Directory where control files can be placed.
     /// \param work_directory Directory to enter when running the subprocess.
     /// \param unprivileged_user If set, user to switch to before execution.
+    /// \param cgroup If set, cgroup.procs file of the cgroup to join.
     run_child(Hook hook,
               const fs::path& control_directory,
               const fs::path& work_directory,
-              const optional< passwd::user > unprivileged_user) :
+              const optional< passwd::user > unprivileged_user,
+              const optional< fs::path >& cgroup) :
         _hook(hook),
         _control_directory(control_directory),
         _work_directory(work_directory),
-        _unprivileged_user(unprivileged_user)
+        _unprivileged_user(unprivileged_user),
+        _cgroup(cgroup)
     {
     }
 
@@ -91,11 +99,43 @@ public:
     operator()(void)
     {
         executor::detail::setup_child(_unprivileged_user,
-                                      _control_directory, _work_directory);
+                                      _control_directory, _work_directory,
+                                      _cgroup);
         _hook(_control_directory);
     }
 };
 
+
+/// Functor to execute a precomputed plan in a child process.
+///
+/// This is used by spawn_plan() when the subprocess cannot be spawned without
+/// running code of ours in it.
+template< class Planner >
+class run_plan {
+    /// Function or functor to compute the plan to execute.
+    Planner _planner;
+
+public:
+    /// Constructor.
+    ///
+    /// \param planner Function or functor to compute the plan to execute.
+    run_plan(Planner planner) :
+        _planner(planner)
+    {
+    }
+
+    /// Body of the subprocess.
+    ///
+    /// \param control_directory Directory where control files can be placed.
+    void
+    operator()(const fs::path& control_directory)
+    {
+        const exec_plan plan = _planner(control_directory);
+        plan.exec();
+    }
+};
+
+
 }  // namespace detail
 }  // namespace executor
 
@@ -124,16 +164,17 @@ executor::executor_handle::spawn(
 {
     const fs::path unique_work_directory = spawn_pre();
 
-    const fs::path stdout_path = stdout_target ?
-        stdout_target.get() : (unique_work_directory / detail::stdout_name);
-    const fs::path stderr_path = stderr_target ?
-        stderr_target.get() : (unique_work_directory / detail::stderr_name);
+    const fs::path stdout_path = output_file(
+        unique_work_directory, detail::stdout_name, stdout_target);
+    const fs::path stderr_path = output_file(
+        unique_work_directory, detail::stderr_name, stderr_target);
 
     std::unique_ptr< process::child > child = process::child::fork_files(
         detail::run_child< Hook >(hook,
                                   unique_work_directory,
                                   unique_work_directory / detail::work_subdir,
-                                  unprivileged_user),
+                                  unprivileged_user,
+                                  child_cgroup()),
         stdout_path, stderr_path);
 
     return spawn_post(unique_work_directory, stdout_path, stderr_path,
@@ -141,11 +182,70 @@ executor::executor_handle::spawn(
 }
 
 
+/// Executes a subprocess described by a precomputed plan asynchronously.
+///
+/// This is equivalent to calling spawn() with a hook that executes the plan,
+/// but the plan is computed in the parent process so that the subprocess does
+/// not have to run any code of ours: see child::spawn_plan() for details.  The
+/// plan is extended to isolate the subprocess in the same way spawn() does.
+///
+/// Switching to an unprivileged user requires running code in the subprocess,
+/// so the plan is executed by a forked subprocess in that case.
+///
+/// \tparam Planner Type of the planner.
+/// \param planner Function or functor that, given the control directory of the
+///     subprocess, returns the exec_plan to execute.  The planner runs in the
+///     parent process.
+/// \param timeout Maximum amount of time the subprocess can run for.
+/// \param unprivileged_user If not none, user to switch to before execution.
+/// \param stdout_target If not none, file to which to write the stdout of the
+///     test case.
+/// \param stderr_target If not none, file to which to write the stderr of the
+///     test case.
+///
+/// \return A handle for the background operation.  Used to match the result of
+/// the execution returned by wait_any() with this invocation.
+template< class Planner >
+executor::exec_handle
+executor::executor_handle::spawn_plan(
+    Planner planner,
+    const datetime::delta& timeout,
+    const optional< passwd::user > unprivileged_user,
+    const optional< fs::path > stdout_target,
+    const optional< fs::path > stderr_target)
+{
+    if (unprivileged_user && passwd::current_user().is_root())
+        return spawn(detail::run_plan< Planner >(planner), timeout,
+                     unprivileged_user, stdout_target, stderr_target);
+
+    const fs::path unique_work_directory = spawn_pre();
+
+    const fs::path stdout_path = output_file(
+        unique_work_directory, detail::stdout_name, stdout_target);
+    const fs::path stderr_path = output_file(
+        unique_work_directory, detail::stderr_name, stderr_target);
+
+    exec_plan plan = process::isolate_plan(
+        planner(unique_work_directory),
+        unique_work_directory / detail::work_subdir);
+    const optional< fs::path > cgroup = child_cgroup();
+    if (cgroup)
+        plan.set_cgroup(cgroup.get());
+
+    std::unique_ptr< process::child > child = process::child::spawn_plan(
+        plan, stdout_path, stderr_path);
+
+    return spawn_post(unique_work_directory, stdout_path, stderr_path,
+                      timeout, unprivileged_user, std::move(child));
+}
+
+
 /// Forks and executes a subprocess asynchronously in the context of another.
 ///
 /// By context we understand the on-disk state of a previously-executed process,
 /// thus the new subprocess spawned by this function will run with the same
-/// control and work directories as another process.
+/// control and work directories as another process.  The new subprocess also
+/// joins the cgroup of the other process, if any.
 ///
 /// \tparam Hook Type of the hook.
 /// \param hook Function or functor to run in the subprocess.
@@ -163,13 +263,14 @@ executor::executor_handle::spawn_followup(Hook hook,
                                           const exit_handle& base,
                                           const datetime::delta& timeout)
 {
-    spawn_followup_pre();
+    const optional< fs::path > cgroup = spawn_followup_pre(base);
 
     std::unique_ptr< process::child > child = process::child::fork_files(
         detail::run_child< Hook >(hook,
                                   base.control_directory(),
                                   base.work_directory(),
-                                  base.unprivileged_user()),
+                                  base.unprivileged_user(),
+                                  cgroup),
         base.stdout_file(), base.stderr_file());
 
     return spawn_followup_post(base, timeout, std::move(child));
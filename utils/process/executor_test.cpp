@@ -33,6 +33,7 @@ extern "C" {
 #include <sys/time.h>
 #include <sys/wait.h>
 
+#include <fcntl.h>
 #include <signal.h>
 #include <unistd.h>
 }
@@ -41,6 +42,7 @@ extern "C" {
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <string>
 #include <vector>
 
 #include <atf-c++.hpp>
@@ -54,12 +56,15 @@ extern "C" {
 #include "utils/fs/path.hpp"
 #include "utils/optional.ipp"
 #include "utils/passwd.hpp"
+#include "utils/process/cgroup.hpp"
+#include "utils/process/exec_plan.hpp"
 #include "utils/process/status.hpp"
 #include "utils/sanity.hpp"
 #include "utils/signals/exceptions.hpp"
 #include "utils/stacktrace.hpp"
 #include "utils/text/exceptions.hpp"
 #include "utils/text/operations.ipp"
+#include "utils/units.hpp"
 
 namespace datetime = utils::datetime;
 namespace executor = utils::process::executor;
@@ -68,6 +73,7 @@ namespace passwd = utils::passwd;
 namespace process = utils::process;
 namespace signals = utils::signals;
 namespace text = utils::text;
+namespace units = utils::units;
 
 using utils::none;
 using utils::optional;
@@ -191,6 +197,24 @@ public:
 };
 
 
+static void child_flood(const fs::path&) UTILS_NORETURN;
+
+
+/// Subprocess that writes a lot of data to stdout and a little to stderr.
+///
+/// The output to stdout is much larger than the capacity of a pipe so that
+/// the subprocess cannot terminate unless its output is drained.
+static void
+child_flood(const fs::path& /* control_directory */)
+{
+    std::cout << std::string(50, 'h') << std::string(1000000, 'x')
+              << std::string(50, 't');
+    std::cerr << "stderr: some text\n";
+
+    do_exit(EXIT_SUCCESS);
+}
+
+
 static void child_pause(const fs::path&) UTILS_NORETURN;
 
 
@@ -278,6 +302,41 @@ child_spawn_blocking_child(
 }
 
 
+static void child_spawn_daemon(const fs::path&) UTILS_NORETURN;
+
+
+/// Subprocess that leaves a daemon behind.
+///
+/// The daemon runs in its own session, so it escapes the process group of this
+/// subprocess and can only be tracked by its cgroup.
+///
+/// \param control_directory Directory where control files separate from the
+///     work directory can be placed.
+static void
+child_spawn_daemon(const fs::path& control_directory)
+{
+    pid_t pid = ::fork();
+    if (pid == -1) {
+        std::cerr << "Cannot fork subprocess\n";
+        do_exit(EXIT_FAILURE);
+    } else if (pid == 0) {
+        (void)::setsid();
+        for (;;)
+            ::pause();
+    } else {
+        const fs::path name = control_directory / "pid";
+        std::ofstream pidfile(name.c_str());
+        if (!pidfile) {
+            std::cerr << "Failed to create the pidfile\n";
+            do_exit(EXIT_FAILURE);
+        }
+        pidfile << pid;
+        pidfile.close();
+        do_exit(EXIT_SUCCESS);
+    }
+}
+
+
 static void child_validate_isolation(const fs::path&) UTILS_NORETURN;
 
 
@@ -297,6 +356,26 @@ child_validate_isolation(const fs::path& /* control_directory */)
 }
 
 
+/// Computes a plan that prints details about the environment of the child.
+///
+/// \param control_directory Directory where control files can be placed.
+///
+/// \return A plan to run a shell script.
+static process::exec_plan
+plan_print_environment(const fs::path& control_directory)
+{
+    process::args_vector args;
+    args.push_back("-c");
+    args.push_back("echo \"HOME=${HOME}\"; echo \"LANG=${LANG-unset}\"; "
+                   "echo \"CONTROL=${1}\"; echo \"PLAN=${PLAN}\"");
+    args.push_back("sh");
+    args.push_back(control_directory.str());
+    process::exec_plan plan(fs::path("/bin/sh"), args);
+    plan.set_env("PLAN", "from the planner");
+    return plan;
+}
+
+
 /// Invokes executor::spawn() with default arguments.
 ///
 /// \param handle The executor on which to invoke spawn().
@@ -617,6 +696,108 @@ ATF_TEST_CASE_BODY(integration__followup)
 }
 
 
+ATF_TEST_CASE_WITHOUT_HEAD(integration__in_memory_output);
+ATF_TEST_CASE_BODY(integration__in_memory_output)
+{
+    executor::executor_handle handle = executor::setup();
+    handle.set_in_memory_output(true);
+
+    (void)handle.spawn(child_create_cookie("cookie.1"), infinite_timeout, none);
+    executor::exit_handle exit_1_handle = handle.wait_any();
+    if (exit_1_handle.stdout_file() ==
+        exit_1_handle.control_directory() / "stdout.txt") {
+        exit_1_handle.cleanup();
+        handle.cleanup();
+        ATF_SKIP("In-memory files not supported by this system");
+    }
+    ATF_REQUIRE(!fs::exists(exit_1_handle.control_directory() / "stdout.txt"));
+    ATF_REQUIRE(!fs::exists(exit_1_handle.control_directory() / "stderr.txt"));
+
+    (void)handle.spawn_followup(child_create_cookie("cookie.2"), exit_1_handle,
+                                infinite_timeout);
+    executor::exit_handle exit_2_handle = handle.wait_any();
+    ATF_REQUIRE_EQ(exit_1_handle.stdout_file(), exit_2_handle.stdout_file());
+    ATF_REQUIRE_EQ(exit_1_handle.stderr_file(), exit_2_handle.stderr_file());
+
+    exit_2_handle.cleanup();
+    exit_1_handle.cleanup();
+
+    // The output must remain accessible for as long as the handles are alive,
+    // even after the on-disk state is gone.
+    ATF_REQUIRE(!fs::exists(exit_1_handle.control_directory()));
+    ATF_REQUIRE(atf::utils::compare_file(
+                    exit_1_handle.stdout_file().str(),
+                    "Creating cookie: cookie.1 (stdout)\n"
+                    "Creating cookie: cookie.2 (stdout)\n"));
+    ATF_REQUIRE(atf::utils::compare_file(
+                    exit_1_handle.stderr_file().str(),
+                    "Creating cookie: cookie.1 (stderr)\n"
+                    "Creating cookie: cookie.2 (stderr)\n"));
+
+    (void)handle.spawn_plan(plan_print_environment, infinite_timeout, none);
+    executor::exit_handle exit_3_handle = handle.wait_any();
+    ATF_REQUIRE(!fs::exists(exit_3_handle.control_directory() / "stdout.txt"));
+    ATF_REQUIRE(atf::utils::grep_file("PLAN=from the planner",
+                                      exit_3_handle.stdout_file().str()));
+    exit_3_handle.cleanup();
+
+    handle.cleanup();
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(integration__output_limit);
+ATF_TEST_CASE_BODY(integration__output_limit)
+{
+    int fds[2];
+    ATF_REQUIRE(::pipe(fds) != -1);
+    const std::string path = F("/dev/fd/%s") % fds[1];
+    const int fd = ::open(path.c_str(), O_WRONLY);
+    ::close(fds[0]);
+    ::close(fds[1]);
+    if (fd == -1)
+        ATF_SKIP("Pipes cannot be opened by path on this system");
+    ::close(fd);
+
+    executor::executor_handle handle = executor::setup();
+    handle.set_output_limit(100);
+
+    const executor::exec_handle exec_1_handle = handle.spawn(
+        child_flood, infinite_timeout, none);
+    const executor::exec_handle exec_2_handle = handle.spawn(
+        child_flood, infinite_timeout, none);
+    const fs::path stdout_target("stdout-target.txt");
+    const executor::exec_handle exec_3_handle = handle.spawn(
+        child_print, infinite_timeout, none,
+        utils::make_optional(stdout_target));
+    ATF_REQUIRE_EQ(exec_1_handle.control_directory() / "stdout.txt",
+                   exec_1_handle.stdout_file());
+
+    for (int i = 0; i < 3; ++i) {
+        executor::exit_handle exit_handle = handle.wait_any();
+        ATF_REQUIRE(exit_handle.status());
+        ATF_REQUIRE(exit_handle.status().get().exited());
+        if (exit_handle.original_pid() == exec_3_handle.pid()) {
+            ATF_REQUIRE(atf::utils::compare_file(
+                stdout_target.str(), "stdout: some text\n"));
+            ATF_REQUIRE(atf::utils::compare_file(
+                exit_handle.stderr_file().str(),
+                "stderr: some other text\n"));
+        } else {
+            ATF_REQUIRE(atf::utils::compare_file(
+                exit_handle.stdout_file().str(),
+                std::string(50, 'h') +
+                "\n[1000000 bytes of output omitted]\n" +
+                std::string(50, 't')));
+            ATF_REQUIRE(atf::utils::compare_file(
+                exit_handle.stderr_file().str(), "stderr: some text\n"));
+        }
+        exit_handle.cleanup();
+    }
+
+    handle.cleanup();
+}
+
+
 ATF_TEST_CASE_WITHOUT_HEAD(integration__output_files_always_exist);
 ATF_TEST_CASE_BODY(integration__output_files_always_exist)
 {
@@ -640,6 +821,126 @@ ATF_TEST_CASE_BODY(integration__output_files_always_exist)
 }
 
 
+ATF_TEST_CASE_WITHOUT_HEAD(integration__directory_pool);
+ATF_TEST_CASE_BODY(integration__directory_pool)
+{
+    executor::executor_handle handle = executor::setup();
+    const fs::path root_work_directory = handle.root_work_directory();
+
+    const executor::exec_handle exec_1_handle = handle.spawn(
+        child_pause, infinite_timeout, none);
+    ATF_REQUIRE_EQ(root_work_directory / "1", exec_1_handle.control_directory());
+    const executor::exec_handle exec_2_handle = handle.spawn(
+        child_print, infinite_timeout, none);
+    ATF_REQUIRE_EQ(root_work_directory / "2", exec_2_handle.control_directory());
+
+    // Waiting gives the executor a chance to prepare directories ahead of
+    // time, but they must still be handed out in order.
+    executor::exit_handle exit_2_handle = handle.wait(exec_2_handle);
+    ATF_REQUIRE(fs::exists(root_work_directory / "3" / "work"));
+    ATF_REQUIRE(fs::exists(root_work_directory / "4" / "work"));
+    ATF_REQUIRE(atf::utils::compare_file(exit_2_handle.stdout_file().str(),
+                                         "stdout: some text\n"));
+    exit_2_handle.cleanup();
+
+    const executor::exec_handle exec_3_handle = handle.spawn(
+        child_print, infinite_timeout, none);
+    ATF_REQUIRE_EQ(root_work_directory / "3", exec_3_handle.control_directory());
+    executor::exit_handle exit_3_handle = handle.wait(exec_3_handle);
+    ATF_REQUIRE(atf::utils::compare_file(exit_3_handle.stdout_file().str(),
+                                         "stdout: some text\n"));
+    exit_3_handle.cleanup();
+    ATF_REQUIRE(!fs::exists(root_work_directory / "3"));
+
+    // Unused directories in the pool must be wiped along with the executor.
+    handle.cleanup();
+    ATF_REQUIRE(!fs::exists(root_work_directory));
+}
+
+
+ATF_TEST_CASE(integration__tmpfs);
+ATF_TEST_CASE_HEAD(integration__tmpfs)
+{
+    set_md_var("require.user", "root");
+}
+ATF_TEST_CASE_BODY(integration__tmpfs)
+{
+    executor::executor_handle handle = executor::setup();
+    handle.use_tmpfs(units::bytes(16 * units::MB));
+    const fs::path tmpfs = handle.root_work_directory() / "tmpfs";
+
+    (void)handle.spawn(child_create_cookie("cookie"), infinite_timeout, none);
+    executor::exit_handle exit_1_handle = handle.wait_any();
+    ATF_REQUIRE_EQ(tmpfs, exit_1_handle.control_directory().branch_path());
+    ATF_REQUIRE(fs::exists(exit_1_handle.work_directory() / "cookie"));
+    ATF_REQUIRE(fs::free_disk_space(exit_1_handle.work_directory()) <=
+                units::bytes(16 * units::MB));
+    exit_1_handle.cleanup();
+
+    handle.set_required_disk_space(units::bytes(32 * units::MB));
+    (void)handle.spawn(child_create_cookie("cookie"), infinite_timeout, none);
+    executor::exit_handle exit_2_handle = handle.wait_any();
+    ATF_REQUIRE_EQ(handle.root_work_directory(),
+                   exit_2_handle.control_directory().branch_path());
+    ATF_REQUIRE(fs::exists(exit_2_handle.work_directory() / "cookie"));
+    exit_2_handle.cleanup();
+
+    const fs::path root_work_directory = handle.root_work_directory();
+    handle.cleanup();
+    ATF_REQUIRE(!fs::exists(root_work_directory));
+}
+
+
+ATF_TEST_CASE(integration__tmpfs__unavailable);
+ATF_TEST_CASE_HEAD(integration__tmpfs__unavailable)
+{
+    set_md_var("require.user", "unprivileged");
+}
+ATF_TEST_CASE_BODY(integration__tmpfs__unavailable)
+{
+    executor::executor_handle handle = executor::setup();
+    handle.use_tmpfs(units::bytes(16 * units::MB));
+
+    (void)handle.spawn(child_create_cookie("cookie"), infinite_timeout, none);
+    executor::exit_handle exit_handle = handle.wait_any();
+    ATF_REQUIRE_EQ(handle.root_work_directory(),
+                   exit_handle.control_directory().branch_path());
+    ATF_REQUIRE(fs::exists(exit_handle.work_directory() / "cookie"));
+    exit_handle.cleanup();
+
+    handle.cleanup();
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(integration__cgroups);
+ATF_TEST_CASE_BODY(integration__cgroups)
+{
+    const optional< process::cgroup > cgroup = process::cgroup::current();
+    if (!cgroup || ::access(cgroup.get().directory().c_str(), W_OK) == -1)
+        skip("Requires a delegated cgroup v2 subtree");
+
+    executor::executor_handle handle = executor::setup();
+    handle.use_cgroups();
+
+    (void)handle.spawn(child_spawn_daemon, infinite_timeout, none);
+    executor::exit_handle exit_handle = handle.wait_any();
+    require_exit(EXIT_SUCCESS, exit_handle.status());
+    ATF_REQUIRE(exit_handle.usage());
+
+    std::ifstream pidfile((exit_handle.control_directory() / "pid").c_str());
+    ATF_REQUIRE(pidfile);
+    pid_t pid;
+    pidfile >> pid;
+    pidfile.close();
+    ATF_REQUIRE(::kill(pid, 0) != -1);
+
+    exit_handle.cleanup();
+    ensure_dead(pid);
+
+    handle.cleanup();
+}
+
+
 ATF_TEST_CASE(integration__timeouts);
 ATF_TEST_CASE_HEAD(integration__timeouts)
 {
@@ -689,6 +990,45 @@ ATF_TEST_CASE_BODY(integration__timeouts)
 }
 
 
+ATF_TEST_CASE(integration__terminate);
+ATF_TEST_CASE_HEAD(integration__terminate)
+{
+    set_md_var("timeout", "60");
+}
+ATF_TEST_CASE_BODY(integration__terminate)
+{
+    executor::executor_handle handle = executor::setup();
+
+    const executor::exec_handle exec_handle1 =
+        do_spawn(handle, child_sleep(30));
+    const executor::exec_handle exec_handle2 =
+        do_spawn(handle, child_exit(15));
+
+    {
+        executor::exit_handle exit_handle = handle.wait_any();
+        ATF_REQUIRE_EQ(exec_handle2.pid(), exit_handle.original_pid());
+        require_exit(15, exit_handle.status());
+        exit_handle.cleanup();
+    }
+
+    handle.terminate(exec_handle1.pid());
+
+    {
+        executor::exit_handle exit_handle = handle.wait_any();
+        ATF_REQUIRE_EQ(exec_handle1.pid(), exit_handle.original_pid());
+        ATF_REQUIRE(exit_handle.status());
+        ATF_REQUIRE(exit_handle.status().get().signaled());
+        ATF_REQUIRE_EQ(SIGKILL, exit_handle.status().get().termsig());
+        const datetime::delta duration =
+            exit_handle.end_time() - exit_handle.start_time();
+        ATF_REQUIRE(duration < datetime::delta(10, 0));
+        exit_handle.cleanup();
+    }
+
+    handle.cleanup();
+}
+
+
 ATF_TEST_CASE(integration__unprivileged_user);
 ATF_TEST_CASE_HEAD(integration__unprivileged_user)
 {
@@ -871,6 +1211,33 @@ ATF_TEST_CASE_BODY(integration__isolate_child_is_called)
 }
 
 
+ATF_TEST_CASE_WITHOUT_HEAD(integration__spawn_plan);
+ATF_TEST_CASE_BODY(integration__spawn_plan)
+{
+    executor::executor_handle handle = executor::setup();
+
+    utils::setenv("HOME", "fake-value");
+    utils::setenv("LANG", "es_ES");
+    const executor::exec_handle exec_handle = handle.spawn_plan(
+        plan_print_environment, infinite_timeout, none);
+
+    executor::exit_handle exit_handle = handle.wait_any();
+    ATF_REQUIRE_EQ(exec_handle.pid(), exit_handle.original_pid());
+    require_exit(EXIT_SUCCESS, exit_handle.status());
+
+    ATF_REQUIRE(atf::utils::compare_file(
+        exit_handle.stdout_file().str(),
+        F("HOME=%s\nLANG=unset\nCONTROL=%s\nPLAN=from the planner\n") %
+        exit_handle.work_directory() % exit_handle.control_directory()));
+    ATF_REQUIRE(atf::utils::compare_file(exit_handle.stderr_file().str(),
+                                         ""));
+    ATF_REQUIRE_EQ("fake-value", utils::getenv("HOME").get());
+
+    exit_handle.cleanup();
+    handle.cleanup();
+}
+
+
 ATF_TEST_CASE_WITHOUT_HEAD(integration__process_group_is_terminated);
 ATF_TEST_CASE_BODY(integration__process_group_is_terminated)
 {
@@ -929,12 +1296,20 @@ ATF_INIT_TEST_CASES(tcs)
 
     ATF_ADD_TEST_CASE(tcs, integration__followup);
 
+    ATF_ADD_TEST_CASE(tcs, integration__in_memory_output);
+    ATF_ADD_TEST_CASE(tcs, integration__output_limit);
     ATF_ADD_TEST_CASE(tcs, integration__output_files_always_exist);
+    ATF_ADD_TEST_CASE(tcs, integration__directory_pool);
+    ATF_ADD_TEST_CASE(tcs, integration__tmpfs);
+    ATF_ADD_TEST_CASE(tcs, integration__tmpfs__unavailable);
+    ATF_ADD_TEST_CASE(tcs, integration__cgroups);
     ATF_ADD_TEST_CASE(tcs, integration__timeouts);
+    ATF_ADD_TEST_CASE(tcs, integration__terminate);
     ATF_ADD_TEST_CASE(tcs, integration__unprivileged_user);
     ATF_ADD_TEST_CASE(tcs, integration__auto_cleanup);
     ATF_ADD_TEST_CASE(tcs, integration__signal_handling);
     ATF_ADD_TEST_CASE(tcs, integration__isolate_child_is_called);
+    ATF_ADD_TEST_CASE(tcs, integration__spawn_plan);
     ATF_ADD_TEST_CASE(tcs, integration__process_group_is_terminated);
     ATF_ADD_TEST_CASE(tcs, integration__prevent_clobbering_control_files);
 }
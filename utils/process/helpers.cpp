@@ -26,6 +26,12 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+extern "C" {
+#include <sys/stat.h>
+
+#include <unistd.h>
+}
+
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
@@ -42,6 +48,30 @@ print_args(int argc, char* argv[])
 }
 
 
+static int
+print_state(int argc, char* argv[])
+{
+    char cwd[1024];
+    if (::getcwd(cwd, sizeof(cwd)) == NULL)
+        std::abort();
+    std::cout << "cwd = " << cwd << "\n";
+
+    const ::mode_t mask = ::umask(0);
+    std::cout << "umask = " << std::oct << mask << std::dec << "\n";
+
+    std::cout << "session = "
+              << (::getsid(::getpid()) == ::getpid() ? "own" : "inherited")
+              << "\n";
+
+    for (int i = 2; i < argc; i++) {
+        const char* value = std::getenv(argv[i]);
+        std::cout << argv[i] << " = " << (value == NULL ? "(unset)" : value)
+                  << "\n";
+    }
+    return EXIT_SUCCESS;
+}
+
+
 static int
 return_code(int argc, char* argv[])
 {
@@ -65,6 +95,8 @@ main(int argc, char* argv[])
 
     if (std::strcmp(argv[1], "print-args") == 0) {
         return print_args(argc, argv);
+    } else if (std::strcmp(argv[1], "print-state") == 0) {
+        return print_state(argc, argv);
     } else if (std::strcmp(argv[1], "return-code") == 0) {
         return return_code(argc, argv);
     } else {
@@ -48,6 +48,7 @@ extern "C" {
 #include "utils/logging/macros.hpp"
 #include "utils/optional.ipp"
 #include "utils/passwd.hpp"
+#include "utils/process/exec_plan.hpp"
 #include "utils/sanity.hpp"
 #include "utils/signals/misc.hpp"
 #include "utils/stacktrace.hpp"
@@ -67,6 +68,12 @@ const int process::exit_isolation_failure = 124;
 namespace {
 
 
+/// Environment variables that isolated subprocesses must not inherit.
+static const char* const to_unset[] = {
+    "LANG", "LC_ALL", "LC_COLLATE", "LC_CTYPE", "LC_MESSAGES", "LC_MONETARY",
+    "LC_NUMERIC", "LC_TIME", NULL };
+
+
 static void fail(const std::string&, const int) UTILS_NORETURN;
 
 
@@ -109,10 +116,7 @@ do_chown(const fs::path& file, const uid_t uid, const gid_t gid)
 static void
 prepare_environment(const fs::path& work_directory)
 {
-    const char* to_unset[] = { "LANG", "LC_ALL", "LC_COLLATE", "LC_CTYPE",
-                               "LC_MESSAGES", "LC_MONETARY", "LC_NUMERIC",
-                               "LC_TIME", NULL };
-    const char** iter;
+    const char* const* iter;
     for (iter = to_unset; *iter != NULL; ++iter) {
         utils::unsetenv(*iter);
     }
@@ -172,6 +176,33 @@ process::isolate_child(const optional< passwd::user >& unprivileged_user,
 }
 
 
+/// Extends an execution plan to isolate the subprocess it describes.
+///
+/// The resulting plan describes a subprocess equivalent to the one that
+/// isolate_child() prepares when run with no unprivileged user, which lets the
+/// caller spawn the subprocess without running any code in it.  Switching to an
+/// unprivileged user is not supported this way.
+///
+/// \param plan The execution plan to extend.
+/// \param work_directory Path to the subprocess-specific work directory.
+///
+/// \return A new execution plan.
+process::exec_plan
+process::isolate_plan(const exec_plan& plan, const fs::path& work_directory)
+{
+    exec_plan isolated = plan;
+    for (const char* const* iter = to_unset; *iter != NULL; ++iter)
+        isolated.unset_env(*iter);
+    isolated.set_env("HOME", work_directory.str());
+    isolated.set_env("TMPDIR", work_directory.str());
+    isolated.set_env("TZ", "UTC");
+    isolated.set_work_directory(work_directory);
+    isolated.set_unlimit_core();
+    isolated.set_umask(0022);
+    return isolated;
+}
+
+
 /// Sets up a path to be writable by a child isolated with isolate_child.
 ///
 /// If there is any error during the setup, the new process is terminated
@@ -38,6 +38,7 @@
 #include "utils/fs/path_fwd.hpp"
 #include "utils/optional_fwd.hpp"
 #include "utils/passwd_fwd.hpp"
+#include "utils/process/exec_plan_fwd.hpp"
 
 namespace utils {
 namespace process {
@@ -49,6 +50,8 @@ extern const int exit_isolation_failure;
 void isolate_child(const utils::optional< utils::passwd::user >&,
                    const utils::fs::path&);
 
+exec_plan isolate_plan(const exec_plan&, const utils::fs::path&);
+
 void isolate_path(const utils::optional< utils::passwd::user >&,
                   const utils::fs::path&);
 
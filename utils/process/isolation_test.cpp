@@ -36,10 +36,13 @@ extern "C" {
 #include <unistd.h>
 }
 
+#include <algorithm>
 #include <cerrno>
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <string>
+#include <vector>
 
 #include <atf-c++.hpp>
 
@@ -51,6 +54,7 @@ extern "C" {
 #include "utils/optional.ipp"
 #include "utils/passwd.hpp"
 #include "utils/process/child.ipp"
+#include "utils/process/exec_plan.hpp"
 #include "utils/process/status.hpp"
 #include "utils/sanity.hpp"
 #include "utils/test_utils.ipp"
@@ -486,6 +490,42 @@ ATF_TEST_CASE_BODY(isolate_child__reset_umask)
 }
 
 
+ATF_TEST_CASE_WITHOUT_HEAD(isolate_plan);
+ATF_TEST_CASE_BODY(isolate_plan)
+{
+    utils::setenv("LANG", "es");
+    utils::setenv("LC_ALL", "es");
+    utils::setenv("KEEP_ME", "kept");
+
+    process::exec_plan plan(fs::path("program"), process::args_vector());
+    plan.set_env("TZ", "Europe/Madrid");
+    const process::exec_plan isolated = process::isolate_plan(
+        plan, fs::path("/the/work/dir"));
+
+    const std::vector< std::string > environment = isolated.environment();
+    ATF_REQUIRE(std::find(environment.begin(), environment.end(),
+                          "HOME=/the/work/dir") != environment.end());
+    ATF_REQUIRE(std::find(environment.begin(), environment.end(),
+                          "TMPDIR=/the/work/dir") != environment.end());
+    ATF_REQUIRE(std::find(environment.begin(), environment.end(),
+                          "TZ=UTC") != environment.end());
+    ATF_REQUIRE(std::find(environment.begin(), environment.end(),
+                          "KEEP_ME=kept") != environment.end());
+    for (std::vector< std::string >::const_iterator iter = environment.begin();
+         iter != environment.end(); ++iter) {
+        ATF_REQUIRE((*iter).find("LANG=") != 0);
+        ATF_REQUIRE((*iter).find("LC_ALL=") != 0);
+    }
+
+    ATF_REQUIRE_EQ(fs::path("/the/work/dir"), isolated.work_directory().get());
+    ATF_REQUIRE_EQ(0022, isolated.umask().get());
+    ATF_REQUIRE(isolated.unlimit_core());
+
+    ATF_REQUIRE(!plan.work_directory());
+    ATF_REQUIRE_EQ("es", utils::getenv("LANG").get());
+}
+
+
 /// Executes isolate_path() and compares the on-disk changes to expected values.
 ///
 /// \param unprivileged_user The user to pass to isolate_path; may be none.
@@ -613,6 +653,8 @@ ATF_INIT_TEST_CASES(tcs)
     ATF_ADD_TEST_CASE(tcs, isolate_child__process_group);
     ATF_ADD_TEST_CASE(tcs, isolate_child__reset_umask);
 
+    ATF_ADD_TEST_CASE(tcs, isolate_plan);
+
     ATF_ADD_TEST_CASE(tcs, isolate_path__no_user);
     ATF_ADD_TEST_CASE(tcs, isolate_path__same_user);
     ATF_ADD_TEST_CASE(tcs, isolate_path__other_user_when_unprivileged);
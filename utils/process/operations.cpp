@@ -30,6 +30,7 @@
 
 extern "C" {
 #include <sys/types.h>
+#include <sys/resource.h>
 #include <sys/wait.h>
 
 #include <signal.h>
@@ -41,19 +42,26 @@ extern "C" {
 #include <cstring>
 #include <iostream>
 
+#include "utils/datetime.hpp"
 #include "utils/format/macros.hpp"
 #include "utils/fs/path.hpp"
 #include "utils/logging/macros.hpp"
+#include "utils/optional.ipp"
 #include "utils/process/exceptions.hpp"
+#include "utils/process/resource_usage.hpp"
 #include "utils/process/system.hpp"
 #include "utils/process/status.hpp"
 #include "utils/sanity.hpp"
 #include "utils/signals/interrupts.hpp"
 
+namespace datetime = utils::datetime;
 namespace fs = utils::fs;
 namespace process = utils::process;
 namespace signals = utils::signals;
 
+using utils::none;
+using utils::optional;
+
 
 /// Maximum number of arguments supported by exec.
 ///
@@ -66,44 +74,110 @@ namespace signals = utils::signals;
 namespace {
 
 
-/// Exception-based, type-improved version of wait(2).
+/// Converts the accounting data returned by wait4(2) to our representation.
+///
+/// \param usage The accounting data of a terminated process.
+///
+/// \return The resource usage record.
+static process::resource_usage
+to_resource_usage(const struct ::rusage& usage)
+{
+#if defined(__APPLE__)
+    // Darwin reports the maximum resident set size in bytes...
+    const uint64_t max_rss = static_cast< uint64_t >(usage.ru_maxrss);
+#else
+    // ... whereas the BSDs and Linux report it in kilobytes.
+    const uint64_t max_rss = static_cast< uint64_t >(usage.ru_maxrss) * 1024;
+#endif
+
+    return process::resource_usage(
+        datetime::delta(usage.ru_utime.tv_sec, usage.ru_utime.tv_usec),
+        datetime::delta(usage.ru_stime.tv_sec, usage.ru_stime.tv_usec),
+        max_rss,
+        static_cast< uint64_t >(usage.ru_inblock),
+        static_cast< uint64_t >(usage.ru_oublock),
+        static_cast< uint64_t >(usage.ru_nvcsw),
+        static_cast< uint64_t >(usage.ru_nivcsw));
+}
+
+
+/// Exception-based, type-improved version of wait4(2) for any child.
 ///
 /// \return The PID of the terminated process and its termination status.
 ///
-/// \throw process::system_error If the call to wait(2) fails.
+/// \throw process::system_error If the call to wait4(2) fails.
 static process::status
 safe_wait(void)
 {
     LD("Waiting for any child process");
     int stat_loc;
-    const pid_t pid = ::wait(&stat_loc);
+    struct ::rusage usage;
+    const pid_t pid = process::detail::syscall_wait4(-1, &stat_loc, 0, &usage);
     if (pid == -1) {
         const int original_errno = errno;
         throw process::system_error("Failed to wait for any child process",
                                     original_errno);
     }
-    return process::status(pid, stat_loc);
+    return process::status(pid, stat_loc, to_resource_usage(usage));
 }
 
 
-/// Exception-based, type-improved version of waitpid(2).
+/// Exception-based, type-improved version of wait4(2) for a specific child.
 ///
 /// \param pid The identifier of the process to wait for.
 ///
 /// \return The termination status of the process.
 ///
-/// \throw process::system_error If the call to waitpid(2) fails.
+/// \throw process::system_error If the call to wait4(2) fails.
 static process::status
 safe_waitpid(const pid_t pid)
 {
     LD(F("Waiting for pid=%s") % pid);
     int stat_loc;
-    if (process::detail::syscall_waitpid(pid, &stat_loc, 0) == -1) {
+    struct ::rusage usage;
+    if (process::detail::syscall_wait4(pid, &stat_loc, 0, &usage) == -1) {
         const int original_errno = errno;
         throw process::system_error(F("Failed to wait for PID %s") % pid,
                                     original_errno);
     }
-    return process::status(pid, stat_loc);
+    return process::status(pid, stat_loc, to_resource_usage(usage));
+}
+
+
+/// Exception-based, non-blocking version of wait4(2).
+///
+/// \param pid The identifier of the process to wait for, or -1 to wait for any
+///     child process.
+///
+/// \return The termination status of the process, or none if no matching child
+/// process has terminated yet.
+///
+/// \throw process::system_error If the call to wait4(2) fails.
+static optional< process::status >
+safe_try_wait(const pid_t pid)
+{
+    int stat_loc;
+    struct ::rusage usage;
+    const pid_t dead_pid = process::detail::syscall_wait4(
+        pid, &stat_loc, WNOHANG, &usage);
+    if (dead_pid == -1) {
+        const int original_errno = errno;
+        if (pid == -1)
+            throw process::system_error(
+                "Failed to wait for any child process", original_errno);
+        else
+            throw process::system_error(F("Failed to wait for PID %s") % pid,
+                                        original_errno);
+    } else if (dead_pid == 0) {
+        return none;
+    }
+
+    {
+        signals::interrupts_inhibiter inhibiter;
+        signals::remove_pid_to_kill(dead_pid);
+    }
+    return utils::make_optional(process::status(
+        dead_pid, stat_loc, to_resource_usage(usage)));
 }
 
 
@@ -271,3 +345,31 @@ process::wait_any(void)
     }
     return status;
 }
+
+
+/// Checks for the completion of a subprocess without blocking.
+///
+/// \param pid Identifier of the process to check.
+///
+/// \return The termination status of the child process if it has terminated,
+/// or none if it is still running.
+///
+/// \throw process::system_error If the call to wait(2) fails.
+optional< process::status >
+process::try_wait(const int pid)
+{
+    return safe_try_wait(pid);
+}
+
+
+/// Checks for the completion of any subprocess without blocking.
+///
+/// \return The termination status of a child process that terminated, or none
+/// if all of them are still running.
+///
+/// \throw process::system_error If the call to wait(2) fails.
+optional< process::status >
+process::try_wait_any(void)
+{
+    return safe_try_wait(-1);
+}
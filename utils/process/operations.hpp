@@ -36,6 +36,7 @@
 
 #include "utils/defs.hpp"
 #include "utils/fs/path_fwd.hpp"
+#include "utils/optional_fwd.hpp"
 #include "utils/process/status_fwd.hpp"
 
 namespace utils {
@@ -48,6 +49,8 @@ void terminate_group(const int);
 void terminate_self_with(const status&) UTILS_NORETURN;
 status wait(const int);
 status wait_any(void);
+optional< status > try_wait(const int);
+optional< status > try_wait_any(void);
 
 
 }  // namespace process
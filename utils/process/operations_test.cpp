@@ -37,22 +37,30 @@ extern "C" {
 }
 
 #include <cerrno>
+#include <cstdlib>
 #include <iostream>
+#include <vector>
 
 #include <atf-c++.hpp>
 
+#include "utils/datetime.hpp"
 #include "utils/defs.hpp"
 #include "utils/format/containers.ipp"
 #include "utils/fs/path.hpp"
+#include "utils/optional.ipp"
 #include "utils/process/child.ipp"
 #include "utils/process/exceptions.hpp"
+#include "utils/process/resource_usage.hpp"
 #include "utils/process/status.hpp"
 #include "utils/stacktrace.hpp"
 #include "utils/test_utils.ipp"
 
+namespace datetime = utils::datetime;
 namespace fs = utils::fs;
 namespace process = utils::process;
 
+using utils::optional;
+
 
 namespace {
 
@@ -117,6 +125,27 @@ child_exit(void)
 }
 
 
+/// Size of the memory block touched by child_use_resources().
+static const std::size_t child_memory_size = 16 * 1024 * 1024;
+
+
+/// Body for a process that consumes some memory and CPU time.
+static void
+child_use_resources(void)
+{
+    std::vector< char > memory(child_memory_size);
+    for (std::size_t i = 0; i < memory.size(); i += 512)
+        memory[i] = static_cast< char >(i);
+
+    const datetime::timestamp deadline = datetime::timestamp::now() +
+        datetime::delta(0, 100000);
+    while (datetime::timestamp::now() < deadline) {
+        // Busy loop to accumulate CPU time.
+    }
+    std::exit(memory[512] == 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+
 static void suspend(void) UTILS_NORETURN;
 
 
@@ -392,6 +421,24 @@ ATF_TEST_CASE_BODY(wait__ok)
 }
 
 
+ATF_TEST_CASE_WITHOUT_HEAD(wait__usage);
+ATF_TEST_CASE_BODY(wait__usage)
+{
+    std::unique_ptr< process::child > child = process::child::fork_capture(
+        child_use_resources);
+    const pid_t pid = child->pid();
+    child.reset();  // Ensure there is no conflict between destructor and wait.
+
+    const process::status status = process::wait(pid);
+    ATF_REQUIRE(status.exited());
+    ATF_REQUIRE_EQ(EXIT_SUCCESS, status.exitstatus());
+    ATF_REQUIRE(status.usage());
+    const process::resource_usage& usage = status.usage().get();
+    ATF_REQUIRE(usage.user_time + usage.system_time > datetime::delta());
+    ATF_REQUIRE(usage.max_rss >= child_memory_size);
+}
+
+
 ATF_TEST_CASE_WITHOUT_HEAD(wait__fail);
 ATF_TEST_CASE_BODY(wait__fail)
 {
@@ -410,6 +457,21 @@ ATF_TEST_CASE_BODY(wait_any__one)
 }
 
 
+ATF_TEST_CASE_WITHOUT_HEAD(wait_any__usage);
+ATF_TEST_CASE_BODY(wait_any__usage)
+{
+    process::child::fork_capture(child_use_resources);
+
+    const process::status status = process::wait_any();
+    ATF_REQUIRE(status.exited());
+    ATF_REQUIRE_EQ(EXIT_SUCCESS, status.exitstatus());
+    ATF_REQUIRE(status.usage());
+    const process::resource_usage& usage = status.usage().get();
+    ATF_REQUIRE(usage.user_time + usage.system_time > datetime::delta());
+    ATF_REQUIRE(usage.max_rss >= child_memory_size);
+}
+
+
 ATF_TEST_CASE_WITHOUT_HEAD(wait_any__many);
 ATF_TEST_CASE_BODY(wait_any__many)
 {
@@ -445,6 +507,79 @@ ATF_TEST_CASE_BODY(wait_any__none_is_failure)
 }
 
 
+ATF_TEST_CASE_WITHOUT_HEAD(try_wait__running);
+ATF_TEST_CASE_BODY(try_wait__running)
+{
+    std::unique_ptr< process::child > child = process::child::fork_capture(
+        suspend);
+    const pid_t pid = child->pid();
+    child.reset();  // Ensure there is no conflict between destructor and wait.
+
+    ATF_REQUIRE(!process::try_wait(pid));
+    ATF_REQUIRE(::kill(pid, SIGKILL) != -1);
+    const process::status status = process::wait(pid);
+    ATF_REQUIRE(status.signaled());
+    ATF_REQUIRE_EQ(SIGKILL, status.termsig());
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(try_wait__ok);
+ATF_TEST_CASE_BODY(try_wait__ok)
+{
+    std::unique_ptr< process::child > child = process::child::fork_capture(
+        child_exit< 15 >);
+    const pid_t pid = child->pid();
+    child.reset();  // Ensure there is no conflict between destructor and wait.
+
+    optional< process::status > status;
+    while (!(status = process::try_wait(pid)))
+        ::usleep(1000);
+    ATF_REQUIRE_EQ(pid, status.get().dead_pid());
+    ATF_REQUIRE(status.get().exited());
+    ATF_REQUIRE_EQ(15, status.get().exitstatus());
+    ATF_REQUIRE(status.get().usage());
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(try_wait__fail);
+ATF_TEST_CASE_BODY(try_wait__fail)
+{
+    ATF_REQUIRE_THROW(process::system_error, process::try_wait(1));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(try_wait_any__some);
+ATF_TEST_CASE_BODY(try_wait_any__some)
+{
+    std::unique_ptr< process::child > child = process::child::fork_capture(
+        suspend);
+    const pid_t pid = child->pid();
+    child.reset();  // Ensure there is no conflict between destructor and wait.
+
+    ATF_REQUIRE(!process::try_wait_any());
+    ATF_REQUIRE(::kill(pid, SIGKILL) != -1);
+
+    optional< process::status > status;
+    while (!(status = process::try_wait_any()))
+        ::usleep(1000);
+    ATF_REQUIRE_EQ(pid, status.get().dead_pid());
+    ATF_REQUIRE(status.get().signaled());
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(try_wait_any__none_is_failure);
+ATF_TEST_CASE_BODY(try_wait_any__none_is_failure)
+{
+    try {
+        process::try_wait_any();
+        fail("Expected exception but none raised");
+    } catch (const process::system_error& e) {
+        ATF_REQUIRE(atf::utils::grep_string("Failed to wait", e.what()));
+        ATF_REQUIRE_EQ(ECHILD, e.original_errno());
+    }
+}
+
+
 ATF_INIT_TEST_CASES(tcs)
 {
     ATF_ADD_TEST_CASE(tcs, exec__no_args);
@@ -463,9 +598,18 @@ ATF_INIT_TEST_CASES(tcs)
     ATF_ADD_TEST_CASE(tcs, terminate_self_with__termsig_and_core);
 
     ATF_ADD_TEST_CASE(tcs, wait__ok);
+    ATF_ADD_TEST_CASE(tcs, wait__usage);
     ATF_ADD_TEST_CASE(tcs, wait__fail);
 
     ATF_ADD_TEST_CASE(tcs, wait_any__one);
+    ATF_ADD_TEST_CASE(tcs, wait_any__usage);
     ATF_ADD_TEST_CASE(tcs, wait_any__many);
     ATF_ADD_TEST_CASE(tcs, wait_any__none_is_failure);
+
+    ATF_ADD_TEST_CASE(tcs, try_wait__running);
+    ATF_ADD_TEST_CASE(tcs, try_wait__ok);
+    ATF_ADD_TEST_CASE(tcs, try_wait__fail);
+
+    ATF_ADD_TEST_CASE(tcs, try_wait_any__some);
+    ATF_ADD_TEST_CASE(tcs, try_wait_any__none_is_failure);
 }
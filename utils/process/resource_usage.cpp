@@ -0,0 +1,121 @@
+// Copyright 2026 The Kyua Authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// * Neither the name of Google Inc. nor the names of its contributors
+//   may be used to endorse or promote products derived from this software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "utils/process/resource_usage.hpp"
+
+#include "utils/format/macros.hpp"
+
+namespace datetime = utils::datetime;
+namespace process = utils::process;
+
+
+/// Constructs an empty resource usage record.
+process::resource_usage::resource_usage(void) :
+    max_rss(0),
+    block_input(0),
+    block_output(0),
+    voluntary_ctxsw(0),
+    involuntary_ctxsw(0)
+{
+}
+
+
+/// Constructs a resource usage record.
+///
+/// \param user_time_ Time spent executing in user mode.
+/// \param system_time_ Time spent executing in kernel mode.
+/// \param max_rss_ Maximum resident set size, in bytes.
+/// \param block_input_ Number of block input operations.
+/// \param block_output_ Number of block output operations.
+/// \param voluntary_ctxsw_ Number of voluntary context switches.
+/// \param involuntary_ctxsw_ Number of involuntary context switches.
+process::resource_usage::resource_usage(const datetime::delta& user_time_,
+                                        const datetime::delta& system_time_,
+                                        const uint64_t max_rss_,
+                                        const uint64_t block_input_,
+                                        const uint64_t block_output_,
+                                        const uint64_t voluntary_ctxsw_,
+                                        const uint64_t involuntary_ctxsw_) :
+    user_time(user_time_),
+    system_time(system_time_),
+    max_rss(max_rss_),
+    block_input(block_input_),
+    block_output(block_output_),
+    voluntary_ctxsw(voluntary_ctxsw_),
+    involuntary_ctxsw(involuntary_ctxsw_)
+{
+}
+
+
+/// Checks if two resource usage records are equal.
+///
+/// \param other The object to compare to.
+///
+/// \return True if the two records are equal; false otherwise.
+bool
+process::resource_usage::operator==(const resource_usage& other) const
+{
+    return (user_time == other.user_time &&
+            system_time == other.system_time &&
+            max_rss == other.max_rss &&
+            block_input == other.block_input &&
+            block_output == other.block_output &&
+            voluntary_ctxsw == other.voluntary_ctxsw &&
+            involuntary_ctxsw == other.involuntary_ctxsw);
+}
+
+
+/// Checks if two resource usage records are different.
+///
+/// \param other The object to compare to.
+///
+/// \return True if the two records are different; false otherwise.
+bool
+process::resource_usage::operator!=(const resource_usage& other) const
+{
+    return !(*this == other);
+}
+
+
+/// Injects the object into a stream.
+///
+/// \param output The stream into which to inject the object.
+/// \param object The object to format.
+///
+/// \return The output stream.
+std::ostream&
+process::operator<<(std::ostream& output, const resource_usage& object)
+{
+    output << F("resource_usage{user_time=%s, system_time=%s, max_rss=%s, "
+                "block_input=%s, block_output=%s, voluntary_ctxsw=%s, "
+                "involuntary_ctxsw=%s}")
+        % object.user_time % object.system_time % object.max_rss
+        % object.block_input % object.block_output
+        % object.voluntary_ctxsw % object.involuntary_ctxsw;
+    return output;
+}
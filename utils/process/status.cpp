@@ -62,6 +62,25 @@ process::status::status(const int dead_pid_, int stat_loc) :
 }
 
 
+/// Constructs a new status object based on the results of wait4(2).
+///
+/// \param dead_pid_ The PID of the process this status belonged to.
+/// \param stat_loc The status value returned by wait4(2).
+/// \param usage_ The resources consumed by the process.
+process::status::status(const int dead_pid_, int stat_loc,
+                        const resource_usage& usage_) :
+    _dead_pid(dead_pid_),
+    _exited(WIFEXITED(stat_loc) ?
+            optional< int >(WEXITSTATUS(stat_loc)) : none),
+    _signaled(WIFSIGNALED(stat_loc) ?
+              optional< std::pair< int, bool > >(
+                  std::make_pair(WTERMSIG(stat_loc), WCOREDUMP(stat_loc))) :
+                  none),
+    _usage(usage_)
+{
+}
+
+
 /// Constructs a new status object based on fake values.
 ///
 /// \param exited_ If not none, specifies the exit status of the program.
@@ -180,6 +199,17 @@ process::status::coredump(void) const
 }
 
 
+/// Returns the resources consumed by the process.
+///
+/// \return The resource usage of the process, or none if it is not known
+/// (e.g. if this status object was faked).
+const optional< process::resource_usage >&
+process::status::usage(void) const
+{
+    return _usage;
+}
+
+
 /// Injects the object into a stream.
 ///
 /// \param output The stream into which to inject the object.
@@ -38,6 +38,7 @@
 #include <utility>
 
 #include "utils/optional.ipp"
+#include "utils/process/resource_usage.hpp"
 
 namespace utils {
 namespace process {
@@ -57,10 +58,14 @@ class status {
     /// The signal that terminated the program, if any, and if it dumped core.
     optional< std::pair< int, bool > > _signaled;
 
+    /// The resources consumed by the process, if known.
+    optional< resource_usage > _usage;
+
     status(const optional< int >&, const optional< std::pair< int, bool > >&);
 
 public:
     status(const int, int);
+    status(const int, int, const resource_usage&);
     static status fake_exited(const int);
     static status fake_signaled(const int, const bool);
 
@@ -72,6 +77,8 @@ public:
     bool signaled(void) const;
     int termsig(void) const;
     bool coredump(void) const;
+
+    const optional< resource_usage >& usage(void) const;
 };
 
 
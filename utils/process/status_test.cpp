@@ -39,8 +39,13 @@ extern "C" {
 
 #include <atf-c++.hpp>
 
+#include "utils/datetime.hpp"
+#include "utils/process/resource_usage.hpp"
 #include "utils/test_utils.ipp"
 
+namespace datetime = utils::datetime;
+
+using utils::process::resource_usage;
 using utils::process::status;
 
 
@@ -116,6 +121,29 @@ ATF_TEST_CASE_BODY(fake_signaled)
 }
 
 
+ATF_TEST_CASE_WITHOUT_HEAD(usage__none);
+ATF_TEST_CASE_BODY(usage__none)
+{
+    ATF_REQUIRE(!status::fake_exited(0).usage());
+    ATF_REQUIRE(!status::fake_signaled(9, false).usage());
+    ATF_REQUIRE(!status(123, 0).usage());
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(usage__some);
+ATF_TEST_CASE_BODY(usage__some)
+{
+    const resource_usage usage(datetime::delta(1, 2), datetime::delta(3, 4),
+                               5, 6, 7, 8, 9);
+    const status s(123, 0, usage);
+    ATF_REQUIRE_EQ(123, s.dead_pid());
+    ATF_REQUIRE(s.exited());
+    ATF_REQUIRE_EQ(0, s.exitstatus());
+    ATF_REQUIRE(s.usage());
+    ATF_REQUIRE_EQ(usage, s.usage().get());
+}
+
+
 ATF_TEST_CASE_WITHOUT_HEAD(output__exitstatus);
 ATF_TEST_CASE_BODY(output__exitstatus)
 {
@@ -199,6 +227,9 @@ ATF_INIT_TEST_CASES(tcs)
     ATF_ADD_TEST_CASE(tcs, fake_exited);
     ATF_ADD_TEST_CASE(tcs, fake_signaled);
 
+    ATF_ADD_TEST_CASE(tcs, usage__none);
+    ATF_ADD_TEST_CASE(tcs, usage__some);
+
     ATF_ADD_TEST_CASE(tcs, output__exitstatus);
     ATF_ADD_TEST_CASE(tcs, output__signaled_without_core);
     ATF_ADD_TEST_CASE(tcs, output__signaled_with_core);
@@ -30,6 +30,7 @@
 
 extern "C" {
 #include <sys/types.h>
+#include <sys/resource.h>
 #include <sys/wait.h>
 
 #include <fcntl.h>
@@ -55,5 +56,6 @@ int (*detail::syscall_open)(const char*, const int, ...) = ::open;
 int (*detail::syscall_pipe)(int[2]) = ::pipe;
 
 
-/// Indirection to execute the waitpid(2) system call.
-pid_t (*detail::syscall_waitpid)(const pid_t, int*, const int) = ::waitpid;
+/// Indirection to execute the wait4(2) system call.
+pid_t (*detail::syscall_wait4)(const pid_t, int*, const int, struct rusage*) =
+    ::wait4;
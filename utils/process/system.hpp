@@ -44,6 +44,8 @@
 #define UTILS_PROCESS_SYSTEM_HPP
 
 extern "C" {
+#include <sys/resource.h>
+
 #include <unistd.h>
 }
 
@@ -56,7 +58,7 @@ extern int (*syscall_dup2)(const int, const int);
 extern pid_t (*syscall_fork)(void);
 extern int (*syscall_open)(const char*, const int, ...);
 extern int (*syscall_pipe)(int[2]);
-extern pid_t (*syscall_waitpid)(const pid_t, int*, const int);
+extern pid_t (*syscall_wait4)(const pid_t, int*, const int, struct rusage*);
 
 
 }  // namespace detail
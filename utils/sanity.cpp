@@ -87,6 +87,11 @@ crash_handler(const int signo)
 {
     PRE(!logfile.empty());
 
+    // Writing out the buffered log entries is not async-signal safe, but we
+    // are about to die anyway and the log is the most useful thing we can
+    // leave behind to diagnose the crash.
+    utils::logging::flush();
+
     err_write(F("*** Fatal signal %s received\n") % signo);
     err_write(F("*** Log file is %s\n") % logfile);
     err_write(F("*** Please report this problem to %s detailing what you were "
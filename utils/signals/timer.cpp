@@ -34,9 +34,11 @@ extern "C" {
 #include <signal.h>
 }
 
+#include <algorithm>
 #include <cerrno>
-#include <map>
-#include <set>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
 #include <vector>
 
 #include "utils/datetime.hpp"
@@ -86,146 +88,386 @@ safe_setitimer(const datetime::delta& delta, itimerval* old_timeval)
 }
 
 
-/// Deadline scheduler for all user timers on top of the unique system timer.
-class global_state : utils::noncopyable {
-    /// Collection of active timers.
+/// Computes the delay until a timestamp, rounded up to a non-zero value.
+///
+/// setitimer(2) interprets a zero delay as a request to disarm the timer, so
+/// activations in the past need to be turned into the smallest delay possible.
+///
+/// \param when The desired activation time.
+/// \param now The current time.
+///
+/// \return The delay until the activation time.
+static datetime::delta
+delay_until(const datetime::timestamp& when, const datetime::timestamp& now)
+{
+    if (when > now)
+        return when - now;
+    else
+        return datetime::delta(0, 1);
+}
+
+
+/// Compares two timers by their activation time.
+///
+/// \param a The first timer.
+/// \param b The second timer.
+///
+/// \return True if a fires before b.
+static bool
+compare_by_activation(const signals::timer* a, const signals::timer* b)
+{
+    return a->when() < b->when();
+}
+
+
+/// Hierarchical timing wheel to track the deadlines of all active timers.
+///
+/// Time is divided in ticks of tick_useconds.  The first level of the wheel
+/// has one slot per tick for the next root_size ticks; every subsequent level
+/// has level_size slots, each covering a full turn of the level below.  Timers
+/// far in the future sit in the outer levels and are cascaded into the inner
+/// levels as time advances.  Adding and removing timers is thus O(1),
+/// regardless of the number of active timers.
+///
+/// Note that the wheel does not fire timers on its own: the caller is
+/// responsible for calling expire() at, or after, the time returned by
+/// next_activation().
+class timer_wheel : utils::noncopyable {
+    /// Duration of a tick, in microseconds.
+    static const int64_t tick_useconds = 1000;
+
+    /// Number of bits of the tick index covered by the first level.
+    static const int root_bits = 8;
+
+    /// Number of slots in the first level.
+    static const int64_t root_size = 1 << root_bits;
+
+    /// Number of bits of the tick index covered by each outer level.
+    static const int level_bits = 6;
+
+    /// Number of slots in each outer level.
+    static const int64_t level_size = 1 << level_bits;
+
+    /// Number of outer levels.
     ///
-    /// Because this is a collection of pointers, all timers are guaranteed to
-    /// be unique, and we want all of these pointers to be valid.
-    typedef std::set< signals::timer* > timers_set;
+    /// With 1ms ticks, this covers about 49 days of deadlines.  Timers further
+    /// in the future are parked in the last slot and re-evaluated when that
+    /// slot is cascaded.
+    static const int n_levels = 4;
 
-    /// Sequence of ordered timers.
-    typedef std::vector< signals::timer* > timers_vector;
+    /// Collection of timers in a slot.
+    typedef std::list< signals::timer* > timers_list;
+
+    /// Location of a timer within the wheel.
+    struct position {
+        /// The slot holding the timer.
+        timers_list* slot;
+
+        /// The entry of the timer in the slot.
+        timers_list::iterator iter;
+    };
+
+    /// Slots of the first level, indexed by tick.
+    timers_list _root[root_size];
+
+    /// Slots of the outer levels.
+    timers_list _levels[n_levels][level_size];
+
+    /// Location of every timer in the wheel.
+    std::unordered_map< signals::timer*, position > _positions;
+
+    /// Number of timers in the first level.
+    std::size_t _root_count;
 
-    /// Collection of active timestamps by their activation timestamp.
+    /// The current tick of the wheel.
     ///
-    /// This collection is ordered intentionally so that it can be scanned
-    /// sequentially to find either expired or expiring-now timers.
-    typedef std::map< datetime::timestamp, timers_set > timers_by_timestamp_map;
+    /// All slots for ticks before this one have already been processed.
+    int64_t _base;
 
-    /// The original timer before any timer was programmed.
-    ::itimerval _old_timeval;
+    /// Converts a timestamp to a tick.
+    ///
+    /// \param timestamp The timestamp to convert.
+    ///
+    /// \return The tick containing the timestamp.
+    static int64_t
+    to_tick(const datetime::timestamp& timestamp)
+    {
+        return timestamp.to_microseconds() / tick_useconds;
+    }
 
-    /// Programmer for the SIGALRM handler.
-    std::unique_ptr< signals::programmer > _sigalrm_programmer;
+    /// Checks if a slot belongs to the first level.
+    ///
+    /// \param slot The slot to check.
+    ///
+    /// \return True if the slot is in the first level.
+    bool
+    is_root(const timers_list* slot) const
+    {
+        return slot >= &_root[0] && slot < &_root[root_size];
+    }
 
-    /// Time of the current activation of the timer.
-    datetime::timestamp _timer_activation;
+    /// Computes the slot in which a timer has to be stored.
+    ///
+    /// \param when The activation time of the timer.
+    ///
+    /// \return The slot for the timer.
+    timers_list&
+    slot_for(const datetime::timestamp& when)
+    {
+        const int64_t expires = std::max(to_tick(when), _base);
+        const int64_t delta = expires - _base;
+        if (delta < root_size)
+            return _root[expires & (root_size - 1)];
+
+        for (int level = 0; level < n_levels; level++) {
+            const int shift = root_bits + level * level_bits;
+            const int64_t limit = int64_t(1) << (shift + level_bits);
+            if (delta < limit)
+                return _levels[level][(expires >> shift) & (level_size - 1)];
+        }
 
-    /// Mapping of all active timers using their timestamp as the key.
-    timers_by_timestamp_map _all_timers;
+        const int shift = root_bits + (n_levels - 1) * level_bits;
+        const int64_t limit = int64_t(1) << (shift + level_bits);
+        const int64_t clamped = _base + limit - 1;
+        return _levels[n_levels - 1][(clamped >> shift) & (level_size - 1)];
+    }
 
-    /// Adds a timer to the _all_timers map.
+    /// Moves a timer from one slot to the slot it belongs to now.
     ///
-    /// \param timer The timer to add.
+    /// \param from The slot currently holding the timer.
+    /// \param iter The entry of the timer in from.
     void
-    add_to_all_timers(signals::timer* timer)
+    place(timers_list& from, const timers_list::iterator iter)
     {
-        timers_set& timers = _all_timers[timer->when()];
-        INV(timers.find(timer) == timers.end());
-        timers.insert(timer);
+        signals::timer* timer = *iter;
+        timers_list& to = slot_for(timer->when());
+        to.splice(to.end(), from, iter);
+        if (is_root(&from))
+            _root_count--;
+        if (is_root(&to))
+            _root_count++;
+
+        position& location = _positions[timer];
+        location.slot = &to;
+        location.iter = iter;
     }
 
-    /// Removes a timer from the _all_timers map.
+    /// Redistributes the timers of the outer levels that are now due soon.
     ///
-    /// This ensures that empty vectors are removed from _all_timers if the
-    /// removal of the timer causes its bucket to be emptied.
+    /// This must be called every time the current tick crosses a boundary of
+    /// the first level.
+    void
+    cascade(void)
+    {
+        for (int level = 0; level < n_levels; level++) {
+            const int shift = root_bits + level * level_bits;
+            const int64_t index = (_base >> shift) & (level_size - 1);
+            timers_list& slot = _levels[level][index];
+            while (!slot.empty())
+                place(slot, slot.begin());
+            if (index != 0)
+                break;
+        }
+    }
+
+    /// Takes the expired timers out of the slot for the current tick.
     ///
-    /// \param timer The timer to remove.
+    /// \param now The current time.
+    /// \param [in,out] expired Collection into which to append the timers that
+    ///     have expired, in activation order.
     void
-    remove_from_all_timers(signals::timer* timer)
+    collect(const datetime::timestamp& now, std::vector< signals::timer* >&
+            expired)
     {
-        // We may not find the timer in _all_timers if the timer has fired,
-        // because fire() took it out from the map.
-        timers_by_timestamp_map::iterator iter = _all_timers.find(
-            timer->when());
-        if (iter != _all_timers.end()) {
-            timers_set& timers = (*iter).second;
-            INV(timers.find(timer) != timers.end());
-            timers.erase(timer);
-            if (timers.empty()) {
-                _all_timers.erase(iter);
-            }
+        timers_list& slot = _root[_base & (root_size - 1)];
+        const std::size_t first = expired.size();
+        timers_list::iterator iter = slot.begin();
+        while (iter != slot.end()) {
+            signals::timer* timer = *iter;
+            if (timer->when() <= now) {
+                expired.push_back(timer);
+                _positions.erase(timer);
+                iter = slot.erase(iter);
+                _root_count--;
+            } else
+                ++iter;
         }
+        std::sort(expired.begin() + first, expired.end(),
+                  compare_by_activation);
     }
 
-    /// Calculates all timers to execute at this timestamp.
+public:
+    /// Constructs an empty wheel.
     ///
-    /// \param now The current timestamp.
+    /// \param now The current time.
+    explicit timer_wheel(const datetime::timestamp& now) :
+        _root_count(0),
+        _base(to_tick(now))
+    {
+    }
+
+    /// Checks whether there are any timers in the wheel.
     ///
-    /// \post _all_timers is updated to contain only the timers that are
-    /// strictly in the future.
+    /// \return True if the wheel has no timers.
+    bool
+    empty(void) const
+    {
+        return _positions.empty();
+    }
+
+    /// Adds a timer to the wheel.
     ///
-    /// \return A sequence of valid timers that need to be invoked in the order
-    /// of activation.  These are all previously registered timers with
-    /// activations in the past.
-    timers_vector
-    compute_timers_to_run_and_prune_old(
-        const datetime::timestamp& now,
-        const signals::interrupts_inhibiter& /* inhibiter */)
+    /// \param timer The timer to add.
+    void
+    add(signals::timer* timer)
     {
-        timers_vector to_run;
+        PRE(_positions.find(timer) == _positions.end());
 
-        timers_by_timestamp_map::iterator iter = _all_timers.begin();
-        while (iter != _all_timers.end() && (*iter).first <= now) {
-            const timers_set& timers = (*iter).second;
-            to_run.insert(to_run.end(), timers.begin(), timers.end());
-
-            // Remove expired entries here so that we can always assume that
-            // the first entry in all_timers corresponds to the next
-            // activation.
-            const timers_by_timestamp_map::iterator previous_iter = iter;
-            ++iter;
-            _all_timers.erase(previous_iter);
-        }
+        timers_list& slot = slot_for(timer->when());
+        slot.push_back(timer);
+        if (is_root(&slot))
+            _root_count++;
 
-        return to_run;
+        position location;
+        location.slot = &slot;
+        location.iter = --slot.end();
+        _positions[timer] = location;
     }
 
-    /// Adjusts the global system timer to point to the next activation.
+    /// Removes a timer from the wheel.
     ///
-    /// \param now The current timestamp.
-    ///
-    /// \throw system_error If the programming fails.
+    /// \param timer The timer to remove.  This may not be in the wheel if it
+    ///     has already expired.
     void
-    reprogram_system_timer(
-        const datetime::timestamp& now,
-        const signals::interrupts_inhibiter& /* inhibiter */)
+    remove(signals::timer* timer)
     {
-        if (_all_timers.empty()) {
-            // Nothing to do.  We can reach this case if all the existing timers
-            // are in the past and they all fired.  Just ignore the request and
-            // leave the global timer as is.
+        const std::unordered_map< signals::timer*, position >::iterator iter =
+            _positions.find(timer);
+        if (iter == _positions.end())
             return;
+
+        const position& location = (*iter).second;
+        if (is_root(location.slot))
+            _root_count--;
+        location.slot->erase(location.iter);
+        _positions.erase(iter);
+    }
+
+    /// Advances the wheel and takes out all timers that have expired.
+    ///
+    /// \param now The current time.
+    ///
+    /// \return The timers that expired on or before now, in activation order.
+    std::vector< signals::timer* >
+    expire(const datetime::timestamp& now)
+    {
+        std::vector< signals::timer* > expired;
+
+        const int64_t target = std::max(to_tick(now), _base);
+        for (;;) {
+            collect(now, expired);
+            if (_base == target)
+                break;
+
+            if (_positions.empty()) {
+                _base = target;
+            } else if (_root_count == 0) {
+                // Nothing to look at in the first level: jump straight to the
+                // next cascade instead of walking every tick.
+                const int64_t boundary = (_base | (root_size - 1)) + 1;
+                _base = std::min(boundary, target);
+            } else {
+                _base++;
+            }
+            if ((_base & (root_size - 1)) == 0)
+                cascade();
         }
 
-        // While fire() prunes old entries from the list of timers, it is
-        // possible for this routine to run with "expired" timers (i.e. timers
-        // whose deadline lies in the past but that have not yet fired for
-        // whatever reason that is out of our control) in the list.  We have to
-        // iterate until we find the next activation instead of assuming that
-        // the first entry represents the desired value.
-        timers_by_timestamp_map::const_iterator iter = _all_timers.begin();
-        PRE(!(*iter).second.empty());
-        datetime::timestamp next = (*iter).first;
-        while (next < now) {
-            ++iter;
-            if (iter == _all_timers.end()) {
-                // Nothing to do.  We can reach this case if all the existing
-                // timers are in the past but they have not yet fired.
-                return;
+        return expired;
+    }
+
+    /// Computes when expire() has to be called next.
+    ///
+    /// This is either the activation of the earliest timer in the first level
+    /// or the time of the next cascade that involves any timer, whichever comes
+    /// first.
+    ///
+    /// \return The next activation time, or none if the wheel is empty.
+    optional< datetime::timestamp >
+    next_activation(void) const
+    {
+        if (empty())
+            return none;
+
+        optional< datetime::timestamp > next;
+
+        for (int64_t i = 0; i < root_size; i++) {
+            const timers_list& slot = _root[(_base + i) & (root_size - 1)];
+            if (slot.empty())
+                continue;
+            for (timers_list::const_iterator iter = slot.begin();
+                 iter != slot.end(); ++iter) {
+                if (!next || (*iter)->when() < next.get())
+                    next = (*iter)->when();
             }
-            PRE(!(*iter).second.empty());
-            next = (*iter).first;
+            break;
         }
 
-        if (next < _timer_activation || now > _timer_activation) {
-            INV(next >= now);
-            const datetime::delta delta = next - now;
-            LD(F("Reprogramming timer; firing on %s; now is %s") % next % now);
-            safe_setitimer(delta, NULL);
-            _timer_activation = next;
+        for (int level = 0; level < n_levels; level++) {
+            const int shift = root_bits + level * level_bits;
+            const int64_t current = _base >> shift;
+            for (int64_t i = 1; i <= level_size; i++) {
+                if (_levels[level][(current + i) & (level_size - 1)].empty())
+                    continue;
+                const datetime::timestamp cascade_time =
+                    datetime::timestamp::from_microseconds(
+                        ((current + i) << shift) * tick_useconds);
+                if (!next || cascade_time < next.get())
+                    next = cascade_time;
+                break;
+            }
         }
+
+        return next;
+    }
+};
+
+
+/// Deadline scheduler for all user timers on top of the unique system timer.
+///
+/// The system timer is only reprogrammed when a new timer expires earlier than
+/// the current activation.  Removing a timer leaves the system timer untouched:
+/// if it fires for a timer that is already gone, the handler finds nothing to
+/// run and simply moves on to the next activation.
+class global_state : utils::noncopyable {
+    /// Sequence of ordered timers.
+    typedef std::vector< signals::timer* > timers_vector;
+
+    /// The original timer before any timer was programmed.
+    ::itimerval _old_timeval;
+
+    /// Programmer for the SIGALRM handler.
+    std::unique_ptr< signals::programmer > _sigalrm_programmer;
+
+    /// Time of the current activation of the system timer, if armed.
+    optional< datetime::timestamp > _timer_activation;
+
+    /// Deadlines of all active timers.
+    timer_wheel _wheel;
+
+    /// Programs the system timer.
+    ///
+    /// \param next The time at which the timer should fire.
+    /// \param now The current timestamp.
+    ///
+    /// \throw system_error If the programming fails.
+    void
+    arm(const datetime::timestamp& next, const datetime::timestamp& now,
+        const signals::interrupts_inhibiter& /* inhibiter */)
+    {
+        LD(F("Reprogramming timer; firing on %s; now is %s") % next % now);
+        safe_setitimer(delay_until(next, now), NULL);
+        _timer_activation = next;
     }
 
 public:
@@ -240,22 +482,19 @@ public:
     ///
     /// \throw system_error If the programming fails.
     global_state(signals::timer* timer, const datetime::timestamp& now) :
-        _timer_activation(timer->when())
+        _wheel(now)
     {
-        PRE(now < timer->when());
-
         signals::interrupts_inhibiter inhibiter;
 
-        const datetime::delta delta = timer->when() - now;
         LD(F("Installing first timer; firing on %s; now is %s") %
            timer->when() % now);
 
         _sigalrm_programmer.reset(
             new signals::programmer(SIGALRM, sigalrm_handler));
         try {
-            safe_setitimer(delta, &_old_timeval);
+            safe_setitimer(delay_until(timer->when(), now), &_old_timeval);
             _timer_activation = timer->when();
-            add_to_all_timers(timer);
+            _wheel.add(timer);
         } catch (...) {
             _sigalrm_programmer.reset();
             throw;
@@ -294,19 +533,24 @@ public:
     {
         signals::interrupts_inhibiter inhibiter;
 
-        add_to_all_timers(timer);
-        reprogram_system_timer(now, inhibiter);
+        _wheel.add(timer);
+        if (!_timer_activation || now > _timer_activation.get()) {
+            // The system timer is either idle or has already gone off without
+            // us having processed it yet; make sure it fires again.
+            arm(_wheel.next_activation().get(), now, inhibiter);
+        } else if (timer->when() < _timer_activation.get()) {
+            arm(timer->when(), now, inhibiter);
+        }
     }
 
     /// Unprograms a timer.
     ///
-    /// This removes the timer from the global state and reprograms the global
-    /// system timer if necessary.
+    /// This removes the timer from the global state but does not touch the
+    /// global system timer.
     ///
     /// \param timer The timer to unprogram.
     ///
-    /// \return True if the system interval timer has been reprogrammed to
-    /// another future timer; false if there are no more active timers.
+    /// \return True if there are other active timers; false otherwise.
     bool
     unprogram(signals::timer* timer)
     {
@@ -314,13 +558,8 @@ public:
 
         LD(F("Unprogramming timer; previously firing on %s") % timer->when());
 
-        remove_from_all_timers(timer);
-        if (_all_timers.empty()) {
-            return false;
-        } else {
-            reprogram_system_timer(datetime::timestamp::now(), inhibiter);
-            return true;
-        }
+        _wheel.remove(timer);
+        return !_wheel.empty();
     }
 
     /// Executes active timers.
@@ -334,8 +573,14 @@ public:
         timers_vector to_run;
         {
             signals::interrupts_inhibiter inhibiter;
-            to_run = compute_timers_to_run_and_prune_old(now, inhibiter);
-            reprogram_system_timer(now, inhibiter);
+            to_run = _wheel.expire(now);
+
+            const optional< datetime::timestamp > next =
+                _wheel.next_activation();
+            if (next)
+                arm(next.get(), now, inhibiter);
+            else
+                _timer_activation = none;
         }
 
         for (timers_vector::iterator iter = to_run.begin();
@@ -529,7 +774,9 @@ signals::timer::unprogram(void)
         return;
     }
 
-    if (!globals->unprogram(this)) {
+    // The global state may be gone already if this timer fired and all other
+    // timers were unprogrammed in the meantime.
+    if (globals.get() != NULL && !globals->unprogram(this)) {
         globals.reset();
     }
     _pimpl->programmed = false;
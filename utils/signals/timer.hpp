@@ -31,7 +31,9 @@
 ///
 /// The timer module and class implement a mechanism to program multiple timers
 /// concurrently by using a deadline scheduler and leveraging the "single timer"
-/// features of the underlying operating system.
+/// features of the underlying operating system.  Pending timers are kept in a
+/// hierarchical timing wheel so that programming and unprogramming them is
+/// cheap even when many are active at once.
 
 #if !defined(UTILS_SIGNALS_TIMER_HPP)
 #define UTILS_SIGNALS_TIMER_HPP
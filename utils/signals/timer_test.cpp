@@ -357,6 +357,41 @@ ATF_TEST_CASE_BODY(reprogram_from_scratch)
 }
 
 
+ATF_TEST_CASE(multiprogram_across_wheel_levels);
+ATF_TEST_CASE_HEAD(multiprogram_across_wheel_levels)
+{
+    set_md_var("descr", "Ensures that timers far enough in the future to "
+               "be stored in the outer levels of the timing wheel fire in "
+               "order with respect to closer timers");
+    set_md_var("timeout", "20");
+}
+ATF_TEST_CASE_BODY(multiprogram_across_wheel_levels)
+{
+    std::vector< signals::timer* > timers;
+    std::vector< int > items;
+
+    timers.push_back(new delayed_inserter(
+                         datetime::delta(1, 300000), items, 3));
+    timers.push_back(new delayed_inserter(
+                         datetime::delta(0, 50000), items, 1));
+    timers.push_back(new delayed_inserter(
+                         datetime::delta(1, 250000), items, 2));
+    timers.push_back(new delayed_inserter(
+                         datetime::delta(100000, 0), items, 4));
+
+    // Cancel the timer that lives in the outermost level; it must not fire.
+    timers[3]->unprogram(); delete timers[3]; timers.erase(timers.begin() + 3);
+
+    wait_timers(timers);
+
+    std::vector< int > exp_items;
+    exp_items.push_back(1);
+    exp_items.push_back(2);
+    exp_items.push_back(3);
+    ATF_REQUIRE_EQ(exp_items, items);
+}
+
+
 ATF_TEST_CASE(unprogram);
 ATF_TEST_CASE_HEAD(unprogram)
 {
@@ -371,6 +406,26 @@ ATF_TEST_CASE_BODY(unprogram)
 }
 
 
+ATF_TEST_CASE(unprogram_after_firing);
+ATF_TEST_CASE_HEAD(unprogram_after_firing)
+{
+    set_md_var("timeout", "10");
+}
+ATF_TEST_CASE_BODY(unprogram_after_firing)
+{
+    std::vector< signals::timer* > timers;
+    for (int i = 0; i < 3; ++i)
+        timers.push_back(new signals::timer(datetime::delta(0, 10000)));
+    wait_timers(timers);
+
+    for (std::vector< signals::timer* >::iterator iter = timers.begin();
+         iter != timers.end(); ++iter) {
+        (*iter)->unprogram();
+        delete *iter;
+    }
+}
+
+
 ATF_TEST_CASE(infinitesimal);
 ATF_TEST_CASE_HEAD(infinitesimal)
 {
@@ -421,6 +476,8 @@ ATF_INIT_TEST_CASES(tcs)
     ATF_ADD_TEST_CASE(tcs, multiprogram_and_expire_before_activations);
     ATF_ADD_TEST_CASE(tcs, expire_before_firing);
     ATF_ADD_TEST_CASE(tcs, reprogram_from_scratch);
+    ATF_ADD_TEST_CASE(tcs, multiprogram_across_wheel_levels);
     ATF_ADD_TEST_CASE(tcs, unprogram);
+    ATF_ADD_TEST_CASE(tcs, unprogram_after_firing);
     ATF_ADD_TEST_CASE(tcs, infinitesimal);
 }
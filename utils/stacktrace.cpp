@@ -271,22 +271,30 @@ utils::unlimit_core_size(void)
 }
 
 
-/// Gathers a stacktrace of a crashed program.
+/// Starts gathering a stacktrace of a crashed program.
+///
+/// The debugger runs asynchronously as a followup of the crashed program so
+/// that it has access to the program's work directory, which will hold on to
+/// it until the debugger terminates.  The caller is responsible for waiting
+/// for the returned handle and for passing the result to finish_stacktrace().
 ///
 /// \param program The name of the binary that crashed and dumped a core file.
 ///     Can be either absolute or relative.
-/// \param executor_handle The executor handler to get the status from and
-///     gdb handler from.
+/// \param executor_handle The executor handler to spawn gdb from.
 /// \param exit_handle The exit handler to stream additional diagnostic
 ///     information from (stderr) and for redirecting to additional
 ///     information to gdb from.
 ///
+/// \return The handle of the gdb subprocess, or none if the stacktrace cannot
+/// be gathered.  In the latter case, the reason has already been written to the
+/// output.
+///
 /// \post If anything goes wrong, the diagnostic messages are written to the
 /// output.  This function should not throw.
-void
-utils::dump_stacktrace(const fs::path& program,
-                       executor::executor_handle& executor_handle,
-                       const executor::exit_handle& exit_handle)
+optional< executor::exec_handle >
+utils::start_stacktrace(const fs::path& program,
+                        executor::executor_handle& executor_handle,
+                        const executor::exit_handle& exit_handle)
 {
     PRE(exit_handle.status());
     const process::status& status = exit_handle.status().get();
@@ -296,7 +304,7 @@ utils::dump_stacktrace(const fs::path& program,
     if (!gdb_err) {
         LW(F("Failed to open %s to append GDB's output") %
            exit_handle.stderr_file());
-        return;
+        return none;
     }
 
     gdb_err << F("Process with PID %s exited with signal %s and dumped core; "
@@ -307,23 +315,40 @@ utils::dump_stacktrace(const fs::path& program,
     if (!gdb) {
         gdb_err << F("Cannot find GDB binary; builtin was '%s'\n") %
             builtin_gdb;
-        return;
+        return none;
     }
 
     const optional< fs::path > core_file = find_core(
         program, status, exit_handle.work_directory());
     if (!core_file) {
         gdb_err << F("Cannot find any core file\n");
-        return;
+        return none;
     }
 
-    gdb_err.flush();
-    const executor::exec_handle exec_handle =
-        executor_handle.spawn_followup(
-            run_gdb(gdb.get(), program, core_file.get()),
-            exit_handle, gdb_timeout);
-    const executor::exit_handle gdb_exit_handle =
-        executor_handle.wait(exec_handle);
+    gdb_err.close();
+    return utils::make_optional(executor_handle.spawn_followup(
+        run_gdb(gdb.get(), program, core_file.get()),
+        exit_handle, gdb_timeout));
+}
+
+
+/// Completes the gathering of a stacktrace started by start_stacktrace().
+///
+/// \param gdb_exit_handle The exit handle of the gdb subprocess.  Its output
+///     files are shared with the crashed program.
+///
+/// \post If anything goes wrong, the diagnostic messages are written to the
+/// output.  This function should not throw.
+void
+utils::finish_stacktrace(const executor::exit_handle& gdb_exit_handle)
+{
+    std::ofstream gdb_err(gdb_exit_handle.stderr_file().c_str(),
+                          std::ios::app);
+    if (!gdb_err) {
+        LW(F("Failed to open %s to append GDB's output") %
+           gdb_exit_handle.stderr_file());
+        return;
+    }
 
     const optional< process::status >& gdb_status = gdb_exit_handle.status();
     if (!gdb_status) {
@@ -339,6 +364,32 @@ utils::dump_stacktrace(const fs::path& program,
 }
 
 
+/// Gathers a stacktrace of a crashed program.
+///
+/// \param program The name of the binary that crashed and dumped a core file.
+///     Can be either absolute or relative.
+/// \param executor_handle The executor handler to get the status from and
+///     gdb handler from.
+/// \param exit_handle The exit handler to stream additional diagnostic
+///     information from (stderr) and for redirecting to additional
+///     information to gdb from.
+///
+/// \post If anything goes wrong, the diagnostic messages are written to the
+/// output.  This function should not throw.
+void
+utils::dump_stacktrace(const fs::path& program,
+                       executor::executor_handle& executor_handle,
+                       const executor::exit_handle& exit_handle)
+{
+    const optional< executor::exec_handle > exec_handle = start_stacktrace(
+        program, executor_handle, exit_handle);
+    if (!exec_handle)
+        return;
+
+    finish_stacktrace(executor_handle.wait(exec_handle.get()));
+}
+
+
 /// Gathers a stacktrace of a program if it crashed.
 ///
 /// This is just a convenience function to allow appending the stacktrace to an
@@ -528,6 +528,70 @@ ATF_TEST_CASE_BODY(dump_stacktrace__gdb_timeout)
 }
 
 
+ATF_TEST_CASE_WITHOUT_HEAD(start_stacktrace__async);
+ATF_TEST_CASE_BODY(start_stacktrace__async)
+{
+    utils::setenv("PATH", ".");
+    create_script("fake-gdb", "echo 'frame 1'; exit 0");
+    utils::builtin_gdb = "fake-gdb";
+
+    executor::executor_handle handle = executor::setup();
+    executor::exit_handle exit_handle = generate_core(this, "short", handle);
+
+    const executor::exec_handle other_handle = handle.spawn(
+        child_pause, datetime::delta(0, 500000), none, none, none);
+
+    const optional< executor::exec_handle > gdb_handle =
+        utils::start_stacktrace(fs::path("short"), handle, exit_handle);
+    ATF_REQUIRE(gdb_handle);
+    ATF_REQUIRE(atf::utils::grep_file("exited with signal [0-9]* and dumped",
+                                      exit_handle.stderr_file().str()));
+    ATF_REQUIRE(!atf::utils::grep_file("GDB exited successfully",
+                                       exit_handle.stderr_file().str()));
+
+    // The debugger must not prevent other subprocesses from being waited for,
+    // and its output must not become visible until it is finished.
+    executor::exit_handle gdb_exit_handle = handle.wait_any();
+    if (gdb_exit_handle.original_pid() == other_handle.pid()) {
+        gdb_exit_handle.cleanup();
+        gdb_exit_handle = handle.wait(gdb_handle.get());
+    } else {
+        ATF_REQUIRE_EQ(gdb_handle.get().pid(), gdb_exit_handle.original_pid());
+        handle.wait(other_handle).cleanup();
+    }
+    ATF_REQUIRE(fs::exists(exit_handle.work_directory()));
+    utils::finish_stacktrace(gdb_exit_handle);
+
+    ATF_REQUIRE(atf::utils::grep_file("^frame 1$",
+                                      exit_handle.stderr_file().str()));
+    ATF_REQUIRE(atf::utils::grep_file("GDB exited successfully",
+                                      exit_handle.stderr_file().str()));
+
+    exit_handle.cleanup();
+    handle.cleanup();
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(start_stacktrace__cannot_find_gdb);
+ATF_TEST_CASE_BODY(start_stacktrace__cannot_find_gdb)
+{
+    utils::setenv("PATH", ".");
+    utils::builtin_gdb = "missing-gdb";
+
+    executor::executor_handle handle = executor::setup();
+    executor::exit_handle exit_handle = generate_core(this, "short", handle);
+
+    ATF_REQUIRE(!utils::start_stacktrace(fs::path("fake"), handle,
+                                         exit_handle));
+    ATF_REQUIRE(atf::utils::grep_file(
+                    "Cannot find GDB binary; builtin was 'missing-gdb'",
+                    exit_handle.stderr_file().str()));
+
+    exit_handle.cleanup();
+    handle.cleanup();
+}
+
+
 ATF_TEST_CASE_WITHOUT_HEAD(dump_stacktrace_if_available__append);
 ATF_TEST_CASE_BODY(dump_stacktrace_if_available__append)
 {
@@ -614,6 +678,9 @@ ATF_INIT_TEST_CASES(tcs)
     ATF_ADD_TEST_CASE(tcs, dump_stacktrace__gdb_fail);
     ATF_ADD_TEST_CASE(tcs, dump_stacktrace__gdb_timeout);
 
+    ATF_ADD_TEST_CASE(tcs, start_stacktrace__async);
+    ATF_ADD_TEST_CASE(tcs, start_stacktrace__cannot_find_gdb);
+
     ATF_ADD_TEST_CASE(tcs, dump_stacktrace_if_available__append);
     ATF_ADD_TEST_CASE(tcs, dump_stacktrace_if_available__no_status);
     ATF_ADD_TEST_CASE(tcs, dump_stacktrace_if_available__no_coredump);